@@ -23,6 +23,8 @@
  *************************************************************************/
 
 #include "bp/bplib.h"
+#include "udpcl.h"
+#include "tcpcl.h"
 
 /*************************************************************************
  * Defines
@@ -47,6 +49,10 @@ typedef struct {
     int         data_port;    
     char        dacs_ip_addr[PARM_STR_SIZE];
     int         dacs_port;    
+    int         batch;          /* datagrams per system call, 0 uses sock.c */
+    int         udpcl_options;  /* UDPCL_GSO, UDPCL_GRO */
+    bool        use_tcp;        /* data and custody share one tcp:// connection */
+    tcpcl_t*    tcpcl;
 } thread_parm_t;
 
 #endif /* __bpio_h__ */
\ No newline at end of file
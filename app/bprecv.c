@@ -27,11 +27,14 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 #include "bp/bplib.h"
 #include "bp/bplib_store_ram.h"
 
 #include "sock.h"
+#include "udpcl.h"
+#include "tcpcl.h"
 #include "bpio.h"
 
 /*************************************************************************
@@ -52,8 +55,11 @@ static bp_store_t storage_service =
     .release    = bplib_store_ram_release,
     .relinquish = bplib_store_ram_relinquish,
     .getcount   = bplib_store_ram_getcount,
+    .relinquish_batch = bplib_store_ram_relinquish_batch,
 };
 
+static bool quiet = false; /* count payloads instead of writing them */
+
 /******************************************************************************
  * Local Functions
  ******************************************************************************/
@@ -147,12 +153,61 @@ static void* reader_thread (void* parm)
     return NULL;
 }
 
+/*
+ * batch_reader_thread - Reads batches of bundles from socket and processes them
+ */
+static void* batch_reader_thread (void* parm)
+{
+    thread_parm_t* info = (thread_parm_t*)parm;
+
+    /* Open Convergence Layer */
+    udpcl_t* cl = udpclopen(info->data_ip_addr, info->data_port, true, info->batch, BP_DEFAULT_MAX_LENGTH, info->udpcl_options);
+    if(cl == NULL)
+    {
+        fprintf(stderr, "Connection unavailable... exiting reader thread\n");
+        return NULL;
+    }
+
+    /* Read Loop */
+    while(app_running)
+    {
+        /* Read Batch */
+        int count = udpclrecv(cl, SOCK_TIMEOUT);
+        if(count > 0)
+        {
+            int i;
+            for(i = 0; i < count; i++)
+            {
+                uint32_t flags = 0;
+                int lib_status = bplib_process(info->bpc, cl->bundles[i], cl->sizes[i], BP_CHECK, &flags);
+                if(lib_status != BP_SUCCESS)
+                {
+                    fprintf(stderr, "Failed (%d) to process bundle [%08X]\n", lib_status, flags);
+                }
+            }
+        }
+        else if(count != 0)
+        {
+            fprintf(stderr, "Failed (%d) to receive bundles over socket: %s\n", count, strerror(errno));
+        }
+    }
+
+    /* Close Convergence Layer */
+    udpclclose(cl);
+
+    return NULL;
+}
+
 /*
  * writer_thread - Accepts payloads and writes them to stdout
  */
 static void* writer_thread (void* parm)
 {
     thread_parm_t* info = (thread_parm_t*)parm;
+    struct timespec last_report;
+    int payloads = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &last_report);
 
     /* Reader Loop */
     while(app_running)
@@ -166,7 +221,8 @@ static void* writer_thread (void* parm)
         if(lib_status == BP_SUCCESS)
         {
             /* Write Line */
-            fprintf(stdout, "%s", payload);
+            if(!quiet) fprintf(stdout, "%s", payload);
+            payloads++;
 
             /* Acknowledge PAyload */
             bplib_ackpayload(info->bpc, payload);
@@ -175,6 +231,20 @@ static void* writer_thread (void* parm)
         {
             fprintf(stderr, "Failed (%d) to accept payload [%08X]\n", lib_status, flags);
         }
+
+        /* Report Payload Rate */
+        if(quiet)
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            double secs = (double)(now.tv_sec - last_report.tv_sec) + ((double)(now.tv_nsec - last_report.tv_nsec) / 1000000000.0);
+            if(secs >= 1.0)
+            {
+                if(payloads > 0) fprintf(stderr, "%.0lf payloads per second\n", payloads / secs);
+                last_report = now;
+                payloads = 0;
+            }
+        }
     }
 
     return NULL;
@@ -231,6 +301,87 @@ static void* custody_thread (void* parm)
     return NULL;
 }
 
+/*
+ * tcp_reader_thread - Reads bundles from the connection and processes them
+ */
+static void* tcp_reader_thread (void* parm)
+{
+    thread_parm_t* info = (thread_parm_t*)parm;
+
+    /* Read Loop */
+    while(app_running)
+    {
+        void* bundle = NULL;
+        int bundle_size = 0;
+
+        int status = tcpclrecv(info->tcpcl, &bundle, &bundle_size, SOCK_TIMEOUT);
+        if(status > 0)
+        {
+            uint32_t flags = 0;
+            int lib_status = bplib_process(info->bpc, bundle, bundle_size, BP_CHECK, &flags);
+            if(lib_status != BP_SUCCESS)
+            {
+                fprintf(stderr, "Failed (%d) to process bundle [%08X]\n", lib_status, flags);
+            }
+        }
+        else if(status == SOCK_INVALID)
+        {
+            fprintf(stderr, "Connection lost... exiting reader thread\n");
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * tcp_custody_thread - Load custody acknowledgements as the peer keeps up and write them to the connection
+ */
+static void* tcp_custody_thread (void* parm)
+{
+    thread_parm_t* info = (thread_parm_t*)parm;
+
+    /* Write Loop */
+    while(app_running)
+    {
+        void* dacs = NULL;
+        int dacs_size = 0;
+        uint32_t flags = 0;
+
+        /* Wait for Room in Window */
+        int ready = tcpclready(info->tcpcl, BPLIB_TIMEOUT);
+        if(ready == SOCK_INVALID)
+        {
+            fprintf(stderr, "Connection lost... exiting custody thread\n");
+            break;
+        }
+        else if(ready == 0)
+        {
+            continue;
+        }
+
+        /* Load Bundle */
+        int lib_status = bplib_load(info->bpc, &dacs, &dacs_size, BPLIB_TIMEOUT, &flags);
+        if(lib_status == BP_SUCCESS)
+        {
+            /* Send Bundle */
+            if(tcpclsend(info->tcpcl, &dacs, &dacs_size, 1, SOCK_TIMEOUT) != 1)
+            {
+                fprintf(stderr, "Failed to send dacs over connection\n");
+            }
+
+            /* Acknowledge bundle */
+            bplib_ackbundle(info->bpc, dacs);
+        }
+        else if(lib_status != BP_TIMEOUT)
+        {
+            fprintf(stderr, "Failed (%d) to load dacs [%08X]\n", lib_status, flags);
+        }
+    }
+
+    return NULL;
+}
+
 /******************************************************************************
  * Main
  ******************************************************************************/
@@ -244,7 +395,11 @@ int main(int argc, char *argv[])
         .data_ip_addr   = DFLT_DATA_IP_ADDR,
         .data_port      = DFLT_DATA_PORT,
         .dacs_ip_addr   = DFLT_DACS_IP_ADDR,
-        .dacs_port      = DFLT_DACS_PORT
+        .dacs_port      = DFLT_DACS_PORT,
+        .batch          = 0,
+        .udpcl_options  = 0,
+        .use_tcp        = false,
+        .tcpcl          = NULL
     };
 
     int i;
@@ -269,7 +424,11 @@ int main(int argc, char *argv[])
     fprintf(stderr, "\n                                      BP Receive                                             ");
     fprintf(stderr, "\n*********************************************************************************************");
     fprintf(stderr, "\n bprecv [options] ipn:<node>.<service> data://<ip address>:<port> dacs://<ip address>:<port> ");
+    fprintf(stderr, "\n bprecv [options] ipn:<node>.<service> tcp://<ip address>:<port>                              ");
     fprintf(stderr, "\n   --dacsrate <r>: sets DACS rate of BP agent to r                                           ");
+    fprintf(stderr, "\n   --batch <b>: receives up to b datagrams per system call                                   ");
+    fprintf(stderr, "\n   --gro: receives datagrams coalesced by the kernel (with --batch)                          ");
+    fprintf(stderr, "\n   --quiet: reports payloads per second instead of writing payloads to stdout                ");
     fprintf(stderr, "\n                                                                                             ");
     fprintf(stderr, "\n   Creates a local BP agent with a local endpoint ID of:                                     ");
     fprintf(stderr, "\n                                                                                             ");
@@ -278,7 +437,8 @@ int main(int argc, char *argv[])
     fprintf(stderr, "\n   A socket is bound to the ip address and port number provided on the                       ");
     fprintf(stderr, "\n   command line, and anything read from the socket treated as a bundle and                   ");
     fprintf(stderr, "\n   processed by the BP Agent.  All payloads retrieved from the bundles are                   ");
-    fprintf(stderr, "\n   writeen to stdout.                                                                        ");
+    fprintf(stderr, "\n   writeen to stdout.  With tcp:// a connection is accepted on the ip address and            ");
+    fprintf(stderr, "\n   port number, and bundles and custody acknowledgements share that connection.              ");
     fprintf(stderr, "\n                                                                                             ");
     fprintf(stderr, "\n   Example usage:                                                                            ");
     fprintf(stderr, "\n                                                                                             ");
@@ -295,6 +455,18 @@ int main(int argc, char *argv[])
         {
             dacs_rate = (int)strtol(argv[++i], NULL, 0);
         }
+        else if(strcmp(argv[i],"--batch") == 0)
+        {
+            info.batch = (int)strtol(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i],"--gro") == 0)
+        {
+            info.udpcl_options |= UDPCL_GRO;
+        }
+        else if(strcmp(argv[i],"--quiet") == 0)
+        {
+            quiet = true;
+        }
         else if(strstr(argv[i], "ipn") != NULL)
         {
             char* serv_str = strrchr(parm, '.');
@@ -306,6 +478,18 @@ int main(int argc, char *argv[])
             node_str++;
             src_node = (int)strtol(node_str, NULL, 0);
         }
+        else if(strstr(argv[i], "tcp") != NULL)
+        {
+            char* port_str = strrchr(parm, ':');
+            *port_str = '\0';
+            port_str++;
+            info.data_port = (int)strtol(port_str, NULL, 0);
+
+            char* ip_str = strrchr(parm, '/');
+            ip_str++;
+            snprintf(info.data_ip_addr, PARM_STR_SIZE, "%s", ip_str);
+            info.use_tcp = true;
+        }
         else if(strstr(argv[i], "data") != NULL)
         {
             char* port_str = strrchr(parm, ':');
@@ -334,8 +518,15 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* Check Command Line Options */
+    if(info.batch < 0 || info.batch > UDPCL_MAX_BATCH)
+    {
+        fprintf(stderr, "Invalid batch size %d, must be between 1 and %d... exiting\n", info.batch, UDPCL_MAX_BATCH);
+        return -1;
+    }
+
     /* Echo Command Line Options */
-    fprintf(stderr, "Creating BP agent at ipn:%d.%d to receiving bundles over udp://%s:%d\n", src_node, src_serv, info.data_ip_addr, info.data_port);
+    fprintf(stderr, "Creating BP agent at ipn:%d.%d to receiving bundles over %s://%s:%d\n", src_node, src_serv, info.use_tcp ? "tcp" : "udp", info.data_ip_addr, info.data_port);
 
     /* Initialize bplib */
     bplib_init();
@@ -355,9 +546,22 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    /* Accept Connection from Sender */
+    while(info.use_tcp && info.tcpcl == NULL && app_running)
+    {
+        info.tcpcl = tcpclopen(info.data_ip_addr, info.data_port, true, BP_DEFAULT_MAX_LENGTH, TCPCL_DEFAULT_WINDOW);
+    }
+    if(info.use_tcp && info.tcpcl == NULL)
+    {
+        bplib_close(info.bpc);
+        return -1;
+    }
+
     /* Create Reader Thread */
     pthread_t read_pid;
-    pthread_create(&read_pid, NULL, &reader_thread, &info);
+    if(info.use_tcp)            pthread_create(&read_pid, NULL, &tcp_reader_thread, &info);
+    else if(info.batch > 0)     pthread_create(&read_pid, NULL, &batch_reader_thread, &info);
+    else                        pthread_create(&read_pid, NULL, &reader_thread, &info);
 
     /* Create Writer Thread */
     pthread_t write_pid;
@@ -365,12 +569,18 @@ int main(int argc, char *argv[])
 
     /* Create Custody Thread */
     pthread_t custody_pid;
-    pthread_create(&custody_pid, NULL, &custody_thread, &info);
+    pthread_create(&custody_pid, NULL, info.use_tcp ? &tcp_custody_thread : &custody_thread, &info);
 
-    /* Idle Loop */
+    /* Idle Loop - Generate Custody Signals */
     while(app_running)
     {
-        sleep(1);
+        uint32_t flags = 0;
+        int lib_status = bplib_custody(info.bpc, BPLIB_TIMEOUT, &flags);
+        if(lib_status != BP_SUCCESS && lib_status != BP_TIMEOUT)
+        {
+            fprintf(stderr, "Failed (%d) to generate custody signals [%08X]\n", lib_status, flags);
+            sleep(1);
+        }
     }
 
     /* Join Threads */
@@ -386,6 +596,15 @@ int main(int argc, char *argv[])
         fprintf(stderr, "Failed (%d) to join writer thread: %s\n", write_rc, strerror(write_rc));
     }
 
+    int custody_rc = pthread_join(custody_pid, NULL);
+    if(custody_rc != 0)
+    {
+        fprintf(stderr, "Failed (%d) to join custody thread: %s\n", custody_rc, strerror(custody_rc));
+    }
+
+    /* Close Connection */
+    tcpclclose(info.tcpcl);
+
     /* Close bplib Channel */
     bplib_close(info.bpc);
 
@@ -27,13 +27,23 @@
 #include <pthread.h>
 #include <unistd.h>
 #include <errno.h>
+#include <time.h>
 
 #include "bp/bplib.h"
 #include "bp/bplib_store_ram.h"
 
 #include "sock.h"
+#include "udpcl.h"
+#include "tcpcl.h"
 #include "bpio.h"
 
+/*************************************************************************
+ * Defines
+ *************************************************************************/
+
+#define MAX_PAYLOAD_SIZE    2048 /* leaves room for headers in a BP_DEFAULT_MAX_LENGTH bundle */
+#define DFLT_TCP_BATCH      64
+
 /*************************************************************************
  * File Data
  *************************************************************************/
@@ -52,15 +62,79 @@ static bp_store_t storage_service =
     .release    = bplib_store_ram_release,
     .relinquish = bplib_store_ram_relinquish,
     .getcount   = bplib_store_ram_getcount,
+    .relinquish_batch = bplib_store_ram_relinquish_batch,
 };
 
 static int msgs = 0;
 static int acks = 0;
 
+static int payload_count = 0; /* number of payloads generated, 0 reads stdin */
+static int payload_size = 64;
+static struct timespec start_time;
+
 /******************************************************************************
  * Local Functions
  ******************************************************************************/
 
+/*
+ * process_dacs - Processes a custody acknowledgement and updates the acknowledged count
+ */
+static void process_dacs(thread_parm_t* info, void* dacs, int dacs_size)
+{
+    uint32_t flags = 0;
+    int lib_status = bplib_process(info->bpc, dacs, dacs_size, BP_CHECK, &flags);
+    if(lib_status == BP_SUCCESS)
+    {
+        bp_stats_t stats;
+        bplib_latchstats(info->bpc, &stats);
+        acks = stats.acknowledged_bundles;
+
+        /* Report Throughput of Generated Payloads */
+        if(payload_count > 0 && acks >= payload_count && app_running)
+        {
+            struct timespec stop_time;
+            clock_gettime(CLOCK_MONOTONIC, &stop_time);
+            double secs = (double)(stop_time.tv_sec - start_time.tv_sec) + ((double)(stop_time.tv_nsec - start_time.tv_nsec) / 1000000000.0);
+            fprintf(stderr, "%d bundles of %d bytes acknowledged in %.3lf seconds: %.0lf bundles per second\n", acks, payload_size, secs, acks / secs);
+            app_running = false;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Failed (%d) to process dacs [%08X]\n", lib_status, flags);
+    }
+}
+
+/*
+ * load_batch - Loads up to max bundles, only waiting for the first
+ */
+static int load_batch(thread_parm_t* info, void** bundles, int* sizes, int max)
+{
+    int timeout = BPLIB_TIMEOUT;
+    int count = 0;
+
+    while(count < max)
+    {
+        uint32_t flags = 0;
+        int lib_status = bplib_load(info->bpc, &bundles[count], &sizes[count], timeout, &flags);
+        if(lib_status == BP_SUCCESS)
+        {
+            timeout = BP_CHECK;
+            count++;
+        }
+        else
+        {
+            if(lib_status != BP_TIMEOUT)
+            {
+                fprintf(stderr, "Failed (%d) to load bundle [%08X]\n", lib_status, flags);
+            }
+            break;
+        }
+    }
+
+    return count;
+}
+
 /*
  * app_quick_exit - Signal handler for Control-C
  */
@@ -142,6 +216,38 @@ static void* reader_thread (void* parm)
     return NULL;
 }
 
+/*
+ * generator_thread - Stores a fixed number of generated payloads as bundles
+ */
+static void* generator_thread (void* parm)
+{
+    static char payload[MAX_PAYLOAD_SIZE];
+
+    thread_parm_t* info = (thread_parm_t*)parm;
+
+    memset(payload, 'B', payload_size);
+    payload[payload_size - 1] = '\n';
+
+    /* Generator Loop */
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    while(app_running && msgs < payload_count)
+    {
+        uint32_t flags = 0;
+        int lib_status = bplib_store(info->bpc, payload, payload_size, BPLIB_TIMEOUT, &flags);
+        if(lib_status == BP_SUCCESS)
+        {
+            msgs++;
+        }
+        else if(lib_status != BP_TIMEOUT)
+        {
+            fprintf(stderr, "Failed (%d) to store payload [%08X]\n", lib_status, flags);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
 /*
  * writer_thread - Loads bundles from storage and writes them to socket
  */
@@ -193,6 +299,53 @@ static void* writer_thread (void* parm)
     return NULL;
 }
 
+/*
+ * batch_writer_thread - Loads batches of bundles from storage and writes them to socket
+ */
+static void* batch_writer_thread (void* parm)
+{
+    static void* bundles[UDPCL_MAX_BATCH];
+    static int sizes[UDPCL_MAX_BATCH];
+
+    thread_parm_t* info = (thread_parm_t*)parm;
+
+    /* Open Convergence Layer */
+    udpcl_t* cl = udpclopen(info->data_ip_addr, info->data_port, false, info->batch, BP_DEFAULT_MAX_LENGTH, info->udpcl_options);
+    if(cl == NULL)
+    {
+        fprintf(stderr, "Connection unavailable... exiting writer thread\n");
+        return NULL;
+    }
+
+    /* Write Loop */
+    while(app_running)
+    {
+        int count = load_batch(info, bundles, sizes, info->batch);
+        int i;
+
+        if(count > 0)
+        {
+            /* Send Batch */
+            int sent = udpclsend(cl, bundles, sizes, count, SOCK_TIMEOUT);
+            if(sent != count)
+            {
+                fprintf(stderr, "Failed (%d) to send %d bundles over socket: %s\n", sent, count, strerror(errno));
+            }
+
+            /* Acknowledge Bundles */
+            for(i = 0; i < count; i++)
+            {
+                bplib_ackbundle(info->bpc, bundles[i]);
+            }
+        }
+    }
+
+    /* Close Convergence Layer */
+    udpclclose(cl);
+
+    return NULL;
+}
+
 /*
  * custody_thread - Receive and process custody acknowledgements
  */
@@ -213,23 +366,11 @@ static void* custody_thread (void* parm)
     /* Write Loop */
     while(app_running && sock != SOCK_INVALID)
     {
-        uint32_t flags = 0;
-
         /* Read Socket */
         int bytes_recv = sockrecv(sock, dacs, BP_DEFAULT_MAX_LENGTH, SOCK_TIMEOUT);
         if(bytes_recv > 0)
         {
-            int lib_status = bplib_process(info->bpc, dacs, bytes_recv, BP_CHECK, &flags);
-            if(lib_status == BP_SUCCESS)
-            {
-                bp_stats_t stats;
-                bplib_latchstats(info->bpc, &stats);
-                acks = stats.acknowledged_bundles;
-            }
-            else
-            {
-                fprintf(stderr, "Failed (%d) to process dacs [%08X]\n", lib_status, flags);
-            }
+            process_dacs(info, dacs, bytes_recv);
         }
         else if(bytes_recv != 0)
         {
@@ -246,6 +387,84 @@ static void* custody_thread (void* parm)
     return NULL;
 }
 
+/*
+ * tcp_writer_thread - Loads bundles from storage as the peer keeps up and writes them to the connection
+ */
+static void* tcp_writer_thread (void* parm)
+{
+    static void* bundles[TCPCL_MAX_BATCH];
+    static int sizes[TCPCL_MAX_BATCH];
+
+    thread_parm_t* info = (thread_parm_t*)parm;
+    int batch = (info->batch > 0 && info->batch <= TCPCL_MAX_BATCH) ? info->batch : DFLT_TCP_BATCH;
+
+    /* Write Loop */
+    while(app_running)
+    {
+        /* Wait for Room in Window */
+        int ready = tcpclready(info->tcpcl, BPLIB_TIMEOUT);
+        if(ready == SOCK_INVALID)
+        {
+            fprintf(stderr, "Connection lost... exiting writer thread\n");
+            break;
+        }
+        else if(ready == 0)
+        {
+            continue;
+        }
+
+        /* Load Batch */
+        int count = load_batch(info, bundles, sizes, (ready < batch) ? ready : batch);
+        int i;
+
+        if(count > 0)
+        {
+            /* Send Batch */
+            int sent = tcpclsend(info->tcpcl, bundles, sizes, count, SOCK_TIMEOUT);
+            if(sent != count)
+            {
+                fprintf(stderr, "Failed (%d) to send %d bundles over connection\n", sent, count);
+            }
+
+            /* Acknowledge Bundles */
+            for(i = 0; i < count; i++)
+            {
+                bplib_ackbundle(info->bpc, bundles[i]);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * tcp_custody_thread - Receive and process custody acknowledgements from the connection
+ */
+static void* tcp_custody_thread (void* parm)
+{
+    thread_parm_t* info = (thread_parm_t*)parm;
+
+    /* Read Loop */
+    while(app_running)
+    {
+        void* dacs = NULL;
+        int dacs_size = 0;
+
+        int status = tcpclrecv(info->tcpcl, &dacs, &dacs_size, SOCK_TIMEOUT);
+        if(status > 0)
+        {
+            process_dacs(info, dacs, dacs_size);
+        }
+        else if(status == SOCK_INVALID)
+        {
+            fprintf(stderr, "Connection lost... exiting custody thread\n");
+            break;
+        }
+    }
+
+    return NULL;
+}
+
 /******************************************************************************
  * Main
  ******************************************************************************/
@@ -262,7 +481,11 @@ int main(int argc, char *argv[])
         .data_ip_addr   = DFLT_DATA_IP_ADDR,
         .data_port      = DFLT_DATA_PORT,
         .dacs_ip_addr   = DFLT_DACS_IP_ADDR,
-        .dacs_port      = DFLT_DACS_PORT
+        .dacs_port      = DFLT_DACS_PORT,
+        .batch          = 0,
+        .udpcl_options  = 0,
+        .use_tcp        = false,
+        .tcpcl          = NULL
     };
 
     int i;
@@ -294,10 +517,15 @@ int main(int argc, char *argv[])
     fprintf(stderr, "\n                                        BP Send                                              ");
     fprintf(stderr, "\n*********************************************************************************************");
     fprintf(stderr, "\n bpsend [options] ipn:<node>.<service> data://<ip address>:<port> dacs://<ip address>:<port> ");
+    fprintf(stderr, "\n bpsend [options] ipn:<node>.<service> tcp://<ip address>:<port>                              ");
     fprintf(stderr, "\n   --node <n>: overrides local node number of BP agent to n                                  ");
     fprintf(stderr, "\n   --service <s>: overrides local service number of BP agent to s                            ");
     fprintf(stderr, "\n   --timeout <t>: sets timeout of BP agent to t                                              ");
     fprintf(stderr, "\n   --lifetime <l>: sets lifetime of BP agent to l                                            ");
+    fprintf(stderr, "\n   --batch <b>: sends up to b bundles per system call                                        ");
+    fprintf(stderr, "\n   --gso: sends equally sized bundles as one datagram segmented by the kernel (with --batch)  ");
+    fprintf(stderr, "\n   --count <c>: sends c generated payloads instead of stdin and reports bundles per second   ");
+    fprintf(stderr, "\n   --size <s>: sets size of generated payloads to s bytes                                    ");
     fprintf(stderr, "\n                                                                                             ");
     fprintf(stderr, "\n   Creates a local BP agent with a source endpoint ID of:                                    ");
     fprintf(stderr, "\n                                                                                             ");
@@ -309,7 +537,8 @@ int main(int argc, char *argv[])
     fprintf(stderr, "\n   A connection is made to the ip address and port number provided on the                    ");
     fprintf(stderr, "\n   command line, and anything read from stdin is bundled and sent to the                     ");
     fprintf(stderr, "\n   destination endpoint ID specified by the ipn address provided on the                      ");
-    fprintf(stderr, "\n   command line.                                                                             ");
+    fprintf(stderr, "\n   command line.  With tcp:// bundles and custody acknowledgements share one                 ");
+    fprintf(stderr, "\n   connection to the ip address and port number, and --batch sets bundles per write.         ");
     fprintf(stderr, "\n                                                                                             ");
     fprintf(stderr, "\n   Example usage:                                                                            ");
     fprintf(stderr, "\n                                                                                             ");
@@ -330,6 +559,22 @@ int main(int argc, char *argv[])
         {
             src_serv = (int)strtol(argv[++i], NULL, 0);
         }
+        else if(strcmp(argv[i],"--batch") == 0)
+        {
+            info.batch = (int)strtol(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i],"--gso") == 0)
+        {
+            info.udpcl_options |= UDPCL_GSO;
+        }
+        else if(strcmp(argv[i],"--count") == 0)
+        {
+            payload_count = (int)strtol(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i],"--size") == 0)
+        {
+            payload_size = (int)strtol(argv[++i], NULL, 0);
+        }
         else if(strstr(argv[i], "ipn") != NULL)
         {
             char* serv_str = strrchr(parm, '.');
@@ -341,6 +586,18 @@ int main(int argc, char *argv[])
             node_str++;
             dst_node = (int)strtol(node_str, NULL, 0);
         }
+        else if(strstr(argv[i], "tcp") != NULL)
+        {
+            char* port_str = strrchr(parm, ':');
+            *port_str = '\0';
+            port_str++;
+            info.data_port = (int)strtol(port_str, NULL, 0);
+
+            char* ip_str = strrchr(parm, '/');
+            ip_str++;
+            snprintf(info.data_ip_addr, PARM_STR_SIZE, "%s", ip_str);
+            info.use_tcp = true;
+        }
         else if(strstr(argv[i], "data") != NULL)
         {
             char* port_str = strrchr(parm, ':');
@@ -369,8 +626,20 @@ int main(int argc, char *argv[])
         }
     }
 
+    /* Check Command Line Options */
+    if(info.batch < 0 || info.batch > UDPCL_MAX_BATCH)
+    {
+        fprintf(stderr, "Invalid batch size %d, must be between 1 and %d... exiting\n", info.batch, UDPCL_MAX_BATCH);
+        return -1;
+    }
+    else if(payload_size < 1 || payload_size > MAX_PAYLOAD_SIZE)
+    {
+        fprintf(stderr, "Invalid payload size %d, must be between 1 and %d... exiting\n", payload_size, MAX_PAYLOAD_SIZE);
+        return -1;
+    }
+
     /* Echo Command Line Options */
-    fprintf(stderr, "Creating BP agent at ipn:%d.%d and sending bundles to ipn:%d.%d over udp://%s:%d\n", src_node, src_serv, dst_node, dst_serv, info.data_ip_addr, info.data_port);
+    fprintf(stderr, "Creating BP agent at ipn:%d.%d and sending bundles to ipn:%d.%d over %s://%s:%d\n", src_node, src_serv, dst_node, dst_serv, info.use_tcp ? "tcp" : "udp", info.data_ip_addr, info.data_port);
 
     /* Initialize bplib */
     bplib_init();
@@ -392,17 +661,30 @@ int main(int argc, char *argv[])
         return -1;
     }
 
+    /* Connect to Receiver */
+    while(info.use_tcp && info.tcpcl == NULL && app_running)
+    {
+        info.tcpcl = tcpclopen(info.data_ip_addr, info.data_port, false, BP_DEFAULT_MAX_LENGTH, TCPCL_DEFAULT_WINDOW);
+    }
+    if(info.use_tcp && info.tcpcl == NULL)
+    {
+        bplib_close(info.bpc);
+        return -1;
+    }
+
     /* Create Reader Thread */
     pthread_t read_pid;
-    pthread_create(&read_pid, NULL, &reader_thread, &info);
+    pthread_create(&read_pid, NULL, (payload_count > 0) ? &generator_thread : &reader_thread, &info);
 
     /* Create Writer Thread */
     pthread_t write_pid;
-    pthread_create(&write_pid, NULL, &writer_thread, &info);
+    if(info.use_tcp)            pthread_create(&write_pid, NULL, &tcp_writer_thread, &info);
+    else if(info.batch > 0)     pthread_create(&write_pid, NULL, &batch_writer_thread, &info);
+    else                        pthread_create(&write_pid, NULL, &writer_thread, &info);
 
     /* Create Custody Thread */
     pthread_t custody_pid;
-    pthread_create(&custody_pid, NULL, &custody_thread, &info);
+    pthread_create(&custody_pid, NULL, info.use_tcp ? &tcp_custody_thread : &custody_thread, &info);
 
     /* Idle Loop */
     while(app_running)
@@ -423,6 +705,15 @@ int main(int argc, char *argv[])
         fprintf(stderr, "Failed (%d) to join writer thread: %s\n", write_rc, strerror(write_rc));
     }
 
+    int custody_rc = pthread_join(custody_pid, NULL);
+    if(custody_rc != 0)
+    {
+        fprintf(stderr, "Failed (%d) to join custody thread: %s\n", custody_rc, strerror(custody_rc));
+    }
+
+    /* Close Connection */
+    tcpclclose(info.tcpcl);
+
     /* Close bplib Channel */
     bplib_close(info.bpc);
 
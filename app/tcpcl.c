@@ -0,0 +1,473 @@
+/************************************************************************
+ * File: tcpcl.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "sock.h"
+#include "tcpcl.h"
+
+/******************************************************************************
+ * Defines
+ ******************************************************************************/
+
+#define TCPCL_READ_SIZE     0x10000 /* bytes read per system call beyond one bundle */
+
+/* Macros */
+#if SOCK_VERBOSE
+#define display_error(...)  printf(__VA_ARGS__)
+#else
+#define display_error(...) (void)0
+#endif
+
+/******************************************************************************
+ * Local Functions
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------*
+ * tcpclelapsed - seconds since time
+ *----------------------------------------------------------------------------*/
+static double tcpclelapsed(struct timespec* since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) + ((double)(now.tv_nsec - since->tv_nsec) / 1000000000.0);
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclheader - writes segment header
+ *----------------------------------------------------------------------------*/
+static void tcpclheader(uint8_t* header, uint8_t type, uint32_t length)
+{
+    header[0] = type;
+    header[1] = (uint8_t)(length >> 24);
+    header[2] = (uint8_t)(length >> 16);
+    header[3] = (uint8_t)(length >> 8);
+    header[4] = (uint8_t)length;
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclfail - marks connection as failed and wakes any thread waiting on it
+ *----------------------------------------------------------------------------*/
+static void tcpclfail(tcpcl_t* cl)
+{
+    pthread_mutex_lock(&cl->state_lock);
+    {
+        cl->failed = true;
+        pthread_cond_broadcast(&cl->state_cond);
+    }
+    pthread_mutex_unlock(&cl->state_lock);
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclwritev - writes all segments, caller holds tx_lock
+ *
+ * Notes: returns 1 when written, 0 when the socket was never writable before
+ *        the timeout, and SOCK_INVALID when the connection failed; once part
+ *        of a segment is written the rest must follow for the framing to
+ *        survive, so a stall after that point fails the connection
+ *----------------------------------------------------------------------------*/
+static int tcpclwritev(tcpcl_t* cl, struct iovec* iovs, int iovcnt, int timeout)
+{
+    bool started = false;
+
+    while(iovcnt > 0)
+    {
+        ssize_t c = writev(cl->fd, iovs, iovcnt);
+        if(c > 0)
+        {
+            /* Skip Written Vectors */
+            started = true;
+            while(iovcnt > 0 && (size_t)c >= iovs->iov_len)
+            {
+                c -= iovs->iov_len;
+                iovs++;
+                iovcnt--;
+            }
+
+            /* Advance Partially Written Vector */
+            if(iovcnt > 0)
+            {
+                iovs->iov_base = (uint8_t*)iovs->iov_base + c;
+                iovs->iov_len -= c;
+            }
+        }
+        else if(c < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            struct pollfd polllist[1];
+            polllist[0].fd = cl->fd;
+            polllist[0].events = POLLOUT;
+            polllist[0].revents = 0;
+
+            int activity = 0;
+            do activity = poll(polllist, 1, timeout);
+            while(activity == -1 && (errno == EINTR || errno == EAGAIN));
+
+            if(activity <= 0 || (polllist[0].revents & (POLLERR | POLLHUP)))
+            {
+                if(activity == 0 && !started) return 0;
+                display_error("Connection stalled writing %d segments\n", iovcnt);
+                tcpclfail(cl);
+                return SOCK_INVALID;
+            }
+        }
+        else
+        {
+            display_error("Failed (%d) to write segments: %s\n", (int)c, strerror(errno));
+            tcpclfail(cl);
+            return SOCK_INVALID;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &cl->last_tx);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclsignal - sends an acknowledgment or keepalive segment
+ *
+ * Notes: skipped when another thread is sending, since the receiving thread
+ *        must never wait on a sender that may itself be waiting on the peer
+ *----------------------------------------------------------------------------*/
+static bool tcpclsignal(tcpcl_t* cl, uint8_t type, uint32_t length)
+{
+    int status = 0;
+
+    if(pthread_mutex_trylock(&cl->tx_lock) == 0)
+    {
+        struct iovec iov;
+        tcpclheader(cl->headers[TCPCL_MAX_BATCH], type, length);
+        iov.iov_base = cl->headers[TCPCL_MAX_BATCH];
+        iov.iov_len = TCPCL_HEADER_SIZE;
+        status = tcpclwritev(cl, &iov, 1, SOCK_TIMEOUT);
+        pthread_mutex_unlock(&cl->tx_lock);
+    }
+
+    return status == 1;
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclack - acknowledges bundles received
+ *----------------------------------------------------------------------------*/
+static void tcpclack(tcpcl_t* cl, bool force)
+{
+    uint32_t unreported = cl->received - cl->reported;
+    if(unreported > 0 && (force || unreported >= (uint32_t)(cl->window / 2)))
+    {
+        if(tcpclsignal(cl, TCPCL_ACK_SEGMENT, cl->received))
+        {
+            cl->reported = cl->received;
+        }
+    }
+}
+
+/******************************************************************************
+ * Exported Functions
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------*
+ * tcpclopen
+ *
+ * Notes: a server waits up to a second for a client to connect
+ *----------------------------------------------------------------------------*/
+tcpcl_t* tcpclopen(const char* ip_addr, int port, int is_server, int max_size, int window)
+{
+    /* Check Parameters */
+    if(max_size < 1 || window < 1)
+    {
+        display_error("Invalid maximum bundle size (%d) or window (%d)\n", max_size, window);
+        return NULL;
+    }
+
+    /* Create Connection */
+    int fd = sockstream(ip_addr, port, is_server, NULL);
+    if(fd == SOCK_INVALID) return NULL;
+
+    /* Send Acknowledgments without Delay */
+    int optval = 1;
+    if(setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval)) < 0)
+    {
+        display_error("Failed to set TCP_NODELAY option on socket, %s\n", strerror(errno));
+    }
+
+    /* Allocate Convergence Layer */
+    tcpcl_t* cl = (tcpcl_t*)calloc(1, sizeof(tcpcl_t));
+    if(cl == NULL)
+    {
+        sockclose(fd);
+        return NULL;
+    }
+
+    cl->fd          = fd;
+    cl->max_size    = max_size;
+    cl->window      = window;
+    cl->failed      = false;
+    cl->rx_size     = TCPCL_HEADER_SIZE + max_size + TCPCL_READ_SIZE;
+    cl->rx_buffer   = (uint8_t*)malloc(cl->rx_size);
+    if(cl->rx_buffer == NULL)
+    {
+        sockclose(fd);
+        free(cl);
+        return NULL;
+    }
+
+    /* Initialize Locks */
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&cl->tx_lock, NULL);
+    pthread_mutex_init(&cl->state_lock, NULL);
+    pthread_cond_init(&cl->state_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    clock_gettime(CLOCK_MONOTONIC, &cl->last_tx);
+    cl->last_rx = cl->last_tx;
+
+    return cl;
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclready
+ *
+ * Notes: returns how many bundles can be sent before the window is full,
+ *        waiting for acknowledgments if none can; bundles are left in
+ *        storage until the peer keeps up
+ *----------------------------------------------------------------------------*/
+int tcpclready(tcpcl_t* cl, int timeout)
+{
+    int ready;
+
+    /* Calculate Deadline */
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout / 1000;
+    deadline.tv_nsec += (timeout % 1000) * 1000000;
+    if(deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&cl->state_lock);
+    {
+        while(!cl->failed && (cl->sent - cl->acked) >= (uint32_t)cl->window && timeout != SOCK_CHECK)
+        {
+            if(pthread_cond_timedwait(&cl->state_cond, &cl->state_lock, &deadline) == ETIMEDOUT) break;
+        }
+
+        if(cl->failed)                                          ready = SOCK_INVALID;
+        else if((cl->sent - cl->acked) >= (uint32_t)cl->window) ready = 0;
+        else                                                    ready = cl->window - (int)(cl->sent - cl->acked);
+    }
+    pthread_mutex_unlock(&cl->state_lock);
+
+    return ready;
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclsend
+ *
+ * Notes: writes each bundle as a data segment, many per system call;
+ *        returns number of bundles sent before the timeout
+ *----------------------------------------------------------------------------*/
+int tcpclsend(tcpcl_t* cl, void** bundles, int* sizes, int count, int timeout)
+{
+    int sent = 0;
+
+    if(cl->failed) return SOCK_INVALID;
+
+    pthread_mutex_lock(&cl->tx_lock);
+    {
+        while(sent < count)
+        {
+            int n = (count - sent < TCPCL_MAX_BATCH) ? (count - sent) : TCPCL_MAX_BATCH;
+            int v = 0;
+            int i;
+
+            /* Build Segments */
+            for(i = 0; i < n; i++)
+            {
+                tcpclheader(cl->headers[i], TCPCL_DATA_SEGMENT, (uint32_t)sizes[sent + i]);
+                cl->iovs[v].iov_base = cl->headers[i];
+                cl->iovs[v].iov_len = TCPCL_HEADER_SIZE;
+                v++;
+                cl->iovs[v].iov_base = bundles[sent + i];
+                cl->iovs[v].iov_len = sizes[sent + i];
+                v++;
+            }
+
+            /* Write Segments */
+            if(tcpclwritev(cl, cl->iovs, v, timeout) != 1) break;
+            sent += n;
+
+            pthread_mutex_lock(&cl->state_lock);
+            cl->sent += n;
+            pthread_mutex_unlock(&cl->state_lock);
+        }
+    }
+    pthread_mutex_unlock(&cl->tx_lock);
+
+    return (sent == 0 && cl->failed) ? SOCK_INVALID : sent;
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclrecv
+ *
+ * Notes: returns 1 when a bundle is received, 0 on timeout, and SOCK_INVALID
+ *        when the connection failed; the bundle is valid until the next call;
+ *        acknowledgment and keepalive segments are handled here, so one
+ *        thread must keep calling this function for the connection to make
+ *        progress in either direction
+ *----------------------------------------------------------------------------*/
+int tcpclrecv(tcpcl_t* cl, void** bundle, int* size, int timeout)
+{
+    bool waited = false;
+
+    while(!cl->failed)
+    {
+        /* Parse Buffered Segments */
+        while(cl->rx_end - cl->rx_start >= TCPCL_HEADER_SIZE)
+        {
+            uint8_t* header = &cl->rx_buffer[cl->rx_start];
+            uint32_t length = ((uint32_t)header[1] << 24) | ((uint32_t)header[2] << 16) | ((uint32_t)header[3] << 8) | (uint32_t)header[4];
+
+            if(header[0] == TCPCL_DATA_SEGMENT)
+            {
+                if(length == 0 || length > (uint32_t)cl->max_size)
+                {
+                    display_error("Received data segment of invalid length %u\n", length);
+                    tcpclfail(cl);
+                    return SOCK_INVALID;
+                }
+                else if(cl->rx_end - cl->rx_start < TCPCL_HEADER_SIZE + (int)length)
+                {
+                    break; /* rest of bundle not read yet */
+                }
+
+                *bundle = &header[TCPCL_HEADER_SIZE];
+                *size = (int)length;
+                cl->rx_start += TCPCL_HEADER_SIZE + length;
+                cl->received++;
+                tcpclack(cl, false);
+                return 1;
+            }
+            else if(header[0] == TCPCL_ACK_SEGMENT)
+            {
+                pthread_mutex_lock(&cl->state_lock);
+                {
+                    cl->acked = length;
+                    pthread_cond_broadcast(&cl->state_cond);
+                }
+                pthread_mutex_unlock(&cl->state_lock);
+            }
+            else if(header[0] != TCPCL_KEEPALIVE_SEGMENT)
+            {
+                display_error("Received segment of unknown type %02X\n", header[0]);
+                tcpclfail(cl);
+                return SOCK_INVALID;
+            }
+
+            cl->rx_start += TCPCL_HEADER_SIZE;
+        }
+
+        /* Acknowledge Everything Received once Caught Up */
+        tcpclack(cl, true);
+
+        /* Keep Connection Alive */
+        if(tcpclelapsed(&cl->last_tx) >= TCPCL_KEEPALIVE)
+        {
+            tcpclsignal(cl, TCPCL_KEEPALIVE_SEGMENT, 0);
+        }
+        if(tcpclelapsed(&cl->last_rx) >= 3 * TCPCL_KEEPALIVE)
+        {
+            display_error("Connection idle for %d seconds\n", 3 * TCPCL_KEEPALIVE);
+            tcpclfail(cl);
+            break;
+        }
+
+        /* Move Partial Segment to Front of Buffer */
+        if(cl->rx_start > 0)
+        {
+            memmove(cl->rx_buffer, &cl->rx_buffer[cl->rx_start], cl->rx_end - cl->rx_start);
+            cl->rx_end -= cl->rx_start;
+            cl->rx_start = 0;
+        }
+
+        /* Read Socket */
+        ssize_t c = read(cl->fd, &cl->rx_buffer[cl->rx_end], cl->rx_size - cl->rx_end);
+        if(c > 0)
+        {
+            cl->rx_end += (int)c;
+            clock_gettime(CLOCK_MONOTONIC, &cl->last_rx);
+        }
+        else if(c == 0)
+        {
+            display_error("Connection closed by peer\n");
+            tcpclfail(cl);
+        }
+        else if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            if(waited) return 0;
+
+            struct pollfd polllist[1];
+            polllist[0].fd = cl->fd;
+            polllist[0].events = POLLIN;
+            polllist[0].revents = 0;
+
+            int activity = 0;
+            do activity = poll(polllist, 1, timeout);
+            while(activity == -1 && (errno == EINTR || errno == EAGAIN));
+            waited = true;
+        }
+        else
+        {
+            display_error("Failed (%d) to read segments: %s\n", (int)c, strerror(errno));
+            tcpclfail(cl);
+        }
+    }
+
+    return SOCK_INVALID;
+}
+
+/*----------------------------------------------------------------------------*
+ * tcpclclose
+ *----------------------------------------------------------------------------*/
+void tcpclclose(tcpcl_t* cl)
+{
+    if(cl)
+    {
+        shutdown(cl->fd, SHUT_RDWR);
+        sockclose(cl->fd);
+        pthread_mutex_destroy(&cl->tx_lock);
+        pthread_mutex_destroy(&cl->state_lock);
+        pthread_cond_destroy(&cl->state_cond);
+        free(cl->rx_buffer);
+        free(cl);
+    }
+}
@@ -0,0 +1,88 @@
+/************************************************************************
+ * File: tcpcl.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _tcpcl_
+#define _tcpcl_
+
+/******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/uio.h>
+
+/******************************************************************************
+ * Defines
+ ******************************************************************************/
+
+/* Segment Types - each segment is a type byte followed by a 32-bit big endian length */
+#define TCPCL_DATA_SEGMENT      0x01    /* length bytes of bundle follow */
+#define TCPCL_ACK_SEGMENT       0x02    /* length is the number of bundles received so far */
+#define TCPCL_KEEPALIVE_SEGMENT 0x03    /* length is zero */
+
+#define TCPCL_HEADER_SIZE       5
+#define TCPCL_MAX_BATCH         256     /* most bundles written per system call */
+#define TCPCL_DEFAULT_WINDOW    1024    /* most bundles sent and not yet acknowledged */
+#define TCPCL_KEEPALIVE         5       /* seconds idle before a keepalive is sent */
+
+/******************************************************************************
+ * Typedefs
+ ******************************************************************************/
+
+/* TCP Convergence Layer - bundles in both directions over one connection */
+typedef struct {
+    int                 fd;
+    int                 max_size;       /* largest bundle received */
+    int                 window;
+    bool                failed;         /* connection lost or peer violated framing */
+
+    /* Transmit - serialized by tx_lock */
+    pthread_mutex_t     tx_lock;
+    uint8_t             headers[TCPCL_MAX_BATCH + 1][TCPCL_HEADER_SIZE];
+    struct iovec        iovs[(TCPCL_MAX_BATCH * 2) + 1];
+    struct timespec     last_tx;
+
+    /* Window - protected by state_lock */
+    pthread_mutex_t     state_lock;
+    pthread_cond_t      state_cond;
+    uint32_t            sent;           /* bundles sent */
+    uint32_t            acked;          /* bundles acknowledged by peer */
+
+    /* Receive - only accessed by the thread calling tcpclrecv */
+    uint8_t*            rx_buffer;
+    int                 rx_size;
+    int                 rx_start;       /* first unparsed byte */
+    int                 rx_end;         /* one past last byte read */
+    uint32_t            received;       /* bundles received */
+    uint32_t            reported;       /* bundles received that the peer has been told about */
+    struct timespec     last_rx;
+} tcpcl_t;
+
+/******************************************************************************
+ * Exported Functions
+ ******************************************************************************/
+
+tcpcl_t*    tcpclopen   (const char* ip_addr, int port, int is_server, int max_size, int window);
+int         tcpclready  (tcpcl_t* cl, int timeout);
+int         tcpclsend   (tcpcl_t* cl, void** bundles, int* sizes, int count, int timeout);
+int         tcpclrecv   (tcpcl_t* cl, void** bundle, int* size, int timeout);
+void        tcpclclose  (tcpcl_t* cl);
+
+#endif /* _tcpcl_ */
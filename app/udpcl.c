@@ -0,0 +1,368 @@
+/************************************************************************
+ * File: udpcl.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/*************************************************************************
+ * Includes
+ *************************************************************************/
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* sendmmsg and recvmmsg */
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#include "sock.h"
+#include "udpcl.h"
+
+/******************************************************************************
+ * Defines
+ ******************************************************************************/
+
+#ifndef SOL_UDP
+#define SOL_UDP             17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT         103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO             104
+#endif
+
+#define UDPCL_MAX_DATAGRAM  65507   /* largest payload of an IPv4 UDP datagram */
+#define UDPCL_GRO_BUF_SIZE  65535
+#define UDPCL_CONTROL_SIZE  CMSG_SPACE(sizeof(int))
+#define UDPCL_SOCKBUF_SIZE  0x400000 /* absorbs bursts of datagrams, capped by the kernel */
+
+/* Macros */
+#if SOCK_VERBOSE
+#define display_error(...)  printf(__VA_ARGS__)
+#else
+#define display_error(...) (void)0
+#endif
+
+/******************************************************************************
+ * Local Functions
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------*
+ * udpclpoll - waits for socket to be ready
+ *----------------------------------------------------------------------------*/
+static int udpclpoll(int fd, short events, int timeout)
+{
+    struct pollfd polllist[1];
+    polllist[0].fd = fd;
+    polllist[0].events = events;
+    polllist[0].revents = 0;
+
+    int activity = 0;
+    do activity = poll(polllist, 1, timeout);
+    while(activity == -1 && (errno == EINTR || errno == EAGAIN));
+
+    return (activity > 0) && (polllist[0].revents & events);
+}
+
+/*----------------------------------------------------------------------------*
+ * udpclsegment - attaches segment size to message so the kernel splits it
+ *----------------------------------------------------------------------------*/
+static void udpclsegment(struct msghdr* hdr, uint8_t* control, int segment_size)
+{
+    hdr->msg_control = control;
+    hdr->msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+
+    struct cmsghdr* cm = CMSG_FIRSTHDR(hdr);
+    cm->cmsg_level = SOL_UDP;
+    cm->cmsg_type = UDP_SEGMENT;
+    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    *(uint16_t*)CMSG_DATA(cm) = (uint16_t)segment_size;
+}
+
+/*----------------------------------------------------------------------------*
+ * udpclgro - segment size of a datagram coalesced by the kernel, zero if not
+ *----------------------------------------------------------------------------*/
+static int udpclgro(struct msghdr* hdr)
+{
+    struct cmsghdr* cm;
+    for(cm = CMSG_FIRSTHDR(hdr); cm != NULL; cm = CMSG_NXTHDR(hdr, cm))
+    {
+        if(cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+        {
+            int segment_size;
+            memcpy(&segment_size, CMSG_DATA(cm), sizeof(segment_size));
+            return segment_size;
+        }
+    }
+
+    return 0;
+}
+
+/******************************************************************************
+ * Exported Functions
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------*
+ * udpclopen
+ *
+ * Notes: options the kernel does not support are turned off
+ *----------------------------------------------------------------------------*/
+udpcl_t* udpclopen(const char* ip_addr, int port, int is_server, int batch, int max_size, int options)
+{
+    /* Check Parameters */
+    if(batch < 1 || batch > UDPCL_MAX_BATCH || max_size < 1 || max_size > UDPCL_MAX_DATAGRAM)
+    {
+        display_error("Invalid batch (%d) or maximum bundle size (%d)\n", batch, max_size);
+        return NULL;
+    }
+
+    /* Create Socket */
+    int fd = sockdatagram(ip_addr, port, is_server, NULL);
+    if(fd == SOCK_INVALID) return NULL;
+
+    /* Size Socket Buffer */
+    int bufsize = UDPCL_SOCKBUF_SIZE;
+    if(setsockopt(fd, SOL_SOCKET, is_server ? SO_RCVBUF : SO_SNDBUF, &bufsize, sizeof(bufsize)) < 0)
+    {
+        display_error("Failed to set socket buffer size to %d, %s\n", bufsize, strerror(errno));
+    }
+
+    /* Check Segmentation Offload */
+    if(options & UDPCL_GSO)
+    {
+        int segment_size = 0;
+        socklen_t optlen = sizeof(segment_size);
+        if(getsockopt(fd, SOL_UDP, UDP_SEGMENT, &segment_size, &optlen) < 0)
+        {
+            display_error("UDP segmentation offload not supported, %s\n", strerror(errno));
+            options &= ~UDPCL_GSO;
+        }
+    }
+
+    /* Enable Receive Offload */
+    if(options & UDPCL_GRO)
+    {
+        int optval = 1;
+        if(setsockopt(fd, SOL_UDP, UDP_GRO, &optval, sizeof(optval)) < 0)
+        {
+            display_error("UDP receive offload not supported, %s\n", strerror(errno));
+            options &= ~UDPCL_GRO;
+        }
+    }
+
+    /* Allocate Convergence Layer */
+    udpcl_t* cl = (udpcl_t*)calloc(1, sizeof(udpcl_t));
+    if(cl == NULL)
+    {
+        sockclose(fd);
+        return NULL;
+    }
+
+    int segments = (options & (UDPCL_GSO | UDPCL_GRO)) ? UDPCL_MAX_SEGMENTS : 1;
+    cl->fd          = fd;
+    cl->batch       = batch;
+    cl->options     = options;
+    cl->max_size    = max_size;
+    cl->buffer_size = (options & UDPCL_GRO) ? UDPCL_GRO_BUF_SIZE : max_size;
+    cl->msgs        = (struct mmsghdr*)calloc(batch, sizeof(struct mmsghdr));
+    cl->iovs        = (struct iovec*)calloc((size_t)batch * segments, sizeof(struct iovec));
+    cl->buffers     = (uint8_t*)malloc((size_t)batch * cl->buffer_size);
+    cl->controls    = (uint8_t*)calloc(batch, UDPCL_CONTROL_SIZE);
+    cl->bundles     = (void**)calloc((size_t)batch * segments, sizeof(void*));
+    cl->sizes       = (int*)calloc((size_t)batch * segments, sizeof(int));
+    if(!cl->msgs || !cl->iovs || !cl->buffers || !cl->controls || !cl->bundles || !cl->sizes)
+    {
+        udpclclose(cl);
+        return NULL;
+    }
+
+    return cl;
+}
+
+/*----------------------------------------------------------------------------*
+ * udpclsend
+ *
+ * Notes: sends each bundle as its own datagram, as many as possible per
+ *        system call; returns number of bundles sent before the timeout
+ *----------------------------------------------------------------------------*/
+int udpclsend(udpcl_t* cl, void** bundles, int* sizes, int count, int timeout)
+{
+    int sent = 0;
+
+    while(sent < count)
+    {
+        int b = sent;
+        int m = 0;
+        int v = 0;
+
+        /* Build Messages */
+        while(b < count && m < cl->batch)
+        {
+            struct msghdr* hdr = &cl->msgs[m].msg_hdr;
+            int segment_size = sizes[b];
+            int total = 0;
+
+            memset(hdr, 0, sizeof(struct msghdr));
+            hdr->msg_iov = &cl->iovs[v];
+            hdr->msg_iovlen = 0;
+
+            /* Runs of Equally Sized Bundles (the last can be shorter) are Segmented by the Kernel */
+            do {
+                cl->iovs[v].iov_base = bundles[b];
+                cl->iovs[v].iov_len = sizes[b];
+                total += sizes[b];
+                hdr->msg_iovlen++;
+                v++;
+            } while((cl->options & UDPCL_GSO) &&
+                    (sizes[b++] == segment_size) &&
+                    (b < count) &&
+                    (sizes[b] <= segment_size) &&
+                    (hdr->msg_iovlen < UDPCL_MAX_SEGMENTS) &&
+                    (total + sizes[b] <= UDPCL_MAX_DATAGRAM));
+            if(!(cl->options & UDPCL_GSO)) b++;
+
+            if(hdr->msg_iovlen > 1)
+            {
+                udpclsegment(hdr, &cl->controls[m * UDPCL_CONTROL_SIZE], segment_size);
+            }
+
+            m++;
+        }
+
+        /* Send Messages */
+        int n = sendmmsg(cl->fd, cl->msgs, m, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if(n > 0)
+        {
+            int i;
+            for(i = 0; i < n; i++) sent += (int)cl->msgs[i].msg_hdr.msg_iovlen;
+        }
+        else if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS || errno == EINTR))
+        {
+            if(!udpclpoll(cl->fd, POLLOUT, timeout)) break;
+        }
+        else if(n < 0 && (cl->options & UDPCL_GSO) && (errno == EINVAL || errno == EIO))
+        {
+            /* Segments Larger than the Path MTU or no Device Support */
+            display_error("UDP segmentation offload failed, %s, sending datagrams individually\n", strerror(errno));
+            cl->options &= ~UDPCL_GSO;
+        }
+        else
+        {
+            display_error("Failed (%d) to send %d datagrams: %s\n", n, m, strerror(errno));
+            return (sent > 0) ? sent : SOCK_INVALID;
+        }
+    }
+
+    return sent;
+}
+
+/*----------------------------------------------------------------------------*
+ * udpclrecv
+ *
+ * Notes: returns number of bundles received into cl->bundles and cl->sizes,
+ *        which are valid until the next call
+ *----------------------------------------------------------------------------*/
+int udpclrecv(udpcl_t* cl, int timeout)
+{
+    int count = 0;
+    int i;
+
+    /* Wait for Datagrams */
+    if(!udpclpoll(cl->fd, POLLIN, timeout)) return 0;
+
+    /* Build Messages */
+    for(i = 0; i < cl->batch; i++)
+    {
+        struct msghdr* hdr = &cl->msgs[i].msg_hdr;
+        memset(hdr, 0, sizeof(struct msghdr));
+        cl->iovs[i].iov_base = &cl->buffers[(size_t)i * cl->buffer_size];
+        cl->iovs[i].iov_len = cl->buffer_size;
+        hdr->msg_iov = &cl->iovs[i];
+        hdr->msg_iovlen = 1;
+        if(cl->options & UDPCL_GRO)
+        {
+            hdr->msg_control = &cl->controls[i * UDPCL_CONTROL_SIZE];
+            hdr->msg_controllen = UDPCL_CONTROL_SIZE;
+        }
+    }
+
+    /* Receive Messages */
+    int n = recvmmsg(cl->fd, cl->msgs, cl->batch, MSG_DONTWAIT, NULL);
+    if(n < 0)
+    {
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+        display_error("Failed (%d) to receive datagrams: %s\n", n, strerror(errno));
+        return SOCK_INVALID;
+    }
+
+    /* Split Messages into Bundles */
+    for(i = 0; i < n; i++)
+    {
+        struct msghdr* hdr = &cl->msgs[i].msg_hdr;
+        uint8_t* buffer = (uint8_t*)cl->iovs[i].iov_base;
+        int len = (int)cl->msgs[i].msg_len;
+        int segment_size = (cl->options & UDPCL_GRO) ? udpclgro(hdr) : 0;
+        int offset;
+
+        if(hdr->msg_flags & MSG_TRUNC)
+        {
+            display_error("Dropped datagram larger than %d bytes\n", cl->buffer_size);
+            continue;
+        }
+
+        if(segment_size <= 0) segment_size = len;
+        for(offset = 0; offset < len; offset += segment_size)
+        {
+            int size = (len - offset < segment_size) ? (len - offset) : segment_size;
+            if(size > cl->max_size)
+            {
+                display_error("Dropped bundle of %d bytes, larger than %d\n", size, cl->max_size);
+                continue;
+            }
+            cl->bundles[count] = &buffer[offset];
+            cl->sizes[count] = size;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/*----------------------------------------------------------------------------*
+ * udpclclose
+ *----------------------------------------------------------------------------*/
+void udpclclose(udpcl_t* cl)
+{
+    if(cl)
+    {
+        if(cl->fd != SOCK_INVALID) sockclose(cl->fd);
+        free(cl->msgs);
+        free(cl->iovs);
+        free(cl->buffers);
+        free(cl->controls);
+        free(cl->bundles);
+        free(cl->sizes);
+        free(cl);
+    }
+}
@@ -0,0 +1,67 @@
+/************************************************************************
+ * File: udpcl.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _udpcl_
+#define _udpcl_
+
+/******************************************************************************
+ * Includes
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+/******************************************************************************
+ * Defines
+ ******************************************************************************/
+
+/* Options */
+#define UDPCL_GSO           0x01    /* send runs of equally sized bundles as one segmented datagram */
+#define UDPCL_GRO           0x02    /* receive datagrams coalesced by the kernel and split them */
+
+#define UDPCL_MAX_BATCH     1024
+#define UDPCL_MAX_SEGMENTS  64      /* most segments the kernel sends or coalesces into one datagram */
+
+/******************************************************************************
+ * Typedefs
+ ******************************************************************************/
+
+/* UDP Convergence Layer - one bundle per datagram, many datagrams per system call */
+typedef struct {
+    int                 fd;
+    int                 batch;          /* most datagrams sent or received per system call */
+    int                 options;
+    int                 max_size;       /* largest bundle received */
+    int                 buffer_size;    /* size of each receive buffer */
+    struct mmsghdr*     msgs;
+    struct iovec*       iovs;
+    uint8_t*            buffers;        /* receive buffers, one per message */
+    uint8_t*            controls;       /* ancillary data, one per message */
+    void**              bundles;        /* bundles received by last call to udpclrecv */
+    int*                sizes;
+} udpcl_t;
+
+/******************************************************************************
+ * Exported Functions
+ ******************************************************************************/
+
+udpcl_t*    udpclopen   (const char* ip_addr, int port, int is_server, int batch, int max_size, int options);
+int         udpclsend   (udpcl_t* cl, void** bundles, int* sizes, int count, int timeout);
+int         udpclrecv   (udpcl_t* cl, int timeout);
+void        udpclclose  (udpcl_t* cl);
+
+#endif /* _udpcl_ */
@@ -0,0 +1,943 @@
+/************************************************************************
+ * File: bpbench.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_store_ram.h"
+#include "bplib_store_file.h"
+#include "bplib_store_flash.h"
+#include "bplib_flash_sim.h"
+#include "bundle_types.h"
+#include "rb_tree.h"
+#include "range_array.h"
+#include "rh_hash.h"
+#include "swiss_table.h"
+#include "cbuf.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define BENCH_BYTES_PER_CASE    0x1000000   /* payload bytes sent per case when iterations are not specified */
+#define BENCH_MIN_ITERATIONS    16
+#define BENCH_MAX_ITERATIONS    10000
+#define BENCH_MAX_PAYLOAD_SIZE  0x100000
+#define BENCH_DEFAULT_PATH      "/tmp/bpbench"
+#define BENCH_CUSTODY_TABLE     { 256, 16384 }
+#define BENCH_NUM_TREES         2
+#define BENCH_TREE_IDS          0x10000     /* custody ids received per custody tree round */
+#define BENCH_TREE_ROUNDS       32
+#define BENCH_TREE_WINDOW       64          /* custody ids arriving out of order are shuffled within this window */
+#define BENCH_NUM_TABLES        3
+#define BENCH_MAX_THREADS       8
+#define BENCH_CONTENDED_BUNDLES 20000       /* bundles stored and loaded across all threads */
+#define BENCH_TABLE_SIZES       { 16384, 65536, 262144, 1048576, 4194304 }  /* runs past the 16-bit index range */
+
+#ifndef LIBID
+#define LIBID                   "unknown"
+#endif
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+typedef enum {
+    BENCH_RAM,
+    BENCH_FILE,
+    BENCH_FLASH,
+    BENCH_NUM_STORES
+} bench_store_type_t;
+
+typedef struct {
+    bench_store_type_t  store;
+    int                 payload_size;
+    bool                integrity_check;
+    bool                request_custody;
+    int                 active_table_size;
+    int                 iterations;
+} bench_case_t;
+
+typedef enum {
+    BENCH_IN_ORDER,
+    BENCH_OUT_OF_ORDER,
+    BENCH_GAPPED,
+    BENCH_NUM_PATTERNS
+} bench_pattern_t;
+
+typedef enum {
+    BENCH_SLIDING,
+    BENCH_STRAGGLERS,
+    BENCH_NUM_TABLE_PATTERNS
+} bench_table_pattern_t;
+
+typedef struct {
+    int                 ids;            /* custody ids added */
+    double              ns;             /* per custody id */
+    int                 failures;
+} bench_table_result_t;
+
+typedef struct {
+    int                 bundles;        /* bundles stored and loaded across all threads */
+    double              ns;             /* per bundle */
+    int                 failures;
+} bench_contended_result_t;
+
+typedef struct {
+    int                 ids;            /* custody ids inserted per round */
+    double              insert_ns;      /* per custody id */
+    double              drain_ns;       /* per range */
+    bp_val_t            ranges;         /* ranges drained per round */
+    int                 failures;
+} bench_tree_result_t;
+
+typedef struct {
+    int                 payloads;       /* round trips completed */
+    int                 bundles;        /* bundles loaded and processed, including fragments and dacs */
+    double              seconds;
+    double              p50_us;
+    double              p99_us;
+    size_t              mem_high;       /* most bytes allocated by the library above what it held before the case */
+    uint32_t            retransmitted;
+    int                 failures;
+} bench_result_t;
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static const char* store_names[BENCH_NUM_STORES] = { "ram", "file", "flash" };
+
+static const bp_store_t stores[BENCH_NUM_STORES] = {
+    {
+        .create     = bplib_store_ram_create,
+        .destroy    = bplib_store_ram_destroy,
+        .enqueue    = bplib_store_ram_enqueue,
+        .dequeue    = bplib_store_ram_dequeue,
+        .retrieve   = bplib_store_ram_retrieve,
+        .release    = bplib_store_ram_release,
+        .relinquish = bplib_store_ram_relinquish,
+        .getcount   = bplib_store_ram_getcount,
+        .relinquish_batch = bplib_store_ram_relinquish_batch
+    },
+    {
+        .create     = bplib_store_file_create,
+        .destroy    = bplib_store_file_destroy,
+        .enqueue    = bplib_store_file_enqueue,
+        .dequeue    = bplib_store_file_dequeue,
+        .retrieve   = bplib_store_file_retrieve,
+        .release    = bplib_store_file_release,
+        .relinquish = bplib_store_file_relinquish,
+        .getcount   = bplib_store_file_getcount,
+        .relinquish_batch = bplib_store_file_relinquish_batch
+    },
+    {
+        .create     = bplib_store_flash_create,
+        .destroy    = bplib_store_flash_destroy,
+        .enqueue    = bplib_store_flash_enqueue,
+        .dequeue    = bplib_store_flash_dequeue,
+        .retrieve   = bplib_store_flash_retrieve,
+        .release    = bplib_store_flash_release,
+        .relinquish = bplib_store_flash_relinquish,
+        .getcount   = bplib_store_flash_getcount,
+        .relinquish_batch = bplib_store_flash_relinquish_batch
+    }
+};
+
+static bp_flash_driver_t flash_driver = {
+    .num_blocks = FLASH_SIM_NUM_BLOCKS,
+    .pages_per_block = FLASH_SIM_PAGES_PER_BLOCK,
+    .page_size = FLASH_SIM_PAGE_SIZE,
+    .read = bplib_flash_sim_page_read,
+    .write = bplib_flash_sim_page_write,
+    .erase = bplib_flash_sim_block_erase,
+    .isbad = bplib_flash_sim_block_is_bad,
+    .phyblk = bplib_flash_sim_physical_block
+};
+
+static const int payload_sizes[] = { 64, 512, 4096, 65536, 1048576 };
+
+static const char* tree_names[BENCH_NUM_TREES] = { "rb_tree", "range_array" }; /* indexed by BP_CUSTODY_xxx */
+static const char* pattern_names[BENCH_NUM_PATTERNS] = { "in_order", "out_of_order", "gapped" };
+static bp_val_t tree_ids[BENCH_TREE_IDS];
+
+static const char* table_names[BENCH_NUM_TABLES] = { "rh_hash", "swiss_table", "cbuf" }; /* indexed by BP_ACTIVE_TABLE_xxx, then cbuf */
+static const char* table_pattern_names[BENCH_NUM_TABLE_PATTERNS] = { "sliding", "stragglers" };
+static bp_active_table_t active_tables[BENCH_NUM_TABLES] = {
+    {
+        .create     = (bp_table_create_t)rh_hash_create,
+        .destroy    = (bp_table_destroy_t)rh_hash_destroy,
+        .add        = (bp_table_add_t)rh_hash_add,
+        .next       = (bp_table_next_t)rh_hash_next,
+        .remove     = (bp_table_remove_t)rh_hash_remove,
+        .count      = (bp_table_count_t)rh_hash_count
+    },
+    {
+        .create     = (bp_table_create_t)swiss_table_create,
+        .destroy    = (bp_table_destroy_t)swiss_table_destroy,
+        .add        = (bp_table_add_t)swiss_table_add,
+        .next       = (bp_table_next_t)swiss_table_next,
+        .remove     = (bp_table_remove_t)swiss_table_remove,
+        .count      = (bp_table_count_t)swiss_table_count
+    },
+    {
+        .create     = (bp_table_create_t)cbuf_create,
+        .destroy    = (bp_table_destroy_t)cbuf_destroy,
+        .add        = (bp_table_add_t)cbuf_add,
+        .next       = (bp_table_next_t)cbuf_next,
+        .remove     = (bp_table_remove_t)cbuf_remove,
+        .count      = (bp_table_count_t)cbuf_count
+    }
+};
+
+static const int thread_counts[] = { 1, 2, 4, BENCH_MAX_THREADS };
+static bp_desc_t* contended_channel;
+
+static const char* file_path = BENCH_DEFAULT_PATH;
+static char run_path[256];  /* created for each run so data files left by earlier runs are never read */
+static bp_file_attr_t file_attr;
+static bp_flash_attr_t flash_attr;
+static uint8_t payload[BENCH_MAX_PAYLOAD_SIZE];
+static FILE* json;  /* results are kept apart from library log messages written to stdout */
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * bench_now - monotonic time in microseconds
+ *-------------------------------------------------------------------------------------*/
+static double bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double)now.tv_sec * 1000000.0) + ((double)now.tv_nsec / 1000.0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_compare - sort order of latencies
+ *-------------------------------------------------------------------------------------*/
+static int bench_compare(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_custody - moves custody signals from receiver to sender, returns number moved
+ *-------------------------------------------------------------------------------------*/
+static int bench_custody(bp_desc_t* sender, bp_desc_t* receiver, bench_result_t* result)
+{
+    int moved = 0;
+    uint32_t flags = 0;
+    void* dacs;
+    int dacs_size;
+
+    bplib_custody(receiver, BP_CHECK, &flags);
+    while(bplib_load(receiver, &dacs, &dacs_size, BP_CHECK, &flags) == BP_SUCCESS)
+    {
+        if(bplib_process(sender, dacs, dacs_size, BP_CHECK, &flags) != BP_SUCCESS) result->failures++;
+        bplib_ackbundle(receiver, dacs);
+        result->bundles++;
+        moved++;
+    }
+
+    return moved;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_roundtrip - stores a payload, loads and processes its bundles, and accepts it
+ *
+ *  Returns latency in microseconds from store to accept, or a negative value on failure;
+ *  custody signals are exchanged after the payload is accepted, or during the round trip
+ *  when the sender's active table is full
+ *-------------------------------------------------------------------------------------*/
+static double bench_roundtrip(bp_desc_t* sender, bp_desc_t* receiver, bench_case_t* bcase, bench_result_t* result)
+{
+    uint32_t flags = 0;
+    void* bundle;
+    int bundle_size;
+    void* accepted;
+    int accepted_size;
+
+    double start = bench_now();
+
+    /* Store */
+    if(bplib_store(sender, payload, bcase->payload_size, BP_CHECK, &flags) != BP_SUCCESS) return -1.0;
+
+    while(true)
+    {
+        int progress = 0;
+
+        /* Load and Process Bundles */
+        while(bplib_load(sender, &bundle, &bundle_size, BP_CHECK, &flags) == BP_SUCCESS)
+        {
+            if(bplib_process(receiver, bundle, bundle_size, BP_CHECK, &flags) != BP_SUCCESS) result->failures++;
+            bplib_ackbundle(sender, bundle);
+            result->bundles++;
+            progress++;
+        }
+
+        /* Accept */
+        if(bplib_accept(receiver, &accepted, &accepted_size, BP_CHECK, &flags) == BP_SUCCESS)
+        {
+            double latency = bench_now() - start;
+            if(accepted_size != bcase->payload_size) result->failures++;
+            bplib_ackpayload(receiver, accepted);
+            if(bcase->request_custody) bench_custody(sender, receiver, result);
+            return latency;
+        }
+
+        /* Free Active Table */
+        if(bcase->request_custody) progress += bench_custody(sender, receiver, result);
+        if(progress == 0) return -1.0;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_run - runs one case
+ *-------------------------------------------------------------------------------------*/
+static int bench_run(bench_case_t* bcase, bench_result_t* result)
+{
+    bp_route_t sender_route = { 4, 3, 72, 43, 0, 0 };
+    bp_route_t receiver_route = { 72, 43, 4, 3, 0, 0 };
+    bp_desc_t* sender;
+    bp_desc_t* receiver;
+    bp_stats_t stats;
+    int i;
+
+    memset(result, 0, sizeof(bench_result_t));
+
+    double* latencies = (double*)malloc(sizeof(double) * bcase->iterations);
+    if(latencies == NULL) return BP_ERROR;
+
+    /* Initialize Store */
+    if(bcase->store == BENCH_FLASH)
+    {
+        bplib_store_flash_init(flash_driver, false);
+    }
+    flash_attr.max_data_size = bcase->payload_size + BP_DEFAULT_MAX_LENGTH;
+
+    /* Open Channels */
+    bp_attr_t attributes;
+    bplib_attrinit(&attributes);
+    attributes.integrity_check = bcase->integrity_check;
+    attributes.request_custody = bcase->request_custody;
+    attributes.allow_fragmentation = true;
+    attributes.active_table_size = bcase->active_table_size;
+    attributes.dacs_policy = BP_DACS_ADAPTIVE;
+    attributes.max_reassembly_size = BENCH_MAX_PAYLOAD_SIZE * 2;
+    if(bcase->store == BENCH_FILE)          attributes.storage_service_parm = &file_attr;
+    else if(bcase->store == BENCH_FLASH)    attributes.storage_service_parm = &flash_attr;
+
+    size_t memused = bplib_os_memused();
+    sender = bplib_open(sender_route, stores[bcase->store], attributes);
+    receiver = bplib_open(receiver_route, stores[bcase->store], attributes);
+    if(sender == NULL || receiver == NULL)
+    {
+        fprintf(stderr, "Failed to open channels for %s store\n", store_names[bcase->store]);
+        if(sender) bplib_close(sender);
+        if(receiver) bplib_close(receiver);
+        if(bcase->store == BENCH_FLASH) bplib_store_flash_uninit();
+        free(latencies);
+        return BP_ERROR;
+    }
+
+    /* Round Trips */
+    double start = bench_now();
+    for(i = 0; i < bcase->iterations; i++)
+    {
+        latencies[i] = bench_roundtrip(sender, receiver, bcase, result);
+        if(latencies[i] < 0.0)
+        {
+            result->failures++;
+            break;
+        }
+
+        size_t used = bplib_os_memused();
+        if(used > memused && used - memused > result->mem_high) result->mem_high = used - memused;
+    }
+    result->seconds = (bench_now() - start) / 1000000.0;
+    result->payloads = i;
+
+    /* Latency Percentiles */
+    if(result->payloads > 0)
+    {
+        qsort(latencies, result->payloads, sizeof(double), bench_compare);
+        result->p50_us = latencies[(result->payloads * 50) / 100];
+        result->p99_us = latencies[(result->payloads * 99) / 100];
+    }
+
+    /* Close Channels */
+    bplib_latchstats(sender, &stats);
+    result->retransmitted = stats.retransmitted_bundles;
+    bplib_close(sender);
+    bplib_close(receiver);
+    if(bcase->store == BENCH_FLASH) bplib_store_flash_uninit();
+
+    free(latencies);
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_print - writes result as a JSON object
+ *-------------------------------------------------------------------------------------*/
+static void bench_print(bench_case_t* bcase, bench_result_t* result, bool first)
+{
+    double secs = (result->seconds > 0.0) ? result->seconds : 1.0;
+
+    fprintf(json, "%s\n    {", first ? "" : ",");
+    fprintf(json, "\"store\": \"%s\", ", store_names[bcase->store]);
+    fprintf(json, "\"payload_size\": %d, ", bcase->payload_size);
+    fprintf(json, "\"bib\": %s, ", bcase->integrity_check ? "true" : "false");
+    fprintf(json, "\"custody\": %s, ", bcase->request_custody ? "true" : "false");
+    fprintf(json, "\"active_table_size\": %d, ", bcase->active_table_size);
+    fprintf(json, "\"payloads\": %d, ", result->payloads);
+    fprintf(json, "\"bundles\": %d, ", result->bundles);
+    fprintf(json, "\"seconds\": %.6lf, ", result->seconds);
+    fprintf(json, "\"payloads_per_sec\": %.1lf, ", result->payloads / secs);
+    fprintf(json, "\"bundles_per_sec\": %.1lf, ", result->bundles / secs);
+    fprintf(json, "\"mb_per_sec\": %.3lf, ", ((double)result->payloads * bcase->payload_size) / (secs * 1000000.0));
+    fprintf(json, "\"latency_p50_us\": %.2lf, ", result->p50_us);
+    fprintf(json, "\"latency_p99_us\": %.2lf, ", result->p99_us);
+    fprintf(json, "\"mem_high_bytes\": %lu, ", (unsigned long)result->mem_high);
+    fprintf(json, "\"retransmitted\": %u, ", (unsigned int)result->retransmitted);
+    fprintf(json, "\"failures\": %d}", result->failures);
+    fflush(json);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_tree_ids - fills tree_ids with the order custody ids are received in, returns count
+ *
+ *  in_order: every custody id in sequence
+ *  out_of_order: every custody id, shuffled within windows as a link with jitter would
+ *  gapped: in sequence with every fourth custody id lost, as a DACS with many fills
+ *-------------------------------------------------------------------------------------*/
+static int bench_tree_ids(bench_pattern_t pattern)
+{
+    uint32_t seed = 1;
+    int count = 0;
+    bp_val_t v;
+
+    for(v = 0; count < BENCH_TREE_IDS; v++)
+    {
+        if(pattern == BENCH_GAPPED && (v % 4) == 3) continue;
+        tree_ids[count++] = v;
+    }
+
+    if(pattern == BENCH_OUT_OF_ORDER)
+    {
+        int w, i;
+        for(w = 0; w < count; w += BENCH_TREE_WINDOW)
+        {
+            for(i = BENCH_TREE_WINDOW - 1; i > 0; i--)
+            {
+                seed = (seed * 1103515245) + 12345; /* same sequence on every run */
+                int j = (int)((seed >> 16) % (uint32_t)(i + 1));
+                bp_val_t tmp = tree_ids[w + i];
+                tree_ids[w + i] = tree_ids[w + j];
+                tree_ids[w + j] = tmp;
+            }
+        }
+    }
+
+    return count;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_tree_run - inserts custody ids into a custody tree and drains it in order
+ *-------------------------------------------------------------------------------------*/
+static int bench_tree_run(int tree_type, bench_pattern_t pattern, bench_tree_result_t* result)
+{
+    bp_custody_tree_t custody_tree;
+    union {
+        rb_tree_t       rb_tree;
+        range_array_t   range_array;
+    } tree_data;
+    rb_range_t range;
+    int r, i;
+
+    memset(result, 0, sizeof(bench_tree_result_t));
+
+    /* Initialize Custody Tree Functions */
+    if(tree_type == BP_CUSTODY_RB_TREE)
+    {
+        custody_tree.create     = (bp_tree_create_t)rb_tree_create;
+        custody_tree.destroy    = (bp_tree_destroy_t)rb_tree_destroy;
+        custody_tree.insert     = (bp_tree_insert_t)rb_tree_insert;
+        custody_tree.is_empty   = (bp_tree_is_empty_t)rb_tree_is_empty;
+        custody_tree.goto_first = (bp_tree_goto_first_t)rb_tree_goto_first;
+        custody_tree.get_next   = (bp_tree_get_next_t)rb_tree_get_next;
+    }
+    else
+    {
+        custody_tree.create     = (bp_tree_create_t)range_array_create;
+        custody_tree.destroy    = (bp_tree_destroy_t)range_array_destroy;
+        custody_tree.insert     = (bp_tree_insert_t)range_array_insert;
+        custody_tree.is_empty   = (bp_tree_is_empty_t)range_array_is_empty;
+        custody_tree.goto_first = (bp_tree_goto_first_t)range_array_goto_first;
+        custody_tree.get_next   = (bp_tree_get_next_t)range_array_get_next;
+    }
+    custody_tree.tree = &tree_data;
+
+    /* Create Tree - sized so that every custody id could be its own range */
+    result->ids = bench_tree_ids(pattern);
+    if(custody_tree.create(result->ids, custody_tree.tree) != BP_SUCCESS) return BP_ERROR;
+
+    for(r = 0; r < BENCH_TREE_ROUNDS; r++)
+    {
+        bp_val_t ranges = 0;
+
+        /* Insert */
+        double start = bench_now();
+        for(i = 0; i < result->ids; i++)
+        {
+            if(custody_tree.insert(tree_ids[i], custody_tree.tree) != BP_SUCCESS) result->failures++;
+        }
+        result->insert_ns += (bench_now() - start) * 1000.0;
+
+        /* Drain In Order */
+        start = bench_now();
+        custody_tree.goto_first(custody_tree.tree);
+        while(!custody_tree.is_empty(custody_tree.tree))
+        {
+            if(custody_tree.get_next(custody_tree.tree, &range, true, false) != BP_SUCCESS) break;
+            ranges++;
+        }
+        result->drain_ns += (bench_now() - start) * 1000.0;
+
+        if(!custody_tree.is_empty(custody_tree.tree)) result->failures++;
+        result->ranges = ranges;
+    }
+
+    result->insert_ns /= (double)result->ids * BENCH_TREE_ROUNDS;
+    if(result->ranges > 0) result->drain_ns /= (double)result->ranges * BENCH_TREE_ROUNDS;
+    custody_tree.destroy(custody_tree.tree);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_tree_print - writes custody tree result as a JSON object
+ *-------------------------------------------------------------------------------------*/
+static void bench_tree_print(int tree_type, bench_pattern_t pattern, bench_tree_result_t* result, bool first)
+{
+    fprintf(json, "%s\n    {", first ? "" : ",");
+    fprintf(json, "\"tree\": \"%s\", ", tree_names[tree_type]);
+    fprintf(json, "\"pattern\": \"%s\", ", pattern_names[pattern]);
+    fprintf(json, "\"ids\": %d, ", result->ids);
+    fprintf(json, "\"ranges\": %lu, ", (unsigned long)result->ranges);
+    fprintf(json, "\"insert_ns\": %.2lf, ", result->insert_ns);
+    fprintf(json, "\"drain_ns\": %.2lf, ", result->drain_ns);
+    fprintf(json, "\"failures\": %d}", result->failures);
+    fflush(json);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_table_run - times an active table with a window of unacknowledged custody ids
+ *
+ *  Sliding fills the table and then slides the window by two tables, acknowledging the
+ *  oldest custody id and checking the next oldest before each add.  Stragglers
+ *  acknowledges custody ids half a table behind the newest, except every eighth which
+ *  is acknowledged two tables behind as if it were lost and retransmitted, so active
+ *  custody ids span more than the table.
+ *-------------------------------------------------------------------------------------*/
+static int bench_table_run(int table_type, bench_table_pattern_t pattern, int size, bench_table_result_t* result)
+{
+    bp_active_table_t* at = &active_tables[table_type];
+    bp_active_bundle_t bundle;
+    bp_val_t cid;
+
+    memset(result, 0, sizeof(bench_table_result_t));
+    memset(&bundle, 0, sizeof(bundle));
+
+    if(at->create(&at->table, size) != BP_SUCCESS) return BP_ERROR;
+
+    double start = bench_now();
+    if(pattern == BENCH_SLIDING)
+    {
+        for(cid = 0; cid < (bp_val_t)size; cid++)
+        {
+            bundle.sid = (bp_sid_t)(cid + 1);
+            bundle.cid = cid;
+            if(at->add(at->table, bundle, false) != BP_SUCCESS) result->failures++;
+        }
+        for(cid = size; cid < (bp_val_t)size * 3; cid++)
+        {
+            bp_active_bundle_t oldest;
+            at->remove(at->table, cid - size, NULL);
+            if(at->next(at->table, &oldest) != BP_SUCCESS || oldest.cid != cid - size + 1) result->failures++;
+            bundle.sid = (bp_sid_t)(cid + 1);
+            bundle.cid = cid;
+            if(at->add(at->table, bundle, false) != BP_SUCCESS) result->failures++;
+        }
+        if(at->count(at->table) != size) result->failures++;
+        result->ids = size * 3;
+    }
+    else
+    {
+        for(cid = 0; cid < (bp_val_t)size * 4; cid++)
+        {
+            bp_active_bundle_t oldest;
+            bundle.sid = (bp_sid_t)(cid + 1);
+            bundle.cid = cid;
+            if(at->add(at->table, bundle, false) != BP_SUCCESS) result->failures++;
+            if(cid >= (bp_val_t)size / 2 && (cid - (size / 2)) % 8 != 0) at->remove(at->table, cid - (size / 2), NULL);
+            if(cid >= (bp_val_t)size * 2 && (cid - (size * 2)) % 8 == 0) at->remove(at->table, cid - (size * 2), NULL);
+            at->next(at->table, &oldest);
+        }
+        result->ids = size * 4;
+    }
+    result->ns = (bench_now() - start) * 1000.0 / result->ids;
+
+    at->destroy(at->table);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_table_print - writes active table result as a JSON object
+ *-------------------------------------------------------------------------------------*/
+static void bench_table_print(int table_type, bench_table_pattern_t pattern, int size, bench_table_result_t* result, bool first)
+{
+    fprintf(json, "%s\n    {", first ? "" : ",");
+    fprintf(json, "\"table\": \"%s\", ", table_names[table_type]);
+    fprintf(json, "\"pattern\": \"%s\", ", table_pattern_names[pattern]);
+    fprintf(json, "\"size\": %d, ", size);
+    fprintf(json, "\"ids\": %d, ", result->ids);
+    fprintf(json, "\"ns_per_id\": %.2lf, ", result->ns);
+    fprintf(json, "\"failures\": %d}", result->failures);
+    fflush(json);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_store_and_load - thread that stores payloads and loads their bundles, the count
+ *  to send is passed in and the count sent is passed back
+ *-------------------------------------------------------------------------------------*/
+static void* bench_store_and_load(void* parm)
+{
+    int count = *(int*)parm;
+    uint32_t flags = 0;
+    void* bundle;
+    int size;
+    int i;
+
+    for(i = 0; i < count; i++)
+    {
+        if(bplib_store(contended_channel, payload, 64, BP_CHECK, &flags) != BP_SUCCESS) break;
+        if(bplib_load(contended_channel, &bundle, &size, 1000, &flags) != BP_SUCCESS) break;
+        bplib_ackbundle(contended_channel, bundle);
+    }
+
+    *(int*)parm = i;
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_contended_run - threads store and load bundles on one channel
+ *
+ *  Bundles are not tracked for custody so only the channel's locks are contended.
+ *-------------------------------------------------------------------------------------*/
+static int bench_contended_run(int num_threads, bench_contended_result_t* result)
+{
+    bp_route_t route = { 4, 3, 72, 43, 0, 0 };
+    pthread_t threads[BENCH_MAX_THREADS];
+    int counts[BENCH_MAX_THREADS];
+    bp_attr_t attributes;
+    int t;
+
+    memset(result, 0, sizeof(bench_contended_result_t));
+
+    bplib_attrinit(&attributes);
+    attributes.request_custody = false;
+    contended_channel = bplib_open(route, stores[BENCH_RAM], attributes);
+    if(contended_channel == NULL) return BP_ERROR;
+
+    double start = bench_now();
+    for(t = 0; t < num_threads; t++)
+    {
+        counts[t] = BENCH_CONTENDED_BUNDLES / num_threads;
+        pthread_create(&threads[t], NULL, bench_store_and_load, &counts[t]);
+    }
+    for(t = 0; t < num_threads; t++)
+    {
+        pthread_join(threads[t], NULL);
+        result->bundles += counts[t];
+    }
+    double elapsed = bench_now() - start;
+
+    if(result->bundles != (BENCH_CONTENDED_BUNDLES / num_threads) * num_threads) result->failures++;
+    if(result->bundles > 0) result->ns = elapsed * 1000.0 / result->bundles;
+    bplib_close(contended_channel);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_contended_print - writes contended channel result as a JSON object
+ *-------------------------------------------------------------------------------------*/
+static void bench_contended_print(int num_threads, bench_contended_result_t* result, bool first)
+{
+    fprintf(json, "%s\n    {", first ? "" : ",");
+    fprintf(json, "\"threads\": %d, ", num_threads);
+    fprintf(json, "\"bundles\": %d, ", result->bundles);
+    fprintf(json, "\"ns_per_bundle\": %.2lf, ", result->ns);
+    fprintf(json, "\"failures\": %d}", result->failures);
+    fflush(json);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_cleanup - removes files left by the file store and the run directory
+ *-------------------------------------------------------------------------------------*/
+static void bench_cleanup(void)
+{
+    char filename[512];
+    struct dirent* entry;
+
+    DIR* dir = opendir(run_path);
+    if(dir == NULL) return;
+    while((entry = readdir(dir)) != NULL)
+    {
+        if(strstr(entry->d_name, ".dat") == NULL && strstr(entry->d_name, ".tbl") == NULL) continue;
+        snprintf(filename, sizeof(filename), "%s/%s", run_path, entry->d_name);
+        remove(filename);
+    }
+    closedir(dir);
+    rmdir(run_path);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bench_usage
+ *-------------------------------------------------------------------------------------*/
+static void bench_usage(void)
+{
+    fprintf(stderr, "bpbench [options] > results.json\n");
+    fprintf(stderr, "  --store <ram|file|flash>: only runs cases on the given store\n");
+    fprintf(stderr, "  --size <bytes>: only runs cases with the given payload size (64 to %d)\n", BENCH_MAX_PAYLOAD_SIZE);
+    fprintf(stderr, "  --iterations <n>: round trips per case (default sends %d bytes per case)\n", BENCH_BYTES_PER_CASE);
+    fprintf(stderr, "  --path <dir>: directory under which the file store keeps a run (default %s)\n", BENCH_DEFAULT_PATH);
+}
+
+/******************************************************************************
+ MAIN
+ ******************************************************************************/
+
+int main(int argc, char* argv[])
+{
+    int store_filter = -1;
+    int size_filter = 0;
+    int iterations = 0;
+    int failures = 0;
+    bool first = true;
+    int i;
+
+    /* Process Command Line */
+    for(i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--store") == 0 && i + 1 < argc)
+        {
+            i++;
+            for(store_filter = 0; store_filter < BENCH_NUM_STORES; store_filter++)
+            {
+                if(strcmp(argv[i], store_names[store_filter]) == 0) break;
+            }
+            if(store_filter == BENCH_NUM_STORES)
+            {
+                bench_usage();
+                return -1;
+            }
+        }
+        else if(strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            size_filter = (int)strtol(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = (int)strtol(argv[++i], NULL, 0);
+        }
+        else if(strcmp(argv[i], "--path") == 0 && i + 1 < argc)
+        {
+            file_path = argv[++i];
+        }
+        else
+        {
+            bench_usage();
+            return -1;
+        }
+    }
+
+    /* Send Library Log Messages to stderr */
+    json = fdopen(dup(STDOUT_FILENO), "w");
+    if(json == NULL || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+        fprintf(stderr, "Failed to separate results from log messages: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* Initialize Library and Stores */
+    bplib_init();
+    bplib_store_ram_init();
+    bplib_store_file_init(NULL);
+    bplib_flash_sim_initialize();
+    snprintf(run_path, sizeof(run_path), "%s/runXXXXXX", file_path);
+    if((mkdir(file_path, 0755) != 0 && errno != EEXIST) || mkdtemp(run_path) == NULL)
+    {
+        fprintf(stderr, "Failed to create directory under %s: %s\n", file_path, strerror(errno));
+        return -1;
+    }
+    file_attr.root_path = run_path;
+    file_attr.flush_on_write = true;
+    for(i = 0; i < BENCH_MAX_PAYLOAD_SIZE; i++) payload[i] = (uint8_t)i;
+
+    /* Run Cases */
+    fprintf(json, "{\n  \"library\": \"%s\",\n  \"results\": [", LIBID);
+    int s;
+    for(s = 0; s < BENCH_NUM_STORES; s++)
+    {
+        unsigned int p;
+        if(store_filter >= 0 && s != store_filter) continue;
+
+        for(p = 0; p < sizeof(payload_sizes) / sizeof(payload_sizes[0]); p++)
+        {
+            int bib;
+            if(size_filter > 0 && payload_sizes[p] != size_filter) continue;
+
+            for(bib = 0; bib <= 1; bib++)
+            {
+                const int table_sizes[] = BENCH_CUSTODY_TABLE;
+                int t;
+
+                /* Without custody the active table is not used, so only one size is run */
+                for(t = -1; t < (int)(sizeof(table_sizes) / sizeof(table_sizes[0])); t++)
+                {
+                    bench_case_t bcase;
+                    bench_result_t result;
+
+                    bcase.store = (bench_store_type_t)s;
+                    bcase.payload_size = payload_sizes[p];
+                    bcase.integrity_check = (bib == 1);
+                    bcase.request_custody = (t >= 0);
+                    bcase.active_table_size = (t >= 0) ? table_sizes[t] : BP_DEFAULT_ACTIVE_TABLE_SIZE;
+                    bcase.iterations = iterations;
+                    if(bcase.iterations <= 0)
+                    {
+                        bcase.iterations = BENCH_BYTES_PER_CASE / bcase.payload_size;
+                        if(bcase.iterations < BENCH_MIN_ITERATIONS) bcase.iterations = BENCH_MIN_ITERATIONS;
+                        if(bcase.iterations > BENCH_MAX_ITERATIONS) bcase.iterations = BENCH_MAX_ITERATIONS;
+                    }
+
+                    fprintf(stderr, "%s store, %d byte payloads, bib %s, custody %s, active table %d...\n",
+                            store_names[s], bcase.payload_size, bcase.integrity_check ? "on" : "off",
+                            bcase.request_custody ? "on" : "off", bcase.active_table_size);
+
+                    if(bench_run(&bcase, &result) != BP_SUCCESS) result.failures++;
+                    failures += result.failures;
+                    bench_print(&bcase, &result, first);
+                    first = false;
+                }
+            }
+        }
+    }
+    fprintf(json, "\n  ],\n  \"custody_trees\": [");
+
+    /* Run Custody Tree Cases */
+    first = true;
+    int tree_type;
+    for(tree_type = 0; tree_type < BENCH_NUM_TREES; tree_type++)
+    {
+        int pattern;
+        for(pattern = 0; pattern < BENCH_NUM_PATTERNS; pattern++)
+        {
+            bench_tree_result_t tree_result;
+
+            fprintf(stderr, "%s custody tree, %s custody ids...\n", tree_names[tree_type], pattern_names[pattern]);
+
+            if(bench_tree_run(tree_type, (bench_pattern_t)pattern, &tree_result) != BP_SUCCESS) tree_result.failures++;
+            failures += tree_result.failures;
+            bench_tree_print(tree_type, (bench_pattern_t)pattern, &tree_result, first);
+            first = false;
+        }
+    }
+    fprintf(json, "\n  ],\n  \"active_tables\": [");
+
+    /* Run Active Table Cases
+     *  The circular buffer cannot hold custody ids that span more than the table, so it
+     *  is not run with stragglers, and the robin hood hash is only run with stragglers at
+     *  the smallest size since its collision chains grow with the span of custody ids */
+    first = true;
+    int table_type;
+    for(table_type = 0; table_type < BENCH_NUM_TABLES; table_type++)
+    {
+        const int table_sizes[] = BENCH_TABLE_SIZES;
+        int pattern;
+        for(pattern = 0; pattern < BENCH_NUM_TABLE_PATTERNS; pattern++)
+        {
+            unsigned int t;
+            for(t = 0; t < sizeof(table_sizes) / sizeof(table_sizes[0]); t++)
+            {
+                bench_table_result_t table_result;
+
+                if(pattern == BENCH_STRAGGLERS && table_type == BENCH_NUM_TABLES - 1) continue;
+                if(pattern == BENCH_STRAGGLERS && table_type == BP_ACTIVE_TABLE_RH_HASH && t > 0) continue;
+
+                fprintf(stderr, "%s active table, %s custody ids, %d entries...\n", table_names[table_type], table_pattern_names[pattern], table_sizes[t]);
+
+                if(bench_table_run(table_type, (bench_table_pattern_t)pattern, table_sizes[t], &table_result) != BP_SUCCESS) table_result.failures++;
+                failures += table_result.failures;
+                bench_table_print(table_type, (bench_table_pattern_t)pattern, table_sizes[t], &table_result, first);
+                first = false;
+            }
+        }
+    }
+    fprintf(json, "\n  ],\n  \"contended_channel\": [");
+
+    /* Run Contended Channel Cases */
+    first = true;
+    unsigned int c;
+    for(c = 0; c < sizeof(thread_counts) / sizeof(thread_counts[0]); c++)
+    {
+        bench_contended_result_t contended_result;
+
+        fprintf(stderr, "%d threads storing and loading on one channel...\n", thread_counts[c]);
+
+        if(bench_contended_run(thread_counts[c], &contended_result) != BP_SUCCESS) contended_result.failures++;
+        failures += contended_result.failures;
+        bench_contended_print(thread_counts[c], &contended_result, first);
+        first = false;
+    }
+    fprintf(json, "\n  ]\n}\n");
+    fclose(json);
+
+    bplib_flash_sim_uninitialize();
+    bench_cleanup();
+
+    return failures ? 1 : 0;
+}
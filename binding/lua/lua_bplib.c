@@ -26,6 +26,7 @@
 #include "bplib_store_file.h"
 #include "bplib_store_flash.h"
 #include "bplib_flash_sim.h"
+#include "bplib_link_sim.h"
 
 #include "unittest.h"
 
@@ -54,6 +55,7 @@
 
 #define lualog(m,...) log_message(__FILE__,__LINE__,m,##__VA_ARGS__)
 #define LBPLIB_MAX_LOG_ENTRY 128
+#define LBPLIB_LINK_BUFFER 4096
 
 /******************************************************************************
  TYPEDEFS
@@ -63,6 +65,10 @@ typedef struct {
     bp_desc_t* desc;
 } lbplib_user_data_t;
 
+typedef struct {
+    bp_link_t* link;
+} lbplib_link_data_t;
+
 typedef struct {
     const char* name;
     bool        initialized;
@@ -86,6 +92,8 @@ int lbplib_sleep        (lua_State* L);
 int lbplib_flashsim     (lua_State* L);
 int lbplib_memstat      (lua_State* L);
 int lbplib_shutdown     (lua_State* L);
+int lbplib_linksim      (lua_State* L);
+int lbplib_clock        (lua_State* L);
 
 /* Bundle Protocol Meta Functions */
 int lbplib_delete       (lua_State* L);
@@ -96,8 +104,17 @@ int lbplib_store        (lua_State* L);
 int lbplib_load         (lua_State* L);
 int lbplib_process      (lua_State* L);
 int lbplib_accept       (lua_State* L);
+int lbplib_custody      (lua_State* L);
 int lbplib_flush        (lua_State* L);
 
+/* Link Simulation Meta Functions */
+int lbplib_link_delete  (lua_State* L);
+int lbplib_link_send    (lua_State* L);
+int lbplib_link_recv    (lua_State* L);
+int lbplib_link_schedule (lua_State* L);
+int lbplib_link_next    (lua_State* L);
+int lbplib_link_stats   (lua_State* L);
+
 /* Storage Service Initialization Functions */
 static void local_store_ram_init        (void);
 static void local_store_file_init       (void);
@@ -110,7 +127,9 @@ static void local_store_flash_deinit    (void);
 
 /* Lua Environment Variables */
 static const char* LUA_BPLIBMETANAME = "Lua.bplib";
+static const char* LUA_LINKMETANAME = "Lua.bplib.link";
 static const char* LUA_ERRNO = "errno";
+static bool virtual_clock = false; /* bplib.clock("START") was called */
 
 /* Lua Bplib Library Functions */
 static const struct luaL_Reg lbplib_functions [] = {
@@ -124,6 +143,8 @@ static const struct luaL_Reg lbplib_functions [] = {
     {"flashsim",    lbplib_flashsim},
     {"memstat",     lbplib_memstat},
     {"shutdown",    lbplib_shutdown},
+    {"linksim",     lbplib_linksim},
+    {"clock",       lbplib_clock},
     {NULL, NULL}
 };
 
@@ -136,12 +157,25 @@ static const struct luaL_Reg lbplib_metadata [] = {
     {"load",        lbplib_load},
     {"process",     lbplib_process},
     {"accept",      lbplib_accept},
+    {"custody",     lbplib_custody},
     {"flush",       lbplib_flush},
     {"close",       lbplib_delete},
     {"__gc",        lbplib_delete},
     {NULL, NULL}
 };
 
+/* Lua Bplib Link Simulation Meta Functions */
+static const struct luaL_Reg lbplib_link_metadata [] = {
+    {"send",        lbplib_link_send},
+    {"recv",        lbplib_link_recv},
+    {"schedule",    lbplib_link_schedule},
+    {"next",        lbplib_link_next},
+    {"stats",       lbplib_link_stats},
+    {"close",       lbplib_link_delete},
+    {"__gc",        lbplib_link_delete},
+    {NULL, NULL}
+};
+
 /* Lua Bplib Storage Services */
 static lbplib_store_t lbplib_stores[] =
 {
@@ -160,6 +194,7 @@ static lbplib_store_t lbplib_stores[] =
             .release    = bplib_store_ram_release,
             .relinquish = bplib_store_ram_relinquish,
             .getcount   = bplib_store_ram_getcount,
+            .relinquish_batch = bplib_store_ram_relinquish_batch,
         }
     },
     {
@@ -177,6 +212,7 @@ static lbplib_store_t lbplib_stores[] =
             .release    = bplib_store_file_release,
             .relinquish = bplib_store_file_relinquish,
             .getcount   = bplib_store_file_getcount,
+            .relinquish_batch = bplib_store_file_relinquish_batch,
         }
     },
     {
@@ -194,6 +230,7 @@ static lbplib_store_t lbplib_stores[] =
             .release    = bplib_store_flash_release,
             .relinquish = bplib_store_flash_relinquish,
             .getcount   = bplib_store_flash_getcount,
+            .relinquish_batch = bplib_store_flash_relinquish_batch,
         }
     }
 };
@@ -266,6 +303,18 @@ static void set_errno (lua_State* L, int error_code)
     lua_setglobal(L, LUA_ERRNO);
 }
 
+/*----------------------------------------------------------------------------
+ * get_number_field - returns value of numeric field of table, or default if missing
+ *----------------------------------------------------------------------------*/
+static double get_number_field (lua_State* L, int index, const char* name, double dflt)
+{
+    double value = dflt;
+    lua_getfield(L, index, name);
+    if(lua_isnumber(L, -1)) value = lua_tonumber(L, -1);
+    lua_pop(L, 1);
+    return value;
+}
+
 /*----------------------------------------------------------------------------
  * push_flag_table
  *----------------------------------------------------------------------------*/
@@ -405,6 +454,13 @@ int luaopen_bplib (lua_State *L)
     /* Associate Meta Data */
     luaL_setfuncs(L, lbplib_metadata, 0);
 
+    /* Create Link User Data */
+    luaL_newmetatable(L, LUA_LINKMETANAME);
+    lua_pushvalue(L, -1);
+    lua_setfield(L, -2, "__index");
+    luaL_setfuncs(L, lbplib_link_metadata, 0);
+    lua_pop(L, 1);
+
     /* Create Functions */
     luaL_newlib(L, lbplib_functions);
 
@@ -496,31 +552,49 @@ int lbplib_open (lua_State* L)
         lua_getfield(L, 6, "max_length");
         lua_getfield(L, 6, "cid_reuse");
         lua_getfield(L, 6, "dacs_rate");
+        lua_getfield(L, 6, "max_load_length");
+        lua_getfield(L, 6, "fast_retransmit");
         lua_getfield(L, 6, "protocol_version");
         lua_getfield(L, 6, "retransmit_order");
+        lua_getfield(L, 6, "active_table");
+        lua_getfield(L, 6, "custody_tree");
+        lua_getfield(L, 6, "custody_shards");
+        lua_getfield(L, 6, "dacs_policy");
         lua_getfield(L, 6, "active_table_size");
         lua_getfield(L, 6, "max_fills_per_dacs");
         lua_getfield(L, 6, "max_gaps_per_dacs");
+        lua_getfield(L, 6, "max_reassembly_size");
+        lua_getfield(L, 6, "duplicate_cache_size");
         lua_getfield(L, 6, "persistent_storage");
+        lua_getfield(L, 6, "checkpoint_rate");
 
         /* Get Attributes from Stack */
-        attributes.lifetime             = luaL_optnumber(L, -17, attributes.lifetime);
-        attributes.request_custody      = luaL_optnumber(L, -16, attributes.request_custody) != 0.0;
-        attributes.admin_record         = luaL_optnumber(L, -15, attributes.admin_record) != 0.0;
-        attributes.integrity_check      = luaL_optnumber(L, -14, attributes.integrity_check) != 0.0;
-        attributes.allow_fragmentation  = luaL_optnumber(L, -13, attributes.allow_fragmentation) != 0.0;
-        attributes.ignore_expiration    = luaL_optnumber(L, -12, attributes.ignore_expiration) != 0.0;
-        attributes.cipher_suite         = luaL_optnumber(L, -11, attributes.cipher_suite);
-        attributes.timeout              = luaL_optnumber(L, -10, attributes.timeout);
-        attributes.max_length           = luaL_optnumber(L, -9,  attributes.max_length);
-        attributes.cid_reuse            = luaL_optnumber(L, -8,  attributes.cid_reuse);
-        attributes.dacs_rate            = luaL_optnumber(L, -7,  attributes.dacs_rate);
-        attributes.protocol_version     = luaL_optnumber(L, -6,  attributes.protocol_version);
-        attributes.retransmit_order     = luaL_optnumber(L, -5,  attributes.retransmit_order);
-        attributes.active_table_size    = luaL_optnumber(L, -4,  attributes.active_table_size);
-        attributes.max_fills_per_dacs   = luaL_optnumber(L, -3,  attributes.max_fills_per_dacs);
-        attributes.max_gaps_per_dacs    = luaL_optnumber(L, -2,  attributes.max_gaps_per_dacs);
-        attributes.persistent_storage   = luaL_optnumber(L, -1,  attributes.persistent_storage) != 0.0;
+        attributes.lifetime             = luaL_optnumber(L, -26, attributes.lifetime);
+        attributes.request_custody      = luaL_optnumber(L, -25, attributes.request_custody) != 0.0;
+        attributes.admin_record         = luaL_optnumber(L, -24, attributes.admin_record) != 0.0;
+        attributes.integrity_check      = luaL_optnumber(L, -23, attributes.integrity_check) != 0.0;
+        attributes.allow_fragmentation  = luaL_optnumber(L, -22, attributes.allow_fragmentation) != 0.0;
+        attributes.ignore_expiration    = luaL_optnumber(L, -21, attributes.ignore_expiration) != 0.0;
+        attributes.cipher_suite         = luaL_optnumber(L, -20, attributes.cipher_suite);
+        attributes.timeout              = luaL_optnumber(L, -19, attributes.timeout);
+        attributes.max_length           = luaL_optnumber(L, -18, attributes.max_length);
+        attributes.cid_reuse            = luaL_optnumber(L, -17, attributes.cid_reuse);
+        attributes.dacs_rate            = luaL_optnumber(L, -16, attributes.dacs_rate);
+        attributes.max_load_length      = luaL_optnumber(L, -15, attributes.max_load_length);
+        attributes.fast_retransmit      = luaL_optnumber(L, -14, attributes.fast_retransmit);
+        attributes.protocol_version     = luaL_optnumber(L, -13, attributes.protocol_version);
+        attributes.retransmit_order     = luaL_optnumber(L, -12, attributes.retransmit_order);
+        attributes.active_table         = luaL_optnumber(L, -11, attributes.active_table);
+        attributes.custody_tree         = luaL_optnumber(L, -10, attributes.custody_tree);
+        attributes.custody_shards       = luaL_optnumber(L, -9,  attributes.custody_shards);
+        attributes.dacs_policy          = luaL_optnumber(L, -8,  attributes.dacs_policy);
+        attributes.active_table_size    = luaL_optnumber(L, -7,  attributes.active_table_size);
+        attributes.max_fills_per_dacs   = luaL_optnumber(L, -6,  attributes.max_fills_per_dacs);
+        attributes.max_gaps_per_dacs    = luaL_optnumber(L, -5,  attributes.max_gaps_per_dacs);
+        attributes.max_reassembly_size  = luaL_optnumber(L, -4,  attributes.max_reassembly_size);
+        attributes.duplicate_cache_size = luaL_optnumber(L, -3,  attributes.duplicate_cache_size);
+        attributes.persistent_storage   = luaL_optnumber(L, -2,  attributes.persistent_storage) != 0.0;
+        attributes.checkpoint_rate      = luaL_optnumber(L, -1,  attributes.checkpoint_rate);
         attributes.storage_service_parm = NULL;
     }
 
@@ -781,6 +855,51 @@ int lbplib_unittest (lua_State* L)
             {
                 failures += bplib_unittest_flash();
             }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("REASM", test) == 0))
+            {
+                failures += bplib_unittest_reasm();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("DEDUP", test) == 0))
+            {
+                failures += bplib_unittest_dedup();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("LOCKS", test) == 0))
+            {
+                failures += bplib_unittest_locks();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("MEMORY", test) == 0))
+            {
+                failures += bplib_unittest_memory();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("LOG", test) == 0))
+            {
+                failures += bplib_unittest_log();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("RECORD", test) == 0))
+            {
+                failures += bplib_unittest_record();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("RANGE", test) == 0))
+            {
+                failures += bplib_unittest_range_array();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("SWISS", test) == 0))
+            {
+                failures += bplib_unittest_swiss_table();
+            }
+
+            if((strcmp("ALL", test) == 0) || (strcmp("LINK", test) == 0))
+            {
+                failures += bplib_unittest_link_sim();
+            }
         }
     }
 
@@ -790,13 +909,19 @@ int lbplib_unittest (lua_State* L)
 }
 
 /*----------------------------------------------------------------------------
- * lbplib_sleep - bplib.sleep(s) --> sleeps for 's' number of seconds
+ * lbplib_sleep - bplib.sleep(s) --> sleeps for 's' number of seconds,
+ *  of virtual time if the virtual clock is running
  *----------------------------------------------------------------------------*/
 int lbplib_sleep (lua_State* L)
 {
     if(lua_isnumber(L, 1))
     {
         double wait_time = lua_tonumber(L, 1); /* seconds */
+        if(virtual_clock)
+        {
+            bplib_os_vclock_advance((unsigned long)(wait_time * 1000));
+            return 0;
+        }
 #ifdef _WINDOWS_
         int wait_msecs = (int)(wait_time * 1000);
         Sleep(wait_msecs); /* milliseconds */
@@ -925,6 +1050,105 @@ int lbplib_shutdown (lua_State* L)
     return 0;
 }
 
+/*----------------------------------------------------------------------------
+ * lbplib_linksim - bplib.linksim({<attribute>=<value>, ...}) --> link
+ *
+ *  attributes: loss, delay, jitter, reorder, reorderdelay, bandwidth, queue, seed
+ *  (rates are probabilities, times are milliseconds of virtual time)
+ *----------------------------------------------------------------------------*/
+int lbplib_linksim (lua_State* L)
+{
+    bp_link_attr_t attr;
+    bplib_link_sim_attrinit(&attr);
+
+    /* Get Attributes */
+    if(lua_istable(L, 1))
+    {
+        attr.loss_rate      = get_number_field(L, 1, "loss", attr.loss_rate);
+        attr.delay          = (unsigned long)get_number_field(L, 1, "delay", attr.delay);
+        attr.jitter         = (unsigned long)get_number_field(L, 1, "jitter", attr.jitter);
+        attr.reorder_rate   = get_number_field(L, 1, "reorder", attr.reorder_rate);
+        attr.reorder_delay  = (unsigned long)get_number_field(L, 1, "reorderdelay", attr.reorder_delay);
+        attr.bandwidth      = (unsigned long)get_number_field(L, 1, "bandwidth", attr.bandwidth);
+        attr.queue_limit    = (int)get_number_field(L, 1, "queue", attr.queue_limit);
+        attr.seed           = (uint32_t)get_number_field(L, 1, "seed", attr.seed);
+    }
+    else if(!lua_isnoneornil(L, 1))
+    {
+        lualog("incorrect parameter type - expected table of attributes\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    /* Create Link */
+    bp_link_t* link = bplib_link_sim_create(&attr);
+    if(link == NULL)
+    {
+        lualog("failed to create link\n");
+        lua_pushnil(L);
+        return 1;
+    }
+
+    /* Create User Data */
+    lbplib_link_data_t* link_data = (lbplib_link_data_t*)lua_newuserdata(L, sizeof(lbplib_link_data_t));
+    link_data->link = link;
+    luaL_getmetatable(L, LUA_LINKMETANAME);
+    lua_setmetatable(L, -2);
+
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_clock - bplib.clock("START", s, t)    virtual time starts at s seconds since 2000 and
+ *                                              jumps when t threads (default 1) are all waiting
+ *                bplib.clock("ADVANCE", ms)    virtual time moves forward ms milliseconds
+ *                bplib.clock("NOW") -->        milliseconds since virtual time started
+ *                bplib.clock("STOP")           library returns to real time
+ *----------------------------------------------------------------------------*/
+int lbplib_clock (lua_State* L)
+{
+    if(!lua_isstring(L, 1))
+    {
+        lualog("clock requires command string");
+        return 0;
+    }
+
+    const char* cmdstr = lua_tostring(L, 1);
+    if(strcmp(cmdstr, "START") == 0)
+    {
+        unsigned long start = 0;
+        if(lua_isnumber(L, 2)) start = (unsigned long)lua_tonumber(L, 2);
+        else bplib_os_systime(&start);
+        int threads = 1;
+        if(lua_isnumber(L, 3)) threads = (int)lua_tonumber(L, 3);
+        bplib_os_vclock_start(start, threads);
+        virtual_clock = true;
+        return 0;
+    }
+    else if(strcmp(cmdstr, "ADVANCE") == 0)
+    {
+        if(lua_isnumber(L, 2)) bplib_os_vclock_advance((unsigned long)lua_tonumber(L, 2));
+        else lualog("did not provide milliseconds to advance");
+        return 0;
+    }
+    else if(strcmp(cmdstr, "NOW") == 0)
+    {
+        lua_pushnumber(L, bplib_os_vclock_now());
+        return 1;
+    }
+    else if(strcmp(cmdstr, "STOP") == 0)
+    {
+        bplib_os_vclock_stop();
+        virtual_clock = false;
+        return 0;
+    }
+    else
+    {
+        lualog("unrecognized command string: %s", cmdstr);
+        return 0;
+    }
+}
+
 /******************************************************************************
  BUNDLE PROTOCOL META FUNCTIONS
  ******************************************************************************/
@@ -1093,6 +1317,26 @@ int lbplib_getopt (lua_State* L)
         lua_pushnumber(L, lua_rate);
         return 2;
     }
+    else if(strcmp(optstr, "MAX_LOAD_LENGTH") == 0)
+    {
+        int len;
+        int status = bplib_config(bplib_data->desc, BP_OPT_MODE_READ, BP_OPT_MAX_LOAD_LENGTH, &len);
+        set_errno(L, status);
+        lua_pushboolean(L, status == BP_SUCCESS);
+        double lua_len = (double)len;
+        lua_pushnumber(L, lua_len);
+        return 2;
+    }
+    else if(strcmp(optstr, "FAST_RETRANSMIT") == 0)
+    {
+        int tolerance;
+        int status = bplib_config(bplib_data->desc, BP_OPT_MODE_READ, BP_OPT_FAST_RETRANSMIT, &tolerance);
+        set_errno(L, status);
+        lua_pushboolean(L, status == BP_SUCCESS);
+        double lua_tolerance = (double)tolerance;
+        lua_pushnumber(L, lua_tolerance);
+        return 2;
+    }
 
     /* Unrecognized Option */
     lualog("unrecognized option: %s\n", optstr);
@@ -1189,6 +1433,16 @@ int lbplib_setopt (lua_State* L)
         int rate = (int)lua_tonumber(L, 3);
         status = bplib_config(bplib_data->desc, BP_OPT_MODE_WRITE, BP_OPT_DACS_RATE, &rate);
     }
+    else if((strcmp(optstr, "MAX_LOAD_LENGTH") == 0) && lua_isnumber(L, 3))
+    {
+        int len = (int)lua_tonumber(L, 3);
+        status = bplib_config(bplib_data->desc, BP_OPT_MODE_WRITE, BP_OPT_MAX_LOAD_LENGTH, &len);
+    }
+    else if((strcmp(optstr, "FAST_RETRANSMIT") == 0) && lua_isnumber(L, 3))
+    {
+        int tolerance = (int)lua_tonumber(L, 3);
+        status = bplib_config(bplib_data->desc, BP_OPT_MODE_WRITE, BP_OPT_FAST_RETRANSMIT, &tolerance);
+    }
 
     /* Return Status */
     set_errno(L, status);
@@ -1259,6 +1513,14 @@ int lbplib_stats (lua_State* L)
     lua_pushnumber(L, stats.received_dacs);
     lua_settable(L, -3);
 
+    lua_pushstring(L, "dacs_cids");
+    lua_pushnumber(L, stats.dacs_cids);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "dacs_bytes");
+    lua_pushnumber(L, stats.dacs_bytes);
+    lua_settable(L, -3);
+
     lua_pushstring(L, "stored_bundles");
     lua_pushnumber(L, stats.stored_bundles);
     lua_settable(L, -3);
@@ -1494,6 +1756,53 @@ int lbplib_accept (lua_State* L)
     return 3;
 }
 
+/*----------------------------------------------------------------------------
+ * lbplib_custody
+ *----------------------------------------------------------------------------*/
+int lbplib_custody (lua_State* L)
+{
+    /* Get User Data */
+    lbplib_user_data_t* bplib_data = (lbplib_user_data_t*)luaL_checkudata(L, 1, LUA_BPLIBMETANAME);
+    if(!bplib_data)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_BPLIBMETANAME);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Check Number of Parameters */
+    int minargs = 2;
+    if(lua_gettop(L) != minargs)
+    {
+        lualog("incorrect number of parameters - expected %d\n", minargs);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Type Check Parameters */
+    if(!lua_isnumber(L, 2))
+    {
+        lualog("incorrect parameter type\n");
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Generate Custody Signals */
+    uint32_t custflags = 0;
+    int timeout = (int)lua_tonumber(L, 2);
+    int status = bplib_custody(bplib_data->desc, timeout, &custflags);
+    set_errno(L, status);
+
+    /* Return Status */
+    lua_pushboolean(L, status == BP_SUCCESS);
+
+    /* Return Flags */
+    push_flag_table(L, custflags);
+
+    /* Return Number of Results */
+    return 2;
+}
+
 /*----------------------------------------------------------------------------
  * lbplib_flush
  *----------------------------------------------------------------------------*/
@@ -1513,3 +1822,239 @@ int lbplib_flush (lua_State* L)
 
     return 0;
 }
+
+/******************************************************************************
+ LINK SIMULATION META FUNCTIONS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * lbplib_link_delete
+ *----------------------------------------------------------------------------*/
+int lbplib_link_delete (lua_State* L)
+{
+    /* Get User Data */
+    lbplib_link_data_t* link_data = (lbplib_link_data_t*)luaL_checkudata(L, 1, LUA_LINKMETANAME);
+    if(!link_data)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_LINKMETANAME);
+    }
+    else if(link_data->link)
+    {
+        /* Destroy Link */
+        bplib_link_sim_destroy(link_data->link);
+        link_data->link = NULL;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_link_send - link:send(<bundle>) --> return code
+ *
+ *  success does not mean the bundle will be delivered
+ *----------------------------------------------------------------------------*/
+int lbplib_link_send (lua_State* L)
+{
+    /* Get User Data */
+    lbplib_link_data_t* link_data = (lbplib_link_data_t*)luaL_checkudata(L, 1, LUA_LINKMETANAME);
+    if(!link_data || !link_data->link)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_LINKMETANAME);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Type Check Parameters */
+    if(!lua_isstring(L, 2))
+    {
+        lualog("incorrect parameter type\n");
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Send Bundle */
+    size_t size = 0;
+    const char* bundle = lua_tolstring(L, 2, &size);
+    int status = bplib_link_sim_send(link_data->link, bundle, (int)size);
+    set_errno(L, status);
+
+    /* Return Status */
+    lua_pushboolean(L, status == BP_SUCCESS);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_link_recv - link:recv() --> return code, bundle
+ *----------------------------------------------------------------------------*/
+int lbplib_link_recv (lua_State* L)
+{
+    /* Get User Data */
+    lbplib_link_data_t* link_data = (lbplib_link_data_t*)luaL_checkudata(L, 1, LUA_LINKMETANAME);
+    if(!link_data || !link_data->link)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_LINKMETANAME);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Receive Bundle */
+    char buffer[LBPLIB_LINK_BUFFER];
+    char* bundle = buffer;
+    int size = sizeof(buffer);
+    int status = bplib_link_sim_recv(link_data->link, bundle, &size);
+    if(status == BP_ERROR && size > LBPLIB_LINK_BUFFER)
+    {
+        /* Retry with Buffer Large Enough for Bundle */
+        bundle = (char*)malloc(size);
+        if(bundle) status = bplib_link_sim_recv(link_data->link, bundle, &size);
+    }
+    set_errno(L, status);
+
+    /* Return Status and Bundle */
+    lua_pushboolean(L, status == BP_SUCCESS);
+    if(status == BP_SUCCESS)    lua_pushlstring(L, bundle, size);
+    else                        lua_pushnil(L);
+
+    if(bundle && bundle != buffer) free(bundle);
+    return 2;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_link_schedule - link:schedule({{<start>, <stop>}, ...}, <period>) --> return code
+ *
+ *  times are milliseconds of virtual time, an empty table keeps the link up
+ *----------------------------------------------------------------------------*/
+int lbplib_link_schedule (lua_State* L)
+{
+    int i;
+
+    /* Get User Data */
+    lbplib_link_data_t* link_data = (lbplib_link_data_t*)luaL_checkudata(L, 1, LUA_LINKMETANAME);
+    if(!link_data || !link_data->link)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_LINKMETANAME);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Type Check Parameters */
+    if(!lua_istable(L, 2))
+    {
+        lualog("incorrect parameter type - expected table of contacts\n");
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Get Contacts */
+    int count = (int)lua_rawlen(L, 2);
+    unsigned long period = lua_isnumber(L, 3) ? (unsigned long)lua_tonumber(L, 3) : 0;
+    bp_contact_t* contacts = NULL;
+    if(count > 0)
+    {
+        contacts = (bp_contact_t*)malloc(sizeof(bp_contact_t) * count);
+        if(contacts == NULL)
+        {
+            lua_pushboolean(L, false); /* push result as fail */
+            return 1;
+        }
+
+        for(i = 0; i < count; i++)
+        {
+            lua_rawgeti(L, 2, i + 1);
+            lua_rawgeti(L, -1, 1);
+            lua_rawgeti(L, -2, 2);
+            contacts[i].start = (unsigned long)lua_tonumber(L, -2);
+            contacts[i].stop = (unsigned long)lua_tonumber(L, -1);
+            lua_pop(L, 3);
+        }
+    }
+
+    /* Set Schedule */
+    int status = bplib_link_sim_schedule(link_data->link, contacts, count, period);
+    set_errno(L, status);
+    if(contacts) free(contacts);
+
+    /* Return Status */
+    lua_pushboolean(L, status == BP_SUCCESS);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_link_next - link:next() --> milliseconds of virtual time of next delivery, or nil
+ *----------------------------------------------------------------------------*/
+int lbplib_link_next (lua_State* L)
+{
+    /* Get User Data */
+    lbplib_link_data_t* link_data = (lbplib_link_data_t*)luaL_checkudata(L, 1, LUA_LINKMETANAME);
+    if(!link_data || !link_data->link)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_LINKMETANAME);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    /* Return Time of Next Delivery */
+    unsigned long next = bplib_link_sim_next(link_data->link);
+    if(next == LINK_SIM_NEVER)  lua_pushnil(L);
+    else                        lua_pushnumber(L, next);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------
+ * lbplib_link_stats - link:stats() --> return code, statistics table
+ *----------------------------------------------------------------------------*/
+int lbplib_link_stats (lua_State* L)
+{
+    /* Get User Data */
+    lbplib_link_data_t* link_data = (lbplib_link_data_t*)luaL_checkudata(L, 1, LUA_LINKMETANAME);
+    if(!link_data || !link_data->link)
+    {
+        lualog("unable to retrieve user data object: %s\n", LUA_LINKMETANAME);
+        lua_pushboolean(L, false); /* push result as fail */
+        return 1;
+    }
+
+    /* Get Statistics */
+    bp_link_stats_t stats;
+    int status = bplib_link_sim_stats(link_data->link, &stats);
+    set_errno(L, status);
+    lua_pushboolean(L, status == BP_SUCCESS);
+
+    /* Create Statistics Table */
+    lua_newtable(L);
+
+    lua_pushstring(L, "sent");
+    lua_pushnumber(L, stats.sent);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "delivered");
+    lua_pushnumber(L, stats.delivered);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "lost");
+    lua_pushnumber(L, stats.lost);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "disconnected");
+    lua_pushnumber(L, stats.disconnected);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "overflowed");
+    lua_pushnumber(L, stats.overflowed);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "reordered");
+    lua_pushnumber(L, stats.reordered);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "in_flight");
+    lua_pushnumber(L, stats.in_flight);
+    lua_settable(L, -3);
+
+    lua_pushstring(L, "delivered_bytes");
+    lua_pushnumber(L, stats.delivered_bytes);
+    lua_settable(L, -3);
+
+    /* Return Number of Results */
+    return 2;
+}
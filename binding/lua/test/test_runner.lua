@@ -22,6 +22,7 @@ runner.script(rd .. "ut_active_table.lua", {"RAM", "SMALLEST"})
 runner.script(rd .. "ut_active_table.lua", {"RAM", "OLDEST"})
 runner.script(rd .. "ut_active_table.lua", {"FLASH", "SMALLEST"})
 runner.script(rd .. "ut_active_table.lua", {"FLASH", "OLDEST"})
+runner.script(rd .. "ut_active_table.lua", {"RAM", "OLDEST", "SWISS"})
 runner.script(rd .. "ut_bundle_timeout.lua", {"RAM"})
 runner.script(rd .. "ut_bundle_timeout.lua", {"FILE"})
 runner.script(rd .. "ut_bundle_timeout.lua", {"FLASH"})
@@ -34,9 +35,21 @@ runner.script(rd .. "ut_dacs_continuous.lua", {"FLASH"})
 runner.script(rd .. "ut_dacs_skip.lua", {"RAM"})
 runner.script(rd .. "ut_dacs_skip.lua", {"FILE"})
 runner.script(rd .. "ut_dacs_skip.lua", {"FLASH"})
+runner.script(rd .. "ut_custody_worker.lua", {"RAM"})
+runner.script(rd .. "ut_custody_worker.lua", {"FILE"})
+runner.script(rd .. "ut_fast_retransmit.lua", {"RAM"})
+runner.script(rd .. "ut_fast_retransmit.lua", {"FILE"})
 runner.script(rd .. "ut_high_loss.lua", {"RAM"})
 runner.script(rd .. "ut_high_loss.lua", {"FILE"})
 runner.script(rd .. "ut_high_loss.lua", {"FLASH", 100})
+runner.script(rd .. "ut_link_sim.lua", {"RAM"})
+runner.script(rd .. "ut_link_sim.lua", {"FILE"})
+runner.script(rd .. "ut_fragmentation.lua", {"RAM"})
+runner.script(rd .. "ut_fragmentation.lua", {"FILE"})
+runner.script(rd .. "ut_duplicates.lua", {"RAM"})
+runner.script(rd .. "ut_duplicates.lua", {"FILE"})
+runner.script(rd .. "ut_forwarding.lua", {"RAM"})
+runner.script(rd .. "ut_forwarding.lua", {"FILE"})
 runner.script(rd .. "ut_unittest.lua")
 
 -- Check for Memory Leaks --
@@ -15,6 +15,8 @@ else
 	retx_order = bp.RETX_OLDEST_BUNDLE
 end
 
+local active_table = (arg[3] == "SWISS") and 1 or 0
+
 local src_node = 4
 local src_serv = 3
 local dst_node = 72
@@ -23,7 +25,7 @@ local dst_serv = 43
 local num_bundles = 8
 local timeout = 1
 local cid_reuse = (retx_order == bp.RETX_SMALLEST_CID) and 0 or 1
-local attributes = {cid_reuse=cid_reuse, retransmit_order=retx_order, active_table_size=num_bundles, timeout=timeout}
+local attributes = {cid_reuse=cid_reuse, retransmit_order=retx_order, active_table=active_table, active_table_size=num_bundles, timeout=timeout}
 
 local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store, attributes)
 
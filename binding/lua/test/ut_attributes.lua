@@ -58,6 +58,86 @@ if ch then
 	ch:close()
 end
 
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 3 - custody shards', store, src))
+ch = bplib.open(72, 43, 4, 3, store, {custody_shards=0})
+runner.check(ch == nil, "Channel opened with zero custody shards")
+num_bundles = 16
+sender = bplib.open(4, 3, 72, 43, store)
+receiver = bplib.open(72, 43, 4, 3, store, {custody_shards=4, dacs_rate=1})
+runner.check(sender ~= nil)
+runner.check(receiver ~= nil)
+if sender and receiver then
+	-- send bundles --
+	for i=1,num_bundles do
+		rc, flags = sender:store(string.format('HELLO WORLD %d', i), 1000)
+		runner.check(rc)
+		rc, bundle, flags = sender:load(1000)
+		runner.check(rc)
+		rc, flags = receiver:process(bundle, 1000)
+		runner.check(rc)
+		rc, payload, flags = receiver:accept(1000)
+		runner.check(rc)
+	end
+
+	-- acknowledge bundles --
+	bplib.sleep(1)
+	rc, dacs, flags = receiver:load(1000)
+	runner.check(rc)
+	rc, flags = sender:process(dacs, 1000)
+	runner.check(rc)
+	rc, stats = sender:stats()
+	runner.check(bp.check_stats(stats, {acknowledged_bundles=num_bundles, active_bundles=0}))
+
+	-- close channels --
+	sender:close()
+	receiver:close()
+end
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 4 - adaptive dacs policy', store, src))
+num_bundles = 40
+sender = bplib.open(4, 3, 72, 43, store)
+receiver = bplib.open(72, 43, 4, 3, store, {dacs_policy=1, max_fills_per_dacs=8, dacs_rate=100, timeout=0})
+runner.check(sender ~= nil)
+runner.check(receiver ~= nil)
+if sender and receiver then
+	-- send bundles, skipping every other one --
+	for i=1,num_bundles do
+		rc, flags = sender:store(string.format('HELLO WORLD %d', i), 1000)
+		runner.check(rc)
+		rc, bundle, flags = sender:load(1000)
+		runner.check(rc)
+		if i % 2 == 0 then
+			rc, flags = receiver:process(bundle, 1000)
+			runner.check(rc)
+			rc, payload, flags = receiver:accept(1000)
+			runner.check(rc)
+		end
+	end
+
+	-- dacs sent once four ranges pending, without waiting for dacs rate --
+	num_dacs = 0
+	while true do
+		rc, dacs, flags = receiver:load(0)
+		if not rc then break end
+		num_dacs = num_dacs + 1
+		rc, flags = sender:process(dacs, 1000)
+		runner.check(rc)
+	end
+	runner.check(num_dacs == 5, string.format('Expected 5 dacs, received %d', num_dacs))
+	rc, stats = receiver:stats()
+	runner.check(stats.dacs_cids == (num_bundles / 2))
+	runner.check(stats.dacs_bytes > 0)
+	rc, stats = sender:stats()
+	runner.check(bp.check_stats(stats, {acknowledged_bundles=(num_bundles / 2)}))
+
+	-- close channels --
+	sender:flush()
+	sender:close()
+	receiver:close()
+end
+
 -- Clean Up --
 
 runner.cleanup(bplib, store)
@@ -0,0 +1,109 @@
+local bplib = require("bplib")
+local runner = require("bptest")
+local bp = require("bp")
+local rd = runner.rootdir(arg[0])
+local src = runner.srcscript()
+
+-- Setup --
+
+local store = arg[1] or "RAM"
+runner.setup(bplib, store)
+
+local src_node = 4
+local src_serv = 3
+local dst_node = 72
+local dst_serv = 43
+
+local num_bundles = 64
+local dacs_rate = 2
+
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store)
+local receiver = bplib.open(dst_node, dst_serv, src_node, src_serv, store)
+
+rc = receiver:setopt("DACS_RATE", dacs_rate)
+runner.check(rc)
+
+-- Local Functions --
+
+local function send_bundles(first, last)
+    for i=first,last do
+        payload = string.format('HELLO WORLD %d', i)
+
+        -- store payload --
+        rc, flags = sender:store(payload, 1000)
+        runner.check(rc)
+        runner.check(bp.check_flags(flags, {}), "flags set on store")
+
+        -- load bundle --
+        rc, bundle, flags = sender:load(1000)
+        runner.check(rc)
+        runner.check(bundle ~= nil, string.format('Sender failed to load bundle %s', payload))
+
+        -- process bundle --
+        rc, flags = receiver:process(bundle, 1000)
+        runner.check(rc)
+
+        -- accept payload --
+        rc, app_payload, flags = receiver:accept(1000)
+        runner.check(rc)
+        runner.check(bp.match_payload(app_payload, payload), string.format('Error - payload %s did not match: %s', app_payload, payload))
+    end
+end
+
+local function ack_bundles()
+    local num_dacs = 0
+    while true do
+        rc, bundle, flags = receiver:load(0)
+        if rc then
+            rc, flags = sender:process(bundle, 1000)
+            runner.check(rc)
+            runner.check(bp.check_flags(flags, {}), "flags set on sender process")
+            num_dacs = num_dacs + 1
+        else
+            break
+        end
+    end
+    return num_dacs
+end
+
+-- Test --
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 1 - custody signals generated by worker', store, src))
+
+-- first custody signal is due immediately --
+send_bundles(1, num_bundles / 2)
+rc, flags = receiver:custody(0)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}), "flags set on custody")
+runner.check(ack_bundles() == 1)
+
+-- next custody signal waits for the dacs rate --
+send_bundles((num_bundles / 2) + 1, num_bundles)
+rc, flags = receiver:custody(0)
+runner.check(rc == false)
+runner.check(ack_bundles() == 0)
+rc, flags = receiver:custody((dacs_rate + 1) * 1000)
+runner.check(rc)
+runner.check(ack_bundles() == 1)
+
+-- nothing left to acknowledge --
+rc, flags = receiver:custody(0)
+runner.check(rc == false)
+
+-- check stats --
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {transmitted_bundles=num_bundles, acknowledged_bundles=num_bundles, active_bundles=0}))
+rc, stats = receiver:stats()
+runner.check(bp.check_stats(stats, {transmitted_dacs=2, stored_dacs=0}))
+
+-- Clean Up --
+
+sender:close()
+receiver:close()
+
+runner.cleanup(bplib, store)
+
+-- Report Results --
+
+runner.report(bplib)
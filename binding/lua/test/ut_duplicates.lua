@@ -0,0 +1,114 @@
+local bplib = require("bplib")
+local runner = require("bptest")
+local bp = require("bp")
+local rd = runner.rootdir(arg[0])
+local src = runner.srcscript()
+
+-- Setup --
+
+local store = arg[1] or "RAM"
+runner.setup(bplib, store)
+
+local src_node = 4
+local src_serv = 3
+local dst_node = 72
+local dst_serv = 43
+
+local num_bundles = 16
+
+-- Local Functions --
+
+local function send_twice(sender, receiver, dupflags)
+    for i=1,num_bundles do
+        payload = string.format('HELLO WORLD %d', i)
+
+        -- store payload --
+        rc, flags = sender:store(payload, 1000)
+        runner.check(rc)
+
+        -- load bundle --
+        rc, bundle, flags = sender:load(1000)
+        runner.check(rc)
+        runner.check(bundle ~= nil)
+
+        -- process bundle twice (as if retransmitted) --
+        rc, flags = receiver:process(bundle, 1000)
+        runner.check(rc)
+        runner.check(bp.check_flags(flags, {}), "Flags set on first receiver process")
+        rc, flags = receiver:process(bundle, 1000)
+        runner.check(rc)
+        runner.check(bp.check_flags(flags, dupflags), "Unexpected flags set on second receiver process")
+    end
+end
+
+local function acknowledge(sender, receiver)
+    bplib.sleep(1)
+    while true do
+        rc, bundle, flags = receiver:load(0)
+        if not rc then break end
+        rc, flags = sender:process(bundle, 1000)
+        runner.check(rc)
+    end
+end
+
+local function drain(receiver)
+    local accepted = 0
+    while true do
+        rc, payload, flags = receiver:accept(0)
+        if not rc then break end
+        accepted = accepted + 1
+    end
+    return accepted
+end
+
+-- Test --
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 1 - duplicates delivered when cache disabled', store, src))
+
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store)
+local receiver = bplib.open(dst_node, dst_serv, src_node, src_serv, store)
+runner.check(receiver:setopt("DACS_RATE", 1))
+
+send_twice(sender, receiver, {"duplicates"})
+rc, stats = receiver:stats()
+runner.check(bp.check_stats(stats, {received_bundles=num_bundles*2, stored_payloads=num_bundles*2}))
+
+acknowledge(sender, receiver)
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {stored_bundles=0, acknowledged_bundles=num_bundles}))
+
+local accepted = drain(receiver)
+runner.check(accepted == num_bundles*2, string.format('Accepted %d payloads', accepted))
+
+sender:close()
+receiver:close()
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 2 - duplicates dropped and acknowledged', store, src))
+
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store)
+local receiver = bplib.open(dst_node, dst_serv, src_node, src_serv, store, { duplicate_cache_size = num_bundles })
+runner.check(receiver:setopt("DACS_RATE", 1))
+
+send_twice(sender, receiver, {"duplicates"})
+rc, stats = receiver:stats()
+runner.check(bp.check_stats(stats, {received_bundles=num_bundles*2, stored_payloads=num_bundles}))
+
+acknowledge(sender, receiver)
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {stored_bundles=0, acknowledged_bundles=num_bundles}))
+
+local accepted = drain(receiver)
+runner.check(accepted == num_bundles, string.format('Accepted %d payloads', accepted))
+
+sender:close()
+receiver:close()
+
+-- Clean Up --
+
+runner.cleanup(bplib, store)
+
+-- Report Results --
+
+runner.report(bplib)
@@ -0,0 +1,141 @@
+local bplib = require("bplib")
+local runner = require("bptest")
+local bp = require("bp")
+local rd = runner.rootdir(arg[0])
+local src = runner.srcscript()
+
+-- Setup --
+
+local store = arg[1] or "RAM"
+runner.setup(bplib, store)
+
+local src_node = 4
+local src_serv = 3
+local dst_node = 72
+local dst_serv = 43
+
+local num_bundles = 64
+local skip = 8
+local max_missing_ranges = 64 -- BP_MAX_MISSING_RANGES
+local timeout = 60
+
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store)
+local receiver = bplib.open(dst_node, dst_serv, src_node, src_serv, store)
+
+runner.check(sender:setopt("TIMEOUT", timeout))
+runner.check(receiver:setopt("DACS_RATE", 1))
+
+-- Local Functions --
+
+local function send_bundles(first, count)
+    count = count or num_bundles
+    for i=first,first+count-1 do
+        payload = string.format('HELLO WORLD %d', i)
+
+        -- store payload --
+        rc, flags = sender:store(payload, 1000)
+        runner.check(rc)
+        runner.check(bp.check_flags(flags, {}), "Flags set on sender store")
+
+        -- load bundle --
+        rc, bundle, flags = sender:load(1000)
+        runner.check(rc)
+        runner.check(bundle ~= nil, string.format('Sender failed to load bundle %s', payload))
+
+        -- process bundle (dropping every eighth one) --
+        if i % skip ~= 0 then
+            rc, flags = receiver:process(bundle, 1000)
+            runner.check(rc)
+        end
+    end
+end
+
+local function process_dacs()
+    bplib.sleep(1)
+    while true do
+        rc, bundle, flags = receiver:load(0)
+        if not rc then break end
+        runner.check(bp.check_flags(flags, {"routeneeded"}), "Unexpected flags set on receiver load")
+
+        -- process DACS --
+        rc, flags = sender:process(bundle, 1000)
+        runner.check(rc)
+        runner.check(bp.check_flags(flags, {}), "Flags set on sender process")
+    end
+end
+
+local function resend_bundles()
+    local resent = 0
+    while true do
+        rc, bundle, flags = sender:load(0)
+        if not rc then break end
+        runner.check(bundle ~= nil)
+
+        -- process bundle --
+        rc, flags = receiver:process(bundle, 1000)
+        runner.check(rc)
+        resent = resent + 1
+    end
+    return resent
+end
+
+-- Test --
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 1 - retransmit missing bundles before timeout', store, src))
+send_bundles(1)
+process_dacs()
+
+-- only the last dropped bundle is not reported missing (nothing acknowledged after it) --
+local resent = resend_bundles()
+runner.check(resent == (num_bundles / skip) - 1, string.format('Resent %d bundles', resent))
+
+for i=1,num_bundles-1 do
+    -- accept bundle --
+    rc, app_payload, flags = receiver:accept(1000)
+    runner.check(rc)
+    runner.check(bp.check_flags(flags, {}), "Flags set on receiver accept")
+end
+
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {transmitted_bundles=num_bundles, retransmitted_bundles=resent}))
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 2 - wait for timeout when disabled', store, src))
+runner.check(sender:setopt("FAST_RETRANSMIT", -1))
+send_bundles(num_bundles + 1)
+process_dacs()
+
+resent = resend_bundles()
+runner.check(resent == 0, string.format('Resent %d bundles', resent))
+
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {transmitted_bundles=num_bundles*2, retransmitted_bundles=(num_bundles / skip) - 1}))
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 3 - more missing ranges than can be queued', store, src))
+runner.check(sender:setopt("FAST_RETRANSMIT", 3))
+local many_bundles = skip * (max_missing_ranges + 16)
+send_bundles((num_bundles * 2) + 1, many_bundles)
+process_dacs()
+
+-- ranges past the queue are merged, not dropped (only gaps at DACS boundaries and the last are not reported) --
+resent = resend_bundles()
+runner.check(resent > max_missing_ranges, string.format('Resent %d bundles', resent))
+runner.check(resent < many_bundles / skip, string.format('Resent %d bundles', resent))
+
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {transmitted_bundles=(num_bundles*2)+many_bundles, retransmitted_bundles=(num_bundles / skip) - 1 + resent}))
+
+-- Clean Up --
+
+sender:flush()
+receiver:flush()
+sender:close()
+receiver:close()
+
+runner.cleanup(bplib, store)
+
+-- Report Results --
+
+runner.report(bplib)
@@ -0,0 +1,136 @@
+local bplib = require("bplib")
+local runner = require("bptest")
+local bp = require("bp")
+local rd = runner.rootdir(arg[0])
+local src = runner.srcscript()
+
+-- Setup --
+
+local store = arg[1] or "RAM"
+runner.setup(bplib, store)
+
+local src_node = 4
+local relay_node = 50
+local dst_node = 72
+local serv = 43
+
+local sender = bplib.open(src_node, serv, dst_node, serv, store)
+local relay = bplib.open(relay_node, serv, dst_node, serv, store)
+local receiver = bplib.open(dst_node, serv, src_node, serv, store)
+
+-- Test --
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 1 - forward bundle through relay', store, src))
+payload = string.rep("0123456789", 100)
+
+-- store and load bundle at sender --
+rc, flags = sender:store(payload, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+rc, bundle, flags = sender:load(1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+
+-- forward bundle at relay --
+rc, flags = relay:process(bundle, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+
+-- load forwarded bundle (custody signal to sender goes back to sender) --
+local forwarded = nil
+rc, bundle, flags = relay:load(1000)
+while rc do
+    local route_rc, node, serv = bplib.route(bundle)
+    runner.check(route_rc)
+    if node == dst_node then
+        runner.check(bp.check_flags(flags, {}))
+        forwarded = bundle
+    else
+        runner.check(node == src_node)
+        runner.check(bp.check_flags(flags, {"routeneeded"}))
+        sender:process(bundle, 1000)
+    end
+    rc, bundle, flags = relay:load(0)
+end
+runner.check(forwarded ~= nil, "Bundle not forwarded")
+
+-- accept payload at receiver --
+rc, flags = receiver:process(forwarded, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+rc, app_payload, flags = receiver:accept(1000)
+runner.check(rc)
+runner.check(app_payload == payload, "Forwarded payload does not match")
+
+-- custody signal from receiver goes to relay --
+rc, dacs, flags = receiver:load(1000)
+runner.check(rc)
+rc, flags = relay:process(dacs, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+
+-- check stats --
+rc, stats = relay:stats()
+runner.check(bp.check_stats(stats, {forwarded_bundles=1, acknowledged_bundles=1, lost=0}))
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 2 - forward bundle with large extension blocks', store, src))
+payload = string.rep("9876543210", 100)
+
+-- store and load bundle at sender --
+rc, flags = sender:store(payload, 1000)
+runner.check(rc)
+rc, bundle, flags = sender:load(1000)
+runner.check(rc)
+
+-- insert unrecognized extension blocks ahead of payload block (type, flags, two byte length) --
+local blocks = ""
+for i = 1, 8 do
+    blocks = blocks .. string.char(0x14, 0x00, 0x81, 0x00) .. string.rep(string.char(i), 128)
+end
+local pay_index = #bundle - #payload - 6
+bundle = bundle:sub(1, pay_index) .. blocks .. bundle:sub(pay_index + 1)
+
+-- forward bundle at relay --
+rc, flags = relay:process(bundle, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {"incomplete"}))
+
+-- load forwarded bundle --
+forwarded = nil
+rc, bundle, flags = relay:load(1000)
+while rc do
+    local route_rc, node, serv = bplib.route(bundle)
+    if node == dst_node then
+        forwarded = bundle
+    else
+        sender:process(bundle, 1000)
+    end
+    rc, bundle, flags = relay:load(0)
+end
+runner.check(forwarded ~= nil, "Bundle not forwarded")
+runner.check(#forwarded > #blocks + #payload, string.format('Extension blocks not forwarded: %d', #forwarded))
+
+-- accept payload at receiver --
+rc, flags = receiver:process(forwarded, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {"incomplete"}))
+rc, app_payload, flags = receiver:accept(1000)
+runner.check(rc)
+runner.check(app_payload == payload, "Forwarded payload does not match")
+
+-- Clean Up --
+
+sender:flush()
+relay:flush()
+receiver:flush()
+sender:close()
+relay:close()
+receiver:close()
+
+runner.cleanup(bplib, store)
+
+-- Report Results --
+
+runner.report(bplib)
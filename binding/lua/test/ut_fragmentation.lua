@@ -0,0 +1,132 @@
+local bplib = require("bplib")
+local runner = require("bptest")
+local bp = require("bp")
+local rd = runner.rootdir(arg[0])
+local src = runner.srcscript()
+
+-- Setup --
+
+local store = arg[1] or "RAM"
+runner.setup(bplib, store)
+
+local src_node = 4
+local src_serv = 3
+local dst_node = 72
+local dst_serv = 43
+
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store, {allow_fragmentation=1, max_length=128})
+local receiver = bplib.open(dst_node, dst_serv, src_node, src_serv, store)
+
+-- Test --
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 1 - reassemble out of order fragments', store, src))
+payload = string.rep("0123456789", 100)
+
+-- store payload --
+rc, flags = sender:store(payload, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+
+-- load fragments --
+local fragments = {}
+rc, bundle, flags = sender:load(1000)
+while rc do
+    runner.check(bp.check_flags(flags, {}))
+    table.insert(fragments, bundle)
+    rc, bundle, flags = sender:load(0)
+end
+runner.check(#fragments > 1, string.format('Payload not fragmented: %d', #fragments))
+
+-- process fragments in reverse order --
+for i = #fragments, 1, -1 do
+    rc, flags = receiver:process(fragments[i], 1000)
+    runner.check(rc)
+    runner.check(bp.check_flags(flags, {}))
+    if i > 1 then
+        rc, app_payload, flags = receiver:accept(0)
+        runner.check(rc == false, "Partial payload incorrectly accepted")
+    end
+end
+
+-- process duplicate fragment --
+rc, flags = receiver:process(fragments[1], 1000)
+runner.check(rc)
+
+-- accept payload --
+rc, app_payload, flags = receiver:accept(1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+runner.check(app_payload == payload, "Reassembled payload does not match")
+
+-- check stats --
+rc, stats = receiver:stats()
+runner.check(bp.check_stats(stats, {received_bundles=#fragments+1, delivered_payloads=1, lost=0}))
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 2 - fragment stored bundle on load', store, src))
+payload = string.rep("9876543210", 100)
+
+-- store payload as a single bundle --
+runner.check(sender:setopt("MAX_LENGTH", 4096))
+rc, flags = sender:store(payload, 1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+
+-- load fragments --
+runner.check(sender:setopt("MAX_LOAD_LENGTH", 128))
+fragments = {}
+rc, bundle, flags = sender:load(1000)
+while rc do
+    runner.check(bp.check_flags(flags, {}))
+    runner.check(#bundle <= 128, string.format('Loaded bundle exceeds load length: %d', #bundle))
+    table.insert(fragments, bundle)
+    rc, bundle, flags = sender:load(0)
+end
+runner.check(#fragments > 1, string.format('Payload not fragmented: %d', #fragments))
+
+-- process fragments --
+for i = 1, #fragments do
+    rc, flags = receiver:process(fragments[i], 1000)
+    runner.check(rc)
+    runner.check(bp.check_flags(flags, {}))
+end
+
+-- accept payload --
+rc, app_payload, flags = receiver:accept(1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+runner.check(app_payload == payload, "Reassembled payload does not match")
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 3 - bundle that fits is not a fragment', store, src))
+payload = "HELLO WORLD"
+
+-- store and load payload --
+rc, flags = sender:store(payload, 1000)
+runner.check(rc)
+rc, bundle, flags = sender:load(1000)
+runner.check(rc)
+runner.check(bp.check_flags(flags, {}))
+
+-- fragment flag is the low bit of the last byte of the processing control flags --
+runner.check(string.byte(bundle, 4) % 2 == 0, "Bundle marked as a fragment")
+
+-- process and accept payload --
+rc, flags = receiver:process(bundle, 1000)
+runner.check(rc)
+rc, app_payload, flags = receiver:accept(1000)
+runner.check(rc)
+runner.check(app_payload == payload, "Payload does not match")
+
+-- Clean Up --
+
+sender:flush()
+sender:close()
+receiver:close()
+
+runner.cleanup(bplib, store)
+
+-- Report Results --
+
+runner.report(bplib)
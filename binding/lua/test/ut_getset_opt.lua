@@ -19,6 +19,7 @@ dflt_paytype = 10
 dflt_timeout = 10
 dflt_bundlelen = 4096
 dflt_dacsrate = 5
+dflt_fastretx = 3
 ch = bplib.open(src_node, src_serv, dst_node, dst_serv, store)
 
 local function check_option(opt, default, valid_new, invalid_new)
@@ -97,6 +98,10 @@ check_option("CID_REUSE", false, true, "organ")
 print(string.format('%s/%s: Test 11 - acs rate', store, src))
 check_option("DACS_RATE", dflt_dacsrate, 60, "tea")
 
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 12 - fast retransmit', store, src))
+check_option("FAST_RETRANSMIT", dflt_fastretx, -1, "coffee")
+
 -- Clean Up --
 
 ch:close()
@@ -0,0 +1,129 @@
+local bplib = require("bplib")
+local runner = require("bptest")
+local bp = require("bp")
+local rd = runner.rootdir(arg[0])
+local src = runner.srcscript()
+
+-- Setup --
+
+local store = arg[1] or "RAM"
+runner.setup(bplib, store)
+
+local num_payloads = arg[2] or 200
+
+local src_node = 4
+local src_serv = 3
+local dst_node = 72
+local dst_serv = 43
+
+local timeout = 60                  -- seconds
+local dacs_rate = 10                -- seconds
+local step = 100                    -- milliseconds of virtual time per loop
+local contact = {{600000, 900000}}  -- up from 10 to 15 minutes...
+local period = 1800000              -- ...of every 30 minutes
+local max_time = 4 * 3600000        -- 4 hours
+
+bplib.clock("START")
+
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store)
+local receiver = bplib.open(dst_node, dst_serv, src_node, src_serv, store)
+runner.check(sender:setopt("TIMEOUT", timeout))
+runner.check(sender:setopt("CID_REUSE", true))
+runner.check(receiver:setopt("DACS_RATE", dacs_rate))
+
+local forward = bplib.linksim({loss=0.2, delay=1000, jitter=200, seed=7})
+local reverse = bplib.linksim({loss=0.2, delay=1000, seed=11})
+runner.check(forward ~= nil)
+runner.check(reverse ~= nil)
+runner.check(forward:schedule(contact, period))
+runner.check(reverse:schedule(contact, period))
+
+-- Test --
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 1 - store payloads', store, src))
+for i=1,num_payloads do
+	rc, flags = sender:store(string.format('HELLO WORLD %d', i), 0)
+	runner.check(rc)
+	runner.check(bp.check_flags(flags, {}))
+end
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 2 - deliver over intermittent lossy link', store, src))
+local delivered = 0
+local duplicates = 0
+local received = {}
+local tx_stats = nil
+repeat
+	-- sender to link --
+	while true do
+		rc, bundle, flags = sender:load(0)
+		if not rc then break end
+		runner.check(forward:send(bundle))
+	end
+
+	-- link to receiver --
+	while true do
+		rc, bundle = forward:recv()
+		if not rc then break end
+		rc, flags = receiver:process(bundle, 0)
+		runner.check(rc)
+	end
+
+	-- receiver to application --
+	while true do
+		rc, payload, flags = receiver:accept(0)
+		if not rc then break end
+		if received[payload] then
+			duplicates = duplicates + 1
+		else
+			received[payload] = true
+			delivered = delivered + 1
+		end
+	end
+
+	-- custody signals back to sender --
+	while true do
+		rc, bundle, flags = receiver:load(0)
+		if not rc then break end
+		runner.check(reverse:send(bundle))
+	end
+	while true do
+		rc, bundle = reverse:recv()
+		if not rc then break end
+		rc, flags = sender:process(bundle, 0)
+		runner.check(rc)
+	end
+
+	bplib.clock("ADVANCE", step)
+	rc, tx_stats = sender:stats()
+until (delivered == num_payloads and tx_stats["active_bundles"] == 0) or bplib.clock("NOW") >= max_time
+
+runner.check(delivered == num_payloads, string.format('Delivered %d of %d payloads', delivered, num_payloads))
+runner.check(tx_stats["active_bundles"] == 0, string.format('%d bundles still active', tx_stats["active_bundles"]))
+
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 3 - report efficiency', store, src))
+rc, rx_stats = receiver:stats()
+rc, fwd_stats = forward:stats()
+rc, rev_stats = reverse:stats()
+runner.check(fwd_stats["lost"] > 0)
+runner.check(fwd_stats["disconnected"] > 0)
+runner.check(fwd_stats["delivered"] == delivered + duplicates)
+print(string.format('Simulated %d seconds: %d bundles retransmitted, %d duplicates, %d custody signals sent, %d lost and %d disconnected on forward link, %d lost and %d disconnected on reverse link',
+	math.floor(bplib.clock("NOW") / 1000), tx_stats["retransmitted_bundles"], duplicates, rx_stats["transmitted_dacs"],
+	fwd_stats["lost"], fwd_stats["disconnected"], rev_stats["lost"], rev_stats["disconnected"]))
+
+-- Clean Up --
+
+forward:close()
+reverse:close()
+sender:close()
+receiver:close()
+bplib.clock("STOP")
+
+runner.cleanup(bplib, store)
+
+-- Report Results --
+
+runner.report(bplib)
@@ -119,6 +119,62 @@ runner.check(bp.check_stats(stats, {stored_bundles=num_bundles/2, stored_payload
 
 sender:close()
 
+-----------------------------------------------------------------------
+print(string.format('%s/%s: Test 4 - recover active bundles', store, src))
+
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store, attributes)
+
+-- load the remaining bundles, delivering half of them
+for i=num_bundles/2+1,num_bundles do
+    payload = string.format('HELLO WORLD %d', i)
+
+    -- load bundle --
+    rc, bundle, flags = sender:load(1000)
+    runner.check(rc)
+    runner.check(bundle ~= nil)
+    runner.check(bp.check_flags(flags, {}), "flags set on load")
+    runner.check(bp.find_payload(bundle, payload), string.format('Error - wrong payload when checking for %s', payload))
+
+    -- process bundle --
+    if i <= (num_bundles * 3) / 4 then
+        rc, flags = receiver:process(bundle, 1000)
+        runner.check(rc)
+        runner.check(bp.check_flags(flags, {}), "flags set on process")
+    end
+end
+
+sender:close()
+
+-- reopen channel, with recovery --
+local sender = bplib.open(src_node, src_serv, dst_node, dst_serv, store, attributes)
+
+-- check stats --
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {stored_bundles=num_bundles/2, active_bundles=num_bundles/2}))
+
+-- recovered bundles are not resent before they time out --
+rc, bundle, flags = sender:load(1000)
+runner.check(rc == false)
+runner.check(bundle == nil)
+
+-- load DACS --
+bplib.sleep(timeout)
+rc, bundle, flags = receiver:load(1000)
+runner.check(rc)
+runner.check(bundle ~= nil)
+runner.check(bp.check_flags(flags, {"routeneeded"}))
+
+-- process DACS with recovered custody IDs --
+rc, flags = sender:process(bundle, 1000)
+runner.check(rc, string.format('Error(%d) - failed to process DACS: %s', errno, rc))
+runner.check(bp.check_flags(flags, {}))
+
+-- check stats --
+rc, stats = sender:stats()
+runner.check(bp.check_stats(stats, {stored_bundles=num_bundles/4, active_bundles=num_bundles/4, acknowledged_bundles=num_bundles/4, retransmitted_bundles=0}))
+
+sender:close()
+
 -- Clean Up --
 
 receiver:close()
@@ -33,15 +33,15 @@
 int cbuf_create(cbuf_t** cbuf, int size)
 {
     /* Check Buffer Size */
-    if(size < 0 || (unsigned long)size > BP_MAX_INDEX) return BP_ERROR;
+    if(size < 0) return BP_ERROR;
 
     if(size > 0)
     {
         /* Allocate Structure */
-        *cbuf = (cbuf_t*)bplib_os_calloc(sizeof(cbuf_t));
+        *cbuf = (cbuf_t*)bplib_os_calloc_tag(sizeof(cbuf_t), BP_MEM_ACTIVE_TABLE);
 
         /* Allocate Circular Buffer */
-        (*cbuf)->table = (bp_active_bundle_t*)bplib_os_calloc(sizeof(bp_active_bundle_t) * size);
+        (*cbuf)->table = (bp_active_bundle_t*)bplib_os_calloc_tag(sizeof(bp_active_bundle_t) * size, BP_MEM_ACTIVE_TABLE);
         if((*cbuf)->table == NULL) return BP_ERROR;
     }
     else
@@ -80,7 +80,7 @@ int cbuf_destroy(cbuf_t* cbuf)
 int cbuf_add(cbuf_t* cbuf, bp_active_bundle_t bundle, bool overwrite)
 {
     /* Add Bundle */
-    bp_index_t ati = bundle.cid % cbuf->size;
+    uint32_t ati = bundle.cid % cbuf->size;
     if( (!overwrite) &&
         (cbuf->table[ati].sid != BP_SID_VACANT) &&
         (cbuf->table[ati].cid == bundle.cid) )
@@ -89,9 +89,14 @@ int cbuf_add(cbuf_t* cbuf, bp_active_bundle_t bundle, bool overwrite)
     }
     else
     {
+        if(cbuf->table[ati].sid == BP_SID_VACANT) cbuf->num_entries++;
         cbuf->table[ati] = bundle;
-        cbuf->num_entries++;
-        if(!overwrite) cbuf->newest_cid = bundle.cid + 1;
+        if(!overwrite)
+        {
+            /* Nothing Older Remains in an Empty Table - Start Search at New Entry */
+            if(cbuf->num_entries == 1) cbuf->oldest_cid = bundle.cid;
+            cbuf->newest_cid = bundle.cid + 1;
+        }
     }
 
     /* Return Success */
@@ -105,7 +110,7 @@ int cbuf_next(cbuf_t* cbuf, bp_active_bundle_t* bundle)
 {
     while(cbuf->oldest_cid != cbuf->newest_cid)
     {
-        bp_index_t ati = cbuf->oldest_cid % cbuf->size;
+        uint32_t ati = cbuf->oldest_cid % cbuf->size;
         if(cbuf->table[ati].sid == BP_SID_VACANT)
         {
             cbuf->oldest_cid++;
@@ -125,7 +130,7 @@ int cbuf_next(cbuf_t* cbuf, bp_active_bundle_t* bundle)
  *----------------------------------------------------------------------------*/
 int cbuf_remove(cbuf_t* cbuf, bp_val_t cid, bp_active_bundle_t* bundle)
 {
-    bp_index_t ati = cid % cbuf->size;
+    uint32_t ati = cid % cbuf->size;
     if( (cbuf->table[ati].sid != BP_SID_VACANT) &&
         (cbuf->table[ati].cid == cid) )
     {
@@ -138,12 +143,43 @@ int cbuf_remove(cbuf_t* cbuf, bp_val_t cid, bp_active_bundle_t* bundle)
     return BP_ERROR;
 }
 
+/*----------------------------------------------------------------------------
+ * Remove Range - removes count custody IDs starting at cid, storing the
+ *  storage IDs of the removed bundles in sids; returns number removed
+ *----------------------------------------------------------------------------*/
+int cbuf_remove_range(cbuf_t* cbuf, bp_val_t cid, int count, bp_sid_t* sids)
+{
+    int removed = 0;
+    int i;
+
+    /* Wrapped Ranges Revisit Slots - Only Check Each Slot Once */
+    if((bp_val_t)count > cbuf->size)
+    {
+        cid += count - cbuf->size;
+        count = cbuf->size;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        uint32_t ati = (cid + i) % cbuf->size;
+        if( (cbuf->table[ati].sid != BP_SID_VACANT) &&
+            (cbuf->table[ati].cid == cid + i) )
+        {
+            sids[removed++] = cbuf->table[ati].sid;
+            cbuf->table[ati].sid = BP_SID_VACANT;
+        }
+    }
+
+    cbuf->num_entries -= removed;
+    return removed;
+}
+
 /*----------------------------------------------------------------------------
  * Available - checks if the provided CID can be added
  *----------------------------------------------------------------------------*/
 int cbuf_available(cbuf_t* cbuf, bp_val_t cid)
 {
-    bp_index_t ati = cid % cbuf->size;
+    uint32_t ati = cid % cbuf->size;
     if(cbuf->table[ati].sid == BP_SID_VACANT)
     {
         return BP_SUCCESS;
@@ -160,5 +196,27 @@ int cbuf_available(cbuf_t* cbuf, bp_val_t cid)
 int cbuf_count(cbuf_t* cbuf)
 {
     return cbuf->num_entries;
+}
+
+/*----------------------------------------------------------------------------
+ * Walk - visits entries in order of custody ID, stopping at first failure
+ *----------------------------------------------------------------------------*/
+int cbuf_walk(cbuf_t* cbuf, bp_table_visit_t visit, void* parm)
+{
+    bp_val_t cid;
 
+    /* Entries can Span More Than One Lap when Custody IDs are Skipped (e.g. after
+     *  journal recovery), so Start at the Oldest; Slots Reused by Newer Custody IDs
+     *  are Skipped by the Custody ID Check */
+    for(cid = cbuf->oldest_cid; cid != cbuf->newest_cid; cid++)
+    {
+        bp_active_bundle_t* entry = &cbuf->table[cid % cbuf->size];
+        if(entry->sid != BP_SID_VACANT && entry->cid == cid)
+        {
+            int status = visit(parm, entry);
+            if(status != BP_SUCCESS) return status;
+        }
+    }
+
+    return BP_SUCCESS;
 }
@@ -30,8 +30,8 @@
 
 typedef struct {
     bp_active_bundle_t* table;
-    bp_index_t          size;
-    bp_index_t          num_entries;
+    uint32_t            size;
+    uint32_t            num_entries;
     bp_val_t            newest_cid;
     bp_val_t            oldest_cid;
 } cbuf_t;
@@ -45,7 +45,9 @@ int cbuf_destroy    (cbuf_t* cbuf);
 int cbuf_add        (cbuf_t* cbuf, bp_active_bundle_t bundle, bool overwrite);
 int cbuf_next       (cbuf_t* cbuf, bp_active_bundle_t* bundle);
 int cbuf_remove     (cbuf_t* cbuf, bp_val_t cid, bp_active_bundle_t* bundle);
+int cbuf_remove_range (cbuf_t* cbuf, bp_val_t cid, int count, bp_sid_t* sids);
 int cbuf_available  (cbuf_t* cbuf, bp_val_t cid);
 int cbuf_count      (cbuf_t* cbuf);
+int cbuf_walk       (cbuf_t* cbuf, bp_table_visit_t visit, void* parm);
 
 #endif /* _cbuf_h_ */
\ No newline at end of file
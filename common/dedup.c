@@ -0,0 +1,243 @@
+/************************************************************************
+ * File: dedup.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "dedup.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define DEDUP_NULL          0xFFFFFFFF
+#define DEDUP_MAX_SIZE      0x40000000  /* keeps bucket count within 32 bits */
+#define HASH_MULTIPLIER     0x9E3779B97F4A7C15ULL
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * dedup_key_equal -
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool dedup_key_equal(dedup_key_t* k1, dedup_key_t* k2)
+{
+    return (k1->createseq == k2->createseq) &&
+           (k1->createsec == k2->createsec) &&
+           (k1->fragoffset == k2->fragoffset) &&
+           (k1->srcnode == k2->srcnode) &&
+           (k1->srcserv == k2->srcserv);
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_bucket - the sequence number varies fastest between bundles so it is mixed last
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE uint32_t dedup_bucket(dedup_t* dedup, dedup_key_t* key)
+{
+    uint64_t h = (uint64_t)key->srcnode;
+    h = (h * HASH_MULTIPLIER) ^ (uint64_t)key->srcserv;
+    h = (h * HASH_MULTIPLIER) ^ (uint64_t)key->createsec;
+    h = (h * HASH_MULTIPLIER) ^ (uint64_t)key->fragoffset;
+    h = (h * HASH_MULTIPLIER) ^ (uint64_t)key->createseq;
+    h = h * HASH_MULTIPLIER;
+    return (uint32_t)(h >> 32) & dedup->mask;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_remove_oldest - unlinks the oldest entry from its hash bucket
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void dedup_remove_oldest(dedup_t* dedup)
+{
+    uint32_t index = dedup->oldest;
+    uint32_t* link = &dedup->buckets[dedup_bucket(dedup, &dedup->entries[index].key)];
+
+    /* Entries are added to the head of a bucket, so the oldest is found last */
+    while(*link != index) link = &dedup->entries[*link].next;
+    *link = dedup->entries[index].next;
+
+    dedup->oldest = (dedup->oldest + 1) % dedup->size;
+    dedup->num_entries--;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_find - entry remembering the bundle, or NULL
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE dedup_entry_t* dedup_find(dedup_t* dedup, dedup_key_t* key)
+{
+    uint32_t index = dedup->buckets[dedup_bucket(dedup, key)];
+    while(index != DEDUP_NULL)
+    {
+        dedup_entry_t* entry = &dedup->entries[index];
+        if(dedup_key_equal(&entry->key, key)) return entry;
+        index = entry->next;
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_forget_expired - forgets expired bundles in the order received, stopping at
+ *  the first that has not expired; bundles with longer lifetimes received before it
+ *  are still checked for expiration when found
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void dedup_forget_expired(dedup_t* dedup, bp_val_t sysnow)
+{
+    while(dedup->num_entries > 0)
+    {
+        bp_val_t exprtime = dedup->entries[dedup->oldest].exprtime;
+        if(exprtime == 0 || sysnow < exprtime) break;
+        dedup_remove_oldest(dedup);
+    }
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * dedup_create - a size of zero creates a cache that remembers nothing
+ *-------------------------------------------------------------------------------------*/
+int dedup_create(dedup_t* dedup, int size)
+{
+    /* Check Parameters */
+    if(dedup == NULL || size < 0 || size > DEDUP_MAX_SIZE) return BP_ERROR;
+
+    /* Initialize Cache */
+    dedup->entries      = NULL;
+    dedup->buckets      = NULL;
+    dedup->size         = (uint32_t)size;
+    dedup->mask         = 0;
+    dedup->oldest       = 0;
+    dedup->num_entries  = 0;
+    if(size == 0) return BP_SUCCESS;
+
+    /* Allocate at Least One Bucket per Entry */
+    uint32_t num_buckets = 1;
+    while(num_buckets < dedup->size) num_buckets <<= 1;
+    dedup->mask = num_buckets - 1;
+
+    /* Allocate Memory */
+    dedup->entries = (dedup_entry_t*)bplib_os_calloc(sizeof(dedup_entry_t) * dedup->size);
+    dedup->buckets = (uint32_t*)bplib_os_calloc(sizeof(uint32_t) * num_buckets);
+    if(dedup->entries == NULL || dedup->buckets == NULL)
+    {
+        dedup_destroy(dedup);
+        return BP_ERROR;
+    }
+
+    /* Initialize Buckets */
+    uint32_t b;
+    for(b = 0; b < num_buckets; b++) dedup->buckets[b] = DEDUP_NULL;
+
+    /* Return Success */
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_destroy -
+ *-------------------------------------------------------------------------------------*/
+int dedup_destroy(dedup_t* dedup)
+{
+    if(dedup == NULL) return BP_ERROR;
+
+    if(dedup->entries) bplib_os_free(dedup->entries);
+    if(dedup->buckets) bplib_os_free(dedup->buckets);
+    dedup->entries = NULL;
+    dedup->buckets = NULL;
+    dedup->size = 0;
+    dedup->num_entries = 0;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_check - checks whether a bundle was received before
+ *
+ *  dedup - duplicate cache [INPUT]
+ *  key - identifies the received bundle or fragment [INPUT]
+ *  sysnow - current time, zero if unreliable so that nothing is forgotten early [INPUT]
+ *
+ *  Returns:    BP_DUPLICATE if the bundle was remembered and has not expired,
+ *              otherwise BP_SUCCESS
+ *-------------------------------------------------------------------------------------*/
+int dedup_check(dedup_t* dedup, dedup_key_t key, bp_val_t sysnow)
+{
+    if(dedup->size == 0) return BP_SUCCESS;
+
+    dedup_forget_expired(dedup, sysnow);
+
+    dedup_entry_t* entry = dedup_find(dedup, &key);
+    if(entry && (entry->exprtime == 0 || sysnow < entry->exprtime))
+    {
+        return BP_DUPLICATE;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_add - remembers a received bundle
+ *
+ *  dedup - duplicate cache [INPUT]
+ *  key - identifies the received bundle or fragment [INPUT]
+ *  exprtime - absolute time the bundle expires and is forgotten, zero for never [INPUT]
+ *  sysnow - current time, zero if unreliable so that nothing is forgotten early [INPUT]
+ *
+ *  Returns:    BP_SUCCESS; when the cache is full the oldest bundle is forgotten
+ *-------------------------------------------------------------------------------------*/
+int dedup_add(dedup_t* dedup, dedup_key_t key, bp_val_t exprtime, bp_val_t sysnow)
+{
+    if(dedup->size == 0) return BP_SUCCESS;
+
+    dedup_forget_expired(dedup, sysnow);
+
+    /* Bundles Already Remembered are Refreshed in Place */
+    dedup_entry_t* entry = dedup_find(dedup, &key);
+    if(entry)
+    {
+        entry->exprtime = exprtime;
+        return BP_SUCCESS;
+    }
+
+    /* Make Room for Bundle */
+    if(dedup->num_entries == dedup->size)
+    {
+        dedup_remove_oldest(dedup);
+    }
+
+    /* Add Bundle as Newest Entry at Head of its Bucket */
+    uint32_t bucket = dedup_bucket(dedup, &key);
+    uint32_t index = (dedup->oldest + dedup->num_entries) % dedup->size;
+    dedup->entries[index].key = key;
+    dedup->entries[index].exprtime = exprtime;
+    dedup->entries[index].next = dedup->buckets[bucket];
+    dedup->buckets[bucket] = index;
+    dedup->num_entries++;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dedup_count - number of remembered bundles
+ *-------------------------------------------------------------------------------------*/
+int dedup_count(dedup_t* dedup)
+{
+    return (int)dedup->num_entries;
+}
@@ -0,0 +1,68 @@
+/************************************************************************
+ * File: dedup.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _dedup_h_
+#define _dedup_h_
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bundle_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Duplicate Key - identifies a received bundle or fragment */
+typedef struct {
+    bp_ipn_t            srcnode;
+    bp_ipn_t            srcserv;
+    bp_val_t            createsec;
+    bp_val_t            createseq;
+    bp_val_t            fragoffset;
+} dedup_key_t;
+
+/* Remembered Bundle */
+typedef struct {
+    dedup_key_t         key;
+    bp_val_t            exprtime;       /* absolute time the bundle expires and is forgotten, zero for never */
+    uint32_t            next;           /* next entry in the same hash bucket */
+} dedup_entry_t;
+
+/* Duplicate Cache */
+typedef struct {
+    dedup_entry_t*      entries;        /* circular buffer of entries in the order received */
+    uint32_t*           buckets;        /* first entry of each hash bucket */
+    uint32_t            size;           /* maximum number of entries */
+    uint32_t            mask;           /* number of buckets minus one */
+    uint32_t            oldest;         /* index of oldest entry */
+    uint32_t            num_entries;
+} dedup_t;
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int dedup_create    (dedup_t* dedup, int size);
+int dedup_destroy   (dedup_t* dedup);
+int dedup_check     (dedup_t* dedup, dedup_key_t key, bp_val_t sysnow);
+int dedup_add       (dedup_t* dedup, dedup_key_t key, bp_val_t exprtime, bp_val_t sysnow);
+int dedup_count     (dedup_t* dedup);
+
+#endif  /* _dedup_h_ */
@@ -0,0 +1,434 @@
+/************************************************************************
+ * File: link_sim.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_link_sim.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define LINK_SIM_DEFAULT_SEED       0x2545F491
+#define LINK_SIM_US_PER_MS          1000llu
+#define LINK_SIM_US_PER_SEC         1000000llu
+#define LINK_SIM_FOREVER            0xFFFFFFFFFFFFFFFFllu
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Bundle in Flight */
+typedef struct link_sim_node {
+    struct link_sim_node*   next;
+    uint64_t                deliver;    /* microseconds of virtual time the bundle arrives */
+    int                     size;
+    uint8_t                 bundle[];
+} link_sim_node_t;
+
+/* Link */
+typedef struct {
+    int                     lock;
+    bp_link_attr_t          attr;
+    uint32_t                random;     /* xorshift state, so each link is reproducible on its own */
+    uint64_t                tx_free;    /* microseconds of virtual time the transmitter is next idle */
+    bp_contact_t*           contacts;   /* NULL: the link is always up */
+    int                     num_contacts;
+    uint64_t                period;     /* microseconds between repeats of the schedule, 0: no repeat */
+    link_sim_node_t*        head;       /* bundles in flight in order of delivery */
+    link_sim_node_t*        tail;
+    bp_link_stats_t         stats;
+} link_sim_t;
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * link_sim_now - microseconds of virtual time
+ *-------------------------------------------------------------------------------------*/
+static inline uint64_t link_sim_now(void)
+{
+    return (uint64_t)bplib_os_vclock_now() * LINK_SIM_US_PER_MS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * link_sim_random - returns a number in the range [0, 1)
+ *-------------------------------------------------------------------------------------*/
+static double link_sim_random(link_sim_t* ls)
+{
+    uint32_t x = ls->random;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ls->random = x;
+    return (double)x / 4294967296.0;
+}
+
+/*--------------------------------------------------------------------------------------
+ * link_sim_contact - returns true if the link is up at time t and sets the end of the contact
+ *-------------------------------------------------------------------------------------*/
+static bool link_sim_contact(link_sim_t* ls, uint64_t t, uint64_t* stop)
+{
+    int i;
+
+    /* Always Up */
+    if(ls->contacts == NULL)
+    {
+        *stop = LINK_SIM_FOREVER;
+        return true;
+    }
+
+    /* Find Contact */
+    uint64_t offset = ls->period ? (t % ls->period) : t;
+    uint64_t base = t - offset;
+    for(i = 0; i < ls->num_contacts; i++)
+    {
+        uint64_t start = ls->contacts[i].start * LINK_SIM_US_PER_MS;
+        uint64_t end = ls->contacts[i].stop * LINK_SIM_US_PER_MS;
+        if(offset >= start && offset < end)
+        {
+            *stop = base + end;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------
+ * link_sim_insert - bundles delivered at the same time stay in the order they were sent
+ *-------------------------------------------------------------------------------------*/
+static void link_sim_insert(link_sim_t* ls, link_sim_node_t* node)
+{
+    if(ls->tail == NULL)
+    {
+        node->next = NULL;
+        ls->head = node;
+        ls->tail = node;
+    }
+    else if(node->deliver >= ls->tail->deliver)
+    {
+        node->next = NULL;
+        ls->tail->next = node;
+        ls->tail = node;
+    }
+    else if(node->deliver < ls->head->deliver)
+    {
+        node->next = ls->head;
+        ls->head = node;
+    }
+    else
+    {
+        link_sim_node_t* prev = ls->head;
+        while(prev->next->deliver <= node->deliver) prev = prev->next;
+        node->next = prev->next;
+        prev->next = node;
+    }
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_attrinit - a perfect link
+ *-------------------------------------------------------------------------------------*/
+void bplib_link_sim_attrinit(bp_link_attr_t* attr)
+{
+    if(attr)
+    {
+        memset(attr, 0, sizeof(bp_link_attr_t));
+        attr->seed = LINK_SIM_DEFAULT_SEED;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_create -
+ *-------------------------------------------------------------------------------------*/
+bp_link_t* bplib_link_sim_create(bp_link_attr_t* attr)
+{
+    /* Check Attributes */
+    if(attr && (attr->loss_rate < 0.0 || attr->loss_rate > 1.0 ||
+                attr->reorder_rate < 0.0 || attr->reorder_rate > 1.0 ||
+                attr->queue_limit < 0))
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Invalid link attributes\n");
+        return NULL;
+    }
+
+    /* Allocate Link */
+    bp_link_t* link = (bp_link_t*)bplib_os_calloc(sizeof(bp_link_t));
+    link_sim_t* ls = (link_sim_t*)bplib_os_calloc(sizeof(link_sim_t));
+    if(link == NULL || ls == NULL)
+    {
+        if(link) bplib_os_free(link);
+        if(ls) bplib_os_free(ls);
+        return NULL;
+    }
+
+    /* Initialize Link */
+    if(attr)    ls->attr = *attr;
+    else        bplib_link_sim_attrinit(&ls->attr);
+    ls->random = ls->attr.seed ? ls->attr.seed : LINK_SIM_DEFAULT_SEED;
+    ls->lock = bplib_os_createlock();
+    if(ls->lock == BP_INVALID_HANDLE)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create a lock for link\n");
+        bplib_os_free(ls);
+        bplib_os_free(link);
+        return NULL;
+    }
+
+    link->link = ls;
+    return link;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_destroy - bundles in flight are lost
+ *-------------------------------------------------------------------------------------*/
+void bplib_link_sim_destroy(bp_link_t* link)
+{
+    if(link == NULL || link->link == NULL) return;
+    link_sim_t* ls = (link_sim_t*)link->link;
+
+    while(ls->head)
+    {
+        link_sim_node_t* node = ls->head;
+        ls->head = node->next;
+        bplib_os_free(node);
+    }
+
+    if(ls->contacts) bplib_os_free(ls->contacts);
+    bplib_os_destroylock(ls->lock);
+    bplib_os_free(ls);
+    bplib_os_free(link);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_schedule - contacts are in milliseconds of virtual time and repeat
+ *  every period milliseconds when period is not zero; a count of zero keeps the link up
+ *-------------------------------------------------------------------------------------*/
+int bplib_link_sim_schedule(bp_link_t* link, const bp_contact_t* contacts, int count, unsigned long period)
+{
+    int i;
+
+    if(link == NULL || link->link == NULL || count < 0 || (count > 0 && contacts == NULL)) return BP_ERROR;
+    link_sim_t* ls = (link_sim_t*)link->link;
+
+    /* Check Contacts */
+    for(i = 0; i < count; i++)
+    {
+        if(contacts[i].start >= contacts[i].stop || (period && contacts[i].stop > period))
+        {
+            return bplog(NULL, BP_FLAG_API_ERROR, "Invalid contact %d: %lu to %lu\n", i, contacts[i].start, contacts[i].stop);
+        }
+    }
+
+    /* Copy Contacts */
+    bp_contact_t* copy = NULL;
+    if(count > 0)
+    {
+        copy = (bp_contact_t*)bplib_os_calloc(sizeof(bp_contact_t) * count);
+        if(copy == NULL)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate %d contacts\n", count);
+            return BP_ERROR;
+        }
+        memcpy(copy, contacts, sizeof(bp_contact_t) * count);
+    }
+
+    /* Replace Schedule */
+    bplib_os_lock(ls->lock);
+    {
+        if(ls->contacts) bplib_os_free(ls->contacts);
+        ls->contacts = copy;
+        ls->num_contacts = count;
+        ls->period = (uint64_t)period * LINK_SIM_US_PER_MS;
+    }
+    bplib_os_unlock(ls->lock);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_send - like a datagram, success does not mean the bundle will arrive
+ *-------------------------------------------------------------------------------------*/
+int bplib_link_sim_send(bp_link_t* link, const void* bundle, int size)
+{
+    uint64_t stop;
+
+    if(link == NULL || link->link == NULL || bundle == NULL || size <= 0) return BP_ERROR;
+    link_sim_t* ls = (link_sim_t*)link->link;
+    uint64_t now = link_sim_now();
+
+    bplib_os_lock(ls->lock);
+    {
+        ls->stats.sent++;
+
+        /* Draw Random Numbers (always drawn so one setting does not change the others) */
+        double loss_draw = link_sim_random(ls);
+        double jitter_draw = link_sim_random(ls);
+        double reorder_draw = link_sim_random(ls);
+
+        /* Check Queue Limit */
+        if(ls->attr.queue_limit > 0 && ls->stats.in_flight >= (uint32_t)ls->attr.queue_limit)
+        {
+            ls->stats.overflowed++;
+            bplib_os_unlock(ls->lock);
+            return BP_SUCCESS;
+        }
+
+        /* Transmit (waits for bundles ahead of it) */
+        uint64_t start = (ls->tx_free > now) ? ls->tx_free : now;
+        if(!link_sim_contact(ls, start, &stop))
+        {
+            ls->stats.disconnected++;
+            bplib_os_unlock(ls->lock);
+            return BP_SUCCESS;
+        }
+
+        uint64_t done = start;
+        if(ls->attr.bandwidth > 0) done += ((uint64_t)size * LINK_SIM_US_PER_SEC) / ls->attr.bandwidth;
+        if(done > stop)
+        {
+            /* Contact Ended Mid-Transmission */
+            ls->tx_free = stop;
+            ls->stats.disconnected++;
+            bplib_os_unlock(ls->lock);
+            return BP_SUCCESS;
+        }
+        ls->tx_free = done;
+
+        /* Lose */
+        if(loss_draw < ls->attr.loss_rate)
+        {
+            ls->stats.lost++;
+            bplib_os_unlock(ls->lock);
+            return BP_SUCCESS;
+        }
+
+        /* Propagate */
+        uint64_t deliver = done + (ls->attr.delay * LINK_SIM_US_PER_MS);
+        deliver += (uint64_t)(jitter_draw * (double)(ls->attr.jitter * LINK_SIM_US_PER_MS));
+        if(reorder_draw < ls->attr.reorder_rate)
+        {
+            deliver += ls->attr.reorder_delay * LINK_SIM_US_PER_MS;
+            ls->stats.reordered++;
+        }
+
+        /* Queue for Delivery */
+        link_sim_node_t* node = (link_sim_node_t*)bplib_os_calloc(sizeof(link_sim_node_t) + size);
+        if(node == NULL)
+        {
+            bplib_os_unlock(ls->lock);
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate %d byte bundle on link\n", size);
+            return BP_ERROR;
+        }
+        node->deliver = deliver;
+        node->size = size;
+        memcpy(node->bundle, bundle, size);
+        link_sim_insert(ls, node);
+        ls->stats.in_flight++;
+    }
+    bplib_os_unlock(ls->lock);
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_recv - size is the size of the buffer on input and of the bundle on output
+ *
+ *  Returns BP_TIMEOUT when no bundle has arrived by the current virtual time, and BP_ERROR
+ *  when the next bundle does not fit, in which case it is kept and size is set to its size
+ *-------------------------------------------------------------------------------------*/
+int bplib_link_sim_recv(bp_link_t* link, void* bundle, int* size)
+{
+    int status = BP_TIMEOUT;
+
+    if(link == NULL || link->link == NULL || bundle == NULL || size == NULL) return BP_ERROR;
+    link_sim_t* ls = (link_sim_t*)link->link;
+    uint64_t now = link_sim_now();
+
+    bplib_os_lock(ls->lock);
+    {
+        link_sim_node_t* node = ls->head;
+        if(node && node->deliver <= now)
+        {
+            if(node->size > *size)
+            {
+                status = BP_ERROR;
+            }
+            else
+            {
+                memcpy(bundle, node->bundle, node->size);
+                ls->head = node->next;
+                if(ls->head == NULL) ls->tail = NULL;
+                ls->stats.in_flight--;
+                ls->stats.delivered++;
+                ls->stats.delivered_bytes += node->size;
+                status = BP_SUCCESS;
+            }
+            *size = node->size;
+            if(status == BP_SUCCESS) bplib_os_free(node);
+        }
+    }
+    bplib_os_unlock(ls->lock);
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_next - time the next bundle arrives, so simulations can jump to it
+ *-------------------------------------------------------------------------------------*/
+unsigned long bplib_link_sim_next(bp_link_t* link)
+{
+    unsigned long next = LINK_SIM_NEVER;
+
+    if(link == NULL || link->link == NULL) return next;
+    link_sim_t* ls = (link_sim_t*)link->link;
+
+    bplib_os_lock(ls->lock);
+    {
+        /* Round Up so Advancing to the Returned Time Delivers the Bundle */
+        if(ls->head) next = (unsigned long)((ls->head->deliver + LINK_SIM_US_PER_MS - 1) / LINK_SIM_US_PER_MS);
+    }
+    bplib_os_unlock(ls->lock);
+
+    return next;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_link_sim_stats -
+ *-------------------------------------------------------------------------------------*/
+int bplib_link_sim_stats(bp_link_t* link, bp_link_stats_t* stats)
+{
+    if(link == NULL || link->link == NULL || stats == NULL) return BP_ERROR;
+    link_sim_t* ls = (link_sim_t*)link->link;
+
+    bplib_os_lock(ls->lock);
+    {
+        *stats = ls->stats;
+    }
+    bplib_os_unlock(ls->lock);
+
+    return BP_SUCCESS;
+}
@@ -0,0 +1,419 @@
+/************************************************************************
+ * File: range_array.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bundle_types.h"
+#include "range_array.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* The maximum number of ranges, see MAX_TREE_SIZE in rb_tree.c */
+#define MAX_ARRAY_SIZE ((BP_MAX_ENCODED_VALUE / 2) + 1)
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * array_consecutive - Checks if value_2 is the consecutive integer after value_1.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool array_consecutive(bp_val_t value_1, bp_val_t value_2)
+{
+    return (value_1 != BP_MAX_ENCODED_VALUE) && (value_1 + 1 == value_2);
+}
+
+/*--------------------------------------------------------------------------------------
+ * array_find - Binary searches for the position of the first range with a starting
+ *      value greater than value.
+ *
+ * returns: A position relative to first in the range [0, size].
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bp_val_t array_find(range_array_t* array, bp_val_t value)
+{
+    rb_range_t* ranges = &array->ranges[array->first];
+    bp_val_t low = 0;
+    bp_val_t high = array->size;
+
+    while(low < high)
+    {
+        bp_val_t mid = low + ((high - low) / 2);
+        if(ranges[mid].value > value)   high = mid;
+        else                            low = mid + 1;
+    }
+
+    return low;
+}
+
+/*--------------------------------------------------------------------------------------
+ * array_open - Inserts a single value range at the position relative to first.
+ *
+ * returns: BP_SUCCESS or BP_FULL if there is no room for another range.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int array_open(range_array_t* array, bp_val_t pos, bp_val_t value, bp_val_t offset)
+{
+    if(array->size == array->max_size)
+    {
+        return BP_FULL;
+    }
+
+    if(pos == 0 && array->first > 0)
+    {
+        /* Grow Downward into Room Left by Popped Ranges */
+        array->first--;
+    }
+    else
+    {
+        /* Compact to Start of Memory if No Room Above */
+        if(array->first + array->size == array->max_size)
+        {
+            memmove(array->ranges, &array->ranges[array->first], array->size * sizeof(rb_range_t));
+            array->first = 0;
+        }
+
+        /* Open Slot */
+        rb_range_t* ranges = &array->ranges[array->first];
+        memmove(&ranges[pos + 1], &ranges[pos], (array->size - pos) * sizeof(rb_range_t));
+    }
+
+    array->ranges[array->first + pos].value = value;
+    array->ranges[array->first + pos].offset = offset;
+    array->size++;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * array_close - Removes the range at the position relative to first.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void array_close(range_array_t* array, bp_val_t pos)
+{
+    if(pos == 0)
+    {
+        /* Pop Lowest Range without Moving Array */
+        array->first++;
+    }
+    else
+    {
+        rb_range_t* ranges = &array->ranges[array->first];
+        memmove(&ranges[pos], &ranges[pos + 1], (array->size - pos - 1) * sizeof(rb_range_t));
+    }
+
+    array->size--;
+    if(array->size == 0) array->first = 0;
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * range_array_create -
+ *
+ * max_size: The maximum number of ranges within the array.
+ * array: A range_array_t to allocate memory to.
+ *--------------------------------------------------------------------------------------*/
+int range_array_create(bp_val_t max_size, range_array_t* array)
+{
+    if(array == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    array->size = 0;
+    array->max_size = 0;
+    array->first = 0;
+    array->iterator = 0;
+    array->ranges = NULL;
+
+    if((max_size == 0) || (max_size > MAX_ARRAY_SIZE))
+    {
+        /* Array values are not able to represent requested range */
+        return BP_ERROR;
+    }
+    else if(max_size >= (BP_MAX_ENCODED_VALUE / sizeof(rb_range_t)))
+    {
+        /* Memory allocation request below will rollover */
+        return BP_ERROR;
+    }
+
+    array->ranges = (rb_range_t*)bplib_os_calloc_tag(max_size * sizeof(rb_range_t), BP_MEM_CUSTODY_TREE);
+    if(array->ranges == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    array->max_size = max_size;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_clear - Clears all the ranges in a range_array_t. No memory is deallocated.
+ *--------------------------------------------------------------------------------------*/
+int range_array_clear(range_array_t* array)
+{
+    if(array == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    array->size = 0;
+    array->first = 0;
+    array->iterator = 0;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_is_empty -
+ *
+ * returns: True when the range_array_t has no ranges, otherwise false. If array is NULL
+ *      returns false.
+ *--------------------------------------------------------------------------------------*/
+bool range_array_is_empty(range_array_t* array)
+{
+    return array != NULL && array->size == 0;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_is_full -
+ *
+ * returns: True when the range_array_t is full, otherwise false. If array is NULL
+ *      returns true.
+ *--------------------------------------------------------------------------------------*/
+bool range_array_is_full(range_array_t* array)
+{
+    return array == NULL || array->size == array->max_size;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_get_size -
+ *
+ * returns: The number of ranges in the range_array_t. If array is NULL returns 0.
+ *--------------------------------------------------------------------------------------*/
+bp_val_t range_array_get_size(range_array_t* array)
+{
+    return (array == NULL) ? 0 : array->size;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_insert - Inserts a value into the range array, merging it with the
+ *      ranges it is consecutive with.
+ *
+ * value - The value to insert into the range_array_t. [INPUT]
+ * array: A ptr to a range_array_t to insert the value into. [OUTPUT]
+ * returns: BP_SUCCESS, BP_DUPLICATE if the value is already present, or BP_FULL
+ *--------------------------------------------------------------------------------------*/
+int range_array_insert(bp_val_t value, range_array_t* array)
+{
+    if((array == NULL) || (array->ranges == NULL))
+    {
+        return BP_ERROR;
+    }
+
+    /* Empty Array */
+    if(array->size == 0)
+    {
+        return array_open(array, 0, value, 0);
+    }
+
+    /* Beyond Highest Range (no search needed) */
+    rb_range_t* ranges = &array->ranges[array->first];
+    rb_range_t* last = &ranges[array->size - 1];
+    bp_val_t pos;
+    if(value > last->value + last->offset)
+    {
+        if(array_consecutive(last->value + last->offset, value))
+        {
+            last->offset += 1;
+            return BP_SUCCESS;
+        }
+
+        pos = array->size;
+    }
+    else
+    {
+        pos = array_find(array, value);
+    }
+
+    /* Check Range Before Position */
+    rb_range_t* prev = (pos > 0) ? &ranges[pos - 1] : NULL;
+    rb_range_t* next = (pos < array->size) ? &ranges[pos] : NULL;
+    if(prev != NULL && value <= prev->value + prev->offset)
+    {
+        return BP_DUPLICATE;
+    }
+
+    /* Merge or Insert */
+    bool merge_prev = (prev != NULL) && array_consecutive(prev->value + prev->offset, value);
+    bool merge_next = (next != NULL) && array_consecutive(value, next->value);
+    if(merge_prev && merge_next)
+    {
+        /* Value joins previous and next ranges */
+        prev->offset += next->offset + 2;
+        array_close(array, pos);
+    }
+    else if(merge_prev)
+    {
+        prev->offset += 1;
+    }
+    else if(merge_next)
+    {
+        next->value = value;
+        next->offset += 1;
+    }
+    else
+    {
+        return array_open(array, pos, value, 0);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_delete - Deletes a value from the range array.
+ *
+ * value - The value to delete from the range_array_t. [INPUT]
+ * array: A ptr to a range_array_t to delete value from. [OUTPUT]
+ * returns: BP_SUCCESS, BP_ERROR if the value is not present, or BP_FULL if a range
+ *      needed to be split and there was no room for it.
+ *--------------------------------------------------------------------------------------*/
+int range_array_delete(bp_val_t value, range_array_t* array)
+{
+    if(array == NULL || array->size == 0)
+    {
+        return BP_ERROR;
+    }
+
+    /* Find Range Containing Value */
+    bp_val_t pos = array_find(array, value);
+    if(pos == 0)
+    {
+        return BP_ERROR;
+    }
+
+    pos -= 1;
+    rb_range_t* range = &array->ranges[array->first + pos];
+    if(value > range->value + range->offset)
+    {
+        return BP_ERROR;
+    }
+
+    /* Remove Value from Range */
+    if(range->offset == 0)
+    {
+        array_close(array, pos);
+    }
+    else if(value == range->value)
+    {
+        range->value += 1;
+        range->offset -= 1;
+    }
+    else if(value == range->value + range->offset)
+    {
+        range->offset -= 1;
+    }
+    else
+    {
+        /* Split Range */
+        bp_val_t upper_offset = range->value + range->offset - (value + 1);
+        bp_val_t lower_offset = value - range->value - 1;
+        int status = array_open(array, pos + 1, value + 1, upper_offset);
+        if(status != BP_SUCCESS)
+        {
+            return status;
+        }
+
+        array->ranges[array->first + pos].offset = lower_offset;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_destroy - Frees all memory allocated by a given range_array_t.
+ *--------------------------------------------------------------------------------------*/
+int range_array_destroy(range_array_t* array)
+{
+    if(array == NULL)
+    {
+        return BP_ERROR;
+    }
+
+    if(array->ranges != NULL)
+    {
+        bplib_os_free(array->ranges);
+        array->ranges = NULL;
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_goto_first - Sets the iterator to the lowest range. This must be called
+ *      to prepare the array before future iteration calls to range_array_get_next.
+ *--------------------------------------------------------------------------------------*/
+int range_array_goto_first(range_array_t* array)
+{
+    assert(array != NULL);
+
+    array->iterator = 0;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * range_array_get_next - Returns the ranges within the array in order.
+ *
+ * array: A ptr to a range_array_t to iterate over. [OUTPUT]
+ * range: A ptr to a rb_range_t to update with the next range. [OUTPUT]
+ * should_pop: Whether the range at the iterator should be removed from the array. [INPUT]
+ * should_rebalance: Not used; present for compatibility with rb_tree_get_next. [INPUT]
+ * returns: A status indicating the outcome of the function call.
+ *--------------------------------------------------------------------------------------*/
+int range_array_get_next(range_array_t* array, rb_range_t* range, bool should_pop, bool should_rebalance)
+{
+    (void)should_rebalance;
+
+    assert(array != NULL);
+    assert(range != NULL);
+
+    if(array->iterator >= array->size)
+    {
+        return BP_ERROR;
+    }
+
+    *range = array->ranges[array->first + array->iterator];
+
+    if(should_pop)
+    {
+        /* Next range moves into the position of the iterator */
+        array_close(array, array->iterator);
+    }
+    else
+    {
+        array->iterator++;
+    }
+
+    return BP_SUCCESS;
+}
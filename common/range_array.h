@@ -0,0 +1,66 @@
+/************************************************************************
+ * File: range_array.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _range_array_h_
+#define _range_array_h_
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "rb_tree.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* A sorted array of non-overlapping, non-consecutive ranges of cids.  The ranges
+ * in use are held contiguously in ranges[first] through ranges[first + size - 1]
+ * so that the lowest range can be popped without moving the rest of the array. */
+typedef struct range_array {
+    bp_val_t    size;           /* The number of ranges within the array. */
+    bp_val_t    max_size;       /* The maximum number of ranges within the array. */
+    bp_val_t    first;          /* The index of the lowest range. */
+    bp_val_t    iterator;       /* The position, relative to first, of the next range returned by get next. */
+    rb_range_t* ranges;         /* The block of memory holding the ranges. */
+} range_array_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/* Range Array API
+ *
+ * NOTE: The range array provides the same interface as the rb_tree and can be used in
+ *       its place.  Ranges are located by binary search of a single block of memory, and
+ *       values that extend the highest range (the common case for custody IDs) are
+ *       merged without a search.
+ */
+
+int     range_array_create      (bp_val_t max_size, range_array_t* array);  /* Creates an empty range array. */
+int     range_array_clear       (range_array_t* array);                     /* Clears the ranges in a range array without deallocating any memory. */
+bool    range_array_is_empty    (range_array_t* array);                     /* Checks whether a range array is empty. */
+bool    range_array_is_full     (range_array_t* array);                     /* Checks whether a range array is full. */
+bp_val_t range_array_get_size   (range_array_t* array);                     /* Gets the number of ranges in a range array. */
+int     range_array_insert      (bp_val_t value, range_array_t* array);     /* Inserts number into a range array. Duplicates will not be inserted. */
+int     range_array_delete      (bp_val_t value, range_array_t* array);     /* Deletes a number from a range array and may lead to split ranges. */
+int     range_array_destroy     (range_array_t* array);                     /* Frees all memory allocated for a range array. */
+int     range_array_goto_first  (range_array_t* array);                     /* Sets the iterator to the lowest range in the array. */
+int     range_array_get_next    (range_array_t* array, rb_range_t* range, bool should_pop, bool should_rebalance); /* Gets the next range in order and increments the iterator. */
+
+#endif  /* _range_array_h_ */
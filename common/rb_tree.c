@@ -1138,7 +1138,7 @@ int rb_tree_create(bp_val_t max_size, rb_tree_t* tree)
 
     /* Allocate a block of memory for the nodes in the tree and add them all to the
        the free nodes queue. */
-    tree->node_block = (rb_node_t*) bplib_os_calloc(max_size * sizeof(rb_node_t));
+    tree->node_block = (rb_node_t*) bplib_os_calloc_tag(max_size * sizeof(rb_node_t), BP_MEM_CUSTODY_TREE);
     if (tree->node_block == NULL)
     {
         /* If no memory is allocated return an empty tree. */
@@ -1219,6 +1219,17 @@ bool rb_tree_is_full(rb_tree_t *tree)
     return tree == NULL || tree->size == tree->max_size;
 }
 
+/*--------------------------------------------------------------------------------------
+ * rb_tree_get_size -
+ *
+ * tree: The rb_tree to get the number of nodes of.
+ * returns: The number of rb_nodes (ranges) in the tree. If tree is NULL returns 0.
+ *--------------------------------------------------------------------------------------*/
+bp_val_t rb_tree_get_size(rb_tree_t *tree)
+{
+    return (tree == NULL) ? 0 : tree->size;
+}
+
 /*--------------------------------------------------------------------------------------
  * rb_tree_insert - Inserts a value into the red black tree and rebalances it accordingly.
  *
@@ -1233,6 +1244,13 @@ int rb_tree_insert(bp_val_t value, rb_tree_t* tree)
         return BP_ERROR;
     }
 
+    /* Values inside an existing range are duplicates; the merge below only
+       catches values equal to the start of a range. */
+    if (rb_tree_binary_search(tree, value) != NULL)
+    {
+        return BP_DUPLICATE;
+    }
+
     rb_node_t* inserted_node = NULL;
     int status = try_binary_insert_or_merge(value, tree, &inserted_node);
 
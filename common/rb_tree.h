@@ -77,6 +77,7 @@ int     rb_tree_create      (bp_val_t max_size, rb_tree_t* tree);   /* Creates a
 int     rb_tree_clear       (rb_tree_t* tree);                      /* Clears the nodes in a rb_tree without deallocating any memory. */
 bool    rb_tree_is_empty    (rb_tree_t* tree);                      /* Checks whether a rb_tree is empty. */
 bool    rb_tree_is_full     (rb_tree_t* tree);                      /* Checks whether a rb_tree is full. */
+bp_val_t rb_tree_get_size   (rb_tree_t* tree);                      /* Gets the number of ranges in a rb_tree. */
 int     rb_tree_insert      (bp_val_t value, rb_tree_t* tree);      /* Inserts number into a red black tree. Duplicates will not be inserted. */
 int     rb_tree_delete      (bp_val_t value, rb_tree_t* tree);      /* Deletes a number from a rb_tree_t and may lead to split nodes. */
 int     rb_tree_destroy     (rb_tree_t* tree);                      /* Frees all memory allocated for a rb_tree and recursively frees its nodes. */
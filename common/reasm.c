@@ -0,0 +1,344 @@
+/************************************************************************
+ * File: reasm.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "reasm.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define REASM_INITIAL_RANGES    4
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * key_equal -
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool key_equal(reasm_key_t* k1, reasm_key_t* k2)
+{
+    return (k1->srcnode == k2->srcnode) &&
+           (k1->srcserv == k2->srcserv) &&
+           (k1->createsec == k2->createsec) &&
+           (k1->createseq == k2->createseq);
+}
+
+/*--------------------------------------------------------------------------------------
+ * unlink_entry - removes entry from time ordered list and its memory from the budget
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void unlink_entry(reasm_t* reasm, reasm_entry_t* entry)
+{
+    if(entry->prev) entry->prev->next = entry->next;
+    else            reasm->oldest = entry->next;
+
+    if(entry->next) entry->next->prev = entry->prev;
+    else            reasm->newest = entry->prev;
+
+    entry->next = NULL;
+    entry->prev = NULL;
+
+    reasm->num_entries--;
+    reasm->memory_used -= entry->memsize;
+}
+
+/*--------------------------------------------------------------------------------------
+ * free_entry -
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void free_entry(reasm_entry_t* entry)
+{
+    if(entry->ranges) bplib_os_free(entry->ranges);
+    if(entry->buffer) bplib_os_free(entry->buffer);
+    bplib_os_free(entry);
+}
+
+/*--------------------------------------------------------------------------------------
+ * evict_oldest - frees oldest entries other than the one provided until under budget
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int evict_oldest(reasm_t* reasm, reasm_entry_t* keep, int needed)
+{
+    int evicted = 0;
+    reasm_entry_t* entry = reasm->oldest;
+    while(entry && (reasm->memory_used + needed > reasm->max_memory))
+    {
+        reasm_entry_t* next = entry->next;
+        if(entry != keep)
+        {
+            unlink_entry(reasm, entry);
+            free_entry(entry);
+            evicted++;
+        }
+        entry = next;
+    }
+
+    return evicted;
+}
+
+/*--------------------------------------------------------------------------------------
+ * insert_range -
+ *
+ *  Merges [start, stop) into the sorted range array of the entry.
+ *  Returns number of new bytes covered by range, or error code
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int insert_range(reasm_t* reasm, reasm_entry_t* entry, int start, int stop)
+{
+    int i = 0, j, k;
+
+    /* Find First Overlapping or Adjacent Range */
+    while(i < entry->num_ranges && entry->ranges[i].stop < start) i++;
+
+    /* Find End of Overlapping or Adjacent Ranges */
+    j = i;
+    while(j < entry->num_ranges && entry->ranges[j].start <= stop) j++;
+
+    if(i == j)
+    {
+        /* Grow Range Array */
+        if(entry->num_ranges == entry->max_ranges)
+        {
+            int new_max = entry->max_ranges * 2;
+            reasm_range_t* new_ranges = (reasm_range_t*)bplib_os_calloc(sizeof(reasm_range_t) * new_max);
+            if(new_ranges == NULL) return BP_ERROR;
+            memcpy(new_ranges, entry->ranges, sizeof(reasm_range_t) * entry->num_ranges);
+            bplib_os_free(entry->ranges);
+            entry->ranges = new_ranges;
+            entry->memsize += sizeof(reasm_range_t) * entry->max_ranges;
+            reasm->memory_used += sizeof(reasm_range_t) * entry->max_ranges;
+            entry->max_ranges = new_max;
+        }
+
+        /* Insert New Disjoint Range */
+        for(k = entry->num_ranges; k > i; k--) entry->ranges[k] = entry->ranges[k - 1];
+        entry->ranges[i].start = start;
+        entry->ranges[i].stop = stop;
+        entry->num_ranges++;
+
+        return stop - start;
+    }
+    else
+    {
+        /* Merge Ranges i..j-1 with New Range */
+        int covered = 0;
+        int new_start = start < entry->ranges[i].start ? start : entry->ranges[i].start;
+        int new_stop = stop > entry->ranges[j - 1].stop ? stop : entry->ranges[j - 1].stop;
+        for(k = i; k < j; k++) covered += entry->ranges[k].stop - entry->ranges[k].start;
+        entry->ranges[i].start = new_start;
+        entry->ranges[i].stop = new_stop;
+
+        /* Collapse Merged Ranges */
+        for(k = j; k < entry->num_ranges; k++) entry->ranges[i + 1 + k - j] = entry->ranges[k];
+        entry->num_ranges -= j - i - 1;
+
+        return (new_stop - new_start) - covered;
+    }
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * reasm_create -
+ *
+ *  reasm - pointer to reassembly table to initialize [OUTPUT]
+ *  max_memory - number of bytes the table may use to hold partial bundles [INPUT]
+ *  Returns:    BP_SUCCESS or error code
+ *-------------------------------------------------------------------------------------*/
+int reasm_create(reasm_t* reasm, int max_memory)
+{
+    /* Check Parameters */
+    if(reasm == NULL || max_memory < 0) return BP_ERROR;
+
+    /* Initialize Table */
+    reasm->oldest       = NULL;
+    reasm->newest       = NULL;
+    reasm->num_entries  = 0;
+    reasm->memory_used  = 0;
+    reasm->max_memory   = max_memory;
+
+    /* Return Success */
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * reasm_destroy -
+ *-------------------------------------------------------------------------------------*/
+int reasm_destroy(reasm_t* reasm)
+{
+    if(reasm == NULL) return BP_ERROR;
+
+    while(reasm->oldest)
+    {
+        reasm_entry_t* entry = reasm->oldest;
+        unlink_entry(reasm, entry);
+        free_entry(entry);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * reasm_add -
+ *
+ *  reasm - reassembly table [INPUT]
+ *  key - identifies the original bundle [INPUT]
+ *  data - payload store header of fragment (exprtime, ackapp) [INPUT]
+ *  paylen - total length of the payload of the original bundle [INPUT]
+ *  offset - offset of fragment into payload of original bundle [INPUT]
+ *  fragment - pointer to fragment payload [INPUT]
+ *  size - size of fragment payload [INPUT]
+ *  complete - set to the fully reassembled entry, otherwise NULL [OUTPUT]
+ *  evicted - number of partial bundles evicted to make room [OUTPUT]
+ *
+ *  Returns:    BP_SUCCESS if fragment added, BP_DUPLICATE if fragment carried
+ *              no new data, BP_FULL if bundle cannot fit in budget, else BP_ERROR
+ *
+ *  Notes:  A completed entry is removed from the table and its memory is no longer
+ *          counted against the budget; the caller must call reasm_release on it.
+ *-------------------------------------------------------------------------------------*/
+int reasm_add(reasm_t* reasm, reasm_key_t key, bp_payload_data_t* data, int paylen, int offset, uint8_t* fragment, int size, reasm_entry_t** complete, int* evicted)
+{
+    reasm_entry_t* entry;
+    int new_bytes;
+
+    /* Initialize Outputs */
+    *complete = NULL;
+    *evicted = 0;
+
+    /* Check Parameters */
+    if(paylen <= 0 || offset < 0 || size <= 0 || size > paylen - offset) return BP_ERROR;
+
+    /* Find Entry (most recent first) */
+    for(entry = reasm->newest; entry != NULL; entry = entry->prev)
+    {
+        if(key_equal(&entry->key, &key)) break;
+    }
+
+    /* Create Entry */
+    if(entry == NULL)
+    {
+        int memsize = sizeof(reasm_entry_t) + paylen + (sizeof(reasm_range_t) * REASM_INITIAL_RANGES);
+        if(memsize > reasm->max_memory) return BP_FULL;
+
+        /* Make Room */
+        *evicted += evict_oldest(reasm, NULL, memsize);
+
+        /* Allocate Entry */
+        entry = (reasm_entry_t*)bplib_os_calloc(sizeof(reasm_entry_t));
+        if(entry == NULL) return BP_ERROR;
+        entry->buffer = (uint8_t*)bplib_os_calloc(paylen);
+        entry->ranges = (reasm_range_t*)bplib_os_calloc(sizeof(reasm_range_t) * REASM_INITIAL_RANGES);
+        if(entry->buffer == NULL || entry->ranges == NULL)
+        {
+            free_entry(entry);
+            return BP_ERROR;
+        }
+
+        /* Initialize Entry */
+        entry->key = key;
+        entry->data = *data;
+        entry->data.payloadsize = paylen;
+        entry->received = 0;
+        entry->num_ranges = 0;
+        entry->max_ranges = REASM_INITIAL_RANGES;
+        entry->memsize = memsize;
+
+        /* Append as Newest */
+        entry->prev = reasm->newest;
+        entry->next = NULL;
+        if(reasm->newest)   reasm->newest->next = entry;
+        else                reasm->oldest = entry;
+        reasm->newest = entry;
+        reasm->num_entries++;
+        reasm->memory_used += memsize;
+    }
+    else if(entry->data.payloadsize != paylen)
+    {
+        return bplog(NULL, BP_FLAG_FAILED_TO_PARSE, "Fragment total length %d inconsistent with %d\n", paylen, entry->data.payloadsize);
+    }
+
+    /* Record Byte Range */
+    new_bytes = insert_range(reasm, entry, offset, offset + size);
+    if(new_bytes < 0) return new_bytes;
+    else if(new_bytes == 0) return BP_DUPLICATE;
+
+    /* Copy Fragment into Assembly Buffer */
+    memcpy(&entry->buffer[offset], fragment, size);
+    entry->received += new_bytes;
+
+    /* Check Complete */
+    if(entry->received == paylen)
+    {
+        unlink_entry(reasm, entry);
+        *complete = entry;
+    }
+    else if(reasm->memory_used > reasm->max_memory)
+    {
+        /* Range growth pushed table over budget */
+        *evicted += evict_oldest(reasm, entry, 0);
+    }
+
+    /* Return Success */
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * reasm_release - frees an entry returned as complete by reasm_add
+ *-------------------------------------------------------------------------------------*/
+int reasm_release(reasm_t* reasm, reasm_entry_t* entry)
+{
+    if(reasm == NULL || entry == NULL) return BP_ERROR;
+    free_entry(entry);
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * reasm_expire - frees partial bundles whose lifetime has expired
+ *
+ *  Returns:    number of entries expired
+ *-------------------------------------------------------------------------------------*/
+int reasm_expire(reasm_t* reasm, bp_val_t sysnow)
+{
+    int expired = 0;
+    reasm_entry_t* entry = reasm->oldest;
+    while(entry)
+    {
+        reasm_entry_t* next = entry->next;
+        if(entry->data.exprtime != 0 && sysnow >= entry->data.exprtime)
+        {
+            unlink_entry(reasm, entry);
+            free_entry(entry);
+            expired++;
+        }
+        entry = next;
+    }
+
+    return expired;
+}
+
+/*--------------------------------------------------------------------------------------
+ * reasm_count - number of partial bundles
+ *-------------------------------------------------------------------------------------*/
+int reasm_count(reasm_t* reasm)
+{
+    return reasm->num_entries;
+}
@@ -0,0 +1,80 @@
+/************************************************************************
+ * File: reasm.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _reasm_h_
+#define _reasm_h_
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bundle_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Reassembly Key - identifies the original bundle of a fragment */
+typedef struct {
+    bp_ipn_t            srcnode;
+    bp_ipn_t            srcserv;
+    bp_val_t            createsec;
+    bp_val_t            createseq;
+} reasm_key_t;
+
+/* Received Byte Range - [start, stop) */
+typedef struct {
+    int                 start;
+    int                 stop;
+} reasm_range_t;
+
+/* Partially Reassembled Bundle */
+typedef struct reasm_entry {
+    reasm_key_t         key;
+    bp_payload_data_t   data;           /* payload store header of reassembled payload */
+    int                 received;       /* number of unique payload bytes received */
+    int                 num_ranges;     /* number of disjoint byte ranges received */
+    int                 max_ranges;     /* allocated size of range array */
+    reasm_range_t*      ranges;         /* sorted, non-overlapping, non-adjacent ranges */
+    uint8_t*            buffer;         /* assembly buffer holding the entire payload */
+    int                 memsize;        /* memory charged against reassembly budget */
+    struct reasm_entry* next;           /* newer entry */
+    struct reasm_entry* prev;           /* older entry */
+} reasm_entry_t;
+
+/* Reassembly Table */
+typedef struct {
+    reasm_entry_t*      oldest;
+    reasm_entry_t*      newest;
+    int                 num_entries;
+    int                 memory_used;
+    int                 max_memory;
+} reasm_t;
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int reasm_create    (reasm_t* reasm, int max_memory);
+int reasm_destroy   (reasm_t* reasm);
+int reasm_add       (reasm_t* reasm, reasm_key_t key, bp_payload_data_t* data, int paylen, int offset, uint8_t* fragment, int size, reasm_entry_t** complete, int* evicted);
+int reasm_release   (reasm_t* reasm, reasm_entry_t* entry);
+int reasm_expire    (reasm_t* reasm, bp_val_t sysnow);
+int reasm_count     (reasm_t* reasm);
+
+#endif  /* _reasm_h_ */
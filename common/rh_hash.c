@@ -27,17 +27,61 @@
  DEFINES
  ******************************************************************************/
 
-#define NULL_INDEX      BP_MAX_INDEX    /* 0 is a valid index so max_val is used */
+#define NULL_INDEX      RH_NULL_INDEX   /* 0 is a valid index so max_val is used */
+#define NULL_INDEX16    UINT16_MAX      /* null index when links are 16 bits */
 #define HASH_CID(cid)   (cid)           /* identify function for now */
 
 /******************************************************************************
  LOCAL FUNCTIONS
  ******************************************************************************/
 
+/*----------------------------------------------------------------------------
+ * get_link
+ *----------------------------------------------------------------------------*/
+static inline uint32_t get_link(rh_hash_t* rh_hash, uint32_t index, int link)
+{
+    if(rh_hash->links16)
+    {
+        uint16_t value = rh_hash->links16[(index * RH_NUM_LINKS) + link];
+        return (value == NULL_INDEX16) ? NULL_INDEX : value;
+    }
+
+    return rh_hash->links32[(index * RH_NUM_LINKS) + link];
+}
+
+/*----------------------------------------------------------------------------
+ * set_link
+ *----------------------------------------------------------------------------*/
+static inline void set_link(rh_hash_t* rh_hash, uint32_t index, int link, uint32_t value)
+{
+    if(rh_hash->links16)
+    {
+        rh_hash->links16[(index * RH_NUM_LINKS) + link] = (value == NULL_INDEX) ? NULL_INDEX16 : (uint16_t)value;
+    }
+    else
+    {
+        rh_hash->links32[(index * RH_NUM_LINKS) + link] = value;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * copy_node - copies bundle and links of one entry to another
+ *----------------------------------------------------------------------------*/
+static inline void copy_node(rh_hash_t* rh_hash, uint32_t dst_index, uint32_t src_index)
+{
+    int link;
+
+    rh_hash->table[dst_index] = rh_hash->table[src_index];
+    for(link = 0; link < RH_NUM_LINKS; link++)
+    {
+        set_link(rh_hash, dst_index, link, get_link(rh_hash, src_index, link));
+    }
+}
+
 /*----------------------------------------------------------------------------
  * overwrite_node
  *----------------------------------------------------------------------------*/
-BP_LOCAL_SCOPE int overwrite_node(rh_hash_t* rh_hash, bp_index_t index, bp_active_bundle_t bundle, bool overwrite)
+BP_LOCAL_SCOPE int overwrite_node(rh_hash_t* rh_hash, uint32_t index, bp_active_bundle_t bundle, bool overwrite)
 {
     if(overwrite)
     {
@@ -45,24 +89,24 @@ BP_LOCAL_SCOPE int overwrite_node(rh_hash_t* rh_hash, bp_index_t index, bp_activ
         rh_hash->table[index].bundle = bundle;
 
         /* Bridge Over Entry */
-        bp_index_t before_index = rh_hash->table[index].before;
-        bp_index_t after_index = rh_hash->table[index].after;
-        if(before_index != NULL_INDEX) rh_hash->table[before_index].after = after_index;
-        if(after_index != NULL_INDEX) rh_hash->table[after_index].before = before_index;
+        uint32_t before_index = get_link(rh_hash, index, RH_LINK_BEFORE);
+        uint32_t after_index = get_link(rh_hash, index, RH_LINK_AFTER);
+        if(before_index != NULL_INDEX) set_link(rh_hash, before_index, RH_LINK_AFTER, after_index);
+        if(after_index != NULL_INDEX) set_link(rh_hash, after_index, RH_LINK_BEFORE, before_index);
 
         /* Check if Overwriting Oldest/Newest */
         if(index == rh_hash->oldest_entry) rh_hash->oldest_entry = after_index;
         if(index == rh_hash->newest_entry) rh_hash->newest_entry = before_index;
 
         /* Set Current Entry as Newest */
-        bp_index_t oldest_index = rh_hash->oldest_entry;
-        bp_index_t newest_index = rh_hash->newest_entry;
-        rh_hash->table[index].after = NULL_INDEX;
-        rh_hash->table[index].before = newest_index;
+        uint32_t oldest_index = rh_hash->oldest_entry;
+        uint32_t newest_index = rh_hash->newest_entry;
+        set_link(rh_hash, index, RH_LINK_AFTER, NULL_INDEX);
+        set_link(rh_hash, index, RH_LINK_BEFORE, newest_index);
         rh_hash->newest_entry = index;
 
         /* Update Newest/Oldest */
-        if(newest_index != NULL_INDEX) rh_hash->table[newest_index].after = index;
+        if(newest_index != NULL_INDEX) set_link(rh_hash, newest_index, RH_LINK_AFTER, index);
         if(oldest_index == NULL_INDEX) rh_hash->oldest_entry = index;
 
         /* Return Success */
@@ -78,13 +122,13 @@ BP_LOCAL_SCOPE int overwrite_node(rh_hash_t* rh_hash, bp_index_t index, bp_activ
 /*----------------------------------------------------------------------------
  * write_node
  *----------------------------------------------------------------------------*/
-BP_LOCAL_SCOPE void write_node(rh_hash_t* rh_hash, bp_index_t index, bp_active_bundle_t bundle)
+BP_LOCAL_SCOPE void write_node(rh_hash_t* rh_hash, uint32_t index, bp_active_bundle_t bundle)
 {
     rh_hash->table[index].bundle    = bundle;
-    rh_hash->table[index].next      = NULL_INDEX;
-    rh_hash->table[index].prev      = NULL_INDEX;
-    rh_hash->table[index].after     = NULL_INDEX;
-    rh_hash->table[index].before    = rh_hash->newest_entry;
+    set_link(rh_hash, index, RH_LINK_NEXT, NULL_INDEX);
+    set_link(rh_hash, index, RH_LINK_PREV, NULL_INDEX);
+    set_link(rh_hash, index, RH_LINK_AFTER, NULL_INDEX);
+    set_link(rh_hash, index, RH_LINK_BEFORE, rh_hash->newest_entry);
 
     /* Update Time Order */
     if(rh_hash->oldest_entry == NULL_INDEX)
@@ -96,7 +140,7 @@ BP_LOCAL_SCOPE void write_node(rh_hash_t* rh_hash, bp_index_t index, bp_active_b
     else
     {
         /* Not First Entry */
-        rh_hash->table[rh_hash->newest_entry].after = index;
+        set_link(rh_hash, rh_hash->newest_entry, RH_LINK_AFTER, index);
         rh_hash->newest_entry = index;
     }
 }
@@ -113,25 +157,38 @@ int rh_hash_create(rh_hash_t** rh_hash, int size)
     int i;
 
     /* Check Hash Size */
-    if(size < 0 || (unsigned long)size > BP_MAX_INDEX) return BP_ERROR;
+    if(size < 0 || (unsigned long)size >= RH_NULL_INDEX) return BP_ERROR;
 
     /* Allocate Hash Structure */
-    *rh_hash = (rh_hash_t*)bplib_os_calloc(sizeof(rh_hash_t));
+    *rh_hash = (rh_hash_t*)bplib_os_calloc_tag(sizeof(rh_hash_t), BP_MEM_ACTIVE_TABLE);
+    if(*rh_hash == NULL) return BP_ERROR;
 
     if(size > 0)
     {
         /* Allocate Hash Table */
-        (*rh_hash)->table = (rh_hash_node_t*)bplib_os_calloc(size * sizeof(rh_hash_node_t));
+        (*rh_hash)->table = (rh_hash_node_t*)bplib_os_calloc_tag(size * sizeof(rh_hash_node_t), BP_MEM_ACTIVE_TABLE);
         if((*rh_hash)->table == NULL) return BP_ERROR;
 
+        /* Allocate Links - 16 bits when every index and the null index fit */
+        if(size < NULL_INDEX16)
+        {
+            (*rh_hash)->links16 = (uint16_t*)bplib_os_calloc_tag(size * RH_NUM_LINKS * sizeof(uint16_t), BP_MEM_ACTIVE_TABLE);
+            if((*rh_hash)->links16 == NULL) return BP_ERROR;
+        }
+        else
+        {
+            (*rh_hash)->links32 = (uint32_t*)bplib_os_calloc_tag(size * RH_NUM_LINKS * sizeof(uint32_t), BP_MEM_ACTIVE_TABLE);
+            if((*rh_hash)->links32 == NULL) return BP_ERROR;
+        }
+
         /* Initialize Hash Table to Empty */
         for(i = 0; i < size; i++)
         {
             (*rh_hash)->table[i].bundle.sid = BP_SID_VACANT;
-            (*rh_hash)->table[i].next   = NULL_INDEX;
-            (*rh_hash)->table[i].prev   = NULL_INDEX;
-            (*rh_hash)->table[i].before = NULL_INDEX;
-            (*rh_hash)->table[i].after  = NULL_INDEX;
+            set_link(*rh_hash, i, RH_LINK_NEXT, NULL_INDEX);
+            set_link(*rh_hash, i, RH_LINK_PREV, NULL_INDEX);
+            set_link(*rh_hash, i, RH_LINK_BEFORE, NULL_INDEX);
+            set_link(*rh_hash, i, RH_LINK_AFTER, NULL_INDEX);
         }
     }
     else
@@ -158,6 +215,8 @@ int rh_hash_destroy(rh_hash_t* rh_hash)
     if(rh_hash)
     {
         if(rh_hash->table) bplib_os_free(rh_hash->table);
+        if(rh_hash->links16) bplib_os_free(rh_hash->links16);
+        if(rh_hash->links32) bplib_os_free(rh_hash->links32);
         bplib_os_free(rh_hash);
     }
 
@@ -169,7 +228,7 @@ int rh_hash_destroy(rh_hash_t* rh_hash)
  *----------------------------------------------------------------------------*/
 int rh_hash_add(rh_hash_t* rh_hash, bp_active_bundle_t bundle, bool overwrite)
 {
-    bp_index_t curr_index = HASH_CID(bundle.cid) % rh_hash->size;
+    uint32_t curr_index = HASH_CID(bundle.cid) % rh_hash->size;
 
     /* Add Entry to Hash */
     if(rh_hash->table[curr_index].bundle.sid == BP_SID_VACANT)
@@ -185,8 +244,8 @@ int rh_hash_add(rh_hash_t* rh_hash, bp_active_bundle_t bundle, bool overwrite)
         }
 
         /* Transverse to End of Chain */
-        bp_index_t end_index = curr_index;
-        bp_index_t scan_index = rh_hash->table[curr_index].next;
+        uint32_t end_index = curr_index;
+        uint32_t scan_index = get_link(rh_hash, curr_index, RH_LINK_NEXT);
         while(scan_index != NULL_INDEX)
         {
             /* Check Slot for Duplicate */
@@ -197,11 +256,11 @@ int rh_hash_add(rh_hash_t* rh_hash, bp_active_bundle_t bundle, bool overwrite)
 
             /* Go To Next Slot */
             end_index = scan_index;
-            scan_index = rh_hash->table[scan_index].next;
+            scan_index = get_link(rh_hash, scan_index, RH_LINK_NEXT);
         }
 
         /* Find First Open Hash Slot */
-        bp_index_t open_index = (curr_index + 1) % rh_hash->size;
+        uint32_t open_index = (curr_index + 1) % rh_hash->size;
         while( (rh_hash->table[open_index].bundle.sid != BP_SID_VACANT) &&
                (open_index != curr_index) )
         {
@@ -215,42 +274,42 @@ int rh_hash_add(rh_hash_t* rh_hash, bp_active_bundle_t bundle, bool overwrite)
         }
 
         /* Insert Node */
-        if(rh_hash->table[curr_index].prev == NULL_INDEX) /* End of Chain Insertion (chain == 1) */
+        if(get_link(rh_hash, curr_index, RH_LINK_PREV) == NULL_INDEX) /* End of Chain Insertion (chain == 1) */
         {
             /* Add Entry to Open Slot at End of Chain */
             write_node(rh_hash, open_index, bundle);
-            rh_hash->table[end_index].next = open_index;
-            rh_hash->table[open_index].prev = end_index;
+            set_link(rh_hash, end_index, RH_LINK_NEXT, open_index);
+            set_link(rh_hash, open_index, RH_LINK_PREV, end_index);
         }
         else /* Robin Hood Insertion (chain > 1) */
         {
             /* Copy Current Slot to Open Slot */
-            rh_hash->table[open_index] = rh_hash->table[curr_index];
+            copy_node(rh_hash, open_index, curr_index);
 
             /* Update Hash Links */
-            bp_index_t next_index = rh_hash->table[curr_index].next;
-            bp_index_t prev_index = rh_hash->table[curr_index].prev;
-            if(next_index != NULL_INDEX) rh_hash->table[next_index].prev = open_index;
-            if(prev_index != NULL_INDEX) rh_hash->table[prev_index].next = open_index;
+            uint32_t next_index = get_link(rh_hash, curr_index, RH_LINK_NEXT);
+            uint32_t prev_index = get_link(rh_hash, curr_index, RH_LINK_PREV);
+            if(next_index != NULL_INDEX) set_link(rh_hash, next_index, RH_LINK_PREV, open_index);
+            if(prev_index != NULL_INDEX) set_link(rh_hash, prev_index, RH_LINK_NEXT, open_index);
 
             /* Update Time Order (Move) */
-            bp_index_t after_index  = rh_hash->table[curr_index].after;
-            bp_index_t before_index = rh_hash->table[curr_index].before;
-            if(after_index != NULL_INDEX)   rh_hash->table[after_index].before = open_index;
-            if(before_index != NULL_INDEX)  rh_hash->table[before_index].after = open_index;
+            uint32_t after_index  = get_link(rh_hash, curr_index, RH_LINK_AFTER);
+            uint32_t before_index = get_link(rh_hash, curr_index, RH_LINK_BEFORE);
+            if(after_index != NULL_INDEX)   set_link(rh_hash, after_index, RH_LINK_BEFORE, open_index);
+            if(before_index != NULL_INDEX)  set_link(rh_hash, before_index, RH_LINK_AFTER, open_index);
 
             /* Update Oldest Entry */
             if(rh_hash->oldest_entry == curr_index)
             {
                 rh_hash->oldest_entry = open_index;
-                rh_hash->table[rh_hash->oldest_entry].before = NULL_INDEX;
+                set_link(rh_hash, rh_hash->oldest_entry, RH_LINK_BEFORE, NULL_INDEX);
             }
 
             /* Update Newest Entry */
             if(rh_hash->newest_entry == curr_index)
             {
                 rh_hash->newest_entry = open_index;
-                rh_hash->table[rh_hash->newest_entry].after = NULL_INDEX;
+                set_link(rh_hash, rh_hash->newest_entry, RH_LINK_AFTER, NULL_INDEX);
             }
 
             /* Add Entry to Current Slot */
@@ -284,7 +343,7 @@ int rh_hash_next(rh_hash_t* rh_hash, bp_active_bundle_t* bundle)
  *----------------------------------------------------------------------------*/
 int rh_hash_remove(rh_hash_t* rh_hash, bp_val_t cid, bp_active_bundle_t* bundle)
 {
-    bp_index_t curr_index = HASH_CID(cid) % rh_hash->size;
+    uint32_t curr_index = HASH_CID(cid) % rh_hash->size;
 
     /* Find Node to Remove */
     while(curr_index != NULL_INDEX)
@@ -299,7 +358,7 @@ int rh_hash_remove(rh_hash_t* rh_hash, bp_val_t cid, bp_active_bundle_t* bundle)
         }
         else /* go to next */
         {
-            curr_index = rh_hash->table[curr_index].next;
+            curr_index = get_link(rh_hash, curr_index, RH_LINK_NEXT);
         }
     }
 
@@ -313,37 +372,37 @@ int rh_hash_remove(rh_hash_t* rh_hash, bp_val_t cid, bp_active_bundle_t* bundle)
     if(bundle) *bundle = rh_hash->table[curr_index].bundle;
 
     /* Update Time Order (Bridge) */
-    bp_index_t after_index  = rh_hash->table[curr_index].after;
-    bp_index_t before_index = rh_hash->table[curr_index].before;
-    if(after_index != NULL_INDEX)   rh_hash->table[after_index].before = before_index;
-    if(before_index != NULL_INDEX)  rh_hash->table[before_index].after = after_index;
+    uint32_t after_index  = get_link(rh_hash, curr_index, RH_LINK_AFTER);
+    uint32_t before_index = get_link(rh_hash, curr_index, RH_LINK_BEFORE);
+    if(after_index != NULL_INDEX)   set_link(rh_hash, after_index, RH_LINK_BEFORE, before_index);
+    if(before_index != NULL_INDEX)  set_link(rh_hash, before_index, RH_LINK_AFTER, after_index);
 
     /* Update Newest and Oldest Entry */
     if(curr_index == rh_hash->newest_entry)  rh_hash->newest_entry = before_index;
     if(curr_index == rh_hash->oldest_entry)  rh_hash->oldest_entry = after_index;
 
     /* Remove End of Chain */
-    bp_index_t end_index = curr_index;
-    bp_index_t next_index = rh_hash->table[curr_index].next;
+    uint32_t end_index = curr_index;
+    uint32_t next_index = get_link(rh_hash, curr_index, RH_LINK_NEXT);
     if(next_index != NULL_INDEX)
     {
         /* Transverse to End of Chain */
         end_index = next_index;
-        while(rh_hash->table[end_index].next != NULL_INDEX)
+        while(get_link(rh_hash, end_index, RH_LINK_NEXT) != NULL_INDEX)
         {
-            end_index = rh_hash->table[end_index].next;
+            end_index = get_link(rh_hash, end_index, RH_LINK_NEXT);
         }
 
         /* Copy End of Chain into Removed Slot */
         rh_hash->table[curr_index].bundle = rh_hash->table[end_index].bundle;
-        rh_hash->table[curr_index].before = rh_hash->table[end_index].before;
-        rh_hash->table[curr_index].after  = rh_hash->table[end_index].after;
+        set_link(rh_hash, curr_index, RH_LINK_BEFORE, get_link(rh_hash, end_index, RH_LINK_BEFORE));
+        set_link(rh_hash, curr_index, RH_LINK_AFTER, get_link(rh_hash, end_index, RH_LINK_AFTER));
 
         /* Update Time Order (Move) */
-        after_index  = rh_hash->table[end_index].after;
-        before_index = rh_hash->table[end_index].before;
-        if(after_index != NULL_INDEX) rh_hash->table[after_index].before = curr_index;
-        if(before_index != NULL_INDEX) rh_hash->table[before_index].after = curr_index;
+        after_index  = get_link(rh_hash, end_index, RH_LINK_AFTER);
+        before_index = get_link(rh_hash, end_index, RH_LINK_BEFORE);
+        if(after_index != NULL_INDEX) set_link(rh_hash, after_index, RH_LINK_BEFORE, curr_index);
+        if(before_index != NULL_INDEX) set_link(rh_hash, before_index, RH_LINK_AFTER, curr_index);
 
         /* Update Newest and Oldest Entry */
         if(end_index == rh_hash->newest_entry)  rh_hash->newest_entry = curr_index;
@@ -354,8 +413,8 @@ int rh_hash_remove(rh_hash_t* rh_hash, bp_val_t cid, bp_active_bundle_t* bundle)
     rh_hash->table[end_index].bundle.sid = BP_SID_VACANT;
 
     /* Update Hash Order */
-    bp_index_t prev_index = rh_hash->table[end_index].prev;
-    if(prev_index != NULL_INDEX) rh_hash->table[prev_index].next = NULL_INDEX;
+    uint32_t prev_index = get_link(rh_hash, end_index, RH_LINK_PREV);
+    if(prev_index != NULL_INDEX) set_link(rh_hash, prev_index, RH_LINK_NEXT, NULL_INDEX);
 
     /* Update Statistics */
     rh_hash->num_entries--;
@@ -364,6 +423,27 @@ int rh_hash_remove(rh_hash_t* rh_hash, bp_val_t cid, bp_active_bundle_t* bundle)
     return BP_SUCCESS;
 }
 
+/*----------------------------------------------------------------------------
+ * rh_hash_remove_range - removes count custody IDs starting at cid, storing
+ *  the storage IDs of the removed bundles in sids; returns number removed
+ *----------------------------------------------------------------------------*/
+int rh_hash_remove_range(rh_hash_t* rh_hash, bp_val_t cid, int count, bp_sid_t* sids)
+{
+    bp_active_bundle_t bundle;
+    int removed = 0;
+    int i;
+
+    for(i = 0; i < count && rh_hash->num_entries > 0; i++)
+    {
+        if(rh_hash_remove(rh_hash, cid + i, &bundle) == BP_SUCCESS)
+        {
+            sids[removed++] = bundle.sid;
+        }
+    }
+
+    return removed;
+}
+
 /*----------------------------------------------------------------------------
  * rh_hash_available
  *----------------------------------------------------------------------------*/
@@ -387,3 +467,27 @@ int rh_hash_count(rh_hash_t* rh_hash)
 {
     return rh_hash->num_entries;
 }
+
+/*----------------------------------------------------------------------------
+ * rh_hash_walk - visits entries oldest first, stopping at first failure
+ *----------------------------------------------------------------------------*/
+int rh_hash_walk(rh_hash_t* rh_hash, bp_table_visit_t visit, void* parm)
+{
+    uint32_t index = rh_hash->oldest_entry;
+    while(index != NULL_INDEX)
+    {
+        int status = visit(parm, &rh_hash->table[index].bundle);
+        if(status != BP_SUCCESS) return status;
+        index = get_link(rh_hash, index, RH_LINK_AFTER);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * rh_hash_link - returns link of entry at index, RH_NULL_INDEX if none
+ *----------------------------------------------------------------------------*/
+uint32_t rh_hash_link(rh_hash_t* rh_hash, uint32_t index, int link)
+{
+    return get_link(rh_hash, index, link);
+}
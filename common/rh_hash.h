@@ -24,24 +24,40 @@
 #include "bplib.h"
 #include "bundle_types.h"
 
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/* Links of an Entry */
+#define RH_LINK_NEXT            0       /* next entry in chain */
+#define RH_LINK_PREV            1       /* previous entry in chain */
+#define RH_LINK_AFTER           2       /* next entry added to hash (time ordered) */
+#define RH_LINK_BEFORE          3       /* previous entry added to hash (time ordered) */
+#define RH_NUM_LINKS            4
+
+#define RH_NULL_INDEX           UINT32_MAX
+
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
 
 typedef struct {
     bp_active_bundle_t  bundle;
-    bp_index_t          next;   // next entry in chain
-    bp_index_t          prev;   // previous entry in chain
-    bp_index_t          after;  // next entry added to hash (time ordered)
-    bp_index_t          before; // previous entry added to hash (time ordered)
 } rh_hash_node_t;
 
+/*
+ * The links of each entry are kept apart from the bundles in 16-bit indices when
+ * the hash has fewer than 65535 entries, and in 32-bit indices otherwise, so that
+ * small hashes stay compact and large ones are not limited by the index width.
+ */
 typedef struct {
     rh_hash_node_t*     table;
-    bp_index_t          size;
-    bp_index_t          num_entries;
-    bp_index_t          oldest_entry;
-    bp_index_t          newest_entry;
+    uint16_t*           links16;    // RH_NUM_LINKS per entry, used when size fits in 16 bits
+    uint32_t*           links32;    // RH_NUM_LINKS per entry, used otherwise
+    int                 size;
+    int                 num_entries;
+    uint32_t            oldest_entry;
+    uint32_t            newest_entry;
 } rh_hash_t;
 
 /******************************************************************************
@@ -53,7 +69,10 @@ int rh_hash_destroy     (rh_hash_t* rh_hash);
 int rh_hash_add         (rh_hash_t* rh_hash, bp_active_bundle_t bundle, bool overwrite);
 int rh_hash_next        (rh_hash_t* rh_hash, bp_active_bundle_t* bundle);
 int rh_hash_remove      (rh_hash_t* rh_hash, bp_val_t cid, bp_active_bundle_t* bundle);
+int rh_hash_remove_range(rh_hash_t* rh_hash, bp_val_t cid, int count, bp_sid_t* sids);
 int rh_hash_available   (rh_hash_t* rh_hash, bp_val_t cid);
 int rh_hash_count       (rh_hash_t* rh_hash);
+int rh_hash_walk        (rh_hash_t* rh_hash, bp_table_visit_t visit, void* parm);
+uint32_t rh_hash_link   (rh_hash_t* rh_hash, uint32_t index, int link);
 
 #endif /* _rh_hash_h_ */
\ No newline at end of file
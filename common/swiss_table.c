@@ -0,0 +1,512 @@
+/************************************************************************
+ * File: swiss_table.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bundle_types.h"
+#include "swiss_table.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define CTRL_EMPTY          0x80
+#define CTRL_DELETED        0xFE
+#define MAX_TABLE_SIZE      0x20000000  /* keeps slot count and ring positions within 32 bits */
+#define HASH_MULTIPLIER     0x9E3779B97F4A7C15ULL
+#define MAX_LOAD(c)         ((c) - ((c) / 8))   /* used slots (live and deleted) before purging */
+
+#ifdef __SSE2__
+#define GROUP_SIZE          16
+#else
+#define GROUP_SIZE          8
+#define GROUP_LSBS          0x0101010101010101ULL
+#define GROUP_MSBS          0x8080808080808080ULL
+#endif
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* One bit per slot of a group that matched; iterated lowest slot first */
+#ifdef __SSE2__
+typedef uint32_t group_mask_t;
+#else
+typedef uint64_t group_mask_t;
+#endif
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * ctrl_hash - seven bits of the custody ID, mixed so that custody IDs that
+ *  share a group rarely share a control byte
+ *----------------------------------------------------------------------------*/
+static inline uint8_t ctrl_hash(bp_val_t cid)
+{
+    return (uint8_t)(((uint64_t)cid * HASH_MULTIPLIER) >> 57);
+}
+
+/*----------------------------------------------------------------------------
+ * home_group - custody IDs are assigned sequentially, so consecutive custody
+ *  IDs go to consecutive groups; with the active custody IDs filling at most
+ *  half the slots, each group holds about half a group of them and seldom fills
+ *----------------------------------------------------------------------------*/
+static inline unsigned long home_group(swiss_table_t* table, bp_val_t cid)
+{
+    return (unsigned long)cid & ((table->capacity / GROUP_SIZE) - 1);
+}
+
+/*----------------------------------------------------------------------------
+ * mask_first - slot within group of the lowest set bit of a non-zero mask
+ *----------------------------------------------------------------------------*/
+static inline unsigned int mask_first(group_mask_t mask)
+{
+    unsigned int bit = 0;
+#ifdef __GNUC__
+    bit = (unsigned int)__builtin_ctzll((unsigned long long)mask);
+#else
+    while(!(mask & 1)) { mask >>= 1; bit++; }
+#endif
+#ifdef __SSE2__
+    return bit;
+#else
+    return bit >> 3;
+#endif
+}
+
+#ifdef __SSE2__
+
+/*----------------------------------------------------------------------------
+ * group_match - slots in the group whose control byte equals h2
+ *----------------------------------------------------------------------------*/
+static inline group_mask_t group_match(const uint8_t* ctrl, uint8_t h2)
+{
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (group_mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+}
+
+/*----------------------------------------------------------------------------
+ * group_empty - slots in the group that are empty
+ *----------------------------------------------------------------------------*/
+static inline group_mask_t group_empty(const uint8_t* ctrl)
+{
+    return group_match(ctrl, CTRL_EMPTY);
+}
+
+/*----------------------------------------------------------------------------
+ * group_free - slots in the group that are empty or deleted
+ *----------------------------------------------------------------------------*/
+static inline group_mask_t group_free(const uint8_t* ctrl)
+{
+    return (group_mask_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+}
+
+#else
+
+/*----------------------------------------------------------------------------
+ * group_load - control bytes of group with the first slot in the lowest byte
+ *----------------------------------------------------------------------------*/
+static inline uint64_t group_load(const uint8_t* ctrl)
+{
+    uint64_t group = 0;
+    int i;
+    for(i = GROUP_SIZE - 1; i >= 0; i--) group = (group << 8) | ctrl[i];
+    return group;
+}
+
+/*----------------------------------------------------------------------------
+ * group_match - slots in the group whose control byte equals h2; a slot above
+ *  a true match can be reported falsely, so callers always compare the key
+ *----------------------------------------------------------------------------*/
+static inline group_mask_t group_match(const uint8_t* ctrl, uint8_t h2)
+{
+    uint64_t x = group_load(ctrl) ^ (GROUP_LSBS * h2);
+    return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+/*----------------------------------------------------------------------------
+ * group_empty - slots in the group that are empty (high bit set, bit 6 clear)
+ *----------------------------------------------------------------------------*/
+static inline group_mask_t group_empty(const uint8_t* ctrl)
+{
+    uint64_t group = group_load(ctrl);
+    return group & ~(group << 1) & GROUP_MSBS;
+}
+
+/*----------------------------------------------------------------------------
+ * group_free - slots in the group that are empty or deleted
+ *----------------------------------------------------------------------------*/
+static inline group_mask_t group_free(const uint8_t* ctrl)
+{
+    return group_load(ctrl) & GROUP_MSBS;
+}
+
+#endif
+
+/*----------------------------------------------------------------------------
+ * find_slot - returns slot holding cid, or capacity if not present
+ *----------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE unsigned long find_slot(swiss_table_t* table, bp_val_t cid)
+{
+    uint8_t h2 = ctrl_hash(cid);
+    unsigned long group_mask = (table->capacity / GROUP_SIZE) - 1;
+    unsigned long group = home_group(table, cid);
+    unsigned long probe;
+
+    /* Triangular Probing Visits Every Group Once */
+    for(probe = 1; probe <= group_mask + 1; probe++)
+    {
+        const uint8_t* ctrl = &table->ctrl[group * GROUP_SIZE];
+
+        /* Check Slots with Matching Control Byte */
+        group_mask_t match = group_match(ctrl, h2);
+        while(match)
+        {
+            unsigned long slot = (group * GROUP_SIZE) + mask_first(match);
+            if(table->ring[table->slots[slot]].cid == cid) return slot;
+            match &= match - 1;
+        }
+
+        /* An Empty Slot Ends the Probe Sequence */
+        if(group_empty(ctrl)) break;
+
+        group = (group + probe) & group_mask;
+    }
+
+    return table->capacity;
+}
+
+/*----------------------------------------------------------------------------
+ * find_free_slot - returns first empty or deleted slot in cid's probe sequence
+ *----------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE unsigned long find_free_slot(swiss_table_t* table, bp_val_t cid)
+{
+    unsigned long group_mask = (table->capacity / GROUP_SIZE) - 1;
+    unsigned long group = home_group(table, cid);
+    unsigned long probe;
+
+    for(probe = 1; probe <= group_mask + 1; probe++)
+    {
+        group_mask_t free_slots = group_free(&table->ctrl[group * GROUP_SIZE]);
+        if(free_slots) return (group * GROUP_SIZE) + mask_first(free_slots);
+        group = (group + probe) & group_mask;
+    }
+
+    return table->capacity;
+}
+
+/*----------------------------------------------------------------------------
+ * set_slot
+ *----------------------------------------------------------------------------*/
+static inline void set_slot(swiss_table_t* table, unsigned long slot, bp_val_t cid, unsigned long position)
+{
+    table->ctrl[slot] = ctrl_hash(cid);
+    table->slots[slot] = (uint32_t)position;
+}
+
+/*----------------------------------------------------------------------------
+ * purge_deleted - rebuilds the control bytes from the live entries in the ring
+ *  so that slots marked deleted become empty again
+ *----------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void purge_deleted(swiss_table_t* table)
+{
+    unsigned long i;
+
+    memset(table->ctrl, CTRL_EMPTY, table->capacity);
+    for(i = table->oldest; i != table->newest; i++)
+    {
+        unsigned long position = i & (table->ring_size - 1);
+        if(table->ring[position].sid != BP_SID_VACANT)
+        {
+            set_slot(table, find_free_slot(table, table->ring[position].cid), table->ring[position].cid, position);
+        }
+    }
+
+    table->growth_left = MAX_LOAD(table->capacity) - table->num_entries;
+}
+
+/*----------------------------------------------------------------------------
+ * ring_append - returns ring position of bundle added as newest entry; when
+ *  the ring wraps onto the oldest entry, the live entries are compacted
+ *  toward the oldest, which only happens once entries are removed out of order
+ *----------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE unsigned long ring_append(swiss_table_t* table, bp_active_bundle_t bundle)
+{
+    unsigned long ring_mask = table->ring_size - 1;
+
+    if(table->newest - table->oldest == table->ring_size)
+    {
+        unsigned long next = table->oldest;
+        unsigned long i;
+
+        for(i = table->oldest; i != table->newest; i++)
+        {
+            bp_active_bundle_t* entry = &table->ring[i & ring_mask];
+            if(entry->sid != BP_SID_VACANT)
+            {
+                table->slots[find_slot(table, entry->cid)] = (uint32_t)(next & ring_mask);
+                table->ring[next++ & ring_mask] = *entry;
+            }
+        }
+
+        table->newest = next;
+    }
+
+    table->ring[table->newest & ring_mask] = bundle;
+    return table->newest++ & ring_mask;
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*----------------------------------------------------------------------------
+ * Create - initializes swiss table structure
+ *----------------------------------------------------------------------------*/
+int swiss_table_create(swiss_table_t** table, int size)
+{
+    /* Check Table Size */
+    if(size < 0 || size > MAX_TABLE_SIZE) return BP_ERROR;
+
+    /* Allocate Table Structure */
+    *table = (swiss_table_t*)bplib_os_calloc_tag(sizeof(swiss_table_t), BP_MEM_ACTIVE_TABLE);
+    if(*table == NULL) return BP_ERROR;
+
+    if(size > 0)
+    {
+        /* Size Slots to Stay At Most Half Full of Live Entries */
+        unsigned long capacity = GROUP_SIZE;
+        while(capacity < (unsigned long)size * 2) capacity <<= 1;
+
+        /* Size Ring with Room for Removed Entries Between Compactions */
+        unsigned long ring_size = 1;
+        while(ring_size < (unsigned long)size + (size / 2) + 1) ring_size <<= 1;
+
+        /* Allocate Slots and Ring */
+        (*table)->capacity  = capacity;
+        (*table)->ring_size = ring_size;
+        (*table)->ctrl      = (uint8_t*)bplib_os_calloc_tag(capacity, BP_MEM_ACTIVE_TABLE);
+        (*table)->slots     = (uint32_t*)bplib_os_calloc_tag(capacity * sizeof(uint32_t), BP_MEM_ACTIVE_TABLE);
+        (*table)->ring      = (bp_active_bundle_t*)bplib_os_calloc_tag((*table)->ring_size * sizeof(bp_active_bundle_t), BP_MEM_ACTIVE_TABLE);
+        if((*table)->ctrl == NULL || (*table)->slots == NULL || (*table)->ring == NULL)
+        {
+            swiss_table_destroy(*table);
+            *table = NULL;
+            return BP_ERROR;
+        }
+
+        /* Initialize Slots to Empty */
+        memset((*table)->ctrl, CTRL_EMPTY, capacity);
+        (*table)->growth_left = MAX_LOAD(capacity);
+    }
+
+    /* Initialize Table Attributes */
+    (*table)->size          = size;
+    (*table)->num_entries   = 0;
+    (*table)->oldest        = 0;
+    (*table)->newest        = 0;
+
+    /* Return Success */
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * Destroy - frees memory associated with swiss table structure
+ *----------------------------------------------------------------------------*/
+int swiss_table_destroy(swiss_table_t* table)
+{
+    if(table)
+    {
+        if(table->ctrl) bplib_os_free(table->ctrl);
+        if(table->slots) bplib_os_free(table->slots);
+        if(table->ring) bplib_os_free(table->ring);
+        bplib_os_free(table);
+    }
+
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * Add - adds bundle as the newest entry; an existing entry for the custody ID
+ *  is moved to newest when overwrite is set
+ *----------------------------------------------------------------------------*/
+int swiss_table_add(swiss_table_t* table, bp_active_bundle_t bundle, bool overwrite)
+{
+    if(table->size == 0) return BP_ERROR;
+
+    /* Check for Existing Entry */
+    unsigned long slot = find_slot(table, bundle.cid);
+    if(slot != table->capacity)
+    {
+        if(!overwrite) return BP_DUPLICATE;
+
+        /* Move Entry to Newest (appending first since compacting updates the slot) */
+        unsigned long position = ring_append(table, bundle);
+        table->ring[table->slots[slot]].sid = BP_SID_VACANT;
+        table->slots[slot] = (uint32_t)position;
+        return BP_SUCCESS;
+    }
+
+    /* Check for Full Table */
+    if(table->num_entries >= table->size) return BP_ERROR;
+
+    /* Find Slot - Purging Deleted Slots if Out of Empty Ones */
+    slot = find_free_slot(table, bundle.cid);
+    if(table->ctrl[slot] == CTRL_EMPTY && table->growth_left == 0)
+    {
+        purge_deleted(table);
+        slot = find_free_slot(table, bundle.cid);
+    }
+
+    /* Write Entry */
+    if(table->ctrl[slot] == CTRL_EMPTY) table->growth_left--;
+    set_slot(table, slot, bundle.cid, ring_append(table, bundle));
+    table->num_entries++;
+
+    /* Return Success */
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * Next - returns oldest entry
+ *----------------------------------------------------------------------------*/
+int swiss_table_next(swiss_table_t* table, bp_active_bundle_t* bundle)
+{
+    unsigned long ring_mask = table->ring_size - 1;
+
+    /* Skip Removed Entries */
+    while(table->oldest != table->newest && table->ring[table->oldest & ring_mask].sid == BP_SID_VACANT)
+    {
+        table->oldest++;
+    }
+
+    /* Check for Empty Table */
+    if(table->oldest == table->newest) return BP_ERROR;
+
+    if(bundle) *bundle = table->ring[table->oldest & ring_mask];
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * Remove
+ *----------------------------------------------------------------------------*/
+int swiss_table_remove(swiss_table_t* table, bp_val_t cid, bp_active_bundle_t* bundle)
+{
+    if(table->num_entries == 0) return BP_ERROR;
+
+    /* Find Entry */
+    unsigned long slot = find_slot(table, cid);
+    if(slot == table->capacity) return BP_ERROR;
+
+    /* Return and Clear Entry */
+    bp_active_bundle_t* entry = &table->ring[table->slots[slot]];
+    if(bundle) *bundle = *entry;
+    entry->sid = BP_SID_VACANT;
+
+    /* Clear Slot - Empty Only if No Probe Sequence Continues Past Its Group */
+    const uint8_t* group_ctrl = &table->ctrl[slot - (slot % GROUP_SIZE)];
+    if(group_empty(group_ctrl))
+    {
+        table->ctrl[slot] = CTRL_EMPTY;
+        table->growth_left++;
+    }
+    else
+    {
+        table->ctrl[slot] = CTRL_DELETED;
+    }
+
+    /* Update Statistics */
+    table->num_entries--;
+
+    /* Return Success */
+    return BP_SUCCESS;
+}
+
+/*----------------------------------------------------------------------------
+ * Remove Range - removes count custody IDs starting at cid, storing the
+ *  storage IDs of the removed bundles in sids; returns number removed
+ *----------------------------------------------------------------------------*/
+int swiss_table_remove_range(swiss_table_t* table, bp_val_t cid, int count, bp_sid_t* sids)
+{
+    bp_active_bundle_t bundle;
+    int removed = 0;
+    int i;
+
+    for(i = 0; i < count && table->num_entries > 0; i++)
+    {
+        if(swiss_table_remove(table, cid + i, &bundle) == BP_SUCCESS)
+        {
+            sids[removed++] = bundle.sid;
+        }
+    }
+
+    return removed;
+}
+
+/*----------------------------------------------------------------------------
+ * Available - checks if a new custody ID can be added
+ *----------------------------------------------------------------------------*/
+int swiss_table_available(swiss_table_t* table, bp_val_t cid)
+{
+    (void)cid;
+    if(table->num_entries < table->size)
+    {
+        return BP_SUCCESS;
+    }
+    else
+    {
+        return BP_ERROR;
+    }
+}
+
+/*----------------------------------------------------------------------------
+ * Count - returns number of entries in table
+ *----------------------------------------------------------------------------*/
+int swiss_table_count(swiss_table_t* table)
+{
+    return table->num_entries;
+}
+
+/*----------------------------------------------------------------------------
+ * Walk - visits entries oldest first, stopping at first failure
+ *----------------------------------------------------------------------------*/
+int swiss_table_walk(swiss_table_t* table, bp_table_visit_t visit, void* parm)
+{
+    unsigned long ring_mask = table->ring_size - 1;
+    unsigned long i;
+
+    for(i = table->oldest; i != table->newest; i++)
+    {
+        bp_active_bundle_t* entry = &table->ring[i & ring_mask];
+        if(entry->sid != BP_SID_VACANT)
+        {
+            int status = visit(parm, entry);
+            if(status != BP_SUCCESS) return status;
+        }
+    }
+
+    return BP_SUCCESS;
+}
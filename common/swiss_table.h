@@ -0,0 +1,65 @@
+/************************************************************************
+ * File: swiss_table.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+#ifndef _swiss_table_h_
+#define _swiss_table_h_
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bundle_types.h"
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/*
+ * The table is an open addressing hash of custody IDs whose slots are probed a
+ * group at a time by comparing a control byte per slot (empty, deleted, or seven
+ * bits of the hash).  Entries live in a ring kept in the order they were added,
+ * so time order needs no links: the oldest entry is the first one in the ring
+ * that has not been removed, and re-adding an entry moves it to the end.
+ */
+typedef struct {
+    uint8_t*            ctrl;           /* control byte per slot */
+    uint32_t*           slots;          /* ring position of entry in each slot */
+    bp_active_bundle_t* ring;           /* entries in the order they were added */
+    unsigned long       capacity;       /* number of slots, power of two */
+    unsigned long       ring_size;      /* number of entries the ring holds, power of two */
+    unsigned long       oldest;         /* count of entries added before the oldest (may have been removed) */
+    unsigned long       newest;         /* count of entries added; ring position is count modulo ring size */
+    unsigned long       growth_left;    /* empty slots that can be used before tombstones are purged */
+    int                 size;
+    int                 num_entries;
+} swiss_table_t;
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int swiss_table_create      (swiss_table_t** table, int size);
+int swiss_table_destroy     (swiss_table_t* table);
+int swiss_table_add         (swiss_table_t* table, bp_active_bundle_t bundle, bool overwrite);
+int swiss_table_next        (swiss_table_t* table, bp_active_bundle_t* bundle);
+int swiss_table_remove      (swiss_table_t* table, bp_val_t cid, bp_active_bundle_t* bundle);
+int swiss_table_remove_range(swiss_table_t* table, bp_val_t cid, int count, bp_sid_t* sids);
+int swiss_table_available   (swiss_table_t* table, bp_val_t cid);
+int swiss_table_count       (swiss_table_t* table);
+int swiss_table_walk        (swiss_table_t* table, bp_table_visit_t visit, void* parm);
+
+#endif /* _swiss_table_h_ */
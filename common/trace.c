@@ -0,0 +1,417 @@
+/************************************************************************
+ * File: trace.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_trace.h"
+#include "trace.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define TRACE_MAX_EVENTS            0x1000000   /* bounds memory of recorder */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Recorded Event - turn is even once the event for it is written */
+typedef struct {
+    unsigned long       turn;       /* 2 * (position + 1) when written, odd while being written */
+    bp_trace_event_t    event;
+} trace_slot_t;
+
+/* Recorder - ring buffer that keeps the most recent events */
+typedef struct {
+    trace_slot_t*       slots;
+    unsigned long       size;       /* power of two */
+    unsigned long       head;       /* position of next event written */
+} trace_recorder_t;
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static const char* trace_names[BP_TRACE_NUM_POINTS] = {
+    "store",
+    "load",
+    "load_lock",
+    "load_active",
+    "load_wait",
+    "load_dequeue",
+    "process",
+    "process_decode",
+    "process_acknowledge",
+    "process_custody",
+    "accept",
+    "enqueue_bundle",
+    "enqueue_payload",
+    "acknowledged",
+    "bib_update",
+    "bib_verify"
+};
+
+#ifdef BP_TRACE
+bool                        trace_enabled = false;  /* a hook or recorder is installed */
+#ifdef BP_TRACE_USDT
+unsigned short              bplib_stage_semaphore __attribute__((unused)) __attribute__((section(".probes")));
+#endif
+static bp_trace_func_t      trace_hook = NULL;
+static void*                trace_hook_parm = NULL;
+static trace_recorder_t*    trace_recorder = NULL;
+#endif
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+#ifdef BP_TRACE
+
+/*--------------------------------------------------------------------------------------
+ * trace_update - tracing stays enabled while anything is listening
+ *-------------------------------------------------------------------------------------*/
+static void trace_update(void)
+{
+    bool enabled = (__atomic_load_n(&trace_hook, __ATOMIC_ACQUIRE) != NULL) ||
+                   (__atomic_load_n(&trace_recorder, __ATOMIC_ACQUIRE) != NULL);
+    __atomic_store_n(&trace_enabled, enabled, __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------------------------
+ * trace_record - claims the next slot, overwriting the oldest event
+ *-------------------------------------------------------------------------------------*/
+static void trace_record(trace_recorder_t* recorder, const bp_trace_event_t* event)
+{
+    unsigned long pos = __atomic_fetch_add(&recorder->head, 1, __ATOMIC_RELAXED);
+    trace_slot_t* slot = &recorder->slots[pos & (recorder->size - 1)];
+    __atomic_store_n(&slot->turn, (2 * pos) + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->event = *event;
+    __atomic_store_n(&slot->turn, 2 * (pos + 1), __ATOMIC_RELEASE);
+}
+
+/*--------------------------------------------------------------------------------------
+ * trace_copy - copies the event at position if it has not been overwritten
+ *-------------------------------------------------------------------------------------*/
+static bool trace_copy(trace_recorder_t* recorder, unsigned long pos, bp_trace_event_t* event)
+{
+    trace_slot_t* slot = &recorder->slots[pos & (recorder->size - 1)];
+    if(__atomic_load_n(&slot->turn, __ATOMIC_ACQUIRE) != 2 * (pos + 1)) return false;
+    *event = slot->event;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->turn, __ATOMIC_RELAXED) == 2 * (pos + 1);
+}
+
+#endif
+
+/*--------------------------------------------------------------------------------------
+ * trace_matches - acknowledgments are matched by the range of custody ids they cover
+ *-------------------------------------------------------------------------------------*/
+static bool trace_matches(const bp_trace_event_t* event, const void* channel, bp_val_t cid)
+{
+    if(event->channel != channel) return false;
+    if(event->point == BP_TRACE_ACKNOWLEDGED && cid != BP_TRACE_NO_CID)
+    {
+        return cid >= event->cid && cid - event->cid < (bp_val_t)event->size;
+    }
+    return event->cid == cid;
+}
+
+#ifdef BP_TRACE
+
+/*--------------------------------------------------------------------------------------
+ * trace_compare - orders events by channel, custody id, and then start time with
+ *  enclosing stages ahead of the stages they contain
+ *-------------------------------------------------------------------------------------*/
+static int trace_compare(const void* a, const void* b)
+{
+    const bp_trace_event_t* e1 = (const bp_trace_event_t*)a;
+    const bp_trace_event_t* e2 = (const bp_trace_event_t*)b;
+    if(e1->channel != e2->channel) return ((uintptr_t)e1->channel < (uintptr_t)e2->channel) ? -1 : 1;
+    if(e1->cid != e2->cid) return (e1->cid < e2->cid) ? -1 : 1;
+    uint64_t start1 = e1->timestamp - e1->duration;
+    uint64_t start2 = e2->timestamp - e2->duration;
+    if(start1 != start2) return (start1 < start2) ? -1 : 1;
+    if(e1->duration != e2->duration) return (e1->duration > e2->duration) ? -1 : 1;
+    return 0;
+}
+
+/*--------------------------------------------------------------------------------------
+ * trace_print -
+ *-------------------------------------------------------------------------------------*/
+static void trace_print(FILE* stream, const bp_trace_event_t* event, uint64_t first)
+{
+    double start_us = (double)(event->timestamp - event->duration - first) / 1000.0;
+    fprintf(stream, "  %12.3lf us  %-20s %10.3lf us  size %-8d status %d\n",
+            start_us, bplib_trace_name(event->point), (double)event->duration / 1000.0, event->size, event->status);
+}
+
+#endif
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+#ifdef BP_TRACE
+
+/*--------------------------------------------------------------------------------------
+ * trace_event - called at the end of a stage that started at start
+ *-------------------------------------------------------------------------------------*/
+void trace_event(uint64_t start, int point, const void* channel, bp_val_t cid, int size, int status)
+{
+    bp_trace_event_t event;
+    event.timestamp = bplib_os_nanotime();
+    event.duration = event.timestamp - start;
+    event.channel = channel;
+    event.cid = cid;
+    event.size = size;
+    event.point = point;
+    event.status = status;
+
+    /* USDT Probe - bplib:stage(point, channel, cid, size, status, nanoseconds) */
+    #ifdef BP_TRACE_USDT
+    DTRACE_PROBE6(bplib, stage, point, channel, cid, size, status, event.duration);
+    #endif
+
+    /* Hook */
+    bp_trace_func_t hook = __atomic_load_n(&trace_hook, __ATOMIC_ACQUIRE);
+    if(hook) hook(&event, __atomic_load_n(&trace_hook_parm, __ATOMIC_ACQUIRE));
+
+    /* Recorder */
+    trace_recorder_t* recorder = __atomic_load_n(&trace_recorder, __ATOMIC_ACQUIRE);
+    if(recorder) trace_record(recorder, &event);
+}
+
+#endif
+
+/*--------------------------------------------------------------------------------------
+ * bplib_trace_hook - set before channels are used from other threads
+ *-------------------------------------------------------------------------------------*/
+void bplib_trace_hook(bp_trace_func_t func, void* parm)
+{
+    #ifdef BP_TRACE
+    __atomic_store_n(&trace_hook_parm, parm, __ATOMIC_RELEASE);
+    __atomic_store_n(&trace_hook, func, __ATOMIC_RELEASE);
+    trace_update();
+    #else
+    (void)func;
+    (void)parm;
+    if(func) bplog(NULL, BP_FLAG_API_ERROR, "Library built without BP_TRACE\n");
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_trace_start - max_events is rounded up to a power of two
+ *-------------------------------------------------------------------------------------*/
+int bplib_trace_start(int max_events)
+{
+    #ifdef BP_TRACE
+    if(max_events <= 0 || max_events > TRACE_MAX_EVENTS)
+    {
+        return bplog(NULL, BP_FLAG_API_ERROR, "Invalid number of trace events: %d\n", max_events);
+    }
+    else if(__atomic_load_n(&trace_recorder, __ATOMIC_ACQUIRE) != NULL)
+    {
+        return bplog(NULL, BP_FLAG_API_ERROR, "Trace recorder already started\n");
+    }
+
+    /* Allocate Recorder */
+    unsigned long size = 1;
+    while(size < (unsigned long)max_events) size <<= 1;
+    trace_recorder_t* recorder = (trace_recorder_t*)bplib_os_calloc(sizeof(trace_recorder_t));
+    if(recorder == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate trace recorder\n");
+        return BP_ERROR;
+    }
+    recorder->slots = (trace_slot_t*)bplib_os_calloc(sizeof(trace_slot_t) * size);
+    if(recorder->slots == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate %lu trace events\n", size);
+        bplib_os_free(recorder);
+        return BP_ERROR;
+    }
+    recorder->size = size;
+    recorder->head = 0;
+
+    /* Start Recording */
+    __atomic_store_n(&trace_recorder, recorder, __ATOMIC_RELEASE);
+    trace_update();
+    return BP_SUCCESS;
+    #else
+    (void)max_events;
+    return bplog(NULL, BP_FLAG_API_ERROR, "Library built without BP_TRACE\n");
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_trace_stop - discards the recorded events; no stage may still be running
+ *-------------------------------------------------------------------------------------*/
+void bplib_trace_stop(void)
+{
+    #ifdef BP_TRACE
+    trace_recorder_t* recorder = __atomic_exchange_n(&trace_recorder, NULL, __ATOMIC_ACQ_REL);
+    trace_update();
+    if(recorder)
+    {
+        bplib_os_free(recorder->slots);
+        bplib_os_free(recorder);
+    }
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_trace_read - returns the number of events copied, oldest first
+ *-------------------------------------------------------------------------------------*/
+int bplib_trace_read(bp_trace_event_t* events, int max_events)
+{
+    int count = 0;
+
+    if(events == NULL || max_events < 0) return BP_ERROR;
+
+    #ifdef BP_TRACE
+    trace_recorder_t* recorder = __atomic_load_n(&trace_recorder, __ATOMIC_ACQUIRE);
+    if(recorder)
+    {
+        unsigned long head = __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
+        unsigned long pos = (head > recorder->size) ? head - recorder->size : 0;
+        if(head - pos > (unsigned long)max_events) pos = head - (unsigned long)max_events;
+        for(; pos < head; pos++)
+        {
+            if(trace_copy(recorder, pos, &events[count])) count++;
+        }
+    }
+    #endif
+
+    return count;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_trace_timeline - returns the number of recorded events of one bundle, oldest first
+ *-------------------------------------------------------------------------------------*/
+int bplib_trace_timeline(const void* channel, bp_val_t cid, bp_trace_event_t* events, int max_events)
+{
+    int count = bplib_trace_read(events, max_events);
+    int i, matched = 0;
+
+    for(i = 0; i < count; i++)
+    {
+        if(trace_matches(&events[i], channel, cid))
+        {
+            events[matched++] = events[i];
+        }
+    }
+
+    return matched;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_trace_dump - prints a timeline for each custody id of each channel,
+ *  followed by the events without one; times are from the first recorded event
+ *-------------------------------------------------------------------------------------*/
+int bplib_trace_dump(FILE* stream)
+{
+    #ifdef BP_TRACE
+    trace_recorder_t* recorder = __atomic_load_n(&trace_recorder, __ATOMIC_ACQUIRE);
+    if(stream == NULL || recorder == NULL) return BP_ERROR;
+
+    /* Copy Recorded Events */
+    bp_trace_event_t* events = (bp_trace_event_t*)bplib_os_calloc(sizeof(bp_trace_event_t) * recorder->size);
+    if(events == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate %lu trace events to dump\n", recorder->size);
+        return BP_ERROR;
+    }
+    int count = bplib_trace_read(events, (int)recorder->size);
+    if(count == 0)
+    {
+        bplib_os_free(events);
+        return BP_SUCCESS;
+    }
+
+    /* Find Start of Recording */
+    uint64_t first = events[0].timestamp - events[0].duration;
+    int i, j;
+    for(i = 1; i < count; i++)
+    {
+        if(events[i].timestamp - events[i].duration < first) first = events[i].timestamp - events[i].duration;
+    }
+
+    /* Separate Acknowledgments (listed under each bundle they cover) */
+    int num_acks = 0;
+    i = 0;
+    while(i < count)
+    {
+        if(events[i].point == BP_TRACE_ACKNOWLEDGED)
+        {
+            /* Swap to End */
+            bp_trace_event_t ack = events[i];
+            count--;
+            events[i] = events[count];
+            events[count] = ack;
+            num_acks++;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    bp_trace_event_t* acks = &events[count];
+
+    /* Print Timeline of Each Bundle */
+    qsort(events, count, sizeof(bp_trace_event_t), trace_compare);
+    qsort(acks, num_acks, sizeof(bp_trace_event_t), trace_compare);
+    for(i = 0; i < count; i = j)
+    {
+        const void* channel = events[i].channel;
+        bp_val_t cid = events[i].cid;
+
+        if(cid == BP_TRACE_NO_CID)  fprintf(stream, "channel %p: no custody id\n", channel);
+        else                        fprintf(stream, "channel %p: custody id %lu\n", channel, (unsigned long)cid);
+
+        for(j = i; j < count && events[j].channel == channel && events[j].cid == cid; j++)
+        {
+            trace_print(stream, &events[j], first);
+        }
+
+        int a;
+        for(a = 0; a < num_acks && cid != BP_TRACE_NO_CID; a++)
+        {
+            if(trace_matches(&acks[a], channel, cid)) trace_print(stream, &acks[a], first);
+        }
+    }
+
+    bplib_os_free(events);
+    return BP_SUCCESS;
+    #else
+    (void)stream;
+    return bplog(NULL, BP_FLAG_API_ERROR, "Library built without BP_TRACE\n");
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_trace_name -
+ *-------------------------------------------------------------------------------------*/
+const char* bplib_trace_name(int point)
+{
+    if(point < 0 || point >= BP_TRACE_NUM_POINTS) return "unknown";
+    return trace_names[point];
+}
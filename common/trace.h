@@ -0,0 +1,72 @@
+/************************************************************************
+ * File: trace.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _trace_h_
+#define _trace_h_
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_trace.h"
+
+#ifdef BP_TRACE_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#endif
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/*
+ * Trace points time the stage between BP_TRACE_BEGIN and BP_TRACE_END; without
+ * BP_TRACE they compile to nothing, and with it the clock is only read while a
+ * hook or recorder is installed, or while a USDT probe is attached.
+ */
+#ifdef BP_TRACE
+
+#ifdef BP_TRACE_USDT
+#define trace_active()  (__atomic_load_n(&trace_enabled, __ATOMIC_RELAXED) || *(volatile unsigned short*)&bplib_stage_semaphore)
+#else
+#define trace_active()  __atomic_load_n(&trace_enabled, __ATOMIC_RELAXED)
+#endif
+
+#define BP_TRACE_BEGIN(t)                                   uint64_t t = trace_active() ? bplib_os_nanotime() : 0
+#define BP_TRACE_END(t, point, channel, cid, size, status)  do { if(t) trace_event(t, point, channel, cid, size, status); } while(0)
+
+#else
+
+#define BP_TRACE_BEGIN(t)
+#define BP_TRACE_END(t, point, channel, cid, size, status)
+
+#endif
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+#ifdef BP_TRACE
+extern bool trace_enabled;
+#ifdef BP_TRACE_USDT
+extern unsigned short bplib_stage_semaphore;
+#endif
+void trace_event (uint64_t start, int point, const void* channel, bp_val_t cid, int size, int status);
+#endif
+
+#endif  /* _trace_h_ */
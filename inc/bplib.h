@@ -78,6 +78,7 @@ extern "C" {
 #define BP_STORE_DATA_TYPE              0xB0
 #define BP_STORE_DACS_TYPE              0xB1
 #define BP_STORE_PAYLOAD_TYPE           0xB2
+#define BP_STORE_JOURNAL_TYPE           0xB3
 
 /* Error Correcting Codes */
 #define BP_ECC_NO_ERRORS                0
@@ -99,6 +100,18 @@ extern "C" {
 #define BP_RETX_OLDEST_BUNDLE           0
 #define BP_RETX_SMALLEST_CID            1
 
+/* Active Table */
+#define BP_ACTIVE_TABLE_RH_HASH         0
+#define BP_ACTIVE_TABLE_SWISS           1
+
+/* Custody Tree */
+#define BP_CUSTODY_RB_TREE              0
+#define BP_CUSTODY_RANGE_ARRAY          1
+
+/* DACS Policy */
+#define BP_DACS_PERIODIC                0
+#define BP_DACS_ADAPTIVE                1
+
 /* Set/Get Option Modes */
 #define BP_OPT_MODE_READ                0
 #define BP_OPT_MODE_WRITE               1
@@ -116,6 +129,8 @@ extern "C" {
 #define BP_OPT_TIMEOUT                  10
 #define BP_OPT_MAX_LENGTH               11
 #define BP_OPT_DACS_RATE                12
+#define BP_OPT_MAX_LOAD_LENGTH          13
+#define BP_OPT_FAST_RETRANSMIT          14
 
 /* Default Dynamic Configuration */
 #define BP_DEFAULT_LIFETIME             86400 /* seconds, 1 day */
@@ -130,14 +145,23 @@ extern "C" {
 #define BP_DEFAULT_TIMEOUT              10 /* seconds */
 #define BP_DEFAULT_MAX_LENGTH           4096 /* bytes (must be smaller than BP_MAX_INDEX) */
 #define BP_DEFAULT_DACS_RATE            5 /* period in seconds */
+#define BP_DEFAULT_MAX_LOAD_LENGTH      0 /* bytes, zero for no limit */
+#define BP_DEFAULT_FAST_RETRANSMIT      3 /* custody IDs of reordering tolerated, negative to wait for timeout */
 
 /* Default Fixed Configuration */
 #define BP_DEFAULT_PROTOCOL_VERSION     6
 #define BP_DEFAULT_RETRANSMIT_ORDER     BP_RETX_OLDEST_BUNDLE
-#define BP_DEFAULT_ACTIVE_TABLE_SIZE    16384 /* bundles (must be smaller than BP_MAX_INDEX) */
+#define BP_DEFAULT_ACTIVE_TABLE         BP_ACTIVE_TABLE_RH_HASH
+#define BP_DEFAULT_CUSTODY_TREE         BP_CUSTODY_RB_TREE
+#define BP_DEFAULT_CUSTODY_SHARDS       1
+#define BP_DEFAULT_DACS_POLICY          BP_DACS_PERIODIC
+#define BP_DEFAULT_ACTIVE_TABLE_SIZE    16384 /* bundles */
 #define BP_DEFAULT_MAX_FILLS_PER_DACS   64 /* constrains size of DACS bundle */
 #define BP_DEFAULT_MAX_GAPS_PER_DACS    1028 /* sets size of internal memory used to aggregate custody */
+#define BP_DEFAULT_MAX_REASSEMBLY_SIZE  1048576 /* bytes of memory used to reassemble fragmented bundles */
+#define BP_DEFAULT_DUPLICATE_CACHE_SIZE 0 /* received bundles remembered to drop duplicates, zero to deliver duplicates */
 #define BP_DEFAULT_PERSISTENT_STORAGE   false
+#define BP_DEFAULT_CHECKPOINT_RATE      10 /* period in seconds */
 #define BP_DEFAULT_STORAGE_SERVICE_PARM NULL
 
 /******************************************************************************
@@ -188,6 +212,7 @@ typedef struct {
     int (*release)      (int handle, bp_sid_t sid);
     int (*relinquish)   (int handle, bp_sid_t sid);
     int (*getcount)     (int handle);
+    int (*relinquish_batch) (int handle, bp_sid_t* sids, int count); /* optional, NULL: relinquish called per bundle */
 } bp_store_t;
 
 /* Channel Attributes */
@@ -205,13 +230,22 @@ typedef struct {
     int         timeout;                /* seconds, zero for infinite */
     int         max_length;             /* maximum size of bundle in bytes */
     int         dacs_rate;              /* number of seconds to wait between sending ACS bundles (<=0: no periodic dacs) */
+    int         max_load_length;        /* maximum size of loaded bundle in bytes, larger stored bundles are fragmented (0: no limit) */
+    int         fast_retransmit;        /* custody IDs a bundle reported missing must trail the last acknowledged one by to be resent (<0: wait for timeout) */
     /* Fixed Attributes */
     int         protocol_version;       /* bundle protocol version; currently only version 6 supported */
     int         retransmit_order;       /* determination of which timed-out bundle is retransmitted first */
+    int         active_table;           /* data structure used to track unacknowledged bundles retransmitted oldest first */
+    int         custody_tree;           /* data structure used to aggregate received custody IDs */
+    int         custody_shards;         /* number of independently locked custody trees for concurrent receivers */
+    int         dacs_policy;            /* when aggregate custody signals are generated */
     int         active_table_size;      /* number of unacknowledged bundles to keep track of */
     int         max_fills_per_dacs;     /* limits the size of the DACS bundle */
     int         max_gaps_per_dacs;      /* number of gaps in custody IDs that can be kept track of */
-    bool        persistent_storage;     /* attempt to recover bundles and payloads from storage service */
+    int         max_reassembly_size;    /* bytes of memory for reassembling fragments (0: fragments delivered as received) */
+    int         duplicate_cache_size;   /* number of received bundles remembered to drop duplicates (0: duplicates delivered) */
+    bool        persistent_storage;     /* attempt to recover bundles, payloads, and custody state from storage service */
+    int         checkpoint_rate;        /* number of seconds between checkpoints of custody state when persistent (<=0: only on close) */
     void*       storage_service_parm;   /* pass through of parameters needed by storage service */
 } bp_attr_t;
 
@@ -229,6 +263,8 @@ typedef struct {
     uint32_t    received_bundles;       /* bundles destined for local node (process) */
     uint32_t    forwarded_bundles;      /* bundles received by local node but destined for another node (process) */
     uint32_t    received_dacs;          /* dacs destined for local node (process) */
+    uint32_t    dacs_cids;              /* custody IDs acknowledged in generated dacs (process, load) */
+    uint32_t    dacs_bytes;             /* bytes of acknowledgment records in generated dacs (process, load) */
     /* Storage */
     uint32_t    stored_bundles;         /* number of data bundles currently in storage */
     uint32_t    stored_payloads;        /* number of payloads currently in storage */
@@ -255,6 +291,7 @@ int         bplib_store         (bp_desc_t* desc, void* payload, int size, int t
 int         bplib_load          (bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t* flags);
 int         bplib_process       (bp_desc_t* desc, void* bundle, int size, int timeout, uint32_t* flags);
 int         bplib_accept        (bp_desc_t* desc, void** payload, int* size, int timeout, uint32_t* flags);
+int         bplib_custody       (bp_desc_t* desc, int timeout, uint32_t* flags);
 
 int         bplib_ackbundle     (bp_desc_t* desc, void* bundle);
 int         bplib_ackpayload    (bp_desc_t* desc, void* payload);
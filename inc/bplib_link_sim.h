@@ -0,0 +1,95 @@
+/************************************************************************
+ * File: bplib_link_sim.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _bplib_link_sim_h_
+#define _bplib_link_sim_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bplib_os.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define LINK_SIM_NEVER              (~0UL) /* no bundle is waiting to be delivered */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Link Descriptor */
+typedef struct {
+    void* link;
+} bp_link_t;
+
+/* Link Attributes - all times are milliseconds of virtual time (see bplib_os_vclock_start) */
+typedef struct {
+    double          loss_rate;      /* probability that a bundle is lost */
+    unsigned long   delay;          /* time from the end of transmission to delivery */
+    unsigned long   jitter;         /* up to this much time is randomly added to the delay */
+    double          reorder_rate;   /* probability that a bundle is held back so that later bundles overtake it */
+    unsigned long   reorder_delay;  /* time a held back bundle is held */
+    unsigned long   bandwidth;      /* bytes per second, 0: unlimited */
+    int             queue_limit;    /* bundles in flight before new ones are dropped, 0: unlimited */
+    uint32_t        seed;           /* the same seed and traffic produce the same losses and delays */
+} bp_link_attr_t;
+
+/* Contact Window - the link is up from start until just before stop */
+typedef struct {
+    unsigned long   start;
+    unsigned long   stop;
+} bp_contact_t;
+
+/* Link Statistics */
+typedef struct {
+    uint32_t        sent;           /* bundles given to the link */
+    uint32_t        delivered;      /* bundles received from the link */
+    uint32_t        lost;           /* bundles randomly lost */
+    uint32_t        disconnected;   /* bundles sent, or still being transmitted, outside of a contact */
+    uint32_t        overflowed;     /* bundles dropped because the queue limit was reached */
+    uint32_t        reordered;      /* bundles held back */
+    uint32_t        in_flight;      /* bundles waiting to be delivered */
+    unsigned long   delivered_bytes;
+} bp_link_stats_t;
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/* Link */
+void            bplib_link_sim_attrinit         (bp_link_attr_t* attr);
+bp_link_t*      bplib_link_sim_create           (bp_link_attr_t* attr); /* NULL: a perfect link */
+void            bplib_link_sim_destroy          (bp_link_t* link);
+int             bplib_link_sim_schedule         (bp_link_t* link, const bp_contact_t* contacts, int count, unsigned long period);
+int             bplib_link_sim_send             (bp_link_t* link, const void* bundle, int size);
+int             bplib_link_sim_recv             (bp_link_t* link, void* bundle, int* size);
+unsigned long   bplib_link_sim_next             (bp_link_t* link); /* milliseconds since start, or LINK_SIM_NEVER */
+int             bplib_link_sim_stats            (bp_link_t* link, bp_link_stats_t* stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _bplib_link_sim_h_ */
@@ -58,6 +58,14 @@
  DEFINES
  ******************************************************************************/
 
+/* Memory Tags - subsystems that allocated memory is accounted to */
+#define BP_MEM_GENERAL          0
+#define BP_MEM_STORE            1
+#define BP_MEM_ACTIVE_TABLE     2
+#define BP_MEM_CUSTODY_TREE     3
+#define BP_MEM_CODEC            4
+#define BP_MEM_NUM_TAGS         5
+
 /* Macros */
 #define BP_GET_MAXVAL(t)        (0xFFFFFFFFFFFFFFFFllu >> (64 - (sizeof(t) * 8)))
 #define bplog(flags,evt,...)    bplib_os_log(__FILE__,__LINE__,flags,evt,__VA_ARGS__)
@@ -74,26 +82,46 @@ typedef BP_VAL_TYPE bp_val_t;
 typedef BP_INDEX_TYPE bp_index_t;
 #define BP_MAX_INDEX BP_GET_MAXVAL(bp_index_t)
 
+/* Allocator Hooks (alignment is a power of two, allocated memory need not be zeroed) */
+typedef void* (*bp_alloc_func_t) (size_t size, size_t alignment);
+typedef void  (*bp_free_func_t)  (void* ptr);
+
+/* Time Source Hooks (same contract as bplib_os_systime and bplib_os_monotime) */
+typedef int   (*bp_time_func_t)  (unsigned long* now);
+
 /******************************************************************************
  PROTOTYPES
  ******************************************************************************/
 
 void        bplib_os_init           (void);
 int         bplib_os_log            (const char* file, unsigned int line, uint32_t* flags, uint32_t error, const char* fmt, ...) VARG_CHECK(printf, 5, 6);
-int         bplib_os_systime        (unsigned long* sysnow); /* seconds */
+void        bplib_os_log_flush      (void);
+int         bplib_os_systime        (unsigned long* sysnow); /* seconds since 2000, can be stepped */
+int         bplib_os_monotime       (unsigned long* mononow); /* seconds, never stepped */
+uint64_t    bplib_os_nanotime       (void); /* nanoseconds, never stepped, for measuring durations */
 void        bplib_os_sleep          (int seconds);
 uint32_t    bplib_os_random         (void);
 int         bplib_os_createlock     (void);
 void        bplib_os_destroylock    (int handle);
 void        bplib_os_lock           (int handle);
+int         bplib_os_trylock        (int handle);
 void        bplib_os_unlock         (int handle);
 void        bplib_os_signal         (int handle);
 int         bplib_os_waiton         (int handle, int timeout_ms);
 int         bplib_os_format         (char* dst, size_t len, const char* fmt, ...) VARG_CHECK(printf, 3, 4);
 int         bplib_os_strnlen        (const char* str, int maxlen);
 void*       bplib_os_calloc         (size_t size);
+void*       bplib_os_calloc_tag     (size_t size, int tag);
 void        bplib_os_free           (void* ptr);
 size_t      bplib_os_memused        (void);
+size_t      bplib_os_memused_tag    (int tag);
 size_t      bplib_os_memhigh        (void);
+void        bplib_os_allocator      (bp_alloc_func_t alloc_func, bp_free_func_t free_func); /* NULL restores default */
+void        bplib_os_timesource     (bp_time_func_t systime_func, bp_time_func_t monotime_func); /* NULL restores default */
+void        bplib_os_vclock_start   (unsigned long start, int threads); /* start: seconds since 2000, threads: 0 for advance only */
+void        bplib_os_vclock_stop    (void);
+void        bplib_os_vclock_threads (int change);
+void        bplib_os_vclock_advance (unsigned long ms);
+unsigned long bplib_os_vclock_now   (void); /* milliseconds since start */
 
 #endif /* _bplib_os_h_ */
@@ -63,6 +63,7 @@ int     bplib_store_file_retrieve      (int handle, bp_sid_t sid, bp_object_t**
 int     bplib_store_file_release       (int handle, bp_sid_t sid);
 int     bplib_store_file_relinquish    (int handle, bp_sid_t sid);
 int     bplib_store_file_getcount      (int handle);
+int     bplib_store_file_relinquish_batch (int handle, bp_sid_t* sids, int count);
 
 #ifdef __cplusplus
 } // extern "C"
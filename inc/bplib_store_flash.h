@@ -107,6 +107,7 @@ int     bplib_store_flash_retrieve              (int handle, bp_sid_t sid, bp_ob
 int     bplib_store_flash_release               (int handle, bp_sid_t sid);
 int     bplib_store_flash_relinquish            (int handle, bp_sid_t sid);
 int     bplib_store_flash_getcount              (int handle);
+int     bplib_store_flash_relinquish_batch      (int handle, bp_sid_t* sids, int count);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -44,6 +44,7 @@ int     bplib_store_ram_retrieve       (int handle, bp_sid_t sid, bp_object_t**
 int     bplib_store_ram_release        (int handle, bp_sid_t sid);
 int     bplib_store_ram_relinquish     (int handle, bp_sid_t sid);
 int     bplib_store_ram_getcount       (int handle);
+int     bplib_store_ram_relinquish_batch (int handle, bp_sid_t* sids, int count);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,91 @@
+/************************************************************************
+ * File: bplib_trace.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _bplib_trace_h_
+#define _bplib_trace_h_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define BP_TRACE_NO_CID                 BP_MAX_ENCODED_VALUE    /* stage ran before a custody id was assigned */
+
+/* Trace Points - the stage that an event timed */
+#define BP_TRACE_STORE                  0   /* bplib_store, size of payload */
+#define BP_TRACE_LOAD                   1   /* bplib_load, size of bundle loaded */
+#define BP_TRACE_LOAD_LOCK              2   /* waiting to lock the active table */
+#define BP_TRACE_LOAD_ACTIVE            3   /* looking up and retrieving timed out bundles in the active table */
+#define BP_TRACE_LOAD_WAIT              4   /* waiting for a bundle to be stored */
+#define BP_TRACE_LOAD_DEQUEUE           5   /* dequeuing and reading a bundle from storage */
+#define BP_TRACE_PROCESS                6   /* bplib_process, size of bundle */
+#define BP_TRACE_PROCESS_DECODE         7   /* parsing blocks and verifying the integrity block */
+#define BP_TRACE_PROCESS_ACKNOWLEDGE    8   /* acting on a custody signal, size is number of bundles acknowledged */
+#define BP_TRACE_PROCESS_CUSTODY        9   /* taking custody of a received bundle */
+#define BP_TRACE_ACCEPT                 10  /* bplib_accept, size of payload */
+#define BP_TRACE_ENQUEUE_BUNDLE         11  /* storing a bundle or custody signal */
+#define BP_TRACE_ENQUEUE_PAYLOAD        12  /* storing a received payload */
+#define BP_TRACE_ACKNOWLEDGED           13  /* custody ids [cid, cid + size) removed from the active table */
+#define BP_TRACE_BIB_UPDATE             14  /* calculating the integrity block of a payload */
+#define BP_TRACE_BIB_VERIFY             15  /* checking the integrity block of a payload */
+#define BP_TRACE_NUM_POINTS             16
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Trace Event - one stage of one call */
+typedef struct {
+    uint64_t        timestamp;      /* bplib_os_nanotime at the end of the stage */
+    uint64_t        duration;       /* nanoseconds */
+    const void*     channel;        /* the channel of the bp_desc_t, NULL for the bundle codec */
+    bp_val_t        cid;            /* custody id of the bundle, or BP_TRACE_NO_CID */
+    int             size;           /* bytes, unless noted for the trace point */
+    int             point;          /* BP_TRACE_xxx */
+    int             status;         /* return code of the stage */
+} bp_trace_event_t;
+
+/* Trace Hook - called from the thread that ran the stage */
+typedef void (*bp_trace_func_t) (const bp_trace_event_t* event, void* parm);
+
+/******************************************************************************
+ PROTOTYPES
+ ******************************************************************************/
+
+/* Trace points are only compiled in when the library is built with BP_TRACE */
+void            bplib_trace_hook        (bp_trace_func_t func, void* parm); /* NULL removes hook */
+int             bplib_trace_start       (int max_events); /* records the most recent events */
+void            bplib_trace_stop        (void);
+int             bplib_trace_read        (bp_trace_event_t* events, int max_events); /* oldest first */
+int             bplib_trace_timeline    (const void* channel, bp_val_t cid, bp_trace_event_t* events, int max_events);
+int             bplib_trace_dump        (FILE* stream); /* recorded events grouped by bundle */
+const char*     bplib_trace_name        (int point);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif /* _bplib_trace_h_ */
@@ -25,186 +25,1554 @@
 #include "bundle_types.h"
 #include "cbuf.h"
 #include "rh_hash.h"
+#include "swiss_table.h"
+#include "range_array.h"
+#include "reasm.h"
+#include "dedup.h"
+#include "record.h"
+#include "trace.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define BP_ACK_BATCH_SIZE       256 /* custody IDs removed from active table per lock */
+#define BP_MAX_MISSING_RANGES   64  /* ranges of custody IDs reported missing queued for retransmission */
 
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
 
-/* Table Functions */
-typedef int (*bp_table_create_t)    (void** table, int size);
-typedef int (*bp_table_destroy_t)   (void* table);
-typedef int (*bp_table_add_t)       (void* table, bp_active_bundle_t bundle, bool overwrite);
-typedef int (*bp_table_next_t)      (void* table, bp_active_bundle_t* bundle);
-typedef int (*bp_table_remove_t)    (void* table, bp_val_t cid, bp_active_bundle_t* bundle);
-typedef int (*bp_table_available_t) (void* table, bp_val_t cid);
-typedef int (*bp_table_count_t)     (void* table);
+/* Custody Tree Memory */
+typedef union {
+    rb_tree_t               rb_tree;
+    range_array_t           range_array;
+} bp_custody_tree_data_t;
+
+/* Custody Shard */
+typedef struct {
+    int                     lock;
+    void*                   tree;       /* custody IDs received since last flush */
+    bp_ipn_t                node;       /* destination node of custody signal */
+    bp_ipn_t                service;    /* destination service of custody signal */
+    bp_val_t                cids;       /* number of custody IDs inserted since last flush */
+    unsigned long           oldest;     /* monotonic time first custody ID was inserted since last flush */
+} bp_custody_shard_t;
+
+/* Missing Custody IDs */
+typedef struct {
+    bp_val_t                cid;        /* first custody ID reported missing */
+    bp_val_t                count;      /* number of custody IDs reported missing */
+    unsigned long           reported;   /* monotonic time the custody IDs were reported missing */
+} bp_missing_range_t;
+
+/* Channel Control Block */
+typedef struct {
+    /* Storage Service */
+    bp_store_t              store;
+    /* Statistics */
+    bp_stats_t              stats;
+    /* Data Bundles */
+    bp_bundle_t             bundle;
+    int                     bundle_handle;
+    int                     payload_handle;
+    bp_val_t                current_active_cid;
+    int                     active_table_signal;
+    bp_active_table_t       active_table;
+    bp_missing_range_t      missing[BP_MAX_MISSING_RANGES]; /* queued for fast retransmit, guarded by active_table_signal */
+    int                     missing_head;
+    int                     missing_count;
+    /* DTN Aggregate Custody Signals */
+    bp_bundle_t             dacs;
+    int                     dacs_handle;
+    uint8_t*                dacs_buffer;
+    int                     dacs_size;
+    bp_val_t                dacs_last_sent;     /* monotonic time */
+    int                     dacs_lock;
+    bp_custody_tree_t       custody_tree;       /* tree is the one being drained into a dacs */
+    bp_custody_tree_data_t* custody_tree_data;  /* one per shard plus the one being drained */
+    bp_custody_shard_t*     custody_shards;
+    int                     num_custody_shards;
+    int                     custody_shard_hint;
+    int                     dacs_policy;
+    bp_val_t                dacs_max_ranges;    /* adaptive: ranges that fill a dacs */
+    bp_val_t                dacs_max_cids;      /* adaptive: custody IDs pending before the sender's table fills */
+    int                     custody_signal;     /* wakes custody worker when custody IDs become pending */
+    /* Load Readiness */
+    int                     ready_signal;       /* wakes loaders when a bundle or dacs is stored */
+    unsigned long           ready_count;        /* number of bundles and dacs stored, guarded by ready_signal */
+    /* Load Fragmentation */
+    int                     fragment_lock;
+    bp_sid_t                fragment_sid;       /* stored bundle with fragments left to store, guarded by fragment_lock */
+    int                     fragment_offset;    /* payload offset of the next fragment to store */
+    /* Fragment Reassembly */
+    int                     reassembly_lock;
+    reasm_t                 reassembly;
+    /* Duplicate Suppression */
+    int                     duplicate_lock;
+    dedup_t                 duplicates;
+    /* Custody State Journal */
+    int                     journal_handle;
+    int                     journal_lock;       /* serializes checkpoints */
+    uint8_t*                journal_buffer;     /* entries of the journal record being written */
+    int                     journal_size;
+    bp_val_t                journal_checkpoint; /* sequence number of last checkpoint written */
+    bp_val_t                journal_cid_ceiling; /* custody IDs below are reserved by a complete checkpoint, guarded by active_table_signal */
+    int                     journal_records;    /* number of records in storage ahead of the next checkpoint */
+    unsigned long           journal_last_written; /* monotonic time */
+} bp_channel_t;
+
+/* Journal Writer */
+typedef struct {
+    bp_channel_t*           ch;
+    bp_journal_t            journal;    /* record being written */
+    int                     offset;     /* bytes of entries in the journal buffer */
+    int                     records;    /* number of records stored for the checkpoint */
+    unsigned long           sysnow;     /* converts retransmit times to system time for the journal */
+    unsigned long           mononow;
+    uint32_t*               flags;
+} bp_journal_writer_t;
+
+/* Journal Record Recovered from Storage */
+typedef struct {
+    bp_sid_t                sid;
+    bp_val_t                checkpoint;
+    bool                    valid;
+    bool                    last;
+} bp_journal_index_t;
+
+/******************************************************************************
+ CONSTANT DATA
+ ******************************************************************************/
+
+static const bp_attr_t default_attributes = {
+    .lifetime               = BP_DEFAULT_LIFETIME,
+    .request_custody        = BP_DEFAULT_REQUEST_CUSTODY,
+    .admin_record           = BP_DEFAULT_ADMIN_RECORD,
+    .integrity_check        = BP_DEFAULT_INTEGRITY_CHECK,
+    .allow_fragmentation    = BP_DEFAULT_ALLOW_FRAGMENTATION,
+    .ignore_expiration      = BP_DEFAULT_IGNORE_EXPIRATION,
+    .cid_reuse              = BP_DEFAULT_CID_REUSE,
+    .cipher_suite           = BP_DEFAULT_CIPHER_SUITE,
+    .class_of_service       = BP_DEFAULT_CLASS_OF_SERVICE,
+    .timeout                = BP_DEFAULT_TIMEOUT,
+    .max_length             = BP_DEFAULT_MAX_LENGTH,
+    .dacs_rate              = BP_DEFAULT_DACS_RATE,
+    .max_load_length        = BP_DEFAULT_MAX_LOAD_LENGTH,
+    .fast_retransmit        = BP_DEFAULT_FAST_RETRANSMIT,
+    .protocol_version       = BP_DEFAULT_PROTOCOL_VERSION,
+    .retransmit_order       = BP_DEFAULT_RETRANSMIT_ORDER,
+    .active_table           = BP_DEFAULT_ACTIVE_TABLE,
+    .custody_tree           = BP_DEFAULT_CUSTODY_TREE,
+    .custody_shards         = BP_DEFAULT_CUSTODY_SHARDS,
+    .dacs_policy            = BP_DEFAULT_DACS_POLICY,
+    .active_table_size      = BP_DEFAULT_ACTIVE_TABLE_SIZE,
+    .max_fills_per_dacs     = BP_DEFAULT_MAX_FILLS_PER_DACS,
+    .max_gaps_per_dacs      = BP_DEFAULT_MAX_GAPS_PER_DACS,
+    .max_reassembly_size    = BP_DEFAULT_MAX_REASSEMBLY_SIZE,
+    .duplicate_cache_size   = BP_DEFAULT_DUPLICATE_CACHE_SIZE,
+    .persistent_storage     = BP_DEFAULT_PERSISTENT_STORAGE,
+    .checkpoint_rate        = BP_DEFAULT_CHECKPOINT_RATE,
+    .storage_service_parm   = BP_DEFAULT_STORAGE_SERVICE_PARM
+};
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * signal_ready
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void signal_ready(bp_channel_t* ch)
+{
+    bplib_os_lock(ch->ready_signal);
+    {
+        ch->ready_count++;
+        bplib_os_signal(ch->ready_signal);
+    }
+    bplib_os_unlock(ch->ready_signal);
+}
+
+/*--------------------------------------------------------------------------------------
+ * wait_ready
+ *
+ *  Notes:  Waits for a bundle or dacs to be stored after ready_count was read; the count
+ *          is checked under the lock so that a store between reading it and waiting is
+ *          not missed.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int wait_ready(bp_channel_t* ch, unsigned long ready_count, int timeout)
+{
+    int status = BP_SUCCESS;
+
+    bplib_os_lock(ch->ready_signal);
+    {
+        if(ch->ready_count == ready_count)
+        {
+            status = bplib_os_waiton(ch->ready_signal, timeout);
+        }
+    }
+    bplib_os_unlock(ch->ready_signal);
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * enqueue_bundle
+ *
+ *  Notes:  The header of the bundle data must be preceded by BP_RECORD_PREFIX_BUF_SIZE
+ *          bytes of memory so that the storage record prefix can be written directly
+ *          ahead of the header, and the two enqueued as one contiguous block.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int enqueue_bundle(bp_channel_t* ch, int handle, bp_bundle_data_t* data, uint8_t* payload, int size, int timeout, uint32_t* flags)
+{
+    uint8_t* prefix_buf = data->header - BP_RECORD_PREFIX_BUF_SIZE;
+    int prefix_size = record_bundle_write(data, prefix_buf, BP_RECORD_PREFIX_BUF_SIZE, flags);
+    if(prefix_size < 0) return prefix_size;
+
+    BP_TRACE_BEGIN(trace_start);
+    int status = ch->store.enqueue(handle, data->header - prefix_size, prefix_size + data->headersize, payload, size, timeout);
+    BP_TRACE_END(trace_start, BP_TRACE_ENQUEUE_BUNDLE, ch, BP_TRACE_NO_CID, data->headersize + size, status);
+    if(status == BP_SUCCESS) signal_ready(ch);
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * enqueue_payload
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int enqueue_payload(bp_channel_t* ch, bp_payload_data_t* data, uint8_t* payload, int timeout, uint32_t* flags)
+{
+    uint8_t prefix_buf[BP_RECORD_PREFIX_BUF_SIZE];
+    int prefix_size = record_payload_write(data, prefix_buf, BP_RECORD_PREFIX_BUF_SIZE, flags);
+    if(prefix_size < 0) return prefix_size;
+
+    BP_TRACE_BEGIN(trace_start);
+    int status = ch->store.enqueue(ch->payload_handle, &prefix_buf[BP_RECORD_PREFIX_BUF_SIZE - prefix_size], prefix_size, payload, data->payloadsize, timeout);
+    BP_TRACE_END(trace_start, BP_TRACE_ENQUEUE_PAYLOAD, ch, BP_TRACE_NO_CID, data->payloadsize, status);
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * migrate_bundle
+ *
+ *  Notes:  Re-stores a bundle read from a legacy storage record using the current
+ *          record format and frees the legacy record.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int migrate_bundle(bp_channel_t* ch, int handle, bp_object_t* object, bp_bundle_data_t* data, uint32_t* flags)
+{
+    int status = BP_ERROR;
+    uint8_t* legacy_header = data->header;
+
+    /* Copy Header Behind Room for Record Prefix */
+    uint8_t* buffer = (uint8_t*)bplib_os_calloc(BP_RECORD_PREFIX_BUF_SIZE + data->headersize);
+    if(buffer != NULL)
+    {
+        memcpy(&buffer[BP_RECORD_PREFIX_BUF_SIZE], legacy_header, data->headersize);
+        data->header = &buffer[BP_RECORD_PREFIX_BUF_SIZE];
+        status = enqueue_bundle(ch, handle, data, &legacy_header[data->headersize], data->bundlesize - data->headersize, BP_CHECK, flags);
+        data->header = legacy_header;
+        bplib_os_free(buffer);
+    }
+
+    /* Free Legacy Record */
+    if(status == BP_SUCCESS)
+    {
+        ch->store.release(handle, object->header.sid);
+        ch->store.relinquish(handle, object->header.sid);
+    }
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * read_bundle
+ *
+ *  Returns:    BP_SUCCESS if the bundle data was read from the object; otherwise the
+ *              object has been migrated (legacy record) or dropped (unreadable record)
+ *              and the status of the read is returned
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int read_bundle(bp_channel_t* ch, int handle, bp_object_t* object, bp_bundle_data_t* data, uint32_t* flags)
+{
+    int status = record_bundle_read(object, data, flags);
+    if(status == BP_PENDING_MIGRATION)
+    {
+        /* Legacy Record (left in storage if it cannot be migrated) */
+        if(migrate_bundle(ch, handle, object, data, flags) != BP_SUCCESS)
+        {
+            bplog(flags, BP_FLAG_STORE_FAILURE, "Failed to migrate legacy bundle record\n");
+            ch->store.release(handle, object->header.sid);
+        }
+    }
+    else if(status != BP_SUCCESS)
+    {
+        /* Unreadable Record */
+        ch->store.release(handle, object->header.sid);
+        ch->store.relinquish(handle, object->header.sid);
+        ch->stats.lost++;
+    }
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dequeue_dacs
+ *
+ *  Returns:    true if a dacs bundle was dequeued and read into object and data
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool dequeue_dacs(bp_channel_t* ch, bp_object_t** object, bp_bundle_data_t* data, uint32_t* flags)
+{
+    int dacs_status = ch->store.dequeue(ch->dacs_handle, object, BP_CHECK);
+    if(dacs_status == BP_SUCCESS)
+    {
+        /* Read Storage Record (loads nothing if record migrated or dropped) */
+        if(read_bundle(ch, ch->dacs_handle, *object, data, flags) == BP_SUCCESS)
+        {
+            return true;
+        }
+    }
+    else if(dacs_status != BP_TIMEOUT)
+    {
+        /* Failed Storage Service */
+        bplog(flags, BP_FLAG_STORE_FAILURE, "Failed (%d) to dequeue dacs bundle from storage service\n", dacs_status);
+    }
+
+    *object = NULL;
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------
+ * create_bundle
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int create_bundle(void* parm, bool is_record, uint8_t* payload, int size, int timeout)
+{
+    bp_channel_t*       ch      = (bp_channel_t*)parm;
+    bp_bundle_data_t*   data    = NULL;
+    int                 handle  = BP_INVALID_HANDLE;
+    uint32_t            flags   = 0;
+
+    /* Set Type of Bundle */
+    if(is_record)
+    {
+        handle = ch->dacs_handle;
+        data = &ch->dacs.data;
+    }
+    else /* data bundle */
+    {
+        handle = ch->bundle_handle;
+        data = &ch->bundle.data;
+    }
+
+    /* Enqueue Bundle */
+    return enqueue_bundle(ch, handle, data, payload, size, timeout, &flags);
+}
+
+/*--------------------------------------------------------------------------------------
+ * relinquish_bundles
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int relinquish_bundles(bp_channel_t* ch, bp_sid_t* sids, int count)
+{
+    int status = BP_SUCCESS;
+    int i;
+
+    if(ch->store.relinquish_batch)
+    {
+        status = ch->store.relinquish_batch(ch->bundle_handle, sids, count);
+    }
+    else
+    {
+        for(i = 0; i < count; i++)
+        {
+            int sid_status = ch->store.relinquish(ch->bundle_handle, sids[i]);
+            if(sid_status != BP_SUCCESS) status = sid_status;
+        }
+    }
+
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * delete_bundle -
+ *
+ *  Notes:  Acknowledges the range of custody IDs [cid, cid + count).  The active table
+ *          lock is only held while a batch of custody IDs is removed from the table so
+ *          that bplib_load is not stalled for the duration of a large acknowledgment;
+ *          the removed bundles are relinquished after the lock is released.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int delete_bundle(void* parm, bp_val_t cid, bp_val_t count, int* num_deleted, uint32_t* flags)
+{
+    bp_channel_t* ch = (bp_channel_t*)parm;
+    bp_sid_t sids[BP_ACK_BATCH_SIZE];
+    int status = BP_SUCCESS;
+    bp_val_t offset = 0;
+
+    *num_deleted = 0;
+
+    while(offset < count)
+    {
+        bp_val_t remaining = count - offset;
+        int batch_size = remaining < BP_ACK_BATCH_SIZE ? (int)remaining : BP_ACK_BATCH_SIZE;
+        int removed = 0;
+        BP_TRACE_BEGIN(trace_start);
+
+        /* Remove Batch from Active Table */
+        bplib_os_lock(ch->active_table_signal);
+        {
+            removed = ch->active_table.remove_range(ch->active_table.table, cid + offset, batch_size, sids);
+            if(removed > 0) bplib_os_signal(ch->active_table_signal);
+        }
+        bplib_os_unlock(ch->active_table_signal);
+
+        /* Check for Unknown Custody IDs */
+        if(removed < batch_size)
+        {
+            *flags |= BP_FLAG_UNKNOWN_CID;
+            status = BP_ERROR;
+        }
+
+        /* Relinquish Removed Bundles */
+        if(removed > 0)
+        {
+            if(relinquish_bundles(ch, sids, removed) == BP_SUCCESS)
+            {
+                *num_deleted += removed;
+            }
+            else
+            {
+                *flags |= BP_FLAG_STORE_FAILURE;
+                status = BP_ERROR;
+            }
+        }
+
+        BP_TRACE_END(trace_start, BP_TRACE_ACKNOWLEDGED, ch, cid + offset, removed, status);
+        offset += batch_size;
+    }
+
+    /* Return Status */
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * missing_bundle -
+ *
+ *  Notes:  Queues the range of custody IDs [cid, cid + count) reported missing by a DACS
+ *          for retransmission by bplib_load ahead of their timeout; when the queue is
+ *          full the range is merged into the last range queued, which then also spans the
+ *          custody IDs between them (those acknowledged are skipped when it is retrieved)
+ *          and keeps its earlier report time so nothing retransmitted since is resent
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int missing_bundle(void* parm, bp_val_t cid, bp_val_t count, uint32_t* flags)
+{
+    bp_channel_t* ch = (bp_channel_t*)parm;
+    unsigned long mononow = 0;
+    (void)flags;
+
+    /* Get Time Reported */
+    bplib_os_monotime(&mononow);
+
+    /* Queue Range */
+    bplib_os_lock(ch->active_table_signal);
+    {
+        if(ch->missing_count < BP_MAX_MISSING_RANGES)
+        {
+            int tail = (ch->missing_head + ch->missing_count) % BP_MAX_MISSING_RANGES;
+            ch->missing[tail].cid = cid;
+            ch->missing[tail].count = count;
+            ch->missing[tail].reported = mononow;
+            ch->missing_count++;
+        }
+        else
+        {
+            int last = (ch->missing_head + ch->missing_count - 1) % BP_MAX_MISSING_RANGES;
+            bp_val_t first_cid = ch->missing[last].cid < cid ? ch->missing[last].cid : cid;
+            bp_val_t end_cid = ch->missing[last].cid + ch->missing[last].count;
+            if(cid + count > end_cid) end_cid = cid + count;
+            ch->missing[last].cid = first_cid;
+            ch->missing[last].count = end_cid - first_cid;
+        }
+    }
+    bplib_os_unlock(ch->active_table_signal);
+
+    /* Return Status */
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * retrieve_active -
+ *
+ *  Notes:  Retrieves an active bundle from storage for retransmission; must be called
+ *          with the active table lock held.  If the bundle cannot be retransmitted its
+ *          entry is cleared from the active table (and storage, if not already handled).
+ *
+ *  Returns:    true if the bundle was retrieved into object and data
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool retrieve_active(bp_channel_t* ch, bp_active_bundle_t* active_bundle, bp_object_t** object, bp_bundle_data_t* data, unsigned long sysnow, bool* newcid, uint32_t* flags)
+{
+    /* Retrieve Bundle from Storage */
+    if(ch->store.retrieve(ch->bundle_handle, active_bundle->sid, object, BP_CHECK) == BP_SUCCESS)
+    {
+        /* Read Storage Record */
+        if(read_bundle(ch, ch->bundle_handle, *object, data, flags) != BP_SUCCESS)
+        {
+            /* Record Migrated or Dropped (storage already handled) */
+            ch->active_table.remove(ch->active_table.table, active_bundle->cid, NULL);
+            *object = NULL;
+            return false;
+        }
+
+        /* Check Lifetime of Bundle */
+        if(data->exprtime != 0 && sysnow >= data->exprtime)
+        {
+            /* Bundle Expired */
+            *object = NULL;
+            ch->stats.expired++;
+        }
+    }
+    else
+    {
+        /* Failed to Retrieve Bundle from Storage */
+        *object = NULL;
+        *flags |= BP_FLAG_STORE_FAILURE;
+        ch->stats.lost++;
+    }
+
+    /* Check Success of Retrieving Valid Bundle */
+    if(*object)
+    {
+        /* Handle Active Table and Custody ID */
+        if(ch->bundle.attributes.cid_reuse)
+        {
+            /* Set flag to reuse custody id and active table entry,
+            * active table entry is not cleared, since CID is being reused */
+            *newcid = false;
+        }
+        else
+        {
+            /* Clear Entry (it will be reinserted below at the current CID) */
+            ch->active_table.remove(ch->active_table.table, active_bundle->cid, NULL);
+
+            /* Move to Next Oldest */
+            ch->active_table.next(ch->active_table.table, NULL);
+        }
+
+        return true;
+    }
+    else
+    {
+        /* Clear Entry in Active Table and Storage */
+        ch->active_table.remove(ch->active_table.table, active_bundle->cid, NULL);
+        ch->store.release(ch->bundle_handle, active_bundle->sid);
+        ch->store.relinquish(ch->bundle_handle, active_bundle->sid);
+        return false;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * retrieve_missing -
+ *
+ *  Notes:  Retrieves the next bundle reported missing that is still active and has not
+ *          been retransmitted since it was reported; must be called with the active
+ *          table lock held
+ *
+ *  Returns:    true if a bundle was retrieved into object and data
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool retrieve_missing(bp_channel_t* ch, bp_active_bundle_t* active_bundle, bp_object_t** object, bp_bundle_data_t* data, unsigned long sysnow, bool* newcid, uint32_t* flags)
+{
+    while(ch->missing_count > 0)
+    {
+        /* Pop Next Custody ID Reported Missing */
+        bp_missing_range_t* range = &ch->missing[ch->missing_head];
+        bp_val_t cid = range->cid++;
+        unsigned long reported = range->reported;
+        if(--range->count == 0)
+        {
+            ch->missing_head = (ch->missing_head + 1) % BP_MAX_MISSING_RANGES;
+            ch->missing_count--;
+        }
+
+        /* Skip Custody IDs Acknowledged or Already Retransmitted */
+        if(ch->active_table.remove(ch->active_table.table, cid, active_bundle) != BP_SUCCESS)
+        {
+            continue;
+        }
+        else if(active_bundle->retx > reported)
+        {
+            ch->active_table.add(ch->active_table.table, *active_bundle, true);
+            continue;
+        }
+
+        /* Keep Entry when Reusing Custody ID */
+        if(ch->bundle.attributes.cid_reuse)
+        {
+            ch->active_table.add(ch->active_table.table, *active_bundle, true);
+        }
+
+        /* Retrieve Missing Bundle */
+        if(retrieve_active(ch, active_bundle, object, data, sysnow, newcid, flags))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------
+ * create_dacs -
+ *
+ *  Notes:  Drains ch->custody_tree into dacs bundles addressed to node.service; must be
+ *          called with the dacs_lock held
+ *
+ *  Returns:    number of dacs bundles stored (failures are reported in flags)
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int create_dacs(bp_channel_t* ch, bp_ipn_t node, bp_ipn_t service, unsigned long mononow, int timeout, uint32_t* flags)
+{
+    int num_stored = 0;
+
+    /* Check if Destination Changed */
+    if(ch->dacs.route.destination_node != node || ch->dacs.route.destination_service != service)
+    {
+        ch->dacs.route.destination_node = node;
+        ch->dacs.route.destination_service = service;
+        ch->dacs.prebuilt = false;
+    }
+
+    /* If the custody_tree has nodes, initialize the iterator for traversing the custody_tree in order */
+    ch->custody_tree.goto_first(ch->custody_tree.tree);
+
+    /* Continue to delete nodes from the custody_tree and write them to DACS until the custody_tree is empty */
+    while (!ch->custody_tree.is_empty(ch->custody_tree.tree))
+    {
+        /* Build Acknowledgment - will remove nodes from the custody_tree */
+        int size = v6_populate_acknowledgment(ch->dacs_buffer, ch->dacs_size, ch->dacs.attributes.max_fills_per_dacs, &ch->custody_tree, flags);
+        if(size > 0)
+        {
+            int status = BP_SUCCESS;
+            ch->stats.dacs_bytes += size;
+
+            /* Check if Re-initialization Needed */
+            if(ch->dacs.prebuilt == false)
+            {
+                status = v6_populate_bundle(&ch->dacs, flags);
+            }
+
+            /* Send Bundle */
+            if(status == BP_SUCCESS)
+            {
+                status = v6_send_bundle(&ch->dacs, ch->dacs_buffer, size, create_bundle, ch, timeout, flags);
+                if(status == BP_SUCCESS)
+                {
+                    /* DACS successfully enqueued */
+                    ch->dacs_last_sent = mononow;
+                    num_stored++;
+                }
+                else
+                {
+                    /* DACS lost */
+                    *flags |= BP_FLAG_STORE_FAILURE;
+                    ch->stats.lost++;
+                }
+            }
+        }
+    }
+
+    /* Return Number Stored */
+    return num_stored;
+}
+
+/*--------------------------------------------------------------------------------------
+ * acquire_shard -
+ *
+ *  Notes:  Returns a locked custody shard.  Starting from the shard last acquired,
+ *          the first shard not held by another thread is used so that concurrent
+ *          receive threads spread out across the shards, while a single thread keeps
+ *          inserting into the same shard and its custody IDs continue to merge.  If
+ *          every shard is busy, waits on the shard last acquired.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bp_custody_shard_t* acquire_shard(bp_channel_t* ch)
+{
+    int start = ch->custody_shard_hint;
+    int i;
+
+    for(i = 0; i < ch->num_custody_shards; i++)
+    {
+        int s = (start + i) % ch->num_custody_shards;
+        if(bplib_os_trylock(ch->custody_shards[s].lock) == BP_SUCCESS)
+        {
+            ch->custody_shard_hint = s;
+            return &ch->custody_shards[s];
+        }
+    }
+
+    bplib_os_lock(ch->custody_shards[start].lock);
+    return &ch->custody_shards[start];
+}
+
+/*--------------------------------------------------------------------------------------
+ * flush_shard -
+ *
+ *  Notes:  The shard's tree is swapped with the empty drained tree while the shard
+ *          is locked, and then dacs are created from it with only the dacs_lock held,
+ *          so receive threads are not blocked while dacs are built and stored.
+ *          Must be called without the shard locked (lock order is dacs then shard).
+ *          A non-zero min_age only flushes the shard if its oldest custody ID has been
+ *          waiting at least that many seconds.
+ *
+ *  Returns:    number of dacs bundles stored
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int flush_shard(bp_channel_t* ch, bp_custody_shard_t* shard, unsigned long mononow, unsigned long min_age, uint32_t* flags)
+{
+    int num_stored = 0;
+
+    bplib_os_lock(ch->dacs_lock);
+    {
+        bool swapped = false;
+        bp_ipn_t node = 0;
+        bp_ipn_t service = 0;
+
+        /* Swap Out Shard's Custody Tree */
+        bplib_os_lock(shard->lock);
+        {
+            if(!ch->custody_tree.is_empty(shard->tree) && (min_age == 0 || mononow >= shard->oldest + min_age))
+            {
+                void* tree = shard->tree;
+                shard->tree = ch->custody_tree.tree;
+                ch->custody_tree.tree = tree;
+                node = shard->node;
+                service = shard->service;
+                ch->stats.dacs_cids += shard->cids;
+                shard->cids = 0;
+                swapped = true;
+            }
+        }
+        bplib_os_unlock(shard->lock);
+
+        /* Store DACS Bundles */
+        if(swapped)
+        {
+            num_stored = create_dacs(ch, node, service, mononow, BP_CHECK, flags);
+        }
+    }
+    bplib_os_unlock(ch->dacs_lock);
+
+    return num_stored;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dacs_deadline -
+ *
+ *  Notes:  Seconds a custody ID is held before the adaptive policy acknowledges it.
+ *          The sender's retransmission timeout is not known, so the channel's own
+ *          timeout is used as its estimate and custody IDs are acknowledged within
+ *          half of it, leaving the other half for the dacs to reach the sender.
+ *          Returns zero if neither a dacs rate nor a timeout is set.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE unsigned long dacs_deadline(bp_channel_t* ch)
+{
+    unsigned long deadline = (ch->dacs.attributes.dacs_rate > 0) ? ch->dacs.attributes.dacs_rate : 0;
+    if(ch->bundle.attributes.timeout > 0)
+    {
+        unsigned long half_timeout = (ch->bundle.attributes.timeout > 1) ? (ch->bundle.attributes.timeout / 2) : 1;
+        if(deadline == 0 || half_timeout < deadline) deadline = half_timeout;
+    }
+    return deadline;
+}
+
+/*--------------------------------------------------------------------------------------
+ * send_due_dacs -
+ *
+ *  Returns:    number of dacs bundles stored
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int send_due_dacs(bp_channel_t* ch, unsigned long mononow, uint32_t* flags)
+{
+    int num_stored = 0;
+    int i;
+
+    if(ch->dacs_policy == BP_DACS_ADAPTIVE)
+    {
+        /* Flush Custody Shards Holding Custody IDs Past Deadline */
+        unsigned long deadline = dacs_deadline(ch);
+        if(deadline > 0)
+        {
+            for(i = 0; i < ch->num_custody_shards; i++)
+            {
+                num_stored += flush_shard(ch, &ch->custody_shards[i], mononow, deadline, flags);
+            }
+        }
+    }
+    else if(ch->dacs.attributes.dacs_rate > 0)
+    {
+        /* Check If DACS Ready to Send */
+        if(mononow >= (ch->dacs_last_sent + ch->dacs.attributes.dacs_rate))
+        {
+            /* Flush Custody Shards (empty shards are skipped) */
+            for(i = 0; i < ch->num_custody_shards; i++)
+            {
+                num_stored += flush_shard(ch, &ch->custody_shards[i], mononow, 0, flags);
+            }
+        }
+    }
+
+    return num_stored;
+}
+
+/*--------------------------------------------------------------------------------------
+ * dacs_next_due -
+ *
+ *  Returns:    seconds until pending custody IDs are due to be acknowledged, or -1 if
+ *              no custody IDs are pending or none are acknowledged on a schedule
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE long dacs_next_due(bp_channel_t* ch, unsigned long mononow)
+{
+    long next_due = -1;
+    int i;
+
+    /* Get Period */
+    unsigned long period = 0;
+    if(ch->dacs_policy == BP_DACS_ADAPTIVE)         period = dacs_deadline(ch);
+    else if(ch->dacs.attributes.dacs_rate > 0)      period = ch->dacs.attributes.dacs_rate;
+    if(period == 0) return -1;
+
+    /* Find Earliest Shard Due */
+    for(i = 0; i < ch->num_custody_shards; i++)
+    {
+        bp_custody_shard_t* shard = &ch->custody_shards[i];
+        bplib_os_lock(shard->lock);
+        {
+            if(!ch->custody_tree.is_empty(shard->tree))
+            {
+                unsigned long due = ((ch->dacs_policy == BP_DACS_ADAPTIVE) ? shard->oldest : ch->dacs_last_sent) + period;
+                long wait = (due > mononow) ? (long)(due - mononow) : 0;
+                if(next_due < 0 || wait < next_due) next_due = wait;
+            }
+        }
+        bplib_os_unlock(shard->lock);
+    }
+
+    return next_due;
+}
+
+/*--------------------------------------------------------------------------------------
+ * fragment_bundle -
+ *
+ *  Notes:  Splits a stored bundle into fragments no larger than max_length and
+ *          stores each fragment as its own bundle so that custody is tracked per
+ *          fragment.  Fragment headers are patched copies of the stored header and
+ *          the payload of each fragment is copied into storage from the stored
+ *          bundle by enqueue_bundle.  Fragments are stored starting at the payload
+ *          offset passed in, which is advanced past each fragment stored so that a
+ *          failed call can be resumed where it left off.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int fragment_bundle(bp_channel_t* ch, bp_bundle_data_t* data, int max_length, int* offset, uint32_t* flags)
+{
+    uint8_t inline_hdrbuf[BP_RECORD_PREFIX_BUF_SIZE + BP_BUNDLE_HDR_BUF_SIZE];
+    uint8_t* hdrbuf = inline_hdrbuf;
+    bp_bundle_data_t frag;
+    int paysize = data->bundlesize - data->headersize;
+    int status = BP_SUCCESS;
+
+    /* Allocate Fragment Header if Larger than Inline Buffer */
+    int frag_hdrsize = data->headersize + BP_PRI_FRAG_FIELDS_SIZE;
+    if(frag_hdrsize > BP_BUNDLE_HDR_BUF_SIZE)
+    {
+        hdrbuf = (uint8_t*)bplib_os_calloc(BP_RECORD_PREFIX_BUF_SIZE + frag_hdrsize);
+        if(hdrbuf == NULL) return bplog(flags, BP_FLAG_STORE_FAILURE, "Failed to allocate fragment header of size %d\n", frag_hdrsize);
+    }
+    frag.header = &hdrbuf[BP_RECORD_PREFIX_BUF_SIZE];
+
+    while(*offset < paysize)
+    {
+        /* Build Fragment Header */
+        int fragment_size = v6_fragment_bundle(data, &frag, max_length, *offset, flags);
+        if(fragment_size <= 0)
+        {
+            status = BP_ERROR;
+            break;
+        }
+
+        /* Enqueue Fragment */
+        status = enqueue_bundle(ch, ch->bundle_handle, &frag, &data->header[data->headersize + *offset], fragment_size, BP_CHECK, flags);
+        if(status != BP_SUCCESS)
+        {
+            status = bplog(flags, BP_FLAG_STORE_FAILURE, "Failed (%d) to store fragment at offset %d\n", status, *offset);
+            break;
+        }
+
+        *offset += fragment_size;
+    }
+
+    /* Free Allocated Fragment Header */
+    if(hdrbuf != inline_hdrbuf) bplib_os_free(hdrbuf);
+
+    /* Return Status */
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * store_fragments -
+ *
+ *  Notes:  Fragments a dequeued bundle that is larger than the load length.  Once any
+ *          fragment is stored the bundle is never loaded as is, since that would send
+ *          the payload of the stored fragments twice; if storing the rest fails, the
+ *          bundle is held by its storage ID and resume_fragments stores the rest on a
+ *          later load.  Only one bundle is held at a time, so while one is held other
+ *          bundles are loaded unfragmented.  Fragments are enqueued at the tail of
+ *          storage (which returns no storage ID to place them by), so they are loaded
+ *          after any bundles stored since the original bundle.
+ *
+ *  Returns:    true if the bundle was taken (fragmented or held), false if it is to
+ *              be loaded as is
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool store_fragments(bp_channel_t* ch, bp_object_t* object, bp_bundle_data_t* data, uint32_t* flags)
+{
+    bool taken = false;
+
+    bplib_os_lock(ch->fragment_lock);
+    {
+        if(ch->fragment_sid == BP_SID_VACANT)
+        {
+            int offset = 0;
+            int status = fragment_bundle(ch, data, ch->bundle.attributes.max_load_length, &offset, flags);
+            if(status == BP_SUCCESS)
+            {
+                /* All Fragments Stored */
+                ch->store.release(ch->bundle_handle, object->header.sid);
+                ch->store.relinquish(ch->bundle_handle, object->header.sid);
+                taken = true;
+            }
+            else if(offset > 0)
+            {
+                /* Some Fragments Stored (hold bundle to store the rest) */
+                ch->store.release(ch->bundle_handle, object->header.sid);
+                ch->fragment_sid = object->header.sid;
+                ch->fragment_offset = offset;
+                taken = true;
+            }
+        }
+    }
+    bplib_os_unlock(ch->fragment_lock);
+
+    return taken;
+}
+
+/*--------------------------------------------------------------------------------------
+ * resume_fragments -
+ *
+ *  Notes:  Stores the fragments left to store of a bundle held by store_fragments,
+ *          and relinquishes the bundle once all of its fragments are stored
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void resume_fragments(bp_channel_t* ch, uint32_t* flags)
+{
+    bplib_os_lock(ch->fragment_lock);
+    {
+        if(ch->fragment_sid != BP_SID_VACANT)
+        {
+            bp_sid_t sid = ch->fragment_sid;
+            bp_object_t* object;
+            bp_bundle_data_t data;
+
+            /* Retrieve Held Bundle (record was read when first dequeued so needs no migration) */
+            if(ch->store.retrieve(ch->bundle_handle, sid, &object, BP_CHECK) != BP_SUCCESS)
+            {
+                bplog(flags, BP_FLAG_STORE_FAILURE, "Failed to retrieve bundle with fragments left to store\n");
+                ch->fragment_sid = BP_SID_VACANT;
+                ch->stats.lost++;
+            }
+            else if(record_bundle_read(object, &data, flags) != BP_SUCCESS)
+            {
+                ch->store.release(ch->bundle_handle, sid);
+                ch->store.relinquish(ch->bundle_handle, sid);
+                ch->fragment_sid = BP_SID_VACANT;
+                ch->stats.lost++;
+            }
+            else
+            {
+                /* Store Rest of Fragments (bundle held again on failure) */
+                int status = fragment_bundle(ch, &data, ch->bundle.attributes.max_load_length, &ch->fragment_offset, flags);
+                ch->store.release(ch->bundle_handle, sid);
+                if(status == BP_SUCCESS)
+                {
+                    ch->store.relinquish(ch->bundle_handle, sid);
+                    ch->fragment_sid = BP_SID_VACANT;
+                }
+            }
+        }
+    }
+    bplib_os_unlock(ch->fragment_lock);
+}
+
+/*--------------------------------------------------------------------------------------
+ * received_before -
+ *
+ *  Notes:  Fragments that are reassembled are remembered as their original bundle
+ *          once it is stored, so their key does not include the fragment offset.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool received_before(bp_channel_t* ch, dedup_key_t key, uint32_t* flags)
+{
+    int status;
+
+    /* Check Duplicate Suppression Enabled */
+    if(ch->duplicates.size == 0) return false;
+
+    /* Get Current Time (nothing is forgotten early when unreliable) */
+    unsigned long sysnow = 0;
+    if(bplib_os_systime(&sysnow) == BP_ERROR)
+    {
+        *flags |= BP_FLAG_UNRELIABLE_TIME;
+        sysnow = 0;
+    }
+
+    /* Look Up Bundle */
+    bplib_os_lock(ch->duplicate_lock);
+    {
+        status = dedup_check(&ch->duplicates, key, sysnow);
+    }
+    bplib_os_unlock(ch->duplicate_lock);
+
+    return status == BP_DUPLICATE;
+}
+
+/*--------------------------------------------------------------------------------------
+ * remember_received -
+ *
+ *  Notes:  Only called once a payload is stored so that a bundle which failed to be
+ *          stored (and so was not acknowledged) is accepted when it is retransmitted.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE void remember_received(bp_channel_t* ch, dedup_key_t key, bp_val_t exprtime)
+{
+    /* Check Duplicate Suppression Enabled */
+    if(ch->duplicates.size == 0) return;
+
+    unsigned long sysnow = 0;
+    if(bplib_os_systime(&sysnow) == BP_ERROR) sysnow = 0;
+
+    /* Add Bundle */
+    bplib_os_lock(ch->duplicate_lock);
+    {
+        dedup_add(&ch->duplicates, key, exprtime, sysnow);
+    }
+    bplib_os_unlock(ch->duplicate_lock);
+}
+
+/*--------------------------------------------------------------------------------------
+ * reassemble_payload -
+ *
+ *  Notes:  The received fragment is copied once into an assembly buffer laid out as
+ *          the payload it is a part of; when the last byte range arrives the buffer
+ *          is enqueued directly into the payload store.  Returns success whenever the
+ *          fragment was accepted (including duplicates) so that custody is taken.
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int reassemble_payload(bp_channel_t* ch, bp_payload_t* payload, int timeout, uint32_t* flags)
+{
+    int status = BP_SUCCESS;
+    int evicted = 0;
+    reasm_entry_t* complete = NULL;
+    reasm_key_t key = { payload->srcnode, payload->srcserv, payload->createsec, payload->createseq };
+
+    /* Get Current Time */
+    unsigned long sysnow = 0;
+    bool reliable_time = true;
+    if(bplib_os_systime(&sysnow) == BP_ERROR)
+    {
+        *flags |= BP_FLAG_UNRELIABLE_TIME;
+        reliable_time = false;
+    }
+
+    bplib_os_lock(ch->reassembly_lock);
+    {
+        /* Expire Partial Bundles */
+        if(reliable_time)
+        {
+            ch->stats.expired += reasm_expire(&ch->reassembly, sysnow);
+        }
+
+        /* Add Fragment */
+        if(payload->paylen > (bp_val_t)ch->reassembly.max_memory)
+        {
+            status = BP_FULL;
+        }
+        else
+        {
+            status = reasm_add(&ch->reassembly, key, &payload->data, (int)payload->paylen, (int)payload->fragoffset, payload->memptr, payload->data.payloadsize, &complete, &evicted);
+            ch->stats.lost += evicted;
+        }
+    }
+    bplib_os_unlock(ch->reassembly_lock);
+
+    /* Check Status */
+    if(status == BP_DUPLICATE)
+    {
+        *flags |= BP_FLAG_DUPLICATES;
+        status = BP_SUCCESS;
+    }
+    else if(status == BP_FULL)
+    {
+        ch->stats.lost++;
+        status = bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Fragmented bundle of size %lu exceeds reassembly memory\n", (unsigned long)payload->paylen);
+    }
+    else if(status != BP_SUCCESS)
+    {
+        ch->stats.lost++;
+        status = bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to reassemble fragment at offset %lu\n", status, (unsigned long)payload->fragoffset);
+    }
+
+    /* Store Reassembled Payload */
+    if(complete)
+    {
+        status = enqueue_payload(ch, &complete->data, complete->buffer, timeout, flags);
+        if(status == BP_SUCCESS)
+        {
+            dedup_key_t dupkey = { key.srcnode, key.srcserv, key.createsec, key.createseq, 0 };
+            remember_received(ch, dupkey, complete->data.exprtime);
+        }
+        else
+        {
+            *flags |= BP_FLAG_STORE_FAILURE;
+            ch->stats.lost++;
+        }
+
+        reasm_release(&ch->reassembly, complete);
+    }
+
+    /* Return Status */
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * write_journal_record -
+ *
+ *  Notes:  Stores the entries accumulated in the journal buffer as one record of the
+ *          checkpoint being written, and empties the buffer
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int write_journal_record(bp_journal_writer_t* writer, bool last)
+{
+    bp_channel_t* ch = writer->ch;
+    uint8_t prefix_buf[BP_RECORD_PREFIX_BUF_SIZE];
+
+    /* Write Record Prefix */
+    writer->journal.last = last;
+    writer->journal.entries_size = writer->offset;
+    int prefix_size = record_journal_write(&writer->journal, prefix_buf, BP_RECORD_PREFIX_BUF_SIZE, writer->flags);
+    if(prefix_size < 0) return prefix_size;
+
+    /* Store Record */
+    int status = ch->store.enqueue(ch->journal_handle, &prefix_buf[BP_RECORD_PREFIX_BUF_SIZE - prefix_size], prefix_size, ch->journal_buffer, writer->offset, BP_CHECK);
+    if(status != BP_SUCCESS)
+    {
+        return bplog(writer->flags, BP_FLAG_STORE_FAILURE, "Failed (%d) to store journal record\n", status);
+    }
+
+    /* Start Next Record */
+    writer->records++;
+    writer->journal.num_entries = 0;
+    writer->offset = 0;
+
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * write_journal_entry -
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int write_journal_entry(bp_journal_writer_t* writer, bp_journal_entry_t* entry)
+{
+    bp_channel_t* ch = writer->ch;
+
+    /* Store Record if Entry Might Not Fit */
+    if(writer->offset + BP_JOURNAL_MAX_ENTRY_SIZE > ch->journal_size)
+    {
+        int status = write_journal_record(writer, false);
+        if(status != BP_SUCCESS) return status;
+    }
 
-/* Active Table */
-typedef struct {
-    void*                   table;
-    bp_table_create_t       create;
-    bp_table_destroy_t      destroy;
-    bp_table_add_t          add;
-    bp_table_next_t         next;
-    bp_table_remove_t       remove;
-    bp_table_available_t    available;
-    bp_table_count_t        count;
-} bp_active_table_t;
+    /* Add Entry to Record */
+    int offset = record_entry_write(entry, ch->journal_buffer, writer->offset, ch->journal_size);
+    if(offset < 0) return offset;
+    writer->offset = offset;
+    writer->journal.num_entries++;
 
-/* Channel Control Block */
-typedef struct {
-    /* Storage Service */
-    bp_store_t              store;
-    /* Statistics */
-    bp_stats_t              stats;
-    /* Data Bundles */
-    bp_bundle_t             bundle;
-    int                     bundle_handle;
-    int                     payload_handle;
-    bp_val_t                current_active_cid;
-    int                     active_table_signal;
-    bp_active_table_t       active_table;
-    /* DTN Aggregate Custody Signals */
-    bp_bundle_t             dacs;
-    int                     dacs_handle;
-    uint8_t*                dacs_buffer;
-    int                     dacs_size;
-    bp_val_t                dacs_last_sent;
-    int                     custody_tree_lock;
-    rb_tree_t               custody_tree;
-} bp_channel_t;
+    return BP_SUCCESS;
+}
 
-/******************************************************************************
- CONSTANT DATA
- ******************************************************************************/
+/*--------------------------------------------------------------------------------------
+ * journal_active -
+ *
+ *  Notes:  Active table visitor that journals an unacknowledged bundle
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int journal_active(void* parm, bp_active_bundle_t* bundle)
+{
+    bp_journal_writer_t* writer = (bp_journal_writer_t*)parm;
 
-static const bp_attr_t default_attributes = {
-    .lifetime               = BP_DEFAULT_LIFETIME,
-    .request_custody        = BP_DEFAULT_REQUEST_CUSTODY,
-    .admin_record           = BP_DEFAULT_ADMIN_RECORD,
-    .integrity_check        = BP_DEFAULT_INTEGRITY_CHECK,
-    .allow_fragmentation    = BP_DEFAULT_ALLOW_FRAGMENTATION,
-    .ignore_expiration      = BP_DEFAULT_IGNORE_EXPIRATION,
-    .cid_reuse              = BP_DEFAULT_CID_REUSE,
-    .cipher_suite           = BP_DEFAULT_CIPHER_SUITE,
-    .class_of_service       = BP_DEFAULT_CLASS_OF_SERVICE,
-    .timeout                = BP_DEFAULT_TIMEOUT,
-    .max_length             = BP_DEFAULT_MAX_LENGTH,
-    .dacs_rate              = BP_DEFAULT_DACS_RATE,
-    .protocol_version       = BP_DEFAULT_PROTOCOL_VERSION,
-    .retransmit_order       = BP_DEFAULT_RETRANSMIT_ORDER,
-    .active_table_size      = BP_DEFAULT_ACTIVE_TABLE_SIZE,
-    .max_fills_per_dacs     = BP_DEFAULT_MAX_FILLS_PER_DACS,
-    .max_gaps_per_dacs      = BP_DEFAULT_MAX_GAPS_PER_DACS,
-    .persistent_storage     = BP_DEFAULT_PERSISTENT_STORAGE,
-    .storage_service_parm   = BP_DEFAULT_STORAGE_SERVICE_PARM
-};
+    /* Retransmit Times are Monotonic, so Journal them as System Time to Survive a Restart */
+    unsigned long age = (writer->mononow > bundle->retx) ? (writer->mononow - bundle->retx) : 0;
+    bp_val_t retx = (writer->sysnow > age) ? (writer->sysnow - age) : 0;
 
-/******************************************************************************
- LOCAL FUNCTIONS
- ******************************************************************************/
+    bp_journal_entry_t entry = { BP_JOURNAL_ACTIVE, { (bp_val_t)bundle->sid, bundle->cid, retx, bundle->stamp } };
+    return write_journal_entry(writer, &entry);
+}
 
 /*--------------------------------------------------------------------------------------
- * create_bundle
+ * drop_journal_records -
+ *
+ *  Notes:  Relinquishes records at the front of the journal store
  *-------------------------------------------------------------------------------------*/
-BP_LOCAL_SCOPE int create_bundle(void* parm, bool is_record, uint8_t* payload, int size, int timeout)
+BP_LOCAL_SCOPE void drop_journal_records(bp_channel_t* ch, int count)
 {
-    bp_channel_t*       ch      = (bp_channel_t*)parm;
-    bp_bundle_data_t*   data    = NULL;
-    int                 handle  = BP_INVALID_HANDLE;
+    bp_object_t* object;
+    int i;
 
-    /* Set Type of Bundle */
-    if(is_record)
+    for(i = 0; i < count; i++)
     {
-        handle = ch->dacs_handle;
-        data = &ch->dacs.data;
+        if(ch->store.dequeue(ch->journal_handle, &object, BP_CHECK) != BP_SUCCESS) break;
+        ch->store.release(ch->journal_handle, object->header.sid);
+        ch->store.relinquish(ch->journal_handle, object->header.sid);
     }
-    else /* data bundle */
+}
+
+/*--------------------------------------------------------------------------------------
+ * write_checkpoint -
+ *
+ *  Notes:  Journals a ceiling of reserved custody IDs, the active table, and the custody
+ *          IDs not yet acknowledged to their senders as a new checkpoint, and then
+ *          relinquishes the records of the previous checkpoint.  The journal store is first
+ *          in first out, so the previous records are the ones at its front, and they are
+ *          only removed once the new checkpoint is complete.  The ceiling reserves an active
+ *          table's worth of custody IDs past the next one, and no custody ID is assigned at
+ *          or past it until another checkpoint raises it (see reserve_custody_ids), so
+ *          recovery resumes from the ceiling without reusing a custody ID already sent.
+ *          Must be called with the journal_lock held.
+ *
+ *  Returns:    BP_SUCCESS or error code
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int write_checkpoint(bp_channel_t* ch, unsigned long sysnow, unsigned long mononow, uint32_t* flags)
+{
+    int status = BP_SUCCESS;
+    int i;
+
+    /* Initialize Writer */
+    bp_journal_writer_t writer = { ch, { ch->journal_checkpoint + 1, 0, false, 0, 0 }, 0, 0, sysnow, mononow, flags };
+
+    /* Journal Active Bundles */
+    bplib_os_lock(ch->active_table_signal);
     {
-        handle = ch->bundle_handle;
-        data = &ch->bundle.data;
+        writer.journal.current_cid = ch->current_active_cid + ch->bundle.attributes.active_table_size;
+        if(ch->bundle.attributes.active_table_size > 0)
+        {
+            status = ch->active_table.walk(ch->active_table.table, journal_active, &writer);
+        }
     }
+    bplib_os_unlock(ch->active_table_signal);
 
-    /* Enqueue Bundle */
-    int storage_header_size = &data->header[data->headersize] - (uint8_t*)data;
-    return ch->store.enqueue(handle, data, storage_header_size, payload, size, timeout);
+    /* Journal Custody IDs Pending Acknowledgment */
+    for(i = 0; i < ch->num_custody_shards && status == BP_SUCCESS; i++)
+    {
+        bp_custody_shard_t* shard = &ch->custody_shards[i];
+        bplib_os_lock(shard->lock);
+        {
+            bp_val_t num_ranges = ch->custody_tree.get_size(shard->tree);
+            bp_val_t r;
+
+            ch->custody_tree.goto_first(shard->tree);
+            for(r = 0; r < num_ranges && status == BP_SUCCESS; r++)
+            {
+                rb_range_t range;
+                ch->custody_tree.get_next(shard->tree, &range, false, false);
+                bp_journal_entry_t entry = { BP_JOURNAL_CUSTODY, { shard->node, shard->service, range.value, range.offset + 1 } };
+                status = write_journal_entry(&writer, &entry);
+            }
+        }
+        bplib_os_unlock(shard->lock);
+    }
+
+    /* Complete Checkpoint */
+    if(status == BP_SUCCESS)
+    {
+        status = write_journal_record(&writer, true);
+    }
+
+    /* Relinquish Previous Checkpoint
+     *  an incomplete checkpoint is ignored on recovery, so its records are kept
+     *  along with the previous checkpoint's and relinquished after the next one */
+    if(status == BP_SUCCESS)
+    {
+        drop_journal_records(ch, ch->journal_records);
+        ch->journal_records = writer.records;
+
+        /* Raise Ceiling of Reserved Custody IDs */
+        bplib_os_lock(ch->active_table_signal);
+        ch->journal_cid_ceiling = writer.journal.current_cid;
+        bplib_os_unlock(ch->active_table_signal);
+    }
+    else
+    {
+        ch->journal_records += writer.records;
+    }
+
+    ch->journal_checkpoint = writer.journal.checkpoint;
+    ch->journal_last_written = mononow;
+
+    return status;
 }
 
 /*--------------------------------------------------------------------------------------
- * delete_bundle
+ * checkpoint_due -
+ *
+ *  Notes:  Writes a checkpoint if one is due, unless another thread is writing one
  *-------------------------------------------------------------------------------------*/
-BP_LOCAL_SCOPE int delete_bundle(void* parm, bp_val_t cid, uint32_t* flags)
+BP_LOCAL_SCOPE void checkpoint_due(bp_channel_t* ch, unsigned long sysnow, unsigned long mononow, uint32_t* flags)
 {
-    bp_channel_t* ch = (bp_channel_t*)parm;
+    int rate = ch->bundle.attributes.checkpoint_rate;
 
-    bp_active_bundle_t bundle;
-    int status = ch->active_table.remove(ch->active_table.table, cid, &bundle);
-    if(status == BP_SUCCESS)
+    if(ch->journal_handle != BP_INVALID_HANDLE && rate > 0 && mononow >= ch->journal_last_written + rate)
     {
-        status = ch->store.relinquish(ch->bundle_handle, bundle.sid);
-        if(status != BP_SUCCESS)
+        if(bplib_os_trylock(ch->journal_lock) == BP_SUCCESS)
         {
-            *flags |= BP_FLAG_STORE_FAILURE;
+            if(mononow >= ch->journal_last_written + rate)
+            {
+                write_checkpoint(ch, sysnow, mononow, flags);
+            }
+            bplib_os_unlock(ch->journal_lock);
         }
     }
-    else
+}
+
+/*--------------------------------------------------------------------------------------
+ * reserve_custody_ids -
+ *
+ *  Notes:  Writes a checkpoint to raise the ceiling of reserved custody IDs when the
+ *          next custody ID has reached it.  Must be called with the active table lock
+ *          held, which is released while the checkpoint is written, so the caller must
+ *          assign the custody ID only after this returns.
+ *
+ *  Returns:    BP_SUCCESS if the next custody ID is reserved, or error code
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int reserve_custody_ids(bp_channel_t* ch, uint32_t* flags)
+{
+    int status = BP_SUCCESS;
+
+    while( (ch->journal_handle != BP_INVALID_HANDLE) &&
+           (ch->bundle.attributes.active_table_size > 0) &&
+           (ch->current_active_cid >= ch->journal_cid_ceiling) &&
+           (status == BP_SUCCESS) )
     {
-        *flags |= BP_FLAG_UNKNOWN_CID;
+        bplib_os_unlock(ch->active_table_signal);
+        {
+            unsigned long sysnow = 0;
+            unsigned long mononow = 0;
+            bplib_os_systime(&sysnow);
+            bplib_os_monotime(&mononow);
+
+            bplib_os_lock(ch->journal_lock);
+            status = write_checkpoint(ch, sysnow, mononow, flags);
+            bplib_os_unlock(ch->journal_lock);
+        }
+        bplib_os_lock(ch->active_table_signal);
     }
 
-    /* Return Status */
     return status;
 }
 
 /*--------------------------------------------------------------------------------------
- * create_dacs -
+ * stored_bundle_matches -
  *
- *  Notes:
+ *  Notes:  A journaled bundle may have been acknowledged and relinquished after the
+ *          checkpoint was written, and its storage ID reused by another bundle
+ *
+ *  Returns:    true if the bundle stored at the storage ID has the journaled stamp
  *-------------------------------------------------------------------------------------*/
-BP_LOCAL_SCOPE int create_dacs(bp_channel_t* ch, unsigned long sysnow, int timeout, uint32_t* flags)
+BP_LOCAL_SCOPE bool stored_bundle_matches(bp_channel_t* ch, bp_active_bundle_t* active_bundle)
 {
-    int ret_status = BP_SUCCESS;
+    bp_object_t* object;
+    bp_bundle_data_t data;
+    bp_val_t stamp;
+    uint32_t flags = 0;
+    bool matches = false;
 
-    /* If the custody_tree has nodes, initialize the iterator for traversing the custody_tree in order */
-    rb_tree_goto_first(&ch->custody_tree);
+    if(ch->store.retrieve(ch->bundle_handle, active_bundle->sid, &object, BP_CHECK) == BP_SUCCESS)
+    {
+        if(record_bundle_read(object, &data, &flags) == BP_SUCCESS && v6_stamp_bundle(&data, &stamp, &flags) == BP_SUCCESS)
+        {
+            matches = (stamp == active_bundle->stamp);
+        }
+        ch->store.release(ch->bundle_handle, active_bundle->sid);
+    }
 
-    /* Continue to delete nodes from the custody_tree and write them to DACS until the custody_tree is empty */
-    while (!rb_tree_is_empty(&ch->custody_tree))
+    return matches;
+}
+
+/*--------------------------------------------------------------------------------------
+ * restore_journal_entry -
+ *
+ *  Notes:  Active bundles whose storage ID no longer holds them are skipped, active
+ *          bundles that no longer fit in the active table are dropped, and custody IDs
+ *          that no longer fit in a custody shard are left for the sender to retransmit
+ *
+ *  Returns:    true if the entry was restored
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE bool restore_journal_entry(bp_channel_t* ch, bp_journal_entry_t* entry, unsigned long sysnow, unsigned long mononow)
+{
+    int i;
+
+    if(entry->type == BP_JOURNAL_ACTIVE)
     {
-        /* Build Acknowledgment - will remove nodes from the custody_tree */
-        int size = v6_populate_acknowledgment(ch->dacs_buffer, ch->dacs_size, ch->dacs.attributes.max_fills_per_dacs, &ch->custody_tree, flags);
-        if(size > 0)
+        /* Convert Journaled System Time back to Monotonic Retransmit Time */
+        unsigned long age = (sysnow > entry->fields[2]) ? (sysnow - entry->fields[2]) : 0;
+        bp_val_t retx = (mononow > age) ? (mononow - age) : 0;
+
+        bp_active_bundle_t active_bundle = { (bp_sid_t)entry->fields[0], retx, entry->fields[1], entry->fields[3] };
+
+        /* Check Storage ID still Holds the Bundle (it is reused once the bundle is relinquished) */
+        if(!stored_bundle_matches(ch, &active_bundle))
         {
-            int status = BP_SUCCESS;
+            return false;
+        }
 
-            /* Check if Re-initialization Needed */
-            if(ch->dacs.prebuilt == false)
-            {
-                status = v6_populate_bundle(&ch->dacs, flags);
-            }
+        /* Restore Active Bundle */
+        if( (ch->bundle.attributes.active_table_size > 0) &&
+            (ch->active_table.available(ch->active_table.table, active_bundle.cid) == BP_SUCCESS) &&
+            (ch->active_table.add(ch->active_table.table, active_bundle, false) == BP_SUCCESS) )
+        {
+            return true;
+        }
 
-            /* Send Bundle */
-            if(status == BP_SUCCESS)
+        /* Drop Bundle */
+        ch->store.relinquish(ch->bundle_handle, active_bundle.sid);
+        ch->stats.lost++;
+    }
+    else if(entry->type == BP_JOURNAL_CUSTODY)
+    {
+        bp_ipn_t node = entry->fields[0];
+        bp_ipn_t service = entry->fields[1];
+        bp_val_t c;
+
+        /* Insert Custody IDs into Shard Destined for Same DACS */
+        for(i = 0; i < ch->num_custody_shards; i++)
+        {
+            bp_custody_shard_t* shard = &ch->custody_shards[i];
+            bool empty = ch->custody_tree.is_empty(shard->tree);
+            if(empty || (shard->node == node && shard->service == service))
             {
-                status = v6_send_bundle(&ch->dacs, ch->dacs_buffer, size, create_bundle, ch, timeout, flags);
-                if(status == BP_SUCCESS)
+                shard->node = node;
+                shard->service = service;
+                if(empty) shard->oldest = mononow;
+
+                for(c = 0; c < entry->fields[3]; c++)
                 {
-                    /* DACS successfully enqueued */
-                    ch->dacs_last_sent = sysnow;
+                    if(ch->custody_tree.insert(entry->fields[2] + c, shard->tree) == BP_SUCCESS)
+                    {
+                        shard->cids++;
+                    }
                 }
-                else if(ret_status == BP_SUCCESS)
+
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+/*--------------------------------------------------------------------------------------
+ * recover_journal -
+ *
+ *  Notes:  Restores the custody state of the most recent complete checkpoint in the
+ *          journal store, writes it back as a new checkpoint, and relinquishes all
+ *          records recovered.  Custody state that changed after the checkpoint was
+ *          written is not recovered, except that custody IDs resume from the ceiling
+ *          reserved by the checkpoint, so none sent since are assigned again.
+ *
+ *  Returns:    BP_SUCCESS or error code
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int recover_journal(bp_channel_t* ch, unsigned long sysnow, unsigned long mononow, uint32_t* flags)
+{
+    bp_journal_index_t* records = NULL;
+    bp_object_t* object;
+    bp_journal_t journal;
+    bp_val_t latest = 0;
+    bool found = false;
+    int num_records = 0;
+    int num_active = 0;
+    int num_custody = 0;
+    int i;
+
+    /* Allocate Index of Recovered Records */
+    int count = ch->store.getcount(ch->journal_handle);
+    if(count > 0)
+    {
+        records = (bp_journal_index_t*)bplib_os_calloc(sizeof(bp_journal_index_t) * count);
+        if(records == NULL)
+        {
+            return bplog(flags, BP_FLAG_DIAGNOSTIC, "Failed to allocate memory to recover %d journal records\n", count);
+        }
+    }
+
+    /* Index Records and Find Latest Complete Checkpoint */
+    while(num_records < count && ch->store.dequeue(ch->journal_handle, &object, BP_CHECK) == BP_SUCCESS)
+    {
+        bp_journal_index_t* record = &records[num_records++];
+        record->sid = object->header.sid;
+        record->valid = record_journal_read(object, &journal, flags) > 0;
+        if(record->valid)
+        {
+            record->checkpoint = journal.checkpoint;
+            record->last = journal.last;
+            if(journal.checkpoint > ch->journal_checkpoint) ch->journal_checkpoint = journal.checkpoint;
+            if(journal.last && (!found || journal.checkpoint > latest))
+            {
+                latest = journal.checkpoint;
+                found = true;
+            }
+        }
+        ch->store.release(ch->journal_handle, object->header.sid);
+    }
+
+    /* Restore Entries of Latest Complete Checkpoint */
+    for(i = 0; found && i < num_records; i++)
+    {
+        if(!records[i].valid || records[i].checkpoint != latest) continue;
+
+        if(ch->store.retrieve(ch->journal_handle, records[i].sid, &object, BP_CHECK) == BP_SUCCESS)
+        {
+            int offset = record_journal_read(object, &journal, flags);
+            if(offset > 0)
+            {
+                bp_journal_entry_t entry;
+                int e;
+
+                ch->current_active_cid = journal.current_cid;
+                for(e = 0; e < journal.num_entries; e++)
                 {
-                    /* Save first failed DACS enqueue to return later */
-                    ret_status = status;
-                    *flags |= BP_FLAG_STORE_FAILURE;
-                    ch->stats.lost++;
+                    offset = record_entry_read(object, offset, &entry);
+                    if(offset < 0) break;
+
+                    if(restore_journal_entry(ch, &entry, sysnow, mononow))
+                    {
+                        if(entry.type == BP_JOURNAL_ACTIVE) num_active++;
+                        else                                num_custody += (int)entry.fields[3];
+                    }
                 }
             }
+            ch->store.release(ch->journal_handle, records[i].sid);
         }
     }
 
-    /* Return Status */
-    return ret_status;
+    if(found)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Recovered %d active bundles and %d pending custody IDs from checkpoint %lu\n",
+                                        num_active, num_custody, (unsigned long)latest);
+    }
+
+    /* Checkpoint Recovered State */
+    ch->journal_records = 0;
+    int status = write_checkpoint(ch, sysnow, mononow, flags);
+
+    /* Relinquish Recovered Records */
+    for(i = 0; i < num_records; i++)
+    {
+        ch->store.relinquish(ch->journal_handle, records[i].sid);
+    }
+
+    if(records) bplib_os_free(records);
+    return status;
 }
 
 /******************************************************************************
@@ -244,6 +1612,7 @@ bp_desc_t* bplib_open(bp_route_t route, bp_store_t store, bp_attr_t attributes)
     assert(store.getcount);
 
     int status = BP_SUCCESS;
+    int i;
 
     /* Validate Attributes */
     if(attributes.protocol_version != 6)
@@ -261,11 +1630,31 @@ bp_desc_t* bplib_open(bp_route_t route, bp_store_t store, bp_attr_t attributes)
         bplog(NULL, BP_FLAG_API_ERROR, "Timeout cannot be negative\n");
         return NULL;
     }
+    else if(attributes.custody_shards <= 0)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Number of custody shards must be greater than zero\n");
+        return NULL;
+    }
     else if(attributes.max_length < 0)
     {
         bplog(NULL, BP_FLAG_API_ERROR, "Max length cannot be negative\n");
         return NULL;
     }
+    else if(attributes.max_load_length < 0)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Max load length cannot be negative\n");
+        return NULL;
+    }
+    else if(attributes.max_reassembly_size < 0)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Max reassembly size cannot be negative\n");
+        return NULL;
+    }
+    else if(attributes.duplicate_cache_size < 0)
+    {
+        bplog(NULL, BP_FLAG_API_ERROR, "Duplicate cache size cannot be negative\n");
+        return NULL;
+    }
 
     /* Allocate Channel */
     bp_desc_t* desc = (bp_desc_t*)bplib_os_calloc(sizeof(bp_desc_t));
@@ -283,11 +1672,18 @@ bp_desc_t* bplib_open(bp_route_t route, bp_store_t store, bp_attr_t attributes)
     }
 
     /* Clear Channel Memory and Initialize to Defaults */
-    ch->custody_tree_lock   = BP_INVALID_HANDLE;
+    ch->dacs_lock           = BP_INVALID_HANDLE;
+    ch->custody_signal      = BP_INVALID_HANDLE;
+    ch->ready_signal        = BP_INVALID_HANDLE;
     ch->active_table_signal = BP_INVALID_HANDLE;
+    ch->fragment_lock       = BP_INVALID_HANDLE;
+    ch->reassembly_lock     = BP_INVALID_HANDLE;
+    ch->duplicate_lock      = BP_INVALID_HANDLE;
     ch->bundle_handle       = BP_INVALID_HANDLE;
     ch->payload_handle      = BP_INVALID_HANDLE;
     ch->dacs_handle         = BP_INVALID_HANDLE;
+    ch->journal_handle      = BP_INVALID_HANDLE;
+    ch->journal_lock        = BP_INVALID_HANDLE;
 
     /* Set Store */
     ch->store = store;
@@ -348,14 +1744,24 @@ bp_desc_t* bplib_open(bp_route_t route, bp_store_t store, bp_attr_t attributes)
     }
 
     /* Create DACS Lock */
-    ch->custody_tree_lock = bplib_os_createlock();
-    if(ch->custody_tree_lock == BP_INVALID_HANDLE)
+    ch->dacs_lock = bplib_os_createlock();
+    if(ch->dacs_lock == BP_INVALID_HANDLE)
     {
         bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create a lock for dacs processing\n");
         bplib_close(desc);
         return NULL;
     }
 
+    /* Create Custody Worker and Load Readiness Signals */
+    ch->custody_signal = bplib_os_createlock();
+    ch->ready_signal = bplib_os_createlock();
+    if(ch->custody_signal == BP_INVALID_HANDLE || ch->ready_signal == BP_INVALID_HANDLE)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create signals for custody worker and loaders\n");
+        bplib_close(desc);
+        return NULL;
+    }
+
     /* Allocate Memory for Channel DACS Bundle Fills */
     ch->dacs_size = sizeof(bp_val_t) * attributes.max_fills_per_dacs + 6; /* 2 bytes per fill plus payload block header */
     ch->dacs_buffer = (uint8_t*)bplib_os_calloc(ch->dacs_size);
@@ -366,18 +1772,91 @@ bp_desc_t* bplib_open(bp_route_t route, bp_store_t store, bp_attr_t attributes)
         return NULL;
     }
 
-    /* Allocate Memory for DACS Channel Tree to Store Bundle IDs */
-    status = rb_tree_create(attributes.max_gaps_per_dacs, &ch->custody_tree);
-    if(status != BP_SUCCESS)
+    /* Initialize Custody Tree Functions */
+    if(attributes.custody_tree == BP_CUSTODY_RB_TREE)
+    {
+        ch->custody_tree.create     = (bp_tree_create_t)rb_tree_create;
+        ch->custody_tree.destroy    = (bp_tree_destroy_t)rb_tree_destroy;
+        ch->custody_tree.insert     = (bp_tree_insert_t)rb_tree_insert;
+        ch->custody_tree.is_empty   = (bp_tree_is_empty_t)rb_tree_is_empty;
+        ch->custody_tree.get_size   = (bp_tree_get_size_t)rb_tree_get_size;
+        ch->custody_tree.goto_first = (bp_tree_goto_first_t)rb_tree_goto_first;
+        ch->custody_tree.get_next   = (bp_tree_get_next_t)rb_tree_get_next;
+    }
+    else if(attributes.custody_tree == BP_CUSTODY_RANGE_ARRAY)
+    {
+        ch->custody_tree.create     = (bp_tree_create_t)range_array_create;
+        ch->custody_tree.destroy    = (bp_tree_destroy_t)range_array_destroy;
+        ch->custody_tree.insert     = (bp_tree_insert_t)range_array_insert;
+        ch->custody_tree.is_empty   = (bp_tree_is_empty_t)range_array_is_empty;
+        ch->custody_tree.get_size   = (bp_tree_get_size_t)range_array_get_size;
+        ch->custody_tree.goto_first = (bp_tree_goto_first_t)range_array_goto_first;
+        ch->custody_tree.get_next   = (bp_tree_get_next_t)range_array_get_next;
+    }
+    else
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unrecognized attribute for creating custody tree: %d\n", attributes.custody_tree);
+        bplib_close(desc);
+        return NULL;
+    }
+
+    /* Allocate Memory for Custody Shards */
+    ch->custody_shards = (bp_custody_shard_t*)bplib_os_calloc_tag(sizeof(bp_custody_shard_t) * attributes.custody_shards, BP_MEM_CUSTODY_TREE);
+    ch->custody_tree_data = (bp_custody_tree_data_t*)bplib_os_calloc_tag(sizeof(bp_custody_tree_data_t) * (attributes.custody_shards + 1), BP_MEM_CUSTODY_TREE);
+    if(ch->custody_shards == NULL || ch->custody_tree_data == NULL)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate memory for custody shards\n");
+        bplib_close(desc);
+        return NULL;
+    }
+
+    /* Allocate Memory for DACS Channel Trees to Store Bundle IDs */
+    ch->num_custody_shards = attributes.custody_shards;
+    for(i = 0; i < ch->num_custody_shards; i++)
+    {
+        ch->custody_shards[i].lock = BP_INVALID_HANDLE;
+    }
+    for(i = 0; i <= ch->num_custody_shards; i++)
+    {
+        status = ch->custody_tree.create(attributes.max_gaps_per_dacs, &ch->custody_tree_data[i]);
+        if(status != BP_SUCCESS)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate memory for channel DACS tree\n");
+            bplib_close(desc);
+            return NULL;
+        }
+    }
+    ch->custody_tree.tree = &ch->custody_tree_data[ch->num_custody_shards];
+
+    /* Create Custody Shard Locks */
+    for(i = 0; i < ch->num_custody_shards; i++)
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to allocate memory for channel DACS tree\n");
-        bplib_close(desc);
-        return NULL;
+        ch->custody_shards[i].tree = &ch->custody_tree_data[i];
+        ch->custody_shards[i].lock = bplib_os_createlock();
+        if(ch->custody_shards[i].lock == BP_INVALID_HANDLE)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create a lock for custody shard %d\n", i);
+            bplib_close(desc);
+            return NULL;
+        }
     }
 
     /* Initialize Last Time DACS Sent */
     ch->dacs_last_sent = 0;
 
+    /* Initialize DACS Policy */
+    if(attributes.dacs_policy != BP_DACS_PERIODIC && attributes.dacs_policy != BP_DACS_ADAPTIVE)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unrecognized attribute for dacs policy: %d\n", attributes.dacs_policy);
+        bplib_close(desc);
+        return NULL;
+    }
+    ch->dacs_policy = attributes.dacs_policy;
+    ch->dacs_max_ranges = attributes.max_fills_per_dacs / 2; /* one fill for each acknowledged and skipped range */
+    if(ch->dacs_max_ranges > ((bp_val_t)attributes.max_gaps_per_dacs * 3) / 4) ch->dacs_max_ranges = ((bp_val_t)attributes.max_gaps_per_dacs * 3) / 4;
+    if(ch->dacs_max_ranges == 0) ch->dacs_max_ranges = 1;
+    ch->dacs_max_cids = (attributes.active_table_size > 0) ? (attributes.active_table_size / 4) : 0;
+
     /* Initialize Active Table Signal */
     ch->active_table_signal = bplib_os_createlock();
     if(ch->active_table_signal == BP_INVALID_HANDLE)
@@ -395,22 +1874,38 @@ bp_desc_t* bplib_open(bp_route_t route, bp_store_t store, bp_attr_t attributes)
         ch->active_table.add        = (bp_table_add_t)cbuf_add;
         ch->active_table.next       = (bp_table_next_t)cbuf_next;
         ch->active_table.remove     = (bp_table_remove_t)cbuf_remove;
+        ch->active_table.remove_range = (bp_table_remove_range_t)cbuf_remove_range;
         ch->active_table.available  = (bp_table_available_t)cbuf_available;
         ch->active_table.count      = (bp_table_count_t)cbuf_count;
+        ch->active_table.walk       = (bp_table_walk_t)cbuf_walk;
     }
-    else if(attributes.retransmit_order == BP_RETX_OLDEST_BUNDLE)
+    else if(attributes.retransmit_order == BP_RETX_OLDEST_BUNDLE && attributes.active_table == BP_ACTIVE_TABLE_SWISS)
+    {
+        ch->active_table.create     = (bp_table_create_t)swiss_table_create;
+        ch->active_table.destroy    = (bp_table_destroy_t)swiss_table_destroy;
+        ch->active_table.add        = (bp_table_add_t)swiss_table_add;
+        ch->active_table.next       = (bp_table_next_t)swiss_table_next;
+        ch->active_table.remove     = (bp_table_remove_t)swiss_table_remove;
+        ch->active_table.remove_range = (bp_table_remove_range_t)swiss_table_remove_range;
+        ch->active_table.available  = (bp_table_available_t)swiss_table_available;
+        ch->active_table.count      = (bp_table_count_t)swiss_table_count;
+        ch->active_table.walk       = (bp_table_walk_t)swiss_table_walk;
+    }
+    else if(attributes.retransmit_order == BP_RETX_OLDEST_BUNDLE && attributes.active_table == BP_ACTIVE_TABLE_RH_HASH)
     {
         ch->active_table.create     = (bp_table_create_t)rh_hash_create;
         ch->active_table.destroy    = (bp_table_destroy_t)rh_hash_destroy;
         ch->active_table.add        = (bp_table_add_t)rh_hash_add;
         ch->active_table.next       = (bp_table_next_t)rh_hash_next;
         ch->active_table.remove     = (bp_table_remove_t)rh_hash_remove;
+        ch->active_table.remove_range = (bp_table_remove_range_t)rh_hash_remove_range;
         ch->active_table.available  = (bp_table_available_t)rh_hash_available;
         ch->active_table.count      = (bp_table_count_t)rh_hash_count;
+        ch->active_table.walk       = (bp_table_walk_t)rh_hash_walk;
     }
     else
     {
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unrecognized attribute for creating active table: %d\n", attributes.retransmit_order);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unrecognized attributes for creating active table: %d, %d\n", attributes.retransmit_order, attributes.active_table);
         bplib_close(desc);
         return NULL;
     }
@@ -427,6 +1922,94 @@ bp_desc_t* bplib_open(bp_route_t route, bp_store_t store, bp_attr_t attributes)
     /* Initialize Current Custody ID */
     ch->current_active_cid  = 0;
 
+    /* Initialize Custody IDs Reported Missing */
+    ch->missing_head        = 0;
+    ch->missing_count       = 0;
+
+    /* Initialize Load Fragmentation */
+    ch->fragment_sid        = BP_SID_VACANT;
+    ch->fragment_offset     = 0;
+    ch->fragment_lock = bplib_os_createlock();
+    if(ch->fragment_lock == BP_INVALID_HANDLE)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create a lock for load fragmentation\n");
+        bplib_close(desc);
+        return NULL;
+    }
+
+    /* Initialize Reassembly Lock */
+    ch->reassembly_lock = bplib_os_createlock();
+    if(ch->reassembly_lock == BP_INVALID_HANDLE)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create a lock for fragment reassembly\n");
+        bplib_close(desc);
+        return NULL;
+    }
+
+    /* Initialize Reassembly Table */
+    status = reasm_create(&ch->reassembly, attributes.max_reassembly_size);
+    if(status != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create reassembly table for channel\n");
+        bplib_close(desc);
+        return NULL;
+    }
+
+    /* Initialize Duplicate Lock */
+    ch->duplicate_lock = bplib_os_createlock();
+    if(ch->duplicate_lock == BP_INVALID_HANDLE)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create a lock for duplicate suppression\n");
+        bplib_close(desc);
+        return NULL;
+    }
+
+    /* Initialize Duplicate Cache */
+    status = dedup_create(&ch->duplicates, attributes.duplicate_cache_size);
+    if(status != BP_SUCCESS)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create duplicate cache for channel\n");
+        bplib_close(desc);
+        return NULL;
+    }
+
+    /* Initialize Custody State Journal */
+    if(attributes.persistent_storage)
+    {
+        /* Allocate Memory for Journal Record Entries (records with their prefix are no larger than bundles) */
+        ch->journal_size = attributes.max_length - BP_RECORD_PREFIX_BUF_SIZE;
+        if(ch->journal_size < BP_JOURNAL_MAX_ENTRY_SIZE) ch->journal_size = BP_JOURNAL_MAX_ENTRY_SIZE;
+        ch->journal_buffer = (uint8_t*)bplib_os_calloc(ch->journal_size);
+        ch->journal_lock = bplib_os_createlock();
+        if(ch->journal_buffer == NULL || ch->journal_lock == BP_INVALID_HANDLE)
+        {
+            bplog(NULL, BP_FLAG_DIAGNOSTIC, "Failed to create journal for channel\n");
+            bplib_close(desc);
+            return NULL;
+        }
+
+        /* Initialize Journal Store */
+        ch->journal_handle = ch->store.create(BP_STORE_JOURNAL_TYPE, route.local_node, route.local_service, true, attributes.storage_service_parm);
+        if(ch->journal_handle == BP_INVALID_HANDLE)
+        {
+            bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed to create storage handle for journal\n");
+            bplib_close(desc);
+            return NULL;
+        }
+
+        /* Recover Custody State */
+        unsigned long sysnow = 0;
+        unsigned long mononow = 0;
+        uint32_t flags = 0;
+        bplib_os_systime(&sysnow);
+        bplib_os_monotime(&mononow);
+        bplib_os_lock(ch->journal_lock);
+        {
+            recover_journal(ch, sysnow, mononow, &flags);
+        }
+        bplib_os_unlock(ch->journal_lock);
+    }
+
     /* Return Channel */
     return desc;
 }
@@ -442,6 +2025,34 @@ void bplib_close(bp_desc_t* desc)
     /* Get Channel */
     bp_channel_t* ch = (bp_channel_t*)desc->channel;
 
+    /* Checkpoint Custody State and Un-initialize Journal */
+    if(ch->journal_handle != BP_INVALID_HANDLE)
+    {
+        unsigned long sysnow = 0;
+        unsigned long mononow = 0;
+        uint32_t flags = 0;
+        bplib_os_systime(&sysnow);
+        bplib_os_monotime(&mononow);
+        bplib_os_lock(ch->journal_lock);
+        {
+            write_checkpoint(ch, sysnow, mononow, &flags);
+        }
+        bplib_os_unlock(ch->journal_lock);
+
+        ch->store.destroy(ch->journal_handle);
+        ch->journal_handle = BP_INVALID_HANDLE;
+    }
+    if(ch->journal_lock != BP_INVALID_HANDLE)
+    {
+        bplib_os_destroylock(ch->journal_lock);
+        ch->journal_lock = BP_INVALID_HANDLE;
+    }
+    if(ch->journal_buffer)
+    {
+        bplib_os_free(ch->journal_buffer);
+        ch->journal_buffer = NULL;
+    }
+
     /* Un-initialize Bundle Store */
     if(ch->bundle_handle != BP_INVALID_HANDLE)
     {
@@ -463,11 +2074,23 @@ void bplib_close(bp_desc_t* desc)
         ch->dacs_handle = BP_INVALID_HANDLE;
     }
 
-    /* Destroy Custody Tree Lock */
-    if(ch->custody_tree_lock != BP_INVALID_HANDLE)
+    /* Destroy DACS Lock */
+    if(ch->dacs_lock != BP_INVALID_HANDLE)
+    {
+        bplib_os_destroylock(ch->dacs_lock);
+        ch->dacs_lock = BP_INVALID_HANDLE;
+    }
+
+    /* Destroy Custody Worker and Load Readiness Signals */
+    if(ch->custody_signal != BP_INVALID_HANDLE)
     {
-        bplib_os_destroylock(ch->custody_tree_lock);
-        ch->custody_tree_lock = BP_INVALID_HANDLE;
+        bplib_os_destroylock(ch->custody_signal);
+        ch->custody_signal = BP_INVALID_HANDLE;
+    }
+    if(ch->ready_signal != BP_INVALID_HANDLE)
+    {
+        bplib_os_destroylock(ch->ready_signal);
+        ch->ready_signal = BP_INVALID_HANDLE;
     }
 
     /* Free Buffer for DACS */
@@ -477,8 +2100,29 @@ void bplib_close(bp_desc_t* desc)
         ch->dacs_buffer = NULL;
     }
 
-    /* Free Custody Tree */
-    rb_tree_destroy(&ch->custody_tree);
+    /* Free Custody Shards */
+    if(ch->custody_shards)
+    {
+        int i;
+        for(i = 0; i < ch->num_custody_shards; i++)
+        {
+            if(ch->custody_shards[i].lock != BP_INVALID_HANDLE) bplib_os_destroylock(ch->custody_shards[i].lock);
+        }
+        bplib_os_free(ch->custody_shards);
+        ch->custody_shards = NULL;
+    }
+
+    /* Free Custody Trees */
+    if(ch->custody_tree_data)
+    {
+        int i;
+        for(i = 0; i <= ch->num_custody_shards; i++)
+        {
+            if(ch->custody_tree.destroy) ch->custody_tree.destroy(&ch->custody_tree_data[i]);
+        }
+        bplib_os_free(ch->custody_tree_data);
+        ch->custody_tree_data = NULL;
+    }
 
     /* Un-initialize Bundle and DACS */
     v6_destroy(&ch->bundle);
@@ -488,6 +2132,17 @@ void bplib_close(bp_desc_t* desc)
     if(ch->active_table_signal != BP_INVALID_HANDLE) bplib_os_destroylock(ch->active_table_signal);
     if(ch->active_table.destroy) ch->active_table.destroy(ch->active_table.table);
 
+    /* Un-initialize Load Fragmentation */
+    if(ch->fragment_lock != BP_INVALID_HANDLE) bplib_os_destroylock(ch->fragment_lock);
+
+    /* Un-initialize Reassembly Table */
+    if(ch->reassembly_lock != BP_INVALID_HANDLE) bplib_os_destroylock(ch->reassembly_lock);
+    reasm_destroy(&ch->reassembly);
+
+    /* Un-initialize Duplicate Cache */
+    if(ch->duplicate_lock != BP_INVALID_HANDLE) bplib_os_destroylock(ch->duplicate_lock);
+    dedup_destroy(&ch->duplicates);
+
     /* Free Channel */
     bplib_os_free(ch);
     bplib_os_free(desc);
@@ -522,6 +2177,18 @@ int bplib_flush(bp_desc_t* desc)
     }
     bplib_os_unlock(ch->active_table_signal);
 
+    /* Relinquish Bundle with Fragments Left to Store */
+    bplib_os_lock(ch->fragment_lock);
+    {
+        if(ch->fragment_sid != BP_SID_VACANT)
+        {
+            ch->store.relinquish(handle, ch->fragment_sid);
+            ch->fragment_sid = BP_SID_VACANT;
+            ch->stats.lost++;
+        }
+    }
+    bplib_os_unlock(ch->fragment_lock);
+
     /* Return Success */
     return BP_SUCCESS;
 }
@@ -625,6 +2292,19 @@ int bplib_config(bp_desc_t* desc, int mode, int opt, int* val)
             else        *val = ch->dacs.attributes.dacs_rate;
             break;
         }
+        case BP_OPT_MAX_LOAD_LENGTH:
+        {
+            if(setopt && *val < 0) return BP_ERROR;
+            if(setopt)  ch->bundle.attributes.max_load_length = *val;
+            else        *val = ch->bundle.attributes.max_load_length;
+            break;
+        }
+        case BP_OPT_FAST_RETRANSMIT:
+        {
+            if(setopt)  ch->bundle.attributes.fast_retransmit = *val;
+            else        *val = ch->bundle.attributes.fast_retransmit;
+            break;
+        }
         default:
         {
             /* Option Not Found */
@@ -682,6 +2362,7 @@ int bplib_store(bp_desc_t* desc, void* payload, int size, int timeout, uint32_t*
 
     /* Get Channel */
     bp_channel_t* ch = (bp_channel_t*)desc->channel;
+    BP_TRACE_BEGIN(trace_start);
 
     /* Check if Re-initialization Needed */
     if(ch->bundle.prebuilt == false)
@@ -695,6 +2376,8 @@ int bplib_store(bp_desc_t* desc, void* payload, int size, int timeout, uint32_t*
         status = v6_send_bundle(&ch->bundle, payload, size, create_bundle, ch, timeout, flags);
     }
 
+    BP_TRACE_END(trace_start, BP_TRACE_STORE, ch, BP_TRACE_NO_CID, size, status);
+
     /* Return Status */
     return status;
 }
@@ -704,7 +2387,7 @@ int bplib_store(bp_desc_t* desc, void* payload, int size, int timeout, uint32_t*
  *-------------------------------------------------------------------------------------*/
 int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t* flags)
 {
-    bp_active_bundle_t active_bundle = { BP_SID_VACANT, 0, 0 };
+    bp_active_bundle_t active_bundle = { BP_SID_VACANT, 0, 0, 0 };
     int status = BP_SUCCESS; /* success or error code */
 
     /* Check Parameters */
@@ -715,10 +2398,13 @@ int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t*
 
     /* Get Channel */
     bp_channel_t* ch = (bp_channel_t*)desc->channel;
+    BP_TRACE_BEGIN(trace_start);
 
     /* Setup State */
-    unsigned long   sysnow  = 0;                /* current system time used for timeouts (seconds) */
+    unsigned long   sysnow  = 0;                /* current system time used for expiration (seconds) */
+    unsigned long   mononow = 0;                /* current monotonic time used for timeouts (seconds) */
     bp_object_t*    object  = NULL;             /* start out assuming nothing to send */
+    bp_bundle_data_t data;                      /* bundle data read from storage record of object */
     bool            newcid  = true;             /* whether to assign new custody id and active table entry */
     bool            resend  = false;            /* is loaded bundle a retransmission */
     bool            isdacs  = false;            /* is loaded bundle a dacs */
@@ -728,99 +2414,52 @@ int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t*
     {
         *flags |= BP_FLAG_UNRELIABLE_TIME;
     }
+    bplib_os_monotime(&mononow);
 
     /*-------------------------*/
     /* Try to Send DACS Bundle */
     /*-------------------------*/
-    if(ch->dacs.attributes.dacs_rate > 0)
-    {
-        /* Check If DACS Ready to Send */
-        bplib_os_lock(ch->custody_tree_lock);
-        {
-            if( (sysnow >= (ch->dacs_last_sent + ch->dacs.attributes.dacs_rate)) &&
-                !rb_tree_is_empty(&ch->custody_tree) )
-            {
-                create_dacs(ch, sysnow, BP_CHECK, flags);
-            }
-        }
-        bplib_os_unlock(ch->custody_tree_lock);
-    }
+    send_due_dacs(ch, mononow, flags);
+
+    /*--------------------------------*/
+    /* Checkpoint Custody State (due) */
+    /*--------------------------------*/
+    checkpoint_due(ch, sysnow, mononow, flags);
+
+    /* Get Readiness Before Checking Storage */
+    bplib_os_lock(ch->ready_signal);
+    unsigned long ready_count = ch->ready_count;
+    bplib_os_unlock(ch->ready_signal);
 
     /* Dequeue any Stored DACS */
-    int dacs_status = ch->store.dequeue(ch->dacs_handle, &object, BP_CHECK);
-    if(dacs_status == BP_SUCCESS)
-    {
-        isdacs = true;
-    }
-    else if(dacs_status != BP_TIMEOUT)
-    {
-        /* Failed Storage Service */
-        bplog(flags, BP_FLAG_STORE_FAILURE, "Failed (%d) to dequeue dacs bundle from storage service\n", dacs_status);
-    }
+    isdacs = dequeue_dacs(ch, &object, &data, flags);
 
     /*------------------------------------------------*/
     /* Try to Send Active Bundle (if nothing to send) */
     /*------------------------------------------------*/
+    BP_TRACE_BEGIN(trace_lock);
     bplib_os_lock(ch->active_table_signal);
+    BP_TRACE_END(trace_lock, BP_TRACE_LOAD_LOCK, ch, BP_TRACE_NO_CID, 0, BP_SUCCESS);
+    BP_TRACE_BEGIN(trace_active);
     {
         /* Get Oldest Bundle */
         while(object == NULL && ch->active_table.next(ch->active_table.table, &active_bundle) == BP_SUCCESS)
         {
             /* Check if Bundle has Timed Out */
-            if(ch->bundle.attributes.timeout != 0 && sysnow >= (active_bundle.retx + ch->bundle.attributes.timeout))
+            if(ch->bundle.attributes.timeout != 0 && mononow >= (active_bundle.retx + ch->bundle.attributes.timeout))
             {
-                /* Retrieve Timed Out Bundle from Storage */
-                if(ch->store.retrieve(ch->bundle_handle, active_bundle.sid, &object, BP_CHECK) == BP_SUCCESS)
-                {
-                    bp_bundle_data_t* data = (bp_bundle_data_t*)object->data;
-
-                    /* Check Lifetime of Bundle */
-                    if(data->exprtime != 0 && sysnow >= data->exprtime)
-                    {
-                        /* Bundle Expired */
-                        object = NULL;
-                        ch->stats.expired++;
-                    }
-                }
-                else
-                {
-                    /* Failed to Retrieve Bundle from Storage */
-                    *flags |= BP_FLAG_STORE_FAILURE;
-                    ch->stats.lost++;
-                }
-
-                /* Check Success of Retrieving Valid Timed Out Bundle */
-                if(object)
-                {
-                    /* Bundle is a Retransmission */
-                    resend = true;
-
-                    /* Handle Active Table and Custody ID */
-                    if(ch->bundle.attributes.cid_reuse)
-                    {
-                        /* Set flag to reuse custody id and active table entry,
-                        * active table entry is not cleared, since CID is being reused */
-                        newcid = false;
-                    }
-                    else
-                    {
-                        /* Clear Entry (it will be reinserted below at the current CID) */
-                        ch->active_table.remove(ch->active_table.table, active_bundle.cid, NULL);
-
-                        /* Move to Next Oldest */
-                        ch->active_table.next(ch->active_table.table, NULL);
-                    }
-                }
-                else
-                {
-                    /* Clear Entry in Active Table and Storage */
-                    ch->active_table.remove(ch->active_table.table, active_bundle.cid, NULL);
-                    ch->store.release(ch->bundle_handle, active_bundle.sid);
-                    ch->store.relinquish(ch->bundle_handle, active_bundle.sid);
-                }
+                /* Retrieve Timed Out Bundle (loop again if not retransmitted) */
+                resend = retrieve_active(ch, &active_bundle, &object, &data, sysnow, &newcid, flags);
             }
             else /* oldest active bundle still active */
             {
+                /* Retrieve Bundle Reported Missing (ahead of its timeout) */
+                if(retrieve_missing(ch, &active_bundle, &object, &data, sysnow, &newcid, flags))
+                {
+                    resend = true;
+                    break;
+                }
+
                 /* Check Active Table Has Room
                     * Since next step is to dequeue from store, need to make sure that there is room
                     * in the active table since we don't want to dequeue a bundle from store and have
@@ -840,21 +2479,44 @@ int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t*
             }
         }
     }
+    BP_TRACE_END(trace_active, BP_TRACE_LOAD_ACTIVE, ch, resend ? active_bundle.cid : BP_TRACE_NO_CID, 0, status);
     bplib_os_unlock(ch->active_table_signal);
 
     /*------------------------------------------------*/
     /* Try to Send Stored Bundle (if nothing to send) */
     /*------------------------------------------------*/
+    if(object == NULL && status == BP_SUCCESS && ch->bundle.attributes.max_load_length > 0)
+    {
+        /* Store Fragments Left to Store of a Bundle */
+        resume_fragments(ch, flags);
+    }
+    bool waited = (timeout == BP_CHECK);
     while(object == NULL && status == BP_SUCCESS)
     {
         /* Dequeue Bundle from Storage Service */
-        int deq_status = ch->store.dequeue(ch->bundle_handle, &object, timeout);
-        if(deq_status == BP_SUCCESS)
+        BP_TRACE_BEGIN(trace_dequeue);
+        int deq_status = ch->store.dequeue(ch->bundle_handle, &object, BP_CHECK);
+        BP_TRACE_END(trace_dequeue, BP_TRACE_LOAD_DEQUEUE, ch, BP_TRACE_NO_CID, (deq_status == BP_SUCCESS) ? object->header.size : 0, deq_status);
+        if(deq_status == BP_TIMEOUT && !waited)
         {
-            bp_bundle_data_t* data = (bp_bundle_data_t*)object->data;
-
+            /* Wait for Bundle or DACS to be Stored (and loop again) */
+            BP_TRACE_BEGIN(trace_wait);
+            wait_ready(ch, ready_count, timeout);
+            BP_TRACE_END(trace_wait, BP_TRACE_LOAD_WAIT, ch, BP_TRACE_NO_CID, 0, BP_SUCCESS);
+            waited = true;
+
+            /* Send DACS Stored while Waiting */
+            isdacs = dequeue_dacs(ch, &object, &data, flags);
+        }
+        else if(deq_status == BP_SUCCESS)
+        {
+            /* Read Storage Record (loop again if record migrated or dropped) */
+            if(read_bundle(ch, ch->bundle_handle, object, &data, flags) != BP_SUCCESS)
+            {
+                object = NULL;
+            }
             /* Check Expiration Time */
-            if(data->exprtime != 0 && sysnow >= data->exprtime)
+            else if(data.exprtime != 0 && sysnow >= data.exprtime)
             {
                 /* Bundle Expired Clear Entry (and loop again) */
                 ch->store.release(ch->bundle_handle, object->header.sid);
@@ -862,6 +2524,15 @@ int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t*
                 ch->stats.expired++;
                 object = NULL;
             }
+            else if(ch->bundle.attributes.max_load_length > 0 && data.bundlesize > ch->bundle.attributes.max_load_length)
+            {
+                /* Fragment Bundle to Load Length (and loop again),
+                 * otherwise the bundle is loaded as is */
+                if(store_fragments(ch, object, &data, flags))
+                {
+                    object = NULL;
+                }
+            }
         }
         else if(deq_status == BP_TIMEOUT)
         {
@@ -880,22 +2551,30 @@ int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t*
     /*------------------------------*/
     if(object != NULL)
     {
-        bp_bundle_data_t* data = (bp_bundle_data_t*)object->data;
-
         /* Check Custody Transfer */
-        if(data->cteboffset != 0)
+        if(data.cteboffset != 0)
         {
+            /* Stamp Newly Dequeued Bundle for Journal (retransmissions keep their stamp) */
+            if(!resend && ch->journal_handle != BP_INVALID_HANDLE)
+            {
+                v6_stamp_bundle(&data, &active_bundle.stamp, flags);
+            }
+
             /* Save/Update Storage ID */
             active_bundle.sid = object->header.sid;
 
             /* Update Retransmit Time */
-            active_bundle.retx = sysnow;
+            active_bundle.retx = mononow;
 
             /* Save Bundle as Active */
             bplib_os_lock(ch->active_table_signal);
             {
-                /* Assign New Custody ID */
-                if(newcid) active_bundle.cid = ch->current_active_cid++;
+                /* Assign New Custody ID (reserved by the journal, or assigned anyway if checkpoints fail) */
+                if(newcid)
+                {
+                    reserve_custody_ids(ch, flags);
+                    active_bundle.cid = ch->current_active_cid++;
+                }
 
                 /* Update Active Table */
                 status = ch->active_table.add(ch->active_table.table, active_bundle, !newcid);
@@ -904,12 +2583,12 @@ int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t*
             bplib_os_unlock(ch->active_table_signal);
 
             /* Jam Custody ID */
-            v6_update_bundle(data, active_bundle.cid, flags);
+            v6_update_bundle(&data, active_bundle.cid, flags);
         }
 
         /* Load Bundle */
-        *bundle = data->header;
-        if(size) *size = data->bundlesize;
+        *bundle = data.header;
+        if(size) *size = data.bundlesize;
 
         /* Update Statistics and Flags */
         if(isdacs)
@@ -927,6 +2606,8 @@ int bplib_load(bp_desc_t* desc, void** bundle, int* size, int timeout, uint32_t*
         }
     }
 
+    BP_TRACE_END(trace_start, BP_TRACE_LOAD, ch, (object != NULL && data.cteboffset != 0) ? active_bundle.cid : BP_TRACE_NO_CID, (object != NULL) ? data.bundlesize : 0, status);
+
     /* Return Status */
     return status;
 }
@@ -950,7 +2631,9 @@ int bplib_process(bp_desc_t* desc, void* bundle, int size, int timeout, uint32_t
     /* Receive Bundle */
     bp_payload_t payload;
     bool custody_transfer = false;
+    BP_TRACE_BEGIN(trace_start);
     status = v6_receive_bundle(&ch->bundle, bundle, size, &payload, flags);
+    BP_TRACE_END(trace_start, BP_TRACE_PROCESS_DECODE, ch, BP_TRACE_NO_CID, size, status);
     if(status == BP_PENDING_EXPIRATION)
     {
         ch->stats.expired++;
@@ -960,42 +2643,68 @@ int bplib_process(bp_desc_t* desc, void* bundle, int size, int timeout, uint32_t
         /* Increment Statistics */
         ch->stats.received_dacs++;
 
-        /* Process Aggregate Custody Signal (DACS) */
-        bplib_os_lock(ch->active_table_signal);
+        /* Process Aggregate Custody Signal (DACS),
+         * active table is locked per batch of acknowledged custody IDs
+         * and per range of custody IDs reported missing */
+        int num_acks = 0;
+        BP_TRACE_BEGIN(trace_ack);
+        int bytes_read = v6_receive_acknowledgment(payload.memptr, payload.data.payloadsize, &num_acks, ch->bundle.attributes.fast_retransmit, delete_bundle, missing_bundle, ch, flags);
+        BP_TRACE_END(trace_ack, BP_TRACE_PROCESS_ACKNOWLEDGE, ch, BP_TRACE_NO_CID, num_acks, bytes_read > 0 ? BP_SUCCESS : bytes_read);
+        ch->stats.acknowledged_bundles += num_acks;
+
+        /* Set Status */
+        if(bytes_read > 0)
         {
-            int num_acks = 0;
-            int bytes_read = v6_receive_acknowledgment(payload.memptr, payload.data.payloadsize, &num_acks, delete_bundle, ch, flags);
-            ch->stats.acknowledged_bundles += num_acks;
-
-            /* Set Status */
-            if(bytes_read > 0)
-            {
-                bplib_os_signal(ch->active_table_signal);
-                status = BP_SUCCESS;
-            }
-            else
-            {
-                /* Error Code */
-                status = bytes_read;
-            }
+            status = BP_SUCCESS;
+        }
+        else
+        {
+            /* Error Code */
+            status = bytes_read;
         }
-        bplib_os_unlock(ch->active_table_signal);
     }
     else if(status == BP_PENDING_ACCEPTANCE)
     {
         /* Increment Statistics */
         ch->stats.received_bundles++;
 
-        /* Store Payload */
-        status = ch->store.enqueue(ch->payload_handle, &payload.data, sizeof(bp_payload_data_t), payload.memptr, payload.data.payloadsize, timeout);
-        if(status == BP_SUCCESS && payload.node != BP_IPN_NULL)
+        /* Check for Partial Payload */
+        bool partial = payload.is_frag && (payload.fragoffset != 0 || payload.paylen != (bp_val_t)payload.data.payloadsize);
+        bool reassemble = partial && ch->reassembly.max_memory > 0;
+        dedup_key_t dupkey = { payload.srcnode, payload.srcserv, payload.createsec, payload.createseq, reassemble ? 0 : payload.fragoffset };
+        if(received_before(ch, dupkey, flags))
         {
-            custody_transfer = true;
+            /* Drop Duplicate - custody is still acknowledged so the sender stops retransmitting it */
+            *flags |= BP_FLAG_DUPLICATES;
+            status = BP_SUCCESS;
+            if(payload.node != BP_IPN_NULL)
+            {
+                custody_transfer = true;
+            }
         }
-        else if(status != BP_SUCCESS)
+        else if(reassemble)
         {
-            *flags |= BP_FLAG_STORE_FAILURE;
-            ch->stats.lost++;
+            /* Reassemble Payload */
+            status = reassemble_payload(ch, &payload, timeout, flags);
+            if(status == BP_SUCCESS && payload.node != BP_IPN_NULL)
+            {
+                custody_transfer = true;
+            }
+        }
+        else
+        {
+            /* Store Payload */
+            status = enqueue_payload(ch, &payload.data, payload.memptr, timeout, flags);
+            if(status == BP_SUCCESS)
+            {
+                remember_received(ch, dupkey, payload.data.exprtime);
+                if(payload.node != BP_IPN_NULL) custody_transfer = true;
+            }
+            else
+            {
+                *flags |= BP_FLAG_STORE_FAILURE;
+                ch->stats.lost++;
+            }
         }
     }
     else if(status == BP_PENDING_FORWARD)
@@ -1029,71 +2738,146 @@ int bplib_process(bp_desc_t* desc, void* bundle, int size, int timeout, uint32_t
     /* Acknowledge Custody Transfer - Update DACS */
     if(custody_transfer)
     {
+        BP_TRACE_BEGIN(trace_custody);
+
         /* Get Time */
-        unsigned long sysnow = 0;
-        if(bplib_os_systime(&sysnow) == BP_ERROR)
-        {
-            *flags |= BP_FLAG_UNRELIABLE_TIME;
-        }
+        unsigned long mononow = 0;
+        bplib_os_monotime(&mononow);
 
         /* Take Custody */
-        bplib_os_lock(ch->custody_tree_lock);
+        bool inserted = false;
+        bool pending = false;
+        while(!inserted)
         {
-            if(ch->dacs.route.destination_node == payload.node && ch->dacs.route.destination_service == payload.service)
+            bool flush = false;
+            bp_custody_shard_t* shard = acquire_shard(ch);
             {
-                /* Insert Custody ID directly into current custody_tree */
-                int insert_status = rb_tree_insert(payload.cid, &ch->custody_tree);
-                if(insert_status == BP_FULL)
+                /* Insert Custody ID into Shard if Destined for Same DACS */
+                bool empty = ch->custody_tree.is_empty(shard->tree);
+                if(empty || (shard->node == payload.node && shard->service == payload.service))
                 {
-                    /* Flag Full Tree - possibly the custody_tree size is configured to be too small */
-                    *flags |= BP_FLAG_CUSTODY_FULL;
-
-                    /* Store Custody Signal */
-                    create_dacs(ch, sysnow, BP_CHECK, flags);
+                    shard->node = payload.node;
+                    shard->service = payload.service;
 
-                    /* Start New DACS */
-                    insert_status = rb_tree_insert(payload.cid, &ch->custody_tree);
+                    int insert_status = ch->custody_tree.insert(payload.cid, shard->tree);
+                    if(insert_status == BP_SUCCESS)
+                    {
+                        if(empty) shard->oldest = mononow;
+                        pending = empty;
+                        shard->cids++;
+                        inserted = true;
+
+                        /* Acknowledge Early if a Full DACS is Pending or Sender's Table is Filling */
+                        if(ch->dacs_policy == BP_DACS_ADAPTIVE)
+                        {
+                            flush = (ch->custody_tree.get_size(shard->tree) >= ch->dacs_max_ranges) ||
+                                    (ch->dacs_max_cids > 0 && shard->cids >= ch->dacs_max_cids);
+                        }
+                    }
+                    else if(insert_status == BP_DUPLICATE)
+                    {
+                        /* Duplicate values are fine and are treated as a success */
+                        *flags |= BP_FLAG_DUPLICATES;
+                        inserted = true;
+                    }
+                    else if(insert_status == BP_FULL)
+                    {
+                        /* Flag Full Tree - possibly the custody_tree size is configured to be too small */
+                        *flags |= BP_FLAG_CUSTODY_FULL;
 
-                    /* There is no valid reason for an insert to fail on an empty custody_tree */
-                    assert(insert_status == BP_SUCCESS);
-                }
-                else if(insert_status == BP_DUPLICATE)
-                {
-                    /* Duplicate values are fine and are treated as a success */
-                    *flags |= BP_FLAG_DUPLICATES;
+                        /* There is no valid reason for an insert to fail on an empty custody_tree */
+                        assert(!empty);
+                        flush = true;
+                    }
+                    else
+                    {
+                        /* Tree error unexpected */
+                        assert(false);
+                        inserted = true;
+                    }
                 }
-                else if(insert_status != BP_SUCCESS)
+                else
                 {
-                    /* Tree error unexpected */
-                    assert(false);
+                    /* Previous Destination */
+                    flush = true;
                 }
             }
-            else
+            bplib_os_unlock(shard->lock);
+
+            /* Store DACS Bundle */
+            if(flush)
             {
-                /* Store DACS Bundle */
-                if(!rb_tree_is_empty(&ch->custody_tree))
-                {
-                    create_dacs(ch, sysnow, BP_CHECK, flags);
-                }
+                flush_shard(ch, shard, mononow, 0, flags);
+            }
+        }
+
+        /* Wake Custody Worker to Schedule Newly Pending Custody IDs */
+        if(pending)
+        {
+            bplib_os_lock(ch->custody_signal);
+            bplib_os_signal(ch->custody_signal);
+            bplib_os_unlock(ch->custody_signal);
+        }
+
+        BP_TRACE_END(trace_custody, BP_TRACE_PROCESS_CUSTODY, ch, payload.cid, size, BP_SUCCESS);
+    }
+
+    BP_TRACE_END(trace_start, BP_TRACE_PROCESS, ch, custody_transfer ? payload.cid : BP_TRACE_NO_CID, size, status);
+
+    /* Return Status */
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_custody -
+ *
+ *  Generates and stores the custody signals that are due, independent of bplib_load.
+ *  If none are due, waits up to timeout milliseconds (or until the next is due, if
+ *  sooner) and tries again.  Storing a custody signal wakes any thread waiting in
+ *  bplib_load so that the signal can be sent without waiting on the load timeout.
+ *
+ *  Returns success if one or more custody signals were stored, timeout otherwise
+ *-------------------------------------------------------------------------------------*/
+int bplib_custody(bp_desc_t* desc, int timeout, uint32_t* flags)
+{
+    int num_stored = 0;
+
+    /* Check Parameters */
+    if(desc == NULL)                return BP_ERROR;
+    else if(desc->channel == NULL)  return BP_ERROR;
+    else if(flags == NULL)          return BP_ERROR;
 
-                /* Initial New DACS Bundle */
-                ch->dacs.route.destination_node = payload.node;
-                ch->dacs.route.destination_service = payload.service;
-                ch->dacs.prebuilt = false;
+    /* Get Channel */
+    bp_channel_t* ch = (bp_channel_t*)desc->channel;
 
-                /* Start New DACS */
-                int insert_status = rb_tree_insert(payload.cid, &ch->custody_tree);
+    bplib_os_lock(ch->custody_signal);
+    {
+        /* Get Current Time */
+        unsigned long mononow = 0;
+        bplib_os_monotime(&mononow);
 
-                /* There is no valid reason for an insert to fail on an empty custody_tree */
-                assert(insert_status == BP_SUCCESS);
-                (void)insert_status; /* when asserts compiled out, insert_status becomes unused */
+        /* Store Custody Signals that are Due */
+        num_stored = send_due_dacs(ch, mononow, flags);
+        if(num_stored == 0 && timeout != BP_CHECK)
+        {
+            /* Wait until Next Due (or Custody IDs Become Pending) */
+            int wait_ms = timeout;
+            long next_due = dacs_next_due(ch, mononow);
+            if(next_due >= 0)
+            {
+                int due_ms = (next_due > 0) ? (int)(next_due * 1000) : 1000; /* time only resolves to seconds */
+                if(timeout == BP_PEND || due_ms < timeout) wait_ms = due_ms;
             }
+            bplib_os_waiton(ch->custody_signal, wait_ms);
+
+            /* Store Custody Signals that Became Due */
+            bplib_os_monotime(&mononow);
+            num_stored = send_due_dacs(ch, mononow, flags);
         }
-        bplib_os_unlock(ch->custody_tree_lock);
     }
+    bplib_os_unlock(ch->custody_signal);
 
-    /* Return Status */
-    return status;
+    return (num_stored > 0) ? BP_SUCCESS : BP_TIMEOUT;
 }
 
 /*--------------------------------------------------------------------------------------
@@ -1114,6 +2898,7 @@ int bplib_accept(bp_desc_t* desc, void** payload, int* size, int timeout, uint32
 
     /* Get Channel */
     bp_channel_t* ch = (bp_channel_t*)desc->channel;
+    BP_TRACE_BEGIN(trace_start);
 
     while(object == NULL && status == BP_SUCCESS)
     {
@@ -1121,7 +2906,36 @@ int bplib_accept(bp_desc_t* desc, void** payload, int* size, int timeout, uint32
         status = ch->store.dequeue(ch->payload_handle, &object, timeout);
         if(status == BP_SUCCESS)
         {
-            bp_payload_data_t* data = (bp_payload_data_t*)object->data;
+            bp_payload_data_t data;
+            uint8_t* record_payload = NULL;
+
+            /* Read Storage Record */
+            int rec_status = record_payload_read(object, &data, &record_payload, flags);
+            if(rec_status == BP_PENDING_MIGRATION)
+            {
+                /* Re-store Legacy Record in Current Format (and loop again) */
+                if(enqueue_payload(ch, &data, record_payload, BP_CHECK, flags) == BP_SUCCESS)
+                {
+                    ch->store.release(ch->payload_handle, object->header.sid);
+                    ch->store.relinquish(ch->payload_handle, object->header.sid);
+                }
+                else
+                {
+                    bplog(flags, BP_FLAG_STORE_FAILURE, "Failed to migrate legacy payload record\n");
+                    ch->store.release(ch->payload_handle, object->header.sid);
+                }
+                object = NULL;
+                continue;
+            }
+            else if(rec_status != BP_SUCCESS)
+            {
+                /* Drop Unreadable Record (and loop again) */
+                ch->store.release(ch->payload_handle, object->header.sid);
+                ch->store.relinquish(ch->payload_handle, object->header.sid);
+                ch->stats.lost++;
+                object = NULL;
+                continue;
+            }
 
             /* Get Current Time */
             unsigned long sysnow = 0;
@@ -1132,7 +2946,7 @@ int bplib_accept(bp_desc_t* desc, void** payload, int* size, int timeout, uint32
             }
 
             /* Check Expiration Time */
-            if(data->exprtime != 0 && data->exprtime <= sysnow)
+            if(data.exprtime != 0 && data.exprtime <= sysnow)
             {
                 ch->store.release(ch->payload_handle, object->header.sid);
                 ch->store.relinquish(ch->payload_handle, object->header.sid);
@@ -1142,11 +2956,11 @@ int bplib_accept(bp_desc_t* desc, void** payload, int* size, int timeout, uint32
             else
             {
                 /* Return Payload to Application */
-                *payload = (void*)((uint8_t*)data + sizeof(bp_payload_data_t));
-                if(size) *size = data->payloadsize;
+                *payload = (void*)record_payload;
+                if(size) *size = data.payloadsize;
 
                 /* Check for Application Acknowledgement Request */
-                if(data->ackapp) status = BP_PENDING_APPLICATION;
+                if(data.ackapp) status = BP_PENDING_APPLICATION;
 
                 /* Count as Delivered */
                 ch->stats.delivered_payloads++;
@@ -1159,6 +2973,8 @@ int bplib_accept(bp_desc_t* desc, void** payload, int* size, int timeout, uint32
         }
     }
 
+    BP_TRACE_END(trace_start, BP_TRACE_ACCEPT, ch, BP_TRACE_NO_CID, (object != NULL && size != NULL) ? *size : 0, status);
+
     /* Return Status */
     return status;
 }
@@ -1177,14 +2993,16 @@ int bplib_ackbundle(bp_desc_t* desc, void* bundle)
 
     /* Determine Storage Object Pointer */
     bp_channel_t* ch = (bp_channel_t*)desc->channel;
-    bp_bundle_data_t* data = (bp_bundle_data_t*)((uint8_t*)bundle - offsetof(bp_bundle_data_t, header));
-    bp_object_t* object = (bp_object_t*)((uint8_t*)data - sizeof(bp_object_hdr_t));
+    bp_object_t* object = record_object(bundle);
+    bp_bundle_data_t data;
+    uint32_t flags = 0;
+    if(record_bundle_read(object, &data, &flags) != BP_SUCCESS) return BP_ERROR;
 
     /* Release Memory */
     ch->store.release(object->header.handle, object->header.sid);
 
     /* Free Memory - only when no custody transfer is requested */
-    if(data->cteboffset == 0) ch->store.relinquish(object->header.handle, object->header.sid);
+    if(data.cteboffset == 0) ch->store.relinquish(object->header.handle, object->header.sid);
 
     /* Return Status */
     return status;
@@ -1204,8 +3022,7 @@ int bplib_ackpayload(bp_desc_t* desc, void* payload)
 
     /* Determine Storage Object Pointer */
     bp_channel_t* ch = (bp_channel_t*)desc->channel;
-    bp_payload_data_t* data = (bp_payload_data_t*)((uint8_t*)payload - sizeof(bp_payload_data_t));
-    bp_object_t* object = (bp_object_t*)((uint8_t*)data - sizeof(bp_object_hdr_t));
+    bp_object_t* object = record_object(payload);
 
     /* Release Memory */
     ch->store.release(object->header.handle, object->header.sid);
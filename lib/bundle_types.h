@@ -23,12 +23,14 @@
  ******************************************************************************/
 
 #include "bplib.h"
+#include "rb_tree.h"
 
 /******************************************************************************
  DEFINES
  ******************************************************************************/
 
 #define BP_BUNDLE_HDR_BUF_SIZE          128
+#define BP_RECORD_PREFIX_BUF_SIZE       96  /* room reserved ahead of a header for its storage record prefix */
 
 #define BP_DUPLICATE                    (-100)
 #define BP_FULL                         (-101)
@@ -37,6 +39,7 @@
 #define BP_PENDING_ACCEPTANCE           (-104)
 #define BP_PENDING_APPLICATION          (-105)
 #define BP_PENDING_EXPIRATION           (-106)
+#define BP_PENDING_MIGRATION            (-107)
 
 /******************************************************************************
  TYPEDEFS
@@ -44,7 +47,29 @@
 
 /* Call-Backs */
 typedef int (*bp_create_func_t) (void* parm, bool is_record, uint8_t* payload, int size, int timeout);
-typedef int (*bp_delete_func_t) (void* parm, bp_val_t cid, uint32_t* flags);
+typedef int (*bp_delete_func_t) (void* parm, bp_val_t cid, bp_val_t count, int* num_deleted, uint32_t* flags);
+typedef int (*bp_missing_func_t) (void* parm, bp_val_t cid, bp_val_t count, uint32_t* flags);
+
+/* Custody Tree Functions */
+typedef int  (*bp_tree_create_t)        (bp_val_t max_size, void* tree);
+typedef int  (*bp_tree_destroy_t)       (void* tree);
+typedef int  (*bp_tree_insert_t)        (bp_val_t value, void* tree);
+typedef bool (*bp_tree_is_empty_t)      (void* tree);
+typedef bp_val_t (*bp_tree_get_size_t)  (void* tree);
+typedef int  (*bp_tree_goto_first_t)    (void* tree);
+typedef int  (*bp_tree_get_next_t)      (void* tree, rb_range_t* range, bool should_pop, bool should_rebalance);
+
+/* Custody Tree - ranges of custody IDs to acknowledge */
+typedef struct {
+    void*                   tree;
+    bp_tree_create_t        create;
+    bp_tree_destroy_t       destroy;
+    bp_tree_insert_t        insert;
+    bp_tree_is_empty_t      is_empty;
+    bp_tree_get_size_t      get_size;
+    bp_tree_goto_first_t    goto_first;
+    bp_tree_get_next_t      get_next;
+} bp_custody_tree_t;
 
 /* Bundle Field (fixed size) */
 typedef struct {
@@ -56,10 +81,37 @@ typedef struct {
 /* Active Bundle */
 typedef struct {
     bp_sid_t            sid;            /* storage id */
-    bp_val_t            retx;           /* retransmit time */
+    bp_val_t            retx;           /* retransmit time (monotonic) */
     bp_val_t            cid;            /* custody id */
+    bp_val_t            stamp;          /* creation stamp of stored bundle, journaled to check its storage id on recovery */
 } bp_active_bundle_t;
 
+/* Table Functions */
+typedef int (*bp_table_create_t)    (void** table, int size);
+typedef int (*bp_table_destroy_t)   (void* table);
+typedef int (*bp_table_add_t)       (void* table, bp_active_bundle_t bundle, bool overwrite);
+typedef int (*bp_table_next_t)      (void* table, bp_active_bundle_t* bundle);
+typedef int (*bp_table_remove_t)    (void* table, bp_val_t cid, bp_active_bundle_t* bundle);
+typedef int (*bp_table_remove_range_t) (void* table, bp_val_t cid, int count, bp_sid_t* sids);
+typedef int (*bp_table_available_t) (void* table, bp_val_t cid);
+typedef int (*bp_table_count_t)     (void* table);
+typedef int (*bp_table_visit_t)     (void* parm, bp_active_bundle_t* bundle);
+typedef int (*bp_table_walk_t)      (void* table, bp_table_visit_t visit, void* parm);
+
+/* Active Table - unacknowledged bundles by custody ID */
+typedef struct {
+    void*                   table;
+    bp_table_create_t       create;
+    bp_table_destroy_t      destroy;
+    bp_table_add_t          add;
+    bp_table_next_t         next;
+    bp_table_remove_t       remove;
+    bp_table_remove_range_t remove_range;
+    bp_table_available_t    available;
+    bp_table_count_t        count;
+    bp_table_walk_t         walk;
+} bp_active_table_t;
+
 /* Payload Data */
 typedef struct {
     bp_val_t            exprtime;       /* absolute time when payload expires */
@@ -74,6 +126,13 @@ typedef struct {
     bp_ipn_t            service;        /* custody service of payload */
     bp_payload_data_t   data;           /* serialized and stored payload data */
     uint8_t*            memptr;         /* pointer to payload */
+    bool                is_frag;        /* payload is a fragment of the original payload */
+    bp_val_t            fragoffset;     /* offset of fragment into original payload */
+    bp_val_t            paylen;         /* total length of original payload */
+    bp_ipn_t            srcnode;        /* source node of original bundle */
+    bp_ipn_t            srcserv;        /* source service of original bundle */
+    bp_val_t            createsec;      /* creation time of original bundle */
+    bp_val_t            createseq;      /* creation sequence of original bundle */
 } bp_payload_t;
 
 /* Bundle Data */
@@ -85,14 +144,18 @@ typedef struct {
     int                 payoffset;      /* offset of the payload block of bundle */
     int                 headersize;     /* size of the header (portion of buffer below used) */
     int                 bundlesize;     /* total size of the bundle (header and payload) */
-    uint8_t             header[BP_BUNDLE_HDR_BUF_SIZE]; /* header portion of bundle */
+    uint8_t*            header;         /* header portion of bundle, followed by payload when stored */
 } bp_bundle_data_t;
 
 /* Bundle Structure */
 typedef struct {
     bp_route_t          route;          /* addressing information */
     bp_attr_t           attributes;     /* bundle attributes */
-    bp_bundle_data_t    data;           /* serialized and stored bundle data */
+    bp_bundle_data_t    data;           /* serialized and stored bundle data, header points to inline or extended buffer */
+    int                 hdrbufsize;     /* size of the header buffer of data */
+    uint8_t             hdrbuf[BP_RECORD_PREFIX_BUF_SIZE + BP_BUNDLE_HDR_BUF_SIZE]; /* inline record prefix and header buffer */
+    uint8_t*            ext_hdrbuf;     /* record prefix and header buffer allocated for larger headers */
+    int                 ext_hdrbufsize; /* size of the header portion of ext_hdrbuf */
     bool                prebuilt;       /* does pre-built bundle header need initialization */
     void*               blocks;         /* populated in initialization function */
 } bp_bundle_t;
@@ -0,0 +1,407 @@
+/************************************************************************
+ * File: record.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "record.h"
+#include "sdnv.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define RECORD_NUM_BUNDLE_FIELDS    9
+#define RECORD_NUM_PAYLOAD_FIELDS   3
+#define RECORD_NUM_JOURNAL_FIELDS   5
+#define RECORD_NUM_ACTIVE_FIELDS    4
+#define RECORD_NUM_CUSTODY_FIELDS   4
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Legacy Bundle Record - native structure stored ahead of header by earlier versions */
+typedef struct {
+    bp_val_t            exprtime;
+    bp_field_t          cidfield;
+    int                 cteboffset;
+    int                 biboffset;
+    int                 payoffset;
+    int                 headersize;
+    int                 bundlesize;
+    uint8_t             header[BP_BUNDLE_HDR_BUF_SIZE];
+} record_legacy_bundle_t;
+
+/* Legacy Payload Record - native structure stored ahead of payload by earlier versions */
+typedef struct {
+    bp_val_t            exprtime;
+    bool                ackapp;
+    int                 payloadsize;
+} record_legacy_payload_t;
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * write_prefix -
+ *
+ *  Encodes the record type followed by the field values and the prefix length,
+ *  and places the prefix at the end of the buffer
+ *
+ *  Returns:    size of prefix, or error code
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int write_prefix(uint8_t type, bp_val_t* values, int num_values, uint8_t* buffer, int size, uint32_t* flags)
+{
+    uint8_t prefix[BP_RECORD_PREFIX_BUF_SIZE];
+    uint32_t sdnvflags = 0;
+    bp_field_t field = { 0, 1, 0 };
+    int i;
+
+    /* Encode Prefix */
+    prefix[0] = type;
+    for(i = 0; i < num_values; i++)
+    {
+        field.value = values[i];
+        field.index = sdnv_write(prefix, BP_RECORD_PREFIX_BUF_SIZE - 1, field, &sdnvflags);
+    }
+
+    /* Check Encoding */
+    int prefix_size = field.index + 1;
+    if(sdnvflags != 0 || prefix_size > size)
+    {
+        *flags |= sdnvflags;
+        return bplog(flags, BP_FLAG_STORE_FAILURE, "Failed to encode storage record prefix (%08X)\n", sdnvflags);
+    }
+    prefix[field.index] = (uint8_t)prefix_size;
+
+    /* Place Prefix Immediately Ahead of End of Buffer */
+    memcpy(&buffer[size - prefix_size], prefix, prefix_size);
+    return prefix_size;
+}
+
+/*--------------------------------------------------------------------------------------
+ * read_prefix -
+ *
+ *  Returns:    size of prefix, or error code
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int read_prefix(uint8_t type, bp_object_t* object, bp_val_t* values, int num_values)
+{
+    uint8_t* rec = (uint8_t*)object->data;
+    int size = object->header.size;
+    uint32_t sdnvflags = 0;
+    bp_field_t field = { 0, 1, 0 };
+    int i;
+
+    /* Check Type */
+    if(size < 2 || rec[0] != type) return BP_ERROR;
+
+    /* Decode Fields */
+    for(i = 0; i < num_values; i++)
+    {
+        field.index = sdnv_read(rec, size, &field, &sdnvflags);
+        values[i] = field.value;
+    }
+
+    /* Check Prefix */
+    int prefix_size = field.index + 1;
+    if(sdnvflags != 0 || prefix_size > size || prefix_size > BP_RECORD_PREFIX_BUF_SIZE) return BP_ERROR;
+    else if(rec[field.index] != prefix_size) return BP_ERROR;
+
+    return prefix_size;
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * record_bundle_write -
+ *
+ *  data - bundle data to store [INPUT]
+ *  buffer - memory immediately preceding the header of the bundle [OUTPUT]
+ *  size - size of buffer [INPUT]
+ *
+ *  Returns:    size of record prefix written to the end of the buffer, or error code
+ *-------------------------------------------------------------------------------------*/
+int record_bundle_write(bp_bundle_data_t* data, uint8_t* buffer, int size, uint32_t* flags)
+{
+    bp_val_t values[RECORD_NUM_BUNDLE_FIELDS] = {
+        data->exprtime,
+        data->cidfield.value,
+        (bp_val_t)data->cidfield.index,
+        (bp_val_t)data->cidfield.width,
+        (bp_val_t)data->cteboffset,
+        (bp_val_t)data->biboffset,
+        (bp_val_t)data->payoffset,
+        (bp_val_t)data->headersize,
+        (bp_val_t)data->bundlesize
+    };
+
+    return write_prefix(BP_RECORD_BUNDLE_V1, values, RECORD_NUM_BUNDLE_FIELDS, buffer, size, flags);
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_bundle_read -
+ *
+ *  object - storage object holding a bundle record [INPUT]
+ *  data - populated with bundle data, header points into the object [OUTPUT]
+ *
+ *  Returns:    BP_SUCCESS, BP_PENDING_MIGRATION if the record uses the legacy format,
+ *              or error code
+ *-------------------------------------------------------------------------------------*/
+int record_bundle_read(bp_object_t* object, bp_bundle_data_t* data, uint32_t* flags)
+{
+    bp_val_t values[RECORD_NUM_BUNDLE_FIELDS];
+    int size = object->header.size;
+
+    /* Current Format */
+    int prefix_size = read_prefix(BP_RECORD_BUNDLE_V1, object, values, RECORD_NUM_BUNDLE_FIELDS);
+    if(prefix_size > 0)
+    {
+        data->exprtime          = values[0];
+        data->cidfield.value    = values[1];
+        data->cidfield.index    = (int)values[2];
+        data->cidfield.width    = (int)values[3];
+        data->cteboffset        = (int)values[4];
+        data->biboffset         = (int)values[5];
+        data->payoffset         = (int)values[6];
+        data->headersize        = (int)values[7];
+        data->bundlesize        = (int)values[8];
+        data->header            = (uint8_t*)&object->data[prefix_size];
+
+        if(values[8] == (bp_val_t)(size - prefix_size) && values[7] <= values[8] &&
+           values[4] < values[7] && values[5] < values[7] && values[6] < values[7])
+        {
+            return BP_SUCCESS;
+        }
+    }
+
+    /* Legacy Format */
+    record_legacy_bundle_t* legacy = (record_legacy_bundle_t*)object->data;
+    if(size >= (int)offsetof(record_legacy_bundle_t, header) &&
+       legacy->bundlesize == size - (int)offsetof(record_legacy_bundle_t, header) &&
+       legacy->headersize > 0 && legacy->headersize <= legacy->bundlesize &&
+       legacy->headersize <= BP_BUNDLE_HDR_BUF_SIZE &&
+       legacy->payoffset >= 0 && legacy->payoffset < legacy->headersize &&
+       legacy->cteboffset >= 0 && legacy->cteboffset < legacy->headersize &&
+       legacy->biboffset >= 0 && legacy->biboffset < legacy->headersize)
+    {
+        data->exprtime          = legacy->exprtime;
+        data->cidfield          = legacy->cidfield;
+        data->cteboffset        = legacy->cteboffset;
+        data->biboffset         = legacy->biboffset;
+        data->payoffset         = legacy->payoffset;
+        data->headersize        = legacy->headersize;
+        data->bundlesize        = legacy->bundlesize;
+        data->header            = legacy->header;
+        return BP_PENDING_MIGRATION;
+    }
+
+    return bplog(flags, BP_FLAG_STORE_FAILURE, "Unrecognized bundle storage record of size %d\n", size);
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_payload_write -
+ *
+ *  data - payload data to store [INPUT]
+ *  buffer - memory to hold the record prefix [OUTPUT]
+ *  size - size of buffer [INPUT]
+ *
+ *  Returns:    size of record prefix written to the end of the buffer, or error code
+ *-------------------------------------------------------------------------------------*/
+int record_payload_write(bp_payload_data_t* data, uint8_t* buffer, int size, uint32_t* flags)
+{
+    bp_val_t values[RECORD_NUM_PAYLOAD_FIELDS] = {
+        data->exprtime,
+        (bp_val_t)data->ackapp,
+        (bp_val_t)data->payloadsize
+    };
+
+    return write_prefix(BP_RECORD_PAYLOAD_V1, values, RECORD_NUM_PAYLOAD_FIELDS, buffer, size, flags);
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_payload_read -
+ *
+ *  object - storage object holding a payload record [INPUT]
+ *  data - populated with payload data [OUTPUT]
+ *  payload - set to the payload inside the object [OUTPUT]
+ *
+ *  Returns:    BP_SUCCESS, BP_PENDING_MIGRATION if the record uses the legacy format,
+ *              or error code
+ *-------------------------------------------------------------------------------------*/
+int record_payload_read(bp_object_t* object, bp_payload_data_t* data, uint8_t** payload, uint32_t* flags)
+{
+    bp_val_t values[RECORD_NUM_PAYLOAD_FIELDS];
+    int size = object->header.size;
+
+    /* Current Format */
+    int prefix_size = read_prefix(BP_RECORD_PAYLOAD_V1, object, values, RECORD_NUM_PAYLOAD_FIELDS);
+    if(prefix_size > 0 && values[2] == (bp_val_t)(size - prefix_size) && values[1] <= 1)
+    {
+        data->exprtime      = values[0];
+        data->ackapp        = values[1] != 0;
+        data->payloadsize   = (int)values[2];
+        *payload            = (uint8_t*)&object->data[prefix_size];
+        return BP_SUCCESS;
+    }
+
+    /* Legacy Format */
+    record_legacy_payload_t* legacy = (record_legacy_payload_t*)object->data;
+    if(size >= (int)sizeof(record_legacy_payload_t) &&
+       legacy->payloadsize == size - (int)sizeof(record_legacy_payload_t))
+    {
+        data->exprtime      = legacy->exprtime;
+        data->ackapp        = legacy->ackapp;
+        data->payloadsize   = legacy->payloadsize;
+        *payload            = (uint8_t*)object->data + sizeof(record_legacy_payload_t);
+        return BP_PENDING_MIGRATION;
+    }
+
+    return bplog(flags, BP_FLAG_STORE_FAILURE, "Unrecognized payload storage record of size %d\n", size);
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_journal_write -
+ *
+ *  journal - journal record to store [INPUT]
+ *  buffer - memory to hold the record prefix [OUTPUT]
+ *  size - size of buffer [INPUT]
+ *
+ *  Returns:    size of record prefix written to the end of the buffer, or error code
+ *-------------------------------------------------------------------------------------*/
+int record_journal_write(bp_journal_t* journal, uint8_t* buffer, int size, uint32_t* flags)
+{
+    bp_val_t values[RECORD_NUM_JOURNAL_FIELDS] = {
+        journal->checkpoint,
+        journal->current_cid,
+        (bp_val_t)journal->last,
+        (bp_val_t)journal->num_entries,
+        (bp_val_t)journal->entries_size
+    };
+
+    return write_prefix(BP_RECORD_JOURNAL_V1, values, RECORD_NUM_JOURNAL_FIELDS, buffer, size, flags);
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_journal_read -
+ *
+ *  object - storage object holding a journal record [INPUT]
+ *  journal - populated with journal record [OUTPUT]
+ *
+ *  Returns:    offset of the first entry in the object, or error code
+ *-------------------------------------------------------------------------------------*/
+int record_journal_read(bp_object_t* object, bp_journal_t* journal, uint32_t* flags)
+{
+    bp_val_t values[RECORD_NUM_JOURNAL_FIELDS];
+    int size = object->header.size;
+
+    int prefix_size = read_prefix(BP_RECORD_JOURNAL_V1, object, values, RECORD_NUM_JOURNAL_FIELDS);
+    if(prefix_size > 0 && values[4] == (bp_val_t)(size - prefix_size) && values[2] <= 1 && values[3] <= values[4])
+    {
+        journal->checkpoint     = values[0];
+        journal->current_cid    = values[1];
+        journal->last           = values[2] != 0;
+        journal->num_entries    = (int)values[3];
+        journal->entries_size   = (int)values[4];
+        return prefix_size;
+    }
+
+    return bplog(flags, BP_FLAG_STORE_FAILURE, "Unrecognized journal storage record of size %d\n", size);
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_entry_write -
+ *
+ *  entry - journal entry to encode [INPUT]
+ *  buffer - memory holding the entries of a journal record [OUTPUT]
+ *  offset - offset into buffer to write entry [INPUT]
+ *  size - size of buffer [INPUT]
+ *
+ *  Returns:    offset following the entry, or BP_FULL if the entry does not fit
+ *-------------------------------------------------------------------------------------*/
+int record_entry_write(bp_journal_entry_t* entry, uint8_t* buffer, int offset, int size)
+{
+    int num_fields = (entry->type == BP_JOURNAL_ACTIVE) ? RECORD_NUM_ACTIVE_FIELDS : RECORD_NUM_CUSTODY_FIELDS;
+    uint32_t sdnvflags = 0;
+    bp_field_t field = { (bp_val_t)entry->type, offset, 0 };
+    int i;
+
+    field.index = sdnv_write(buffer, size, field, &sdnvflags);
+    for(i = 0; i < num_fields; i++)
+    {
+        field.value = entry->fields[i];
+        field.index = sdnv_write(buffer, size, field, &sdnvflags);
+    }
+
+    if(sdnvflags != 0) return BP_FULL;
+    return field.index;
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_entry_read -
+ *
+ *  object - storage object holding a journal record [INPUT]
+ *  offset - offset into the object of the entry [INPUT]
+ *  entry - populated with journal entry [OUTPUT]
+ *
+ *  Returns:    offset following the entry, or error code
+ *-------------------------------------------------------------------------------------*/
+int record_entry_read(bp_object_t* object, int offset, bp_journal_entry_t* entry)
+{
+    uint8_t* rec = (uint8_t*)object->data;
+    int size = object->header.size;
+    uint32_t sdnvflags = 0;
+    bp_field_t field = { 0, offset, 0 };
+    int num_fields;
+    int i;
+
+    /* Decode Type */
+    field.index = sdnv_read(rec, size, &field, &sdnvflags);
+    if(field.value == BP_JOURNAL_ACTIVE)        num_fields = RECORD_NUM_ACTIVE_FIELDS;
+    else if(field.value == BP_JOURNAL_CUSTODY)  num_fields = RECORD_NUM_CUSTODY_FIELDS;
+    else                                        return BP_ERROR;
+    entry->type = (int)field.value;
+
+    /* Decode Fields */
+    for(i = 0; i < num_fields; i++)
+    {
+        field.index = sdnv_read(rec, size, &field, &sdnvflags);
+        entry->fields[i] = field.value;
+    }
+
+    if(sdnvflags != 0) return BP_ERROR;
+    return field.index;
+}
+
+/*--------------------------------------------------------------------------------------
+ * record_object -
+ *
+ *  ptr - pointer to the header or payload of a record returned to the application [INPUT]
+ *
+ *  Returns:    storage object holding the record
+ *-------------------------------------------------------------------------------------*/
+bp_object_t* record_object(void* ptr)
+{
+    uint8_t* rec = (uint8_t*)ptr;
+    int prefix_size = rec[-1];
+    return (bp_object_t*)(rec - prefix_size - offsetof(bp_object_t, data));
+}
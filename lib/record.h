@@ -0,0 +1,103 @@
+/************************************************************************
+ * File: record.h
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+#ifndef _record_h_
+#define _record_h_
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "bplib.h"
+#include "bundle_types.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+/*
+ * Storage Record Format
+ *
+ *  [type/version (1 byte)][SDNV fields ...][prefix length (1 byte)][header][payload]
+ *
+ *  Bundle record fields:   exprtime, cid value, cid index, cid width, cteboffset,
+ *                          biboffset, payoffset, headersize, bundlesize
+ *  Payload record fields:  exprtime, ackapp, payloadsize
+ *
+ *  The prefix length is the number of bytes from the start of the record up to and
+ *  including itself, so the record can be located from a pointer to its header or
+ *  payload.  All fields are SDNVs and therefore independent of the byte order and
+ *  of the size of bp_val_t used by the library that wrote them.
+ */
+#define BP_RECORD_BUNDLE_V1             0xB1
+#define BP_RECORD_PAYLOAD_V1            0xC1
+
+/*
+ * Journal Record Format
+ *
+ *  [type/version (1 byte)][SDNV fields ...][prefix length (1 byte)][entries]
+ *
+ *  Journal record fields:  checkpoint, cid ceiling, last, number of entries,
+ *                          size of entries
+ *  Active entry:           BP_JOURNAL_ACTIVE, sid, cid, retx, stamp
+ *  Custody entry:          BP_JOURNAL_CUSTODY, node, service, cid, count
+ *
+ *  A checkpoint is written as one or more journal records sharing the same
+ *  checkpoint number, the final one marked last; a checkpoint is only complete
+ *  once its last record is stored.
+ */
+#define BP_RECORD_JOURNAL_V1            0xD1
+
+#define BP_JOURNAL_ACTIVE               1   /* bundle transmitted but not yet acknowledged */
+#define BP_JOURNAL_CUSTODY              2   /* range of custody IDs not yet acknowledged to sender */
+#define BP_JOURNAL_MAX_FIELDS           4
+#define BP_JOURNAL_MAX_ENTRY_SIZE       ((BP_JOURNAL_MAX_FIELDS + 1) * 10) /* ten bytes per 64-bit SDNV */
+
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Journal Record */
+typedef struct {
+    bp_val_t            checkpoint;     /* sequence number of the checkpoint the record belongs to */
+    bp_val_t            current_cid;    /* ceiling of custody IDs reserved, next custody ID to assign on recovery */
+    bool                last;           /* final record of the checkpoint */
+    int                 num_entries;    /* number of entries following the prefix */
+    int                 entries_size;   /* size in bytes of the entries */
+} bp_journal_t;
+
+/* Journal Entry */
+typedef struct {
+    int                 type;                           /* BP_JOURNAL_ACTIVE or BP_JOURNAL_CUSTODY */
+    bp_val_t            fields[BP_JOURNAL_MAX_FIELDS];  /* in the order given by the record format */
+} bp_journal_entry_t;
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int             record_bundle_write     (bp_bundle_data_t* data, uint8_t* buffer, int size, uint32_t* flags);
+int             record_bundle_read      (bp_object_t* object, bp_bundle_data_t* data, uint32_t* flags);
+int             record_payload_write    (bp_payload_data_t* data, uint8_t* buffer, int size, uint32_t* flags);
+int             record_payload_read     (bp_object_t* object, bp_payload_data_t* data, uint8_t** payload, uint32_t* flags);
+int             record_journal_write    (bp_journal_t* journal, uint8_t* buffer, int size, uint32_t* flags);
+int             record_journal_read     (bp_object_t* object, bp_journal_t* journal, uint32_t* flags);
+int             record_entry_write      (bp_journal_entry_t* entry, uint8_t* buffer, int offset, int size);
+int             record_entry_read       (bp_object_t* object, int offset, bp_journal_entry_t* entry);
+bp_object_t*    record_object           (void* ptr);
+
+#endif  /* _record_h_ */
@@ -50,12 +50,76 @@
 #define BP_BPLIB_INFO_EID           0xFF
 #endif
 
+/******************************************************************************
+ TYPEDEFS
+ ******************************************************************************/
+
+/* Memory Block Header - prepended to every allocation */
+typedef struct {
+    size_t          size;       /* size of block including header */
+    size_t          tag;        /* subsystem the block is accounted to */
+} bplib_os_mem_header_t;
+
+/******************************************************************************
+ LOCAL PROTOTYPES
+ ******************************************************************************/
+
+static void* default_alloc (size_t size, size_t alignment);
+static void  default_free  (void* ptr);
+
 /******************************************************************************
  FILE DATA
  ******************************************************************************/
 
-static size_t   current_memory_allocated = 0;
-static size_t   highest_memory_allocated = 0;
+static size_t           current_memory_allocated[BP_MEM_NUM_TAGS];
+static size_t           highest_memory_allocated = 0;
+static bp_alloc_func_t  alloc_func = default_alloc;
+static bp_free_func_t   free_func = default_free;
+static bp_time_func_t   systime_func = NULL;
+static bp_time_func_t   monotime_func = NULL;
+static bool             vclock_running = false;
+static unsigned long    vclock_start = 0;   /* seconds since 2000 at start of virtual time */
+static unsigned long    vclock_now = 0;     /* milliseconds of virtual time since start */
+static int              vclock_threads = 0;
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * default_alloc - alignment of the header is all that is needed
+ *-------------------------------------------------------------------------------------*/
+static void* default_alloc(size_t size, size_t alignment)
+{
+    (void)alignment;
+    return malloc(size);
+}
+
+/*--------------------------------------------------------------------------------------
+ * default_free -
+ *-------------------------------------------------------------------------------------*/
+static void default_free(void* ptr)
+{
+    free(ptr);
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_systime - time source installed while the virtual clock runs
+ *-------------------------------------------------------------------------------------*/
+static int vclock_systime(unsigned long* sysnow)
+{
+    *sysnow = vclock_start + (vclock_now / 1000);
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_monotime - time source installed while the virtual clock runs
+ *-------------------------------------------------------------------------------------*/
+static int vclock_monotime(unsigned long* mononow)
+{
+    *mononow = vclock_now / 1000;
+    return BP_SUCCESS;
+}
 
 /******************************************************************************
  EXPORTED FUNCTIONS
@@ -107,6 +171,13 @@ int bplib_os_log(const char* file, unsigned int line, uint32_t* flags, uint32_t
     }
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_os_log_flush - events are sent when logged
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_log_flush(void)
+{
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_systime - returns seconds
  *-------------------------------------------------------------------------------------*/
@@ -114,6 +185,8 @@ int bplib_os_systime(unsigned long* sysnow)
 {
     assert(sysnow);
 
+    if(systime_func) return systime_func(sysnow);
+
     CFE_TIME_SysTime_t sys_time = CFE_TIME_GetTime();
     if(sys_time.Seconds < BP_CFE_SECS_AT_2000)
     {
@@ -127,11 +200,41 @@ int bplib_os_systime(unsigned long* sysnow)
     }
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_os_monotime - returns seconds of mission elapsed time, which is not stepped
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_monotime(unsigned long* mononow)
+{
+    assert(mononow);
+
+    if(monotime_func) return monotime_func(mononow);
+
+    CFE_TIME_SysTime_t met = CFE_TIME_GetMET();
+    *mononow = met.Seconds;
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_nanotime - mission elapsed time, to the resolution of the subseconds
+ *-------------------------------------------------------------------------------------*/
+uint64_t bplib_os_nanotime(void)
+{
+    CFE_TIME_SysTime_t met = CFE_TIME_GetMET();
+    return ((uint64_t)met.Seconds * 1000000000ULL) + ((uint64_t)CFE_TIME_Sub2MicroSecs(met.Subseconds) * 1000ULL);
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_sleep
  *-------------------------------------------------------------------------------------*/
 void bplib_os_sleep(int seconds)
 {
+    if(vclock_running)
+    {
+        /* The Only Task is Blocked so Time Jumps */
+        if(vclock_threads > 0 && seconds > 0) vclock_now += (unsigned long)seconds * 1000;
+        return;
+    }
+
     OS_TaskDelay(seconds * 1000);
 }
 
@@ -169,6 +272,15 @@ void bplib_os_lock(int handle)
     (void)handle;
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_os_trylock -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_trylock(int handle)
+{
+    (void)handle;
+    return BP_SUCCESS;
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_unlock -
  *-------------------------------------------------------------------------------------*/
@@ -191,7 +303,13 @@ void bplib_os_signal(int handle)
 int bplib_os_waiton(int handle, int timeout_ms)
 {
     (void)handle;
-    (void)timeout_ms;
+
+    /* Nothing Else Can Signal, so a Timed Wait Just Moves Virtual Time */
+    if(vclock_running && vclock_threads > 0 && timeout_ms > 0)
+    {
+        vclock_now += (unsigned long)timeout_ms;
+    }
+
     return BP_TIMEOUT;
 }
 
@@ -233,24 +351,39 @@ int bplib_os_strnlen(const char* str, int maxlen)
  *----------------------------------------------------------------------------*/
 void* bplib_os_calloc(size_t size)
 {
+    return bplib_os_calloc_tag(size, BP_MEM_GENERAL);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_calloc_tag - allocates zeroed memory accounted to a subsystem
+ *----------------------------------------------------------------------------*/
+void* bplib_os_calloc_tag(size_t size, int tag)
+{
+    /* Check Tag */
+    if(tag < 0 || tag >= BP_MEM_NUM_TAGS) tag = BP_MEM_GENERAL;
+
     /* Allocate Memory Block */
-    size_t block_size = size + sizeof(size_t);
-    uint8_t* mem_ptr = (uint8_t*)calloc(block_size, 1);
+    size_t block_size = size + sizeof(bplib_os_mem_header_t);
+    uint8_t* mem_ptr = (uint8_t*)alloc_func(block_size, sizeof(bplib_os_mem_header_t));
     if(mem_ptr)
     {
-        /* Prepend Amount */
-        size_t* size_ptr = (size_t*)mem_ptr;
-        *size_ptr = block_size;
+        memset(mem_ptr, 0, block_size);
+
+        /* Prepend Amount and Tag */
+        bplib_os_mem_header_t* header = (bplib_os_mem_header_t*)mem_ptr;
+        header->size = block_size;
+        header->tag = (size_t)tag;
 
         /* Update Statistics */
-        current_memory_allocated += block_size;
-        if(current_memory_allocated > highest_memory_allocated)
+        current_memory_allocated[tag] += block_size;
+        size_t memused = bplib_os_memused();
+        if(memused > highest_memory_allocated)
         {
-            highest_memory_allocated = current_memory_allocated;
+            highest_memory_allocated = memused;
         }
 
         /* Return User Block */
-        return (mem_ptr + sizeof(size_t));
+        return (mem_ptr + sizeof(bplib_os_mem_header_t));
     }
     else
     {
@@ -265,17 +398,16 @@ void bplib_os_free(void* ptr)
 {
     if(ptr)
     {
-        uint8_t* mem_ptr = (uint8_t*)ptr;
+        uint8_t* mem_ptr = (uint8_t*)ptr - sizeof(bplib_os_mem_header_t);
 
-        /* Read Amount */
-        size_t* size_ptr = (size_t*)((uint8_t*)mem_ptr - sizeof(size_t));
-        size_t block_size = *size_ptr;
+        /* Read Amount and Tag */
+        bplib_os_mem_header_t* header = (bplib_os_mem_header_t*)mem_ptr;
 
         /* Update Statistics */
-        current_memory_allocated -= block_size;
+        current_memory_allocated[header->tag] -= header->size;
 
         /* Free Memory Block */
-        free(mem_ptr - sizeof(size_t));
+        free_func(mem_ptr);
     }
 }
 
@@ -284,7 +416,22 @@ void bplib_os_free(void* ptr)
  *----------------------------------------------------------------------------*/
 size_t bplib_os_memused(void)
 {
-    return current_memory_allocated;
+    size_t total = 0;
+    int tag;
+    for(tag = 0; tag < BP_MEM_NUM_TAGS; tag++)
+    {
+        total += current_memory_allocated[tag];
+    }
+    return total;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_memused_tag - how many bytes of memory currently allocated to a subsystem
+ *----------------------------------------------------------------------------*/
+size_t bplib_os_memused_tag(int tag)
+{
+    if(tag < 0 || tag >= BP_MEM_NUM_TAGS) return 0;
+    return current_memory_allocated[tag];
 }
 
 /*----------------------------------------------------------------------------
@@ -294,3 +441,68 @@ size_t bplib_os_memhigh(void)
 {
     return highest_memory_allocated;
 }
+
+/*----------------------------------------------------------------------------
+ * bplib_os_allocator - must be set before any memory is allocated
+ *----------------------------------------------------------------------------*/
+void bplib_os_allocator(bp_alloc_func_t alloc, bp_free_func_t dealloc)
+{
+    alloc_func = alloc ? alloc : default_alloc;
+    free_func = dealloc ? dealloc : default_free;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_timesource - timed waits still use the OSAL clock
+ *----------------------------------------------------------------------------*/
+void bplib_os_timesource(bp_time_func_t systime, bp_time_func_t monotime)
+{
+    systime_func = systime;
+    monotime_func = monotime;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_start - locks are not used with cFE, so the library runs in
+ *  a single task and any timed wait or sleep advances virtual time at once
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_start(unsigned long start, int threads)
+{
+    vclock_start = start;
+    vclock_threads = threads;
+    vclock_now = 0;
+    bplib_os_timesource(vclock_systime, vclock_monotime);
+    vclock_running = true;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_stop -
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_stop(void)
+{
+    vclock_running = false;
+    vclock_threads = 0;
+    bplib_os_timesource(NULL, NULL);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_threads -
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_threads(int change)
+{
+    vclock_threads += change;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_advance -
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_advance(unsigned long ms)
+{
+    vclock_now += ms;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_now -
+ *----------------------------------------------------------------------------*/
+unsigned long bplib_os_vclock_now(void)
+{
+    return vclock_now;
+}
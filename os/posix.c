@@ -27,6 +27,14 @@
 #include <pthread.h>
 #include <errno.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <sys/mman.h>
+
+#ifdef BP_POSIX_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
 #include "bplib.h"
 
@@ -36,26 +44,866 @@
 
 #define UNIX_SECS_AT_2000       946684800
 #define BP_MAX_LOG_ENTRY_SIZE   256
-#define BP_MAX_LOCKS            128
+#define BP_LOCKS_PER_BLOCK      128         /* locks are allocated a block at a time */
+#define BP_MAX_LOCK_BLOCKS      1024        /* bounds number of locks to 131072 */
+#define BP_CACHE_LINE_SIZE      64
+#define BP_MAX_LOCK_SPINS       200         /* upper bound of adaptive spinning before sleeping */
+#define BP_LARGE_BLOCK_SIZE     0x200000    /* allocations this size or larger are aligned to huge pages */
+#define BP_LARGE_BLOCK_HEADER   64          /* keeps user block of large allocations cache line aligned */
+#define BP_VCLOCK_NEVER         (~0UL)      /* deadline of a virtual wait without a timeout */
+#define BP_MEM_SLOTS            64          /* per-thread memory counters, shared once there are more threads */
+#define BP_MEM_HIGH_SAMPLE      16          /* allocations by a thread between updates of the high water mark */
+#define BP_LOG_RING_SIZE        1024        /* records queued for the log thread, power of two */
+#define BP_LOG_MAX_ARGS         8           /* arguments captured per record, messages with more are formatted when logged */
+#define BP_LOG_NUM_SITES        256         /* call sites tracked by the rate limit, power of two */
+#define BP_LOG_IDLE_MS          100         /* longest the log thread sleeps without being signaled */
+#define BP_LOG_FLUSH_MS         1000        /* longest a flush waits for the log thread */
+
+#ifndef BP_LOG_SITE_RATE
+#define BP_LOG_SITE_RATE        10          /* records per second logged from a single call site */
+#endif
 
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
 
+#ifdef BP_POSIX_FUTEX
+
+/* Non-recursive lock and condition built on futexes; each lock
+ * has its own cache line so that locks of different channels
+ * and stores do not contend with each other */
+typedef struct {
+    int             state;      /* 0: unlocked, 1: locked, 2: locked with sleeping waiters */
+    int             sequence;   /* incremented by each signal, waited on by waiters */
+    int             waiters;    /* number of threads waiting on a signal */
+    int             spins;      /* running average of spins needed to acquire lock */
+    bool            in_use;
+} __attribute__((aligned(BP_CACHE_LINE_SIZE))) bplib_os_lock_t;
+
+#else
+
 typedef struct {
     pthread_cond_t  cond;
     pthread_mutex_t mutex;
+    bool            in_use;
 } bplib_os_lock_t;
 
+#endif
+
+/* Block of Locks - never moved once allocated so locks are found without locking */
+typedef struct {
+    void*               memory;     /* allocated memory, locks are aligned within it */
+    bplib_os_lock_t*    locks;
+    int                 num_used;
+} bplib_os_lock_block_t;
+
+/* Log Argument - captured instead of formatted on the logging thread */
+typedef union {
+    long long           i;
+    double              f;
+    const void*         p;
+} bplib_os_log_arg_t;
+
+/* Log Record - formatted and displayed by the log thread */
+typedef struct {
+    unsigned long       turn;       /* ring position the slot is free for, plus one once written */
+    const char*         file;
+    const char*         fmt;        /* NULL when the message was formatted into strings when logged */
+    unsigned int        line;
+    uint32_t            event;
+    unsigned int        suppressed; /* records from the same call site dropped by the rate limit */
+    int                 num_args;
+    bplib_os_log_arg_t  args[BP_LOG_MAX_ARGS];
+    char                strings[BP_MAX_LOG_ENTRY_SIZE]; /* copies of string arguments */
+} bplib_os_log_record_t;
+
+/* Log Call Site - hashed by file and line */
+typedef struct {
+    unsigned long       second;     /* second that count is for */
+    unsigned int        count;      /* records logged during second */
+    unsigned int        suppressed; /* records dropped since the last one logged */
+} bplib_os_log_site_t;
+
+/* Memory Block Header - prepended to every allocation */
+typedef struct {
+    size_t              size;       /* size of block including header */
+    size_t              tag;        /* subsystem the block is accounted to */
+} bplib_os_mem_header_t;
+
+/* Virtual Clock Waiter - a thread blocked in a wait or sleep while the virtual clock runs */
+typedef struct bplib_os_vclock_waiter {
+    struct bplib_os_vclock_waiter* next;
+    int                 handle;     /* lock waited on, BP_INVALID_HANDLE when sleeping */
+    unsigned long       deadline;   /* milliseconds of virtual time the wait times out */
+    bool                woken;
+    bool                signaled;   /* woken by a signal rather than a timeout */
+    pthread_cond_t      cond;
+} bplib_os_vclock_waiter_t;
+
+/* Memory Counters - each on its own cache line so threads do not contend */
+typedef struct {
+    long                used[BP_MEM_NUM_TAGS];  /* bytes allocated less bytes freed by threads using slot */
+    unsigned int        allocations;
+} __attribute__((aligned(BP_CACHE_LINE_SIZE))) bplib_os_mem_slot_t;
+
+/******************************************************************************
+ LOCAL PROTOTYPES
+ ******************************************************************************/
+
+static void* default_alloc (size_t size, size_t alignment);
+
 /******************************************************************************
  FILE DATA
  ******************************************************************************/
 
-static bplib_os_lock_t*     locks[BP_MAX_LOCKS] = {0};
+static bplib_os_lock_block_t lock_blocks[BP_MAX_LOCK_BLOCKS] = {{0}};
 static pthread_mutex_t      lock_of_locks;
-static struct timespec      prevnow;
-static size_t               current_memory_allocated = 0;
+static long                 prev_systime = 0;   /* seconds of last reported system time */
+static bplib_os_mem_slot_t  mem_slots[BP_MEM_SLOTS];
+static unsigned int         next_mem_slot = 0;
+static __thread bplib_os_mem_slot_t* thread_mem_slot = NULL;
 static size_t               highest_memory_allocated = 0;
+static bp_alloc_func_t      alloc_func = default_alloc;
+static bp_free_func_t       free_func = free;
+static bp_time_func_t       systime_func = NULL; /* replaces the real time clock when set */
+static bp_time_func_t       monotime_func = NULL; /* replaces the monotonic clock when set */
+static bool                 vclock_running = false;
+static unsigned long        vclock_start = 0;   /* seconds since 2000 at start of virtual time */
+static unsigned long        vclock_now = 0;     /* milliseconds of virtual time since start */
+static int                  vclock_threads = 0; /* threads that take part, time advances when all are blocked */
+static int                  vclock_blocked = 0; /* threads waiting that have not been woken */
+static bplib_os_vclock_waiter_t* vclock_waiters = NULL;
+static pthread_mutex_t      vclock_mutex = PTHREAD_MUTEX_INITIALIZER;
+#ifdef BP_POSIX_FUTEX
+static int                  max_lock_spins = BP_MAX_LOCK_SPINS;
+#endif
+static bplib_os_log_record_t log_ring[BP_LOG_RING_SIZE];
+static bplib_os_log_site_t  log_sites[BP_LOG_NUM_SITES];
+static unsigned long        log_head = 0;       /* next ring position written by logging threads */
+static unsigned long        log_tail = 0;       /* next ring position displayed by log thread */
+static unsigned long        log_dropped = 0;    /* records dropped because the ring was full */
+static bool                 log_running = false;
+static bool                 log_stopping = false;
+static bool                 log_sleeping = false;
+static pthread_t            log_thread;
+static pthread_mutex_t      log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       log_cond;
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * default_alloc -
+ *-------------------------------------------------------------------------------------*/
+static void* default_alloc(size_t size, size_t alignment)
+{
+    void* ptr = NULL;
+
+    if(alignment <= sizeof(bplib_os_mem_header_t))
+    {
+        ptr = malloc(size);
+    }
+    else if(posix_memalign(&ptr, alignment, size) == 0)
+    {
+        #ifdef MADV_HUGEPAGE
+        if(alignment >= BP_LARGE_BLOCK_SIZE) madvise(ptr, size, MADV_HUGEPAGE);
+        #endif
+    }
+
+    return ptr;
+}
+
+/*--------------------------------------------------------------------------------------
+ * get_mem_slot - memory counters of calling thread
+ *-------------------------------------------------------------------------------------*/
+static inline bplib_os_mem_slot_t* get_mem_slot(void)
+{
+    if(thread_mem_slot == NULL)
+    {
+        unsigned int slot = __atomic_fetch_add(&next_mem_slot, 1, __ATOMIC_RELAXED);
+        thread_mem_slot = &mem_slots[slot % BP_MEM_SLOTS];
+    }
+    return thread_mem_slot;
+}
+
+/*--------------------------------------------------------------------------------------
+ * update_memhigh - raises high water mark to the memory currently allocated
+ *-------------------------------------------------------------------------------------*/
+static void update_memhigh(void)
+{
+    size_t used = bplib_os_memused();
+    size_t highest = __atomic_load_n(&highest_memory_allocated, __ATOMIC_RELAXED);
+    while(used > highest)
+    {
+        if(__atomic_compare_exchange_n(&highest_memory_allocated, &highest, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * get_lock -
+ *-------------------------------------------------------------------------------------*/
+static inline bplib_os_lock_t* get_lock(int handle)
+{
+    return &lock_blocks[handle / BP_LOCKS_PER_BLOCK].locks[handle % BP_LOCKS_PER_BLOCK];
+}
+
+#ifdef BP_POSIX_FUTEX
+
+/*--------------------------------------------------------------------------------------
+ * futex_wait - returns zero when woken, spuriously or not
+ *-------------------------------------------------------------------------------------*/
+static inline int futex_wait(int* addr, int value, const struct timespec* timeout)
+{
+    return (int)syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, timeout, NULL, 0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * futex_wake -
+ *-------------------------------------------------------------------------------------*/
+static inline void futex_wake(int* addr, int count)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * cpu_relax - tells the processor it is in a spin loop
+ *-------------------------------------------------------------------------------------*/
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * futex_lock_slow - sleeps until the lock is released, marking it as having waiters
+ *-------------------------------------------------------------------------------------*/
+static void futex_lock_slow(bplib_os_lock_t* lock)
+{
+    while(__atomic_exchange_n(&lock->state, 2, __ATOMIC_ACQUIRE) != 0)
+    {
+        futex_wait(&lock->state, 2, NULL);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * futex_lock - spins for up to about twice as long as it has recently taken to acquire
+ *  the lock (the lock is normally held for a short critical section on another core)
+ *  and then sleeps
+ *-------------------------------------------------------------------------------------*/
+static void futex_lock(bplib_os_lock_t* lock)
+{
+    int unlocked = 0;
+    if(__atomic_compare_exchange_n(&lock->state, &unlocked, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return;
+
+    int average = __atomic_load_n(&lock->spins, __ATOMIC_RELAXED);
+    int max_spins = (average * 2) + 10;
+    if(max_spins > max_lock_spins) max_spins = max_lock_spins;
+
+    int spins;
+    for(spins = 0; spins < max_spins; spins++)
+    {
+        cpu_relax();
+        unlocked = 0;
+        if(__atomic_load_n(&lock->state, __ATOMIC_RELAXED) == 0 &&
+           __atomic_compare_exchange_n(&lock->state, &unlocked, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
+
+    __atomic_store_n(&lock->spins, average + ((spins - average) / 8), __ATOMIC_RELAXED);
+    if(spins == max_spins) futex_lock_slow(lock);
+}
+
+/*--------------------------------------------------------------------------------------
+ * futex_unlock -
+ *-------------------------------------------------------------------------------------*/
+static inline void futex_unlock(bplib_os_lock_t* lock)
+{
+    if(__atomic_exchange_n(&lock->state, 0, __ATOMIC_RELEASE) == 2)
+    {
+        futex_wake(&lock->state, 1);
+    }
+}
+
+#endif
+
+/*--------------------------------------------------------------------------------------
+ * init_monotonic_cond - timed waits on the condition are not affected by clock steps
+ *-------------------------------------------------------------------------------------*/
+static void init_monotonic_cond(pthread_cond_t* cond)
+{
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_allowed - rate limits each call site, sites that hash to the same entry share a limit
+ *-------------------------------------------------------------------------------------*/
+static bool log_allowed(const char* file, unsigned int line, unsigned int* suppressed)
+{
+    struct timespec now;
+    uint32_t hash = (uint32_t)(((uintptr_t)file + line) * 2654435761UL);
+    bplib_os_log_site_t* site = &log_sites[(hash >> 16) & (BP_LOG_NUM_SITES - 1)];
+
+    #ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    #else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    #endif
+
+    /* Start New Second (threads racing here can let a few extra records through) */
+    unsigned long second = (unsigned long)now.tv_sec;
+    if(__atomic_load_n(&site->second, __ATOMIC_RELAXED) != second)
+    {
+        __atomic_store_n(&site->second, second, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+    }
+
+    /* Check Rate */
+    if(__atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) > BP_LOG_SITE_RATE)
+    {
+        __atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    *suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_parse_spec - steps over the flags, width, precision, and length of a conversion
+ *
+ *  Returns number of '*' arguments, and sets length to the length modifier found
+ *-------------------------------------------------------------------------------------*/
+static int log_parse_spec(const char** c, char* length)
+{
+    int stars = 0;
+
+    while(**c && strchr("-+ #0'", **c)) (*c)++;
+    while(**c && (isdigit((unsigned char)**c) || **c == '.' || **c == '*'))
+    {
+        if(**c == '*') stars++;
+        (*c)++;
+    }
+
+    /* Length Modifiers - doubled letters are recorded in upper case */
+    *length = '\0';
+    while(**c && strchr("hlLzjtq", **c))
+    {
+        if(*length == 'h' && **c == 'h') *length = 'H';
+        else if(*length == 'l' && **c == 'l') *length = 'Q';
+        else *length = (**c == 'q') ? 'Q' : **c;
+        (*c)++;
+    }
+
+    return stars;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_capture - copies arguments into record so they can be formatted later
+ *
+ *  Returns false if the format cannot be captured and must be formatted now
+ *-------------------------------------------------------------------------------------*/
+static bool log_capture(bplib_os_log_record_t* record, const char* fmt, va_list args)
+{
+    size_t strings_used = 0;
+    const char* c = fmt;
+    char length;
+    int stars;
+
+    record->num_args = 0;
+    while(*c)
+    {
+        if(*c++ != '%') continue;
+        if(*c == '%')
+        {
+            c++;
+            continue;
+        }
+
+        /* Width and Precision Arguments */
+        stars = log_parse_spec(&c, &length);
+        if(stars > 2 || record->num_args + stars + 1 > BP_LOG_MAX_ARGS) return false;
+        while(stars-- > 0) record->args[record->num_args++].i = va_arg(args, int);
+
+        /* Conversion Argument */
+        bplib_os_log_arg_t* arg = &record->args[record->num_args++];
+        switch(*c++)
+        {
+            case 'd':
+            case 'i':
+                switch(length)
+                {
+                    case 'H':   arg->i = (signed char)va_arg(args, int); break;
+                    case 'h':   arg->i = (short)va_arg(args, int); break;
+                    case 'l':   arg->i = va_arg(args, long); break;
+                    case 'Q':   arg->i = va_arg(args, long long); break;
+                    case 'z':   arg->i = va_arg(args, ssize_t); break;
+                    case 'j':   arg->i = va_arg(args, intmax_t); break;
+                    case 't':   arg->i = va_arg(args, ptrdiff_t); break;
+                    default:    arg->i = va_arg(args, int); break;
+                }
+                break;
+
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                switch(length)
+                {
+                    case 'H':   arg->i = (unsigned char)va_arg(args, unsigned int); break;
+                    case 'h':   arg->i = (unsigned short)va_arg(args, unsigned int); break;
+                    case 'l':   arg->i = va_arg(args, unsigned long); break;
+                    case 'Q':   arg->i = (long long)va_arg(args, unsigned long long); break;
+                    case 'z':   arg->i = (long long)va_arg(args, size_t); break;
+                    case 'j':   arg->i = (long long)va_arg(args, uintmax_t); break;
+                    case 't':   arg->i = va_arg(args, ptrdiff_t); break;
+                    default:    arg->i = va_arg(args, unsigned int); break;
+                }
+                break;
+
+            case 'c':
+                arg->i = va_arg(args, int);
+                break;
+
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if(length == 'L')   arg->f = (double)va_arg(args, long double);
+                else                arg->f = va_arg(args, double);
+                break;
+
+            case 'p':
+                arg->p = va_arg(args, void*);
+                break;
+
+            case 's':
+            {
+                if(length != '\0') return false;
+                const char* str = va_arg(args, const char*);
+                if(str == NULL) str = "(null)";
+                size_t len = strlen(str);
+                if(strings_used + len + 1 > sizeof(record->strings)) return false;
+                memcpy(&record->strings[strings_used], str, len + 1);
+                arg->i = (long long)strings_used;
+                strings_used += len + 1;
+                break;
+            }
+
+            default:
+                /* Includes %n, which must write through its pointer when logged */
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_render - formats message from the format and captured arguments of a record
+ *-------------------------------------------------------------------------------------*/
+static int log_render(bplib_os_log_record_t* record, char* buffer, int size)
+{
+    const char* c = record->fmt;
+    int len = 0;
+    int a = 0;
+
+    /* Formatted When Logged */
+    if(c == NULL)
+    {
+        return snprintf(buffer, size, "%s", record->strings);
+    }
+
+    while(*c && len < size - 1)
+    {
+        if(*c != '%')
+        {
+            buffer[len++] = *c++;
+            continue;
+        }
+        else if(c[1] == '%')
+        {
+            buffer[len++] = '%';
+            c += 2;
+            continue;
+        }
+
+        /* Rebuild Conversion with Length of Captured Argument */
+        char spec[BP_MAX_LOG_ENTRY_SIZE];
+        const char* start = c++;
+        char length;
+        int stars = log_parse_spec(&c, &length);
+        int speclen = (int)(c - start);
+        int star[2] = { 0, 0 };
+        char conv = *c++;
+        int s;
+
+        while(speclen > 0 && strchr("hlLzjtq", start[speclen - 1])) speclen--;
+        memcpy(spec, start, speclen);
+        if(strchr("diuoxX", conv)) spec[speclen++] = 'l', spec[speclen++] = 'l';
+        spec[speclen++] = conv;
+        spec[speclen] = '\0';
+
+        for(s = 0; s < stars && a < record->num_args; s++) star[s] = (int)record->args[a++].i;
+        if(a >= record->num_args) break;
+        bplib_os_log_arg_t arg = record->args[a++];
+
+        /* Format Conversion */
+        char* dst = &buffer[len];
+        size_t room = (size_t)(size - len);
+        int n;
+        #define BP_LOG_RENDER(value) ((stars == 0) ? snprintf(dst, room, spec, value) : \
+                                      (stars == 1) ? snprintf(dst, room, spec, star[0], value) : \
+                                                     snprintf(dst, room, spec, star[0], star[1], value))
+        switch(conv)
+        {
+            case 'd': case 'i':                                 n = BP_LOG_RENDER(arg.i); break;
+            case 'u': case 'o': case 'x': case 'X':             n = BP_LOG_RENDER((unsigned long long)arg.i); break;
+            case 'c':                                           n = BP_LOG_RENDER((int)arg.i); break;
+            case 'p':                                           n = BP_LOG_RENDER(arg.p); break;
+            case 's':                                           n = BP_LOG_RENDER(&record->strings[arg.i]); break;
+            default:                                            n = BP_LOG_RENDER(arg.f); break;
+        }
+        #undef BP_LOG_RENDER
+
+        if(n > 0) len += ((size_t)n < room) ? n : (int)room - 1;
+    }
+
+    buffer[len] = '\0';
+    return len;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_display - displays a formatted message
+ *-------------------------------------------------------------------------------------*/
+static void log_display(const char* file, unsigned int line, uint32_t event, unsigned int suppressed, const char* message)
+{
+    char log_message[BP_MAX_LOG_ENTRY_SIZE];
+    const char* pathptr;
+    int msglen;
+
+    /* Chop Path in Filename */
+    pathptr = strrchr(file, '/');
+    if(pathptr) pathptr++;
+    else pathptr = file;
+
+    /* Report Messages Dropped by Rate Limit */
+    if(suppressed > 0)
+    {
+        printf("%s:%u:%u messages suppressed\n", pathptr, line, suppressed);
+    }
+
+    /* Create Log Message */
+    if(event != BP_FLAG_DIAGNOSTIC)
+    {
+        msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%08X:%s", pathptr, line, event, message);
+    }
+    else
+    {
+        msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%s", pathptr, line, message);
+    }
+
+    if(msglen > (BP_MAX_LOG_ENTRY_SIZE - 1))
+    {
+        log_message[BP_MAX_LOG_ENTRY_SIZE - 1] = '#';
+    }
+
+    /* Display Log Message */
+    printf("%s", log_message);
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_reserve - claims the next slot of the ring, NULL if full
+ *-------------------------------------------------------------------------------------*/
+static bplib_os_log_record_t* log_reserve(unsigned long* pos)
+{
+    *pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+    while(true)
+    {
+        bplib_os_log_record_t* record = &log_ring[*pos & (BP_LOG_RING_SIZE - 1)];
+        long diff = (long)(__atomic_load_n(&record->turn, __ATOMIC_ACQUIRE) - *pos);
+        if(diff == 0)
+        {
+            if(__atomic_compare_exchange_n(&log_head, pos, *pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                return record;
+            }
+        }
+        else if(diff < 0)
+        {
+            return NULL;
+        }
+        else
+        {
+            *pos = __atomic_load_n(&log_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_publish - hands a written record to the log thread
+ *-------------------------------------------------------------------------------------*/
+static void log_publish(bplib_os_log_record_t* record, unsigned long pos)
+{
+    __atomic_store_n(&record->turn, pos + 1, __ATOMIC_RELEASE);
+
+    /* Only Wake Log Thread if it Went to Sleep */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&log_sleeping, __ATOMIC_RELAXED))
+    {
+        pthread_mutex_lock(&log_mutex);
+        pthread_cond_signal(&log_cond);
+        pthread_mutex_unlock(&log_mutex);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_ready - whether the next record of the ring has been written
+ *-------------------------------------------------------------------------------------*/
+static bool log_ready(void)
+{
+    bplib_os_log_record_t* record = &log_ring[log_tail & (BP_LOG_RING_SIZE - 1)];
+    return __atomic_load_n(&record->turn, __ATOMIC_ACQUIRE) == log_tail + 1;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_drain - log thread, the only thread that formats and displays records
+ *-------------------------------------------------------------------------------------*/
+static void* log_drain(void* parm)
+{
+    (void)parm;
+    char message[BP_MAX_LOG_ENTRY_SIZE];
+
+    while(true)
+    {
+        /* Display Next Record */
+        if(log_ready())
+        {
+            bplib_os_log_record_t* record = &log_ring[log_tail & (BP_LOG_RING_SIZE - 1)];
+            if(log_render(record, message, sizeof(message)) > 0)
+            {
+                log_display(record->file, record->line, record->event, record->suppressed, message);
+            }
+            __atomic_store_n(&record->turn, log_tail + BP_LOG_RING_SIZE, __ATOMIC_RELEASE);
+            __atomic_store_n(&log_tail, log_tail + 1, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        /* Report Records Dropped while Ring was Full */
+        unsigned long dropped = __atomic_exchange_n(&log_dropped, 0, __ATOMIC_RELAXED);
+        if(dropped > 0)
+        {
+            char dropped_message[BP_MAX_LOG_ENTRY_SIZE];
+            snprintf(dropped_message, sizeof(dropped_message), "%lu log records dropped\n", dropped);
+            log_display(__FILE__, __LINE__, BP_FLAG_DIAGNOSTIC, 0, dropped_message);
+        }
+
+        /* Wait for Records */
+        fflush(stdout);
+        pthread_mutex_lock(&log_mutex);
+        {
+            __atomic_store_n(&log_sleeping, true, __ATOMIC_SEQ_CST);
+            if(!log_ready() && !__atomic_load_n(&log_stopping, __ATOMIC_RELAXED))
+            {
+                struct timespec ts;
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                ts.tv_nsec += BP_LOG_IDLE_MS * 1000000;
+                if(ts.tv_nsec >= 1000000000)
+                {
+                    ts.tv_nsec -= 1000000000;
+                    ts.tv_sec++;
+                }
+                pthread_cond_timedwait(&log_cond, &log_mutex, &ts);
+            }
+            __atomic_store_n(&log_sleeping, false, __ATOMIC_RELAXED);
+        }
+        pthread_mutex_unlock(&log_mutex);
+
+        /* Exit Once Drained */
+        if(__atomic_load_n(&log_stopping, __ATOMIC_RELAXED) && !log_ready()) break;
+    }
+
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_stop - drains and stops the log thread at exit
+ *-------------------------------------------------------------------------------------*/
+static void log_stop(void)
+{
+    if(__atomic_exchange_n(&log_running, false, __ATOMIC_ACQ_REL))
+    {
+        pthread_mutex_lock(&log_mutex);
+        __atomic_store_n(&log_stopping, true, __ATOMIC_RELAXED);
+        pthread_cond_signal(&log_cond);
+        pthread_mutex_unlock(&log_mutex);
+        pthread_join(log_thread, NULL);
+        fflush(stdout);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_systime - time source installed while the virtual clock runs
+ *-------------------------------------------------------------------------------------*/
+static int vclock_systime(unsigned long* sysnow)
+{
+    unsigned long now = __atomic_load_n(&vclock_now, __ATOMIC_ACQUIRE);
+    if(sysnow) *sysnow = vclock_start + (now / 1000);
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_monotime - time source installed while the virtual clock runs
+ *-------------------------------------------------------------------------------------*/
+static int vclock_monotime(unsigned long* mononow)
+{
+    unsigned long now = __atomic_load_n(&vclock_now, __ATOMIC_ACQUIRE);
+    if(mononow) *mononow = now / 1000;
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_wake - vclock_mutex must be held
+ *-------------------------------------------------------------------------------------*/
+static void vclock_wake(bplib_os_vclock_waiter_t* waiter, bool signaled)
+{
+    waiter->woken = true;
+    waiter->signaled = signaled;
+    vclock_blocked--;
+    pthread_cond_signal(&waiter->cond);
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_expire - wakes waiters whose timeouts have passed, vclock_mutex must be held
+ *-------------------------------------------------------------------------------------*/
+static void vclock_expire(void)
+{
+    bplib_os_vclock_waiter_t* waiter;
+    for(waiter = vclock_waiters; waiter; waiter = waiter->next)
+    {
+        if(!waiter->woken && waiter->deadline <= vclock_now)
+        {
+            vclock_wake(waiter, false);
+        }
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_idle - when every thread taking part is blocked, jumps to the next timeout;
+ *  vclock_mutex must be held
+ *-------------------------------------------------------------------------------------*/
+static void vclock_idle(void)
+{
+    bplib_os_vclock_waiter_t* waiter;
+    unsigned long next = BP_VCLOCK_NEVER;
+
+    if(vclock_threads <= 0 || vclock_blocked < vclock_threads) return;
+
+    /* Find Next Timeout */
+    for(waiter = vclock_waiters; waiter; waiter = waiter->next)
+    {
+        if(!waiter->woken && waiter->deadline < next)
+        {
+            next = waiter->deadline;
+        }
+    }
+
+    /* Advance Time (when every wait is without a timeout nothing can change) */
+    if(next != BP_VCLOCK_NEVER)
+    {
+        if(next > vclock_now) __atomic_store_n(&vclock_now, next, __ATOMIC_RELEASE);
+        vclock_expire();
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_wait - blocks until signaled or until virtual time reaches the timeout,
+ *  the lock is released while waiting and held on return
+ *-------------------------------------------------------------------------------------*/
+static int vclock_wait(int handle, int timeout_ms)
+{
+    bplib_os_vclock_waiter_t waiter;
+    bplib_os_vclock_waiter_t** prev;
+
+    waiter.next = NULL;
+    waiter.handle = handle;
+    waiter.woken = false;
+    waiter.signaled = false;
+    pthread_cond_init(&waiter.cond, NULL);
+
+    pthread_mutex_lock(&vclock_mutex);
+    {
+        /* Add to Waiters (in order, so signals wake the longest waiting thread) */
+        waiter.deadline = (timeout_ms < 0) ? BP_VCLOCK_NEVER : vclock_now + (unsigned long)timeout_ms;
+        for(prev = &vclock_waiters; *prev; prev = &(*prev)->next);
+        *prev = &waiter;
+        vclock_blocked++;
+
+        /* Release Lock (signals take vclock_mutex so none are missed) */
+        if(handle != BP_INVALID_HANDLE) bplib_os_unlock(handle);
+
+        /* Wait */
+        vclock_idle();
+        while(!waiter.woken) pthread_cond_wait(&waiter.cond, &vclock_mutex);
+
+        /* Remove from Waiters */
+        for(prev = &vclock_waiters; *prev != &waiter; prev = &(*prev)->next);
+        *prev = waiter.next;
+    }
+    pthread_mutex_unlock(&vclock_mutex);
+    pthread_cond_destroy(&waiter.cond);
+
+    /* Reacquire Lock */
+    if(handle != BP_INVALID_HANDLE) bplib_os_lock(handle);
+
+    return waiter.signaled ? BP_SUCCESS : BP_TIMEOUT;
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_signal - wakes the longest waiting thread on the lock
+ *-------------------------------------------------------------------------------------*/
+static void vclock_signal(int handle)
+{
+    bplib_os_vclock_waiter_t* waiter;
+
+    pthread_mutex_lock(&vclock_mutex);
+    {
+        for(waiter = vclock_waiters; waiter; waiter = waiter->next)
+        {
+            if(!waiter->woken && waiter->handle == handle)
+            {
+                vclock_wake(waiter, true);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&vclock_mutex);
+}
+
+/*--------------------------------------------------------------------------------------
+ * vclock_release - times out every waiter, vclock_mutex must be held
+ *-------------------------------------------------------------------------------------*/
+static void vclock_release(void)
+{
+    bplib_os_vclock_waiter_t* waiter;
+    for(waiter = vclock_waiters; waiter; waiter = waiter->next)
+    {
+        if(!waiter->woken) vclock_wake(waiter, false);
+    }
+}
 
 /******************************************************************************
  EXPORTED FUNCTIONS
@@ -71,60 +919,93 @@ void bplib_os_init()
     pthread_mutexattr_settype(&locks_attr, PTHREAD_MUTEX_RECURSIVE);
     pthread_mutex_init(&lock_of_locks, &locks_attr);
 
-    clock_gettime(CLOCK_REALTIME, &prevnow);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    __atomic_store_n(&prev_systime, (long)now.tv_sec, __ATOMIC_RELAXED);
+
+    srand((unsigned int)now.tv_nsec);
 
-    srand((unsigned int)prevnow.tv_nsec);
+    #ifdef BP_POSIX_FUTEX
+    /* Spinning Cannot Help when the Lock Holder Needs the Only Processor */
+    if(sysconf(_SC_NPROCESSORS_ONLN) <= 1) max_lock_spins = 0;
+    #endif
+
+    /* Start Log Thread - messages are displayed by the calling thread until it runs */
+    if(!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+    {
+        unsigned long pos;
+        for(pos = 0; pos < BP_LOG_RING_SIZE; pos++) log_ring[pos].turn = log_tail + pos;
+        __atomic_store_n(&log_head, log_tail, __ATOMIC_RELAXED);
+        __atomic_store_n(&log_stopping, false, __ATOMIC_RELAXED);
+        init_monotonic_cond(&log_cond);
+        if(pthread_create(&log_thread, NULL, log_drain, NULL) == 0)
+        {
+            static bool registered = false;
+            __atomic_store_n(&log_running, true, __ATOMIC_RELEASE);
+            if(!registered) registered = (atexit(log_stop) == 0);
+        }
+    }
 }
 
 /*--------------------------------------------------------------------------------------
- * bplib_os_log -
+ * bplib_os_log - queues message for the log thread, which formats and displays it
+ *
+ *  The format and file must be string literals since they are read after returning
  *
  * 	Returns - the error code passed in (for convenience)
  *-------------------------------------------------------------------------------------*/
 int bplib_os_log(const char* file, unsigned int line, uint32_t* flags, uint32_t event, const char* fmt, ...)
 {
-    char formatted_string[BP_MAX_LOG_ENTRY_SIZE];
-    char log_message[BP_MAX_LOG_ENTRY_SIZE];
+    unsigned int suppressed = 0;
     va_list args;
-    int vlen, msglen;
-    char* pathptr;
-
-    /* Build Formatted String */
-    va_start(args, fmt);
-    vlen = vsnprintf(formatted_string, BP_MAX_LOG_ENTRY_SIZE - 1, fmt, args);
-    msglen = vlen < BP_MAX_LOG_ENTRY_SIZE - 1 ? vlen : BP_MAX_LOG_ENTRY_SIZE - 1;
-    va_end(args);
 
-    /* Log Message */
-    if(msglen > 0)
+    /* Diagnostics are Requested Explicitly and Never Rate Limited */
+    if(event == BP_FLAG_DIAGNOSTIC || log_allowed(file, line, &suppressed))
     {
-        formatted_string[msglen] = '\0';
-
-        /* Chop Path in Filename */
-        pathptr = strrchr(file, '/');
-        if(pathptr) pathptr++;
-        else pathptr = (char*)file;
-
-        /* Create Log Message */
-        if(event != BP_FLAG_DIAGNOSTIC)
+        if(__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
         {
-            msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%08X:%s", pathptr, line, event, formatted_string);
-            if(msglen > (BP_MAX_LOG_ENTRY_SIZE - 1))
+            unsigned long pos;
+            bplib_os_log_record_t* record = log_reserve(&pos);
+            if(record)
+            {
+                /* Capture Arguments */
+                record->file = file;
+                record->fmt = fmt;
+                record->line = line;
+                record->event = event;
+                record->suppressed = suppressed;
+                va_start(args, fmt);
+                {
+                    va_list capture_args;
+                    va_copy(capture_args, args);
+                    if(!log_capture(record, fmt, capture_args))
+                    {
+                        vsnprintf(record->strings, sizeof(record->strings), fmt, args);
+                        record->fmt = NULL;
+                    }
+                    va_end(capture_args);
+                }
+                va_end(args);
+
+                log_publish(record, pos);
+            }
+            else
             {
-                log_message[BP_MAX_LOG_ENTRY_SIZE - 1] = '#';
+                __atomic_add_fetch(&log_dropped, 1, __ATOMIC_RELAXED);
             }
         }
         else
         {
-            msglen = snprintf(log_message, BP_MAX_LOG_ENTRY_SIZE, "%s:%u:%s", pathptr, line, formatted_string);
-            if(msglen > (BP_MAX_LOG_ENTRY_SIZE - 1))
+            /* Display on Calling Thread */
+            char formatted_string[BP_MAX_LOG_ENTRY_SIZE];
+            va_start(args, fmt);
+            int vlen = vsnprintf(formatted_string, BP_MAX_LOG_ENTRY_SIZE, fmt, args);
+            va_end(args);
+            if(vlen > 0)
             {
-                log_message[BP_MAX_LOG_ENTRY_SIZE - 1] = '#';
+                log_display(file, line, event, suppressed, formatted_string);
             }
         }
-
-        /* Display Log Message */
-        printf("%s", log_message);
     }
 
     /* Set Event Flag and Return */
@@ -140,25 +1021,52 @@ int bplib_os_log(const char* file, unsigned int line, uint32_t* flags, uint32_t
 }
 
 /*--------------------------------------------------------------------------------------
- * bplib_os_systime - returns seconds
+ * bplib_os_log_flush - waits for the log thread to display the messages logged so far
+ *-------------------------------------------------------------------------------------*/
+void bplib_os_log_flush(void)
+{
+    if(__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+    {
+        unsigned long head = __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+        int waited_ms = 0;
+        while((long)(__atomic_load_n(&log_tail, __ATOMIC_ACQUIRE) - head) < 0 && waited_ms < BP_LOG_FLUSH_MS)
+        {
+            pthread_mutex_lock(&log_mutex);
+            pthread_cond_signal(&log_cond);
+            pthread_mutex_unlock(&log_mutex);
+            struct timespec ts = { 0, 1000000 };
+            nanosleep(&ts, NULL);
+            waited_ms++;
+        }
+    }
+
+    fflush(stdout);
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_systime - returns seconds since 2000 on the real time clock, used for DTN
+ *  creation and expiration times; it can be stepped, so nothing is scheduled on it
  *-------------------------------------------------------------------------------------*/
 int bplib_os_systime(unsigned long* sysnow)
 {
     int status = BP_SUCCESS;
 
+    /* Use Time Source Hook */
+    bp_time_func_t time_func = __atomic_load_n(&systime_func, __ATOMIC_ACQUIRE);
+    if(time_func) return time_func(sysnow);
+
     /* Get System Time */
     struct timespec now;
     clock_gettime(CLOCK_REALTIME, &now);
     unsigned long elapsed_secs = now.tv_sec - UNIX_SECS_AT_2000;
-    unsigned long previous_secs = prevnow.tv_sec - UNIX_SECS_AT_2000;
-    prevnow = now;
+    long previous = __atomic_exchange_n(&prev_systime, (long)now.tv_sec, __ATOMIC_RELAXED);
 
     /* Return Time */
     if(sysnow) *sysnow = elapsed_secs;
 
     /* Check Reliability */
     if( (now.tv_sec < UNIX_SECS_AT_2000) || /* time nonsensical */
-        (previous_secs > elapsed_secs) )    /* time going backwards */
+        (previous > (long)now.tv_sec) )     /* time going backwards */
     {
         status = BP_ERROR;
     }
@@ -167,11 +1075,44 @@ int bplib_os_systime(unsigned long* sysnow)
     return status;
 }
 
+/*--------------------------------------------------------------------------------------
+ * bplib_os_monotime - returns seconds on a clock that is never stepped, used for
+ *  timeouts and schedules; its starting point is arbitrary
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_monotime(unsigned long* mononow)
+{
+    /* Use Time Source Hook */
+    bp_time_func_t time_func = __atomic_load_n(&monotime_func, __ATOMIC_ACQUIRE);
+    if(time_func) return time_func(mononow);
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if(mononow) *mononow = (unsigned long)now.tv_sec;
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_nanotime - real time even while the virtual clock runs, since it
+ *  measures how long the library takes
+ *-------------------------------------------------------------------------------------*/
+uint64_t bplib_os_nanotime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
 /*--------------------------------------------------------------------------------------
  * bplib_os_sleep
  *-------------------------------------------------------------------------------------*/
 void bplib_os_sleep(int seconds)
 {
+    if(__atomic_load_n(&vclock_running, __ATOMIC_ACQUIRE))
+    {
+        if(seconds > 0) vclock_wait(BP_INVALID_HANDLE, seconds * 1000);
+        return;
+    }
+
     sleep(seconds);
 }
 
@@ -192,20 +1133,46 @@ int bplib_os_createlock(void)
 
     pthread_mutex_lock(&lock_of_locks);
     {
-        int i;
-        for(i = 0; i < BP_MAX_LOCKS; i++)
+        int b, i;
+        for(b = 0; b < BP_MAX_LOCK_BLOCKS && handle == BP_INVALID_HANDLE; b++)
         {
-            if(locks[i] == NULL)
+            bplib_os_lock_block_t* block = &lock_blocks[b];
+
+            /* Allocate Block */
+            if(block->memory == NULL)
+            {
+                block->memory = bplib_os_calloc((sizeof(bplib_os_lock_t) * BP_LOCKS_PER_BLOCK) + BP_CACHE_LINE_SIZE);
+                if(block->memory == NULL) break;
+                uintptr_t aligned = ((uintptr_t)block->memory + BP_CACHE_LINE_SIZE - 1) & ~(uintptr_t)(BP_CACHE_LINE_SIZE - 1);
+                block->locks = (bplib_os_lock_t*)aligned;
+                block->num_used = 0;
+            }
+            else if(block->num_used == BP_LOCKS_PER_BLOCK)
             {
-                locks[i] = (bplib_os_lock_t*)bplib_os_calloc(sizeof(bplib_os_lock_t));
-                if(locks[i] != NULL)
+                continue;
+            }
+
+            /* Find Free Lock in Block */
+            for(i = 0; i < BP_LOCKS_PER_BLOCK; i++)
+            {
+                bplib_os_lock_t* lock = &block->locks[i];
+                if(!lock->in_use)
                 {
+                    #ifdef BP_POSIX_FUTEX
+                    lock->state = 0;
+                    lock->sequence = 0;
+                    lock->waiters = 0;
+                    lock->spins = 0;
+                    #else
                     pthread_mutexattr_t attr;
                     pthread_mutexattr_init(&attr);
                     pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
-                    pthread_mutex_init(&locks[i]->mutex, &attr);
-                    pthread_cond_init(&locks[i]->cond, NULL);
-                    handle = i;
+                    pthread_mutex_init(&lock->mutex, &attr);
+                    init_monotonic_cond(&lock->cond);
+                    #endif
+                    lock->in_use = true;
+                    block->num_used++;
+                    handle = (b * BP_LOCKS_PER_BLOCK) + i;
                     break;
                 }
             }
@@ -223,12 +1190,23 @@ void bplib_os_destroylock(int handle)
 {
     pthread_mutex_lock(&lock_of_locks);
     {
-        if(locks[handle] != NULL)
+        bplib_os_lock_block_t* block = &lock_blocks[handle / BP_LOCKS_PER_BLOCK];
+        bplib_os_lock_t* lock = get_lock(handle);
+        if(lock->in_use)
         {
-            pthread_mutex_destroy(&locks[handle]->mutex);
-            pthread_cond_destroy(&locks[handle]->cond);
-            bplib_os_free(locks[handle]);
-            locks[handle] = NULL;
+            #ifndef BP_POSIX_FUTEX
+            pthread_mutex_destroy(&lock->mutex);
+            pthread_cond_destroy(&lock->cond);
+            #endif
+            lock->in_use = false;
+
+            /* Free Block when Last Lock Destroyed */
+            if(--block->num_used == 0)
+            {
+                bplib_os_free(block->memory);
+                block->memory = NULL;
+                block->locks = NULL;
+            }
         }
     }
     pthread_mutex_unlock(&lock_of_locks);
@@ -239,7 +1217,25 @@ void bplib_os_destroylock(int handle)
  *-------------------------------------------------------------------------------------*/
 void bplib_os_lock(int handle)
 {
-    pthread_mutex_lock(&locks[handle]->mutex);
+    #ifdef BP_POSIX_FUTEX
+    futex_lock(get_lock(handle));
+    #else
+    pthread_mutex_lock(&get_lock(handle)->mutex);
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * bplib_os_trylock -
+ *-------------------------------------------------------------------------------------*/
+int bplib_os_trylock(int handle)
+{
+    #ifdef BP_POSIX_FUTEX
+    int unlocked = 0;
+    bool locked = __atomic_compare_exchange_n(&get_lock(handle)->state, &unlocked, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+    return locked ? BP_SUCCESS : BP_TIMEOUT;
+    #else
+    return (pthread_mutex_trylock(&get_lock(handle)->mutex) == 0) ? BP_SUCCESS : BP_TIMEOUT;
+    #endif
 }
 
 /*--------------------------------------------------------------------------------------
@@ -247,7 +1243,11 @@ void bplib_os_lock(int handle)
  *-------------------------------------------------------------------------------------*/
 void bplib_os_unlock(int handle)
 {
-    pthread_mutex_unlock(&locks[handle]->mutex);
+    #ifdef BP_POSIX_FUTEX
+    futex_unlock(get_lock(handle));
+    #else
+    pthread_mutex_unlock(&get_lock(handle)->mutex);
+    #endif
 }
 
 /*--------------------------------------------------------------------------------------
@@ -255,7 +1255,22 @@ void bplib_os_unlock(int handle)
  *-------------------------------------------------------------------------------------*/
 void bplib_os_signal(int handle)
 {
-    pthread_cond_signal(&locks[handle]->cond);
+    if(__atomic_load_n(&vclock_running, __ATOMIC_ACQUIRE))
+    {
+        vclock_signal(handle);
+    }
+
+    #ifdef BP_POSIX_FUTEX
+    bplib_os_lock_t* lock = get_lock(handle);
+    __atomic_fetch_add(&lock->sequence, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&lock->waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+        /* System Call Only Needed when a Thread is Waiting */
+        futex_wake(&lock->sequence, 1);
+    }
+    #else
+    pthread_cond_signal(&get_lock(handle)->cond);
+    #endif
 }
 
 /*--------------------------------------------------------------------------------------
@@ -264,12 +1279,51 @@ void bplib_os_signal(int handle)
 int bplib_os_waiton(int handle, int timeout_ms)
 {
     int status;
+    bplib_os_lock_t* lock = get_lock(handle);
+
+    if(timeout_ms != 0 && __atomic_load_n(&vclock_running, __ATOMIC_ACQUIRE))
+    {
+        /* Wait on Virtual Time */
+        return vclock_wait(handle, timeout_ms);
+    }
+
+    #ifdef BP_POSIX_FUTEX
+
+    if(timeout_ms == 0)
+    {
+        /* Non-blocking Attempt is an Immediate Timeout */
+        return BP_TIMEOUT;
+    }
+
+    /* Build Relative Time Structure */
+    struct timespec ts;
+    ts.tv_sec  = (time_t) (timeout_ms / 1000);
+    ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+    /* Wait for Sequence to Change (a signal after it is read wakes immediately) */
+    __atomic_fetch_add(&lock->waiters, 1, __ATOMIC_SEQ_CST);
+    int sequence = __atomic_load_n(&lock->sequence, __ATOMIC_SEQ_CST);
+    futex_unlock(lock);
+    if(futex_wait(&lock->sequence, sequence, (timeout_ms == -1) ? NULL : &ts) == -1 && errno == ETIMEDOUT)
+    {
+        status = BP_TIMEOUT;
+    }
+    else
+    {
+        status = BP_SUCCESS;
+    }
+
+    /* Reacquire Lock (other waiters may have been woken too) */
+    futex_lock_slow(lock);
+    __atomic_fetch_sub(&lock->waiters, 1, __ATOMIC_SEQ_CST);
+
+    #else
 
     /* Perform Wait */
     if(timeout_ms == -1)
     {
         /* Block Forever until Success */
-        status = pthread_cond_wait(&locks[handle]->cond, &locks[handle]->mutex);
+        status = pthread_cond_wait(&lock->cond, &lock->mutex);
         if(status != 0) status = BP_ERROR;
         else            status = BP_SUCCESS;
     }
@@ -277,7 +1331,7 @@ int bplib_os_waiton(int handle, int timeout_ms)
     {
         /* Build Time Structure */
         struct timespec ts;
-        clock_gettime(CLOCK_REALTIME, &ts);
+        clock_gettime(CLOCK_MONOTONIC, &ts);
         ts.tv_sec  += (time_t) (timeout_ms / 1000);
         ts.tv_nsec +=  (timeout_ms % 1000) * 1000000L;
         if(ts.tv_nsec  >= 1000000000L)
@@ -287,7 +1341,7 @@ int bplib_os_waiton(int handle, int timeout_ms)
         }
 
         /* Block on Timed Wait and Update Timeout */
-        status = pthread_cond_timedwait(&locks[handle]->cond, &locks[handle]->mutex, &ts);
+        status = pthread_cond_timedwait(&lock->cond, &lock->mutex, &ts);
         if(status == ETIMEDOUT) status = BP_TIMEOUT;
         else                    status = BP_SUCCESS;
     }
@@ -298,6 +1352,8 @@ int bplib_os_waiton(int handle, int timeout_ms)
         status = BP_TIMEOUT;
     }
 
+    #endif
+
     /* Return Status */
     return status;
 }
@@ -340,24 +1396,51 @@ int bplib_os_strnlen(const char* str, int maxlen)
  *----------------------------------------------------------------------------*/
 void* bplib_os_calloc(size_t size)
 {
+    return bplib_os_calloc_tag(size, BP_MEM_GENERAL);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_calloc_tag - allocates zeroed memory accounted to a subsystem
+ *----------------------------------------------------------------------------*/
+void* bplib_os_calloc_tag(size_t size, int tag)
+{
+    uint8_t* mem_ptr = NULL;
+    size_t header_size = sizeof(bplib_os_mem_header_t);
+    size_t alignment = sizeof(bplib_os_mem_header_t);
+
+    /* Check Tag */
+    if(tag < 0 || tag >= BP_MEM_NUM_TAGS) tag = BP_MEM_GENERAL;
+
+    /* Align Large Tables to Huge Pages */
+    if(size >= BP_LARGE_BLOCK_SIZE)
+    {
+        header_size = BP_LARGE_BLOCK_HEADER;
+        alignment = BP_LARGE_BLOCK_SIZE;
+    }
+
     /* Allocate Memory Block */
-    size_t block_size = size + sizeof(size_t);
-    uint8_t* mem_ptr = (uint8_t*)calloc(block_size, 1);
+    size_t block_size = size + header_size;
+    mem_ptr = (uint8_t*)alloc_func(block_size, alignment);
     if(mem_ptr)
     {
-        /* Prepend Amount */
-        size_t* size_ptr = (size_t*)mem_ptr;
-        *size_ptr = block_size;
+        memset(mem_ptr, 0, block_size);
+
+        /* Prepend Amount and Tag */
+        bplib_os_mem_header_t* header = (bplib_os_mem_header_t*)(mem_ptr + header_size - sizeof(bplib_os_mem_header_t));
+        header->size = block_size;
+        header->tag = (size_t)tag;
 
-        /* Update Statistics */
-        current_memory_allocated += block_size;
-        if(current_memory_allocated > highest_memory_allocated)
+        /* Update Statistics (high water mark is sampled, and always on large blocks) */
+        bplib_os_mem_slot_t* slot = get_mem_slot();
+        __atomic_add_fetch(&slot->used[tag], (long)block_size, __ATOMIC_RELAXED);
+        unsigned int allocations = __atomic_add_fetch(&slot->allocations, 1, __ATOMIC_RELAXED);
+        if((allocations % BP_MEM_HIGH_SAMPLE) == 0 || size >= BP_LARGE_BLOCK_SIZE)
         {
-            highest_memory_allocated = current_memory_allocated;
+            update_memhigh();
         }
 
         /* Return User Block */
-        return (mem_ptr + sizeof(size_t));
+        return (mem_ptr + header_size);
     }
     else
     {
@@ -374,15 +1457,24 @@ void bplib_os_free(void* ptr)
     {
         uint8_t* mem_ptr = (uint8_t*)ptr;
 
-        /* Read Amount */
-        size_t* size_ptr = (size_t*)((uint8_t*)mem_ptr - sizeof(size_t));
-        size_t block_size = *size_ptr;
+        /* Read Amount and Tag */
+        bplib_os_mem_header_t* header = (bplib_os_mem_header_t*)(mem_ptr - sizeof(bplib_os_mem_header_t));
+        size_t block_size = header->size;
+        int tag = (int)header->tag;
 
-        /* Update Statistics */
-        current_memory_allocated -= block_size;
+        /* Update Statistics (may be a different thread than allocated it) */
+        bplib_os_mem_slot_t* slot = get_mem_slot();
+        __atomic_sub_fetch(&slot->used[tag], (long)block_size, __ATOMIC_RELAXED);
 
         /* Free Memory Block */
-        free(mem_ptr - sizeof(size_t));
+        if(block_size >= BP_LARGE_BLOCK_SIZE + BP_LARGE_BLOCK_HEADER)
+        {
+            free_func(mem_ptr - BP_LARGE_BLOCK_HEADER);
+        }
+        else
+        {
+            free_func(mem_ptr - sizeof(bplib_os_mem_header_t));
+        }
     }
 }
 
@@ -391,7 +1483,33 @@ void bplib_os_free(void* ptr)
  *----------------------------------------------------------------------------*/
 size_t bplib_os_memused(void)
 {
-    return current_memory_allocated;
+    size_t total = 0;
+    int tag;
+    for(tag = 0; tag < BP_MEM_NUM_TAGS; tag++)
+    {
+        total += bplib_os_memused_tag(tag);
+    }
+    return total;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_memused_tag - how many bytes of memory currently allocated to a subsystem
+ *----------------------------------------------------------------------------*/
+size_t bplib_os_memused_tag(int tag)
+{
+    long total = 0;
+    int i;
+
+    if(tag < 0 || tag >= BP_MEM_NUM_TAGS) return 0;
+
+    /* Aggregate Thread Counters */
+    for(i = 0; i < BP_MEM_SLOTS; i++)
+    {
+        total += __atomic_load_n(&mem_slots[i].used[tag], __ATOMIC_RELAXED);
+    }
+
+    /* Counters Read while Other Threads Allocate and Free Can Momentarily Go Negative */
+    return (total > 0) ? (size_t)total : 0;
 }
 
 /*----------------------------------------------------------------------------
@@ -399,5 +1517,95 @@ size_t bplib_os_memused(void)
  *----------------------------------------------------------------------------*/
 size_t bplib_os_memhigh(void)
 {
-    return highest_memory_allocated;
+    update_memhigh();
+    return __atomic_load_n(&highest_memory_allocated, __ATOMIC_RELAXED);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_allocator - must be set before any memory is allocated
+ *----------------------------------------------------------------------------*/
+void bplib_os_allocator(bp_alloc_func_t alloc, bp_free_func_t dealloc)
+{
+    alloc_func = alloc ? alloc : default_alloc;
+    free_func = dealloc ? dealloc : free;
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_timesource - timed waits on locks still use the real monotonic clock,
+ *  see bplib_os_vclock_start for waits that follow virtual time
+ *----------------------------------------------------------------------------*/
+void bplib_os_timesource(bp_time_func_t systime, bp_time_func_t monotime)
+{
+    __atomic_store_n(&systime_func, systime, __ATOMIC_RELEASE);
+    __atomic_store_n(&monotime_func, monotime, __ATOMIC_RELEASE);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_start - virtual time starts at zero and both clocks follow it;
+ *  when all threads taking part are blocked in waits and sleeps, it jumps to the
+ *  earliest timeout; with no threads it only moves when advanced
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_start(unsigned long start, int threads)
+{
+    pthread_mutex_lock(&vclock_mutex);
+    {
+        vclock_release();
+        vclock_start = start;
+        vclock_threads = threads;
+        __atomic_store_n(&vclock_now, 0, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&vclock_mutex);
+
+    bplib_os_timesource(vclock_systime, vclock_monotime);
+    __atomic_store_n(&vclock_running, true, __ATOMIC_RELEASE);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_stop - threads still waiting time out, virtual time keeps its value
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_stop(void)
+{
+    __atomic_store_n(&vclock_running, false, __ATOMIC_RELEASE);
+    bplib_os_timesource(NULL, NULL);
+
+    pthread_mutex_lock(&vclock_mutex);
+    {
+        vclock_release();
+        vclock_threads = 0;
+    }
+    pthread_mutex_unlock(&vclock_mutex);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_threads - threads taking part join with 1 and leave with -1
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_threads(int change)
+{
+    pthread_mutex_lock(&vclock_mutex);
+    {
+        vclock_threads += change;
+        vclock_idle();
+    }
+    pthread_mutex_unlock(&vclock_mutex);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_advance -
+ *----------------------------------------------------------------------------*/
+void bplib_os_vclock_advance(unsigned long ms)
+{
+    pthread_mutex_lock(&vclock_mutex);
+    {
+        __atomic_store_n(&vclock_now, vclock_now + ms, __ATOMIC_RELEASE);
+        vclock_expire();
+    }
+    pthread_mutex_unlock(&vclock_mutex);
+}
+
+/*----------------------------------------------------------------------------
+ * bplib_os_vclock_now -
+ *----------------------------------------------------------------------------*/
+unsigned long bplib_os_vclock_now(void)
+{
+    return __atomic_load_n(&vclock_now, __ATOMIC_ACQUIRE);
 }
@@ -30,3 +30,20 @@ APP_COPT += -O3
 
 # Disable Asserts #
 APP_COPT += -DNDEBUG
+
+# Lightweight Locks #
+#  non-recursive futex locks with adaptive spinning (Linux only) when built
+#  with 'make FUTEX=1', otherwise locks are recursive pthread mutexes and
+#  condition variables
+ifeq ($(FUTEX)$(shell uname -s),1Linux)
+APP_COPT += -DBP_POSIX_FUTEX
+endif
+
+# Trace Points #
+#  timed stages of store, load, process, and accept reported to a hook, a
+#  recorder, or USDT probes (when systemtap's sys/sdt.h is installed);
+#  a relaxed load and a branch per stage while nothing is listening
+APP_COPT += -DBP_TRACE
+ifneq ($(wildcard /usr/include/sys/sdt.h),)
+APP_COPT += -DBP_TRACE_USDT
+endif
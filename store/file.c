@@ -206,6 +206,119 @@ BP_LOCAL_SCOPE int delete_tbl_file (int service_id, char* file_root, uint32_t fi
     }
 }
 
+/*--------------------------------------------------------------------------------------
+ * relinquish_data -
+ *
+ *  Notes:  must be called with the lock of the file store held
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int relinquish_data (file_store_t* fs, bp_sid_t sid)
+{
+    /* Get IDs */
+    unsigned long data_id = GET_DATAID(sid);
+    unsigned long file_id = GET_FILEID(data_id);
+    unsigned long data_offset = GET_DATAOFFSET(data_id);
+    unsigned long prev_data_id = GET_DATAID(fs->relinquish_data_id);
+    unsigned long prev_file_id = GET_FILEID(prev_data_id);
+
+    /* Clear Data Cache */
+    unsigned long cache_index = data_id % fs->cache_size;
+    if(fs->data_cache[cache_index].mem_ptr)
+    {
+        if(fs->data_cache[cache_index].mem_data_id == data_id)
+        {
+            bplib_os_free(fs->data_cache[cache_index].mem_ptr);
+            fs->data_cache[cache_index].mem_ptr = NULL;
+            fs->data_cache[cache_index].mem_data_id = BP_SID_VACANT;
+            fs->data_cache[cache_index].mem_locked = FILE_MEM_AVAIABLE;
+        }
+    }
+
+    /* Check Need to Read New Relinquish Table */
+    if(file_id != prev_file_id)
+    {
+        /* Set Current Relinquish Table */
+        fs->relinquish_data_id = (unsigned long)sid;
+
+        /* Check Need to Save Off Previous Relinquish Table */
+        if(fs->relinquish_table.free_cnt > 0)
+        {
+            /* Open Previous Relinquish File */
+            if(fs->relinquish_fd == NULL)
+            {
+                fs->relinquish_fd = open_tbl_file(fs->service_id, fs->file_root, prev_file_id, false);
+                if(fs->relinquish_fd == NULL)
+                {
+                    return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed to relinquish data\n");
+                }
+            }
+
+            /* Write Previous Relinquish Table */
+            unsigned long bytes_written = file_driver.write(&fs->relinquish_table, 1, sizeof(fs->relinquish_table), fs->relinquish_fd);
+
+            /* Close Previous Relinquish File */
+            file_driver.close(fs->relinquish_fd);
+            fs->relinquish_fd = NULL;
+
+            /* Check Status of Write */
+            if(bytes_written != sizeof(fs->relinquish_table))
+            {
+                return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed to update relinquish table (%d != %d)\n", bytes_written, sizeof(fs->relinquish_table));
+            }
+        }
+
+        /* Open New Relinquish File */
+        fs->relinquish_fd = open_tbl_file(fs->service_id, fs->file_root, file_id, true);
+        if(fs->relinquish_fd == NULL)
+        {
+            /* Initialize New Relinquish Table */
+            memset(&fs->relinquish_table, 0, sizeof(fs->relinquish_table));
+        }
+        else
+        {
+            /* Read Relinquish Table */
+            unsigned long bytes_read = file_driver.read(&fs->relinquish_table, 1, sizeof(fs->relinquish_table), fs->relinquish_fd);
+
+            /* Close New Relinquish File */
+            file_driver.close(fs->relinquish_fd);
+            fs->relinquish_fd = NULL;
+
+            /* Check for Error */
+            if(bytes_read != sizeof(fs->relinquish_table))
+            {
+                return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed to read new relinquish table (%d != %d)\n", bytes_read, sizeof(fs->relinquish_table));
+            }
+        }
+    }
+
+    /* Check if Still Present */
+    if(fs->relinquish_table.freed[data_offset] == 0)
+    {
+        /* Mark Data as Relinquished */
+        fs->relinquish_table.freed[data_offset] = 1;
+        fs->data_count--;
+
+        /* Relinquish Resources */
+        fs->relinquish_table.free_cnt++;
+        if(fs->relinquish_table.free_cnt == FILE_DATA_COUNT)
+        {
+            /* Delete Associated Files
+             *  only check the status of the data file deletion as it is
+             *  possible (and often the case) that the table file is never
+             *  created because the state of which bundles are freed does
+             *  not need to be saved off */
+            delete_tbl_file(fs->service_id, fs->file_root, file_id);
+            int dat_status = delete_dat_file(fs->service_id, fs->file_root, file_id);
+            if(dat_status < 0)
+            {
+                return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed (%d) to relinquish file\n", dat_status);
+            }
+        }
+    }
+
+    /* Return Success */
+    return BP_SUCCESS;
+}
+
 /******************************************************************************
  EXPORTED FUNCTIONS
  ******************************************************************************/
@@ -270,7 +383,7 @@ int bplib_store_file_create (int type, bp_ipn_t node, bp_ipn_t service, bool rec
             int root_path_len = bplib_os_strnlen(root_path, FILE_MAX_FILENAME) + 1;
             if(root_path_len <= FILE_MAX_FILENAME)
             {
-                file_stores[s].file_root = (char*)bplib_os_calloc(root_path_len);
+                file_stores[s].file_root = (char*)bplib_os_calloc_tag(root_path_len, BP_MEM_STORE);
                 if(file_stores[s].file_root)
                 {
                     memcpy(file_stores[s].file_root, root_path, root_path_len);
@@ -289,7 +402,7 @@ int bplib_store_file_create (int type, bp_ipn_t node, bp_ipn_t service, bool rec
             int cache_size = FILE_DEFAULT_CACHE_SIZE;
             if(attr && attr->cache_size) cache_size = attr->cache_size;
             file_stores[s].cache_size = cache_size;
-            file_stores[s].data_cache = (data_cache_t*)bplib_os_calloc(cache_size * sizeof(data_cache_t));
+            file_stores[s].data_cache = (data_cache_t*)bplib_os_calloc_tag(cache_size * sizeof(data_cache_t), BP_MEM_STORE);
 
             /* Set Flush Attribute */
             if(attr)    file_stores[s].flush_on_write = attr->flush_on_write;
@@ -543,7 +656,7 @@ int bplib_store_file_dequeue (int handle, bp_object_t** object, int timeout)
         bytes_read = file_driver.read(&object_size, 1, sizeof(object_size), fs->read_fd);
         if(bytes_read == sizeof(object_size))
         {
-            object_ptr = (unsigned char*)bplib_os_calloc(object_size);
+            object_ptr = (unsigned char*)bplib_os_calloc_tag(object_size, BP_MEM_STORE);
             bytes_read = file_driver.read(object_ptr, 1, object_size, fs->read_fd);
             if(bytes_read == object_size)
             {
@@ -740,7 +853,7 @@ int bplib_store_file_retrieve (int handle, bp_sid_t sid, bp_object_t** object, i
         bytes_read = file_driver.read(&object_size, 1, sizeof(object_size), fs->retrieve_fd);
         if(bytes_read == sizeof(object_size))
         {
-            object_ptr = (unsigned char*)bplib_os_calloc(object_size);
+            object_ptr = (unsigned char*)bplib_os_calloc_tag(object_size, BP_MEM_STORE);
             bytes_read = file_driver.read(object_ptr, 1, object_size, fs->retrieve_fd);
             if(bytes_read == object_size)
             {
@@ -852,118 +965,42 @@ int bplib_store_file_relinquish (int handle, bp_sid_t sid)
     assert(file_stores[handle].in_use);
 
     file_store_t* fs = (file_store_t*)&file_stores[handle];
+    int status = BP_SUCCESS;
+
     bplib_os_lock(fs->lock);
     {
-        /* Get IDs */
-        unsigned long data_id = GET_DATAID(sid);
-        unsigned long file_id = GET_FILEID(data_id);
-        unsigned long data_offset = GET_DATAOFFSET(data_id);
-        unsigned long prev_data_id = GET_DATAID(fs->relinquish_data_id);
-        unsigned long prev_file_id = GET_FILEID(prev_data_id);
-
-        /* Clear Data Cache */
-        unsigned long cache_index = data_id % fs->cache_size;
-        if(fs->data_cache[cache_index].mem_ptr)
-        {
-            if(fs->data_cache[cache_index].mem_data_id == data_id)
-            {
-                bplib_os_free(fs->data_cache[cache_index].mem_ptr);
-                fs->data_cache[cache_index].mem_ptr = NULL;
-                fs->data_cache[cache_index].mem_data_id = BP_SID_VACANT;
-                fs->data_cache[cache_index].mem_locked = FILE_MEM_AVAIABLE;
-            }
-        }
-
-        /* Check Need to Read New Relinquish Table */
-        if(file_id != prev_file_id)
-        {
-            /* Set Current Relinquish Table */
-            fs->relinquish_data_id = (unsigned long)sid;
-
-            /* Check Need to Save Off Previous Relinquish Table */
-            if(fs->relinquish_table.free_cnt > 0)
-            {
-                /* Open Previous Relinquish File */
-                if(fs->relinquish_fd == NULL)
-                {
-                    fs->relinquish_fd = open_tbl_file(fs->service_id, fs->file_root, prev_file_id, false);
-                    if(fs->relinquish_fd == NULL)
-                    {
-                        bplib_os_unlock(fs->lock);
-                        return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed to relinquish data\n");
-                    }
-                }
-
-                /* Write Previous Relinquish Table */
-                unsigned long bytes_written = file_driver.write(&fs->relinquish_table, 1, sizeof(fs->relinquish_table), fs->relinquish_fd);
-
-                /* Close Previous Relinquish File */
-                file_driver.close(fs->relinquish_fd);
-                fs->relinquish_fd = NULL;
-
-                /* Check Status of Write */
-                if(bytes_written != sizeof(fs->relinquish_table))
-                {
-                    bplib_os_unlock(fs->lock);
-                    return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed to update relinquish table (%d != %d)\n", bytes_written, sizeof(fs->relinquish_table));
-                }
-            }
+        status = relinquish_data(fs, sid);
+    }
+    bplib_os_unlock(fs->lock);
 
-            /* Open New Relinquish File */
-            fs->relinquish_fd = open_tbl_file(fs->service_id, fs->file_root, file_id, true);
-            if(fs->relinquish_fd == NULL)
-            {
-                /* Initialize New Relinquish Table */
-                memset(&fs->relinquish_table, 0, sizeof(fs->relinquish_table));
-            }
-            else
-            {
-                /* Read Relinquish Table */
-                unsigned long bytes_read = file_driver.read(&fs->relinquish_table, 1, sizeof(fs->relinquish_table), fs->relinquish_fd);
+    /* Return Status */
+    return status;
+}
 
-                /* Close New Relinquish File */
-                file_driver.close(fs->relinquish_fd);
-                fs->relinquish_fd = NULL;
+/*--------------------------------------------------------------------------------------
+ * bplib_store_file_relinquish_batch -
+ *-------------------------------------------------------------------------------------*/
+int bplib_store_file_relinquish_batch (int handle, bp_sid_t* sids, int count)
+{
+    assert(handle >= 0 && handle < FILE_MAX_STORES);
+    assert(file_stores[handle].in_use);
 
-                /* Check for Error */
-                if(bytes_read != sizeof(fs->relinquish_table))
-                {
-                    bplib_os_unlock(fs->lock);
-                    return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed to read new relinquish table (%d != %d)\n", bytes_read, sizeof(fs->relinquish_table));
-                }
-            }
-        }
+    file_store_t* fs = (file_store_t*)&file_stores[handle];
+    int status = BP_SUCCESS;
+    int i;
 
-        /* Check if Still Present */
-        if(fs->relinquish_table.freed[data_offset] == 0)
+    bplib_os_lock(fs->lock);
+    {
+        for(i = 0; i < count; i++)
         {
-            /* Mark Data as Relinquished */
-            fs->relinquish_table.freed[data_offset] = 1;
-            fs->data_count--;
-
-            /* Relinquish Resources */
-            fs->relinquish_table.free_cnt++;
-            if(fs->relinquish_table.free_cnt == FILE_DATA_COUNT)
-            {
-                /* Delete Associated Files
-                 *  only check the status of the data file deletion as it is
-                 *  possible (and often the case) that the table file is never
-                 *  created because the state of which bundles are freed does
-                 *  not need to be saved off */
-                delete_tbl_file(fs->service_id, fs->file_root, file_id);
-                int dat_status = delete_dat_file(fs->service_id, fs->file_root, file_id);
-                if(dat_status < 0)
-                {
-                    bplib_os_unlock(fs->lock);
-                    return bplog(NULL, BP_FLAG_STORE_FAILURE, "Failed (%d) to relinquish file\n", dat_status);
-                }
-            }
+            int sid_status = relinquish_data(fs, sids[i]);
+            if(sid_status != BP_SUCCESS) status = sid_status;
         }
     }
     bplib_os_unlock(fs->lock);
 
-    /* Return Success */
-    return BP_SUCCESS;
+    /* Return Status */
+    return status;
 }
 
 /*--------------------------------------------------------------------------------------
@@ -112,6 +112,7 @@ BP_LOCAL_SCOPE const char* type2str(int type)
     if(type == BP_STORE_DATA_TYPE) type_str = "bundle(s)";
     else if(type == BP_STORE_PAYLOAD_TYPE) type_str = "payload(s)";
     else if(type == BP_STORE_DACS_TYPE) type_str = "dacs(s)";
+    else if(type == BP_STORE_JOURNAL_TYPE) type_str = "journal record(s)";
     return type_str;
 }
 
@@ -646,7 +647,7 @@ int bplib_store_flash_init (bp_flash_driver_t driver, bool sw_edac)
         }
 
         /* Allocate Memory for Block Control */
-        flash_blocks = (flash_block_control_t*)bplib_os_calloc(sizeof(flash_block_control_t) * FLASH_DRIVER.num_blocks);
+        flash_blocks = (flash_block_control_t*)bplib_os_calloc_tag(sizeof(flash_block_control_t) * FLASH_DRIVER.num_blocks, BP_MEM_STORE);
         if(flash_blocks == NULL)
         {
             bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unable to allocate memory for flash block control information\n");
@@ -667,7 +668,7 @@ int bplib_store_flash_init (bp_flash_driver_t driver, bool sw_edac)
         }
 
         /* Allocate Page Buffer (used by ECC and for object deletes) */
-        flash_page_buffer = (uint8_t*)bplib_os_calloc(FLASH_DRIVER.page_size);
+        flash_page_buffer = (uint8_t*)bplib_os_calloc_tag(FLASH_DRIVER.page_size, BP_MEM_STORE);
         if(!flash_page_buffer)
         {
             bplog(NULL, BP_FLAG_DIAGNOSTIC, "Unable to allocate memory for flash page buffer\n");
@@ -942,8 +943,8 @@ int bplib_store_flash_create (int type, bp_ipn_t node, bp_ipn_t service, bool re
     if(handle != BP_INVALID_HANDLE)
     {
         flash_stores[s].stage_locked = false;
-        flash_stores[s].write_stage = (uint8_t*)bplib_os_calloc(flash_stores[s].attributes.max_data_size);
-        flash_stores[s].read_stage = (uint8_t*)bplib_os_calloc(flash_stores[s].attributes.max_data_size);
+        flash_stores[s].write_stage = (uint8_t*)bplib_os_calloc_tag(flash_stores[s].attributes.max_data_size, BP_MEM_STORE);
+        flash_stores[s].read_stage = (uint8_t*)bplib_os_calloc_tag(flash_stores[s].attributes.max_data_size, BP_MEM_STORE);
         if((flash_stores[s].write_stage == NULL) ||
         (flash_stores[s].read_stage == NULL) )
         {
@@ -972,8 +973,13 @@ int bplib_store_flash_destroy (int handle)
     assert(handle >= 0 && handle < FLASH_MAX_STORES);
     assert(flash_stores[handle].in_use);
 
-    /* If Preserving:
-     *  Reset Active Block to Read Address - this will cause any bundles that are 
+    /* If Preserving Bundles:
+     *  Keep all blocks, including those holding bundles that were dequeued but not yet
+     *  relinquished; the library journals the storage IDs of its active bundles and
+     *  retrieves or relinquishes them by storage ID once the store is recovered.
+     *
+     * If Preserving Other Types:
+     *  Reset Active Block to Read Address - this will cause any objects that are 
      *  active to be lost.  Since this store doesn't keep track of individual free pages, 
      *  there is no way to reset the active address to the exact page (the active address 
      *  only keeps track of the block for this reason). 
@@ -981,9 +987,10 @@ int bplib_store_flash_destroy (int handle)
      * If Not Preserving:
      *  Reclaim all blocks from the active block all the way to the end.  This drains all
      *  the blocks associated with this store from flash. */
+    bool keep_active = flash_stores[handle].type == BP_STORE_DATA_TYPE;
     while( (flash_stores[handle].active_block != BP_FLASH_INVALID_INDEX) && 
            ( (!flash_stores[handle].preserve) ||
-             (flash_stores[handle].active_block != flash_stores[handle].read_addr.block) ) )
+             ( (!keep_active) && (flash_stores[handle].active_block != flash_stores[handle].read_addr.block) ) ) )
     {
         /* Get Next Block */
         bp_flash_index_t next_active_block = flash_blocks[flash_stores[handle].active_block].next_block;
@@ -1024,15 +1031,14 @@ int bplib_store_flash_destroy (int handle)
     }
     else
     {
-        int active_bundles = flash_stores[handle].object_count - flash_stores[handle].unactive_count;
-        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Deleting %d abandoned %s from ipn:%d.%d in flash store\n", 
-                                        active_bundles, type2str(flash_stores[handle].type), 
+        int active_objects = flash_stores[handle].object_count - flash_stores[handle].unactive_count;
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s %d active %s from ipn:%d.%d in flash store\n", 
+                                        keep_active ? "Preserving" : "Deleting", active_objects, type2str(flash_stores[handle].type), 
                                         flash_stores[handle].node, flash_stores[handle].service);
     }
 
-
     /* Set Store Properties */
-    flash_stores[handle].object_count = flash_stores[handle].unactive_count;
+    if(!keep_active) flash_stores[handle].object_count = flash_stores[handle].unactive_count;
     flash_stores[handle].in_use = false;
 
     return BP_SUCCESS;
@@ -1223,3 +1229,31 @@ int bplib_store_flash_getcount (int handle)
 
     return fs->object_count;
 }
+
+/*--------------------------------------------------------------------------------------
+ * bplib_store_flash_relinquish_batch -
+ *-------------------------------------------------------------------------------------*/
+int bplib_store_flash_relinquish_batch (int handle, bp_sid_t* sids, int count)
+{
+    assert(handle >= 0 && handle < FLASH_MAX_STORES);
+    assert(flash_stores[handle].in_use);
+
+    flash_store_t* fs = (flash_store_t*)&flash_stores[handle];
+    int status = BP_SUCCESS;
+    int i;
+
+    bplib_os_lock(flash_device_lock);
+    {
+        /* Delete Pages Containing Objects */
+        for(i = 0; i < count; i++)
+        {
+            int sid_status = flash_object_delete(fs, sids[i]);
+            if(sid_status == BP_SUCCESS)    fs->object_count--;
+            else                            status = sid_status;
+        }
+    }
+    bplib_os_unlock(flash_device_lock);
+
+    /* Return Status */
+    return status;
+}
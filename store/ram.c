@@ -148,7 +148,7 @@ BP_LOCAL_SCOPE int enqueue(queue_t* q, void* data, int size)
     }
 
     /* create temp node */
-    queue_node_t* temp = (queue_node_t*)bplib_os_calloc((int)sizeof(queue_node_t));
+    queue_node_t* temp = (queue_node_t*)bplib_os_calloc_tag((int)sizeof(queue_node_t), BP_MEM_STORE);
     if(!temp) return MSGQ_MEMORY_ERROR;
 
     /* construct node to be added */
@@ -242,7 +242,7 @@ BP_LOCAL_SCOPE msgq_t msgq_create(const char* name, int depth, int data_size)
     }
 
     /* Allocate MSG Q */
-    msgQ = (message_queue_t*)bplib_os_calloc(sizeof(message_queue_t));
+    msgQ = (message_queue_t*)bplib_os_calloc_tag(sizeof(message_queue_t), BP_MEM_STORE);
     if(msgQ == NULL)
     {
         printf("ERROR, Unable to allocate message queue: %s\n", name);
@@ -439,7 +439,7 @@ int bplib_store_ram_enqueue(int handle, void* data1, int data1_size,
     int status;
     int data_size = data1_size + data2_size;
     int object_size = sizeof(bp_object_hdr_t) + data_size;
-    bp_object_t* object = (bp_object_t*)bplib_os_calloc(object_size);
+    bp_object_t* object = (bp_object_t*)bplib_os_calloc_tag(object_size, BP_MEM_STORE);
 
     /* Check memory allocation */
     if(!object) return BP_ERROR;
@@ -557,3 +557,22 @@ int bplib_store_ram_getcount (int handle)
 
     return msgq_counts[handle];
 }
+
+/*----------------------------------------------------------------------------
+ * bplib_store_ram_relinquish_batch -
+ *----------------------------------------------------------------------------*/
+int bplib_store_ram_relinquish_batch (int handle, bp_sid_t* sids, int count)
+{
+    assert(handle >= 0 && handle < MSGQ_MAX_STORES);
+    assert(msgq_stores[handle]);
+
+    int i;
+    for(i = 0; i < count; i++)
+    {
+        bp_object_t* object = (void*)sids[i];
+        bplib_os_free(object);
+    }
+    msgq_counts[handle] -= count;
+
+    return BP_SUCCESS;
+}
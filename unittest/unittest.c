@@ -30,6 +30,17 @@ extern int ut_crc (void);
 extern int ut_rb_tree (void);
 extern int ut_rh_hash (void);
 extern int ut_flash (void);
+extern int ut_reasm (void);
+extern int ut_dedup (void);
+extern int ut_locks (void);
+extern int ut_memory (void);
+extern int ut_log (void);
+extern int ut_record (void);
+extern int ut_range_array (void);
+extern int ut_swiss_table (void);
+extern int ut_link_sim (void);
+extern int ut_trace (void);
+extern int ut_journal (void);
 
 /******************************************************************************
  EXPORTED FUNCTIONS
@@ -83,3 +94,135 @@ int bplib_unittest_flash (void)
         return 0;
     #endif
 }
+
+/*--------------------------------------------------------------------------------------
+ * Reassembly Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_reasm (void)
+{
+    #ifdef UNITTESTS
+        return ut_reasm();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * Duplicate Cache Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_dedup (void)
+{
+    #ifdef UNITTESTS
+        return ut_dedup();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * OS Lock Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_locks (void)
+{
+    #ifdef UNITTESTS
+        return ut_locks();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * OS Memory Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_memory (void)
+{
+    #ifdef UNITTESTS
+        return ut_memory();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * OS Log Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_log (void)
+{
+    #ifdef UNITTESTS
+        return ut_log();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * Storage Record Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_record (void)
+{
+    #ifdef UNITTESTS
+        return ut_record();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * Range Array Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_range_array (void)
+{
+    #ifdef UNITTESTS
+        return ut_range_array();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * Swiss Table Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_swiss_table (void)
+{
+    #ifdef UNITTESTS
+        return ut_swiss_table();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * Link Simulation Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_link_sim (void)
+{
+    #ifdef UNITTESTS
+        return ut_link_sim();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * Trace Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_trace (void)
+{
+    #ifdef UNITTESTS
+        return ut_trace();
+    #else
+        return 0;
+    #endif
+}
+
+/*--------------------------------------------------------------------------------------
+ * Journal Unit Test -
+ *--------------------------------------------------------------------------------------*/
+int bplib_unittest_journal (void)
+{
+    #ifdef UNITTESTS
+        return ut_journal();
+    #else
+        return 0;
+    #endif
+}
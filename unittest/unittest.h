@@ -25,5 +25,16 @@ int bplib_unittest_crc      (void);
 int bplib_unittest_rb_tree  (void);
 int bplib_unittest_rh_hash  (void);
 int bplib_unittest_flash    (void);
+int bplib_unittest_reasm    (void);
+int bplib_unittest_dedup    (void);
+int bplib_unittest_locks    (void);
+int bplib_unittest_memory   (void);
+int bplib_unittest_log      (void);
+int bplib_unittest_record   (void);
+int bplib_unittest_range_array (void);
+int bplib_unittest_swiss_table (void);
+int bplib_unittest_link_sim (void);
+int bplib_unittest_trace    (void);
+int bplib_unittest_journal  (void);
 
 #endif /* _unittest_h_ */
@@ -0,0 +1,146 @@
+/************************************************************************
+ * File: ut_dedup.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "dedup.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define CACHE_SIZE      1000
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * bundle_key
+ *-------------------------------------------------------------------------------------*/
+static dedup_key_t bundle_key(bp_val_t seq, bp_val_t offset)
+{
+    dedup_key_t key = { 1, 2, 1000, seq, offset };
+    return key;
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Duplicates
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    dedup_t dedup;
+    bp_val_t seq;
+
+    printf("\n==== Test 1: Duplicates ====\n");
+
+    ut_assert(dedup_create(&dedup, CACHE_SIZE) == BP_SUCCESS, "Failed to create duplicate cache\n");
+
+    /* First Reception */
+    for(seq = 0; seq < CACHE_SIZE; seq++)
+    {
+        ut_check(dedup_check(&dedup, bundle_key(seq, 0), 10) == BP_SUCCESS);
+        ut_check(dedup_add(&dedup, bundle_key(seq, 0), 0, 10) == BP_SUCCESS);
+    }
+    ut_assert(dedup_count(&dedup) == CACHE_SIZE, "Incorrect number of entries: %d\n", dedup_count(&dedup));
+
+    /* Retransmissions */
+    for(seq = 0; seq < CACHE_SIZE; seq++)
+    {
+        ut_assert(dedup_check(&dedup, bundle_key(seq, 0), 10) == BP_DUPLICATE, "Failed to detect duplicate %lu\n", (unsigned long)seq);
+    }
+
+    /* Other Fragments, Sources, and Creation Times are Not Duplicates */
+    dedup_key_t key = bundle_key(5, 0);
+    ut_check(dedup_check(&dedup, bundle_key(5, 100), 10) == BP_SUCCESS);
+    key.srcserv = 3;
+    ut_check(dedup_check(&dedup, key, 10) == BP_SUCCESS);
+    key = bundle_key(5, 0);
+    key.createsec = 1001;
+    ut_check(dedup_check(&dedup, key, 10) == BP_SUCCESS);
+
+    /* Adding Again Does Not Add an Entry */
+    ut_check(dedup_add(&dedup, bundle_key(5, 0), 0, 10) == BP_SUCCESS);
+    ut_check(dedup_count(&dedup) == CACHE_SIZE);
+
+    ut_assert(dedup_destroy(&dedup) == BP_SUCCESS, "Failed to destroy duplicate cache\n");
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Capacity and Expiration
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    dedup_t dedup;
+    bp_val_t seq;
+
+    printf("\n==== Test 2: Capacity and Expiration ====\n");
+
+    ut_assert(dedup_create(&dedup, 3) == BP_SUCCESS, "Failed to create duplicate cache\n");
+
+    /* Fourth Forgets Oldest */
+    for(seq = 0; seq < 4; seq++) ut_check(dedup_add(&dedup, bundle_key(seq, 0), 100 + seq, 10) == BP_SUCCESS);
+    ut_check(dedup_count(&dedup) == 3);
+    ut_check(dedup_check(&dedup, bundle_key(0, 0), 10) == BP_SUCCESS);
+    ut_check(dedup_check(&dedup, bundle_key(1, 0), 10) == BP_DUPLICATE);
+    ut_check(dedup_check(&dedup, bundle_key(3, 0), 10) == BP_DUPLICATE);
+
+    /* Unreliable Time Forgets Nothing */
+    ut_check(dedup_check(&dedup, bundle_key(1, 0), 0) == BP_DUPLICATE);
+
+    /* Expiration */
+    ut_check(dedup_check(&dedup, bundle_key(2, 0), 101) == BP_DUPLICATE);
+    ut_check(dedup_count(&dedup) == 2);
+    ut_check(dedup_check(&dedup, bundle_key(3, 0), 103) == BP_SUCCESS);
+    ut_check(dedup_count(&dedup) == 0);
+
+    /* Expired Out of Order */
+    ut_check(dedup_add(&dedup, bundle_key(4, 0), 0, 200) == BP_SUCCESS);
+    ut_check(dedup_add(&dedup, bundle_key(5, 0), 210, 200) == BP_SUCCESS);
+    ut_check(dedup_check(&dedup, bundle_key(5, 0), 220) == BP_SUCCESS);
+    ut_check(dedup_check(&dedup, bundle_key(4, 0), 220) == BP_DUPLICATE);
+    ut_check(dedup_count(&dedup) == 2);
+
+    ut_assert(dedup_destroy(&dedup) == BP_SUCCESS, "Failed to destroy duplicate cache\n");
+
+    /* Disabled Cache Remembers Nothing */
+    ut_assert(dedup_create(&dedup, 0) == BP_SUCCESS, "Failed to create empty duplicate cache\n");
+    ut_check(dedup_add(&dedup, bundle_key(0, 0), 0, 10) == BP_SUCCESS);
+    ut_check(dedup_check(&dedup, bundle_key(0, 0), 10) == BP_SUCCESS);
+    ut_check(dedup_count(&dedup) == 0);
+    ut_check(dedup_destroy(&dedup) == BP_SUCCESS);
+
+    /* Invalid Size */
+    ut_check(dedup_create(&dedup, -1) == BP_ERROR);
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_dedup (void)
+{
+    ut_reset();
+
+    test_1();
+    test_2();
+
+    return ut_failures();
+}
@@ -0,0 +1,396 @@
+/************************************************************************
+ * File: ut_journal.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "bplib.h"
+#include "bplib_trace.h"
+#include "bplib_store_ram.h"
+#include "bplib_store_flash.h"
+#include "bplib_flash_sim.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define VIRTUAL_START       600000000   /* seconds since 2000 */
+#define TABLE_SIZE          16
+#define NUM_BUNDLES         8
+#define TIMEOUT             10          /* seconds */
+#define MAX_LOADED          64
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+#ifdef BP_TRACE
+
+static bp_flash_driver_t flash_driver = {
+    .num_blocks = FLASH_SIM_NUM_BLOCKS,
+    .pages_per_block = FLASH_SIM_PAGES_PER_BLOCK,
+    .page_size = FLASH_SIM_PAGE_SIZE,
+    .read = bplib_flash_sim_page_read,
+    .write = bplib_flash_sim_page_write,
+    .erase = bplib_flash_sim_block_erase,
+    .isbad = bplib_flash_sim_block_is_bad,
+    .phyblk = bplib_flash_sim_physical_block
+};
+
+static bp_store_t ram_store = {
+    .create     = bplib_store_ram_create,
+    .destroy    = bplib_store_ram_destroy,
+    .enqueue    = bplib_store_ram_enqueue,
+    .dequeue    = bplib_store_ram_dequeue,
+    .retrieve   = bplib_store_ram_retrieve,
+    .release    = bplib_store_ram_release,
+    .relinquish = bplib_store_ram_relinquish,
+    .getcount   = bplib_store_ram_getcount,
+    .relinquish_batch = bplib_store_ram_relinquish_batch
+};
+
+static int journal_store = BP_INVALID_HANDLE;
+static int bundle_store = BP_INVALID_HANDLE;
+static bool crashed;                        /* journal records fail to be stored, as if power was lost */
+static bp_sid_t last_dequeued = BP_SID_VACANT;
+static bp_sid_t stale_sid = BP_SID_VACANT;  /* retrieved as reused_sid, as if the storage ID was reused */
+static bp_sid_t reused_sid = BP_SID_VACANT;
+
+static const void* traced_channel;
+static bp_val_t loaded_cids[MAX_LOADED];
+static int num_loaded;
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * test_create - flash store that remembers the handles of the bundle and journal stores
+ *-------------------------------------------------------------------------------------*/
+static int test_create (int type, bp_ipn_t node, bp_ipn_t service, bool recover, void* parm)
+{
+    int handle = bplib_store_flash_create(type, node, service, recover, parm);
+    if(type == BP_STORE_JOURNAL_TYPE)   journal_store = handle;
+    else if(type == BP_STORE_DATA_TYPE) bundle_store = handle;
+    return handle;
+}
+
+/*--------------------------------------------------------------------------------------
+ * test_enqueue - fails journal records once crashed
+ *-------------------------------------------------------------------------------------*/
+static int test_enqueue (int handle, void* data1, int data1_size, void* data2, int data2_size, int timeout)
+{
+    if(crashed && handle == journal_store) return BP_ERROR;
+    return bplib_store_flash_enqueue(handle, data1, data1_size, data2, data2_size, timeout);
+}
+
+/*--------------------------------------------------------------------------------------
+ * test_dequeue - remembers the storage ID of the last bundle dequeued
+ *-------------------------------------------------------------------------------------*/
+static int test_dequeue (int handle, bp_object_t** object, int timeout)
+{
+    int status = bplib_store_flash_dequeue(handle, object, timeout);
+    if(status == BP_SUCCESS && handle == bundle_store) last_dequeued = (*object)->header.sid;
+    return status;
+}
+
+/*--------------------------------------------------------------------------------------
+ * test_retrieve - stale storage ID holds the bundle of the reused one
+ *-------------------------------------------------------------------------------------*/
+static int test_retrieve (int handle, bp_sid_t sid, bp_object_t** object, int timeout)
+{
+    if(handle == bundle_store && sid == stale_sid) sid = reused_sid;
+    return bplib_store_flash_retrieve(handle, sid, object, timeout);
+}
+
+/*--------------------------------------------------------------------------------------
+ * test_release - stale storage ID holds the bundle of the reused one
+ *-------------------------------------------------------------------------------------*/
+static int test_release (int handle, bp_sid_t sid)
+{
+    if(handle == bundle_store && sid == stale_sid) sid = reused_sid;
+    return bplib_store_flash_release(handle, sid);
+}
+
+static bp_store_t test_store = {
+    .create     = test_create,
+    .destroy    = bplib_store_flash_destroy,
+    .enqueue    = test_enqueue,
+    .dequeue    = test_dequeue,
+    .retrieve   = test_retrieve,
+    .release    = test_release,
+    .relinquish = bplib_store_flash_relinquish,
+    .getcount   = bplib_store_flash_getcount,
+    .relinquish_batch = bplib_store_flash_relinquish_batch
+};
+
+/*--------------------------------------------------------------------------------------
+ * record_load - trace hook that records the custody IDs loaded on the traced channel
+ *-------------------------------------------------------------------------------------*/
+static void record_load(const bp_trace_event_t* event, void* parm)
+{
+    (void)parm;
+    if(event->point == BP_TRACE_LOAD && event->channel == traced_channel &&
+       event->cid != BP_TRACE_NO_CID && num_loaded < MAX_LOADED)
+    {
+        loaded_cids[num_loaded++] = event->cid;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * open_sender - opens a channel with persistent storage whose loads are traced
+ *-------------------------------------------------------------------------------------*/
+static bp_desc_t* open_sender(bp_ipn_t node)
+{
+    bp_route_t route = { node, 3, 72, 43, 0, 0 };
+    bp_attr_t attr;
+
+    bplib_attrinit(&attr);
+    attr.persistent_storage = true;
+    attr.active_table_size = TABLE_SIZE;
+    attr.timeout = TIMEOUT;
+    attr.checkpoint_rate = 0;
+    attr.fast_retransmit = -1;
+    attr.cid_reuse = true;
+
+    bp_desc_t* sender = bplib_open(route, test_store, attr);
+    ut_assert(sender != NULL, "Failed to open channel for ipn:%lu.3\n", (unsigned long)node);
+    traced_channel = sender ? sender->channel : NULL;
+    num_loaded = 0;
+
+    return sender;
+}
+
+/*--------------------------------------------------------------------------------------
+ * send_bundle - stores and loads a bundle, returns its storage ID
+ *-------------------------------------------------------------------------------------*/
+static bp_sid_t send_bundle(bp_desc_t* sender, void** bundle, int* size)
+{
+    char payload[] = "HELLO WORLD";
+    uint32_t flags = 0;
+
+    last_dequeued = BP_SID_VACANT;
+    ut_check(bplib_store(sender, payload, sizeof(payload), BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_load(sender, bundle, size, BP_CHECK, &flags) == BP_SUCCESS);
+
+    return last_dequeued;
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Clean Close
+ *
+ *  Active custody IDs and their retransmit times are restored from the checkpoint
+ *  written on close, and new custody IDs start at the ceiling it reserved.
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    bp_stats_t stats;
+    uint32_t flags = 0;
+    void* bundle;
+    int size;
+    int i;
+
+    printf("\n==== Test 1: Clean Close ====\n");
+
+    /* Send Bundles a Second Apart */
+    bp_desc_t* sender = open_sender(4);
+    if(sender == NULL) return;
+    for(i = 0; i < NUM_BUNDLES; i++)
+    {
+        send_bundle(sender, &bundle, &size);
+        bplib_ackbundle(sender, bundle);
+        bplib_os_vclock_advance(1000);
+    }
+    ut_check(num_loaded == NUM_BUNDLES);
+    for(i = 0; i < num_loaded; i++) ut_check(loaded_cids[i] == (bp_val_t)i);
+    bplib_close(sender);
+
+    /* Recover */
+    sender = open_sender(4);
+    if(sender == NULL) return;
+    bplib_latchstats(sender, &stats);
+    ut_assert(stats.active_bundles == NUM_BUNDLES, "Recovered %u active bundles\n", stats.active_bundles);
+
+    /* Retransmitted in Order when Each Times Out */
+    ut_check(bplib_load(sender, &bundle, &size, BP_CHECK, &flags) == BP_TIMEOUT);
+    bplib_os_vclock_advance((TIMEOUT - NUM_BUNDLES) * 1000);
+    for(i = 0; i < NUM_BUNDLES; i++)
+    {
+        ut_check(bplib_load(sender, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+        bplib_ackbundle(sender, bundle);
+        ut_check(bplib_load(sender, &bundle, &size, BP_CHECK, &flags) == BP_TIMEOUT);
+        bplib_os_vclock_advance(1000);
+    }
+    ut_check(num_loaded == NUM_BUNDLES);
+    for(i = 0; i < num_loaded; i++) ut_check(loaded_cids[i] == (bp_val_t)i);
+    bplib_latchstats(sender, &stats);
+    ut_check(stats.retransmitted_bundles == NUM_BUNDLES);
+
+    /* New Custody IDs Start at Ceiling */
+    send_bundle(sender, &bundle, &size);
+    bplib_ackbundle(sender, bundle);
+    ut_assert(num_loaded == NUM_BUNDLES + 1 && loaded_cids[NUM_BUNDLES] == NUM_BUNDLES + TABLE_SIZE,
+              "Custody ID %lu assigned after recovery\n", (unsigned long)loaded_cids[num_loaded - 1]);
+
+    bplib_flush(sender);
+    bplib_close(sender);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Crash
+ *
+ *  Custody IDs sent after the last checkpoint are not restored, and are not assigned
+ *  again since custody IDs resume from the ceiling that checkpoint reserved.
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    bp_stats_t stats;
+    void* bundle;
+    int size;
+    int i;
+
+    printf("\n==== Test 2: Crash ====\n");
+
+    /* Send Bundles after Checkpoint Written on Open */
+    bp_desc_t* sender = open_sender(5);
+    if(sender == NULL) return;
+    for(i = 0; i < NUM_BUNDLES / 2; i++)
+    {
+        send_bundle(sender, &bundle, &size);
+        bplib_ackbundle(sender, bundle);
+    }
+    ut_check(num_loaded == NUM_BUNDLES / 2);
+
+    /* Crash before Checkpoint */
+    crashed = true;
+    bplib_close(sender);
+    crashed = false;
+
+    /* Recover */
+    sender = open_sender(5);
+    if(sender == NULL) return;
+    bplib_latchstats(sender, &stats);
+    ut_assert(stats.active_bundles == 0, "Recovered %u active bundles\n", stats.active_bundles);
+
+    /* New Custody IDs Start at Ceiling */
+    send_bundle(sender, &bundle, &size);
+    bplib_ackbundle(sender, bundle);
+    ut_assert(num_loaded == 1 && loaded_cids[0] == TABLE_SIZE, "Custody ID %lu assigned after recovery\n", (unsigned long)loaded_cids[0]);
+
+    bplib_flush(sender);
+    bplib_close(sender);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Stale Storage ID
+ *
+ *  A journaled bundle acknowledged after the checkpoint was written is not restored
+ *  when its storage ID has been reused by another bundle.
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    bp_route_t route = { 72, 43, 6, 3, 0, 0 };
+    bp_stats_t stats;
+    bp_attr_t attr;
+    uint32_t flags = 0;
+    void* bundle;
+    void* dacs;
+    int size, dacs_size;
+
+    printf("\n==== Test 3: Stale Storage ID ====\n");
+
+    bplib_attrinit(&attr);
+    attr.dacs_rate = 1;
+    bp_desc_t* receiver = bplib_open(route, ram_store, attr);
+    ut_assert(receiver != NULL, "Failed to open receiver\n");
+    if(receiver == NULL) return;
+
+    /* Journal Bundle in Checkpoint Written on Close and Recovery */
+    bp_desc_t* sender = open_sender(6);
+    if(sender == NULL) return;
+    bp_sid_t acked_sid = send_bundle(sender, &bundle, &size);
+    ut_check(bplib_process(receiver, bundle, size, BP_CHECK, &flags) == BP_SUCCESS);
+    bplib_ackbundle(sender, bundle);
+    bplib_close(sender);
+    sender = open_sender(6);
+    if(sender == NULL) return;
+    bplib_latchstats(sender, &stats);
+    ut_check(stats.active_bundles == 1);
+
+    /* Acknowledge Bundle and Send Another */
+    bplib_os_vclock_advance(1000);
+    ut_check(bplib_load(receiver, &dacs, &dacs_size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_process(sender, dacs, dacs_size, BP_CHECK, &flags) == BP_SUCCESS);
+    bplib_ackbundle(receiver, dacs);
+    bp_sid_t sent_sid = send_bundle(sender, &bundle, &size);
+    bplib_ackbundle(sender, bundle);
+    bplib_latchstats(sender, &stats);
+    ut_check(stats.acknowledged_bundles == 1);
+    ut_check(stats.active_bundles == 1);
+
+    /* Crash and Recover with Acknowledged Storage ID Reused */
+    crashed = true;
+    bplib_close(sender);
+    crashed = false;
+    stale_sid = acked_sid;
+    reused_sid = sent_sid;
+    sender = open_sender(6);
+    stale_sid = BP_SID_VACANT;
+    if(sender == NULL) return;
+    bplib_latchstats(sender, &stats);
+    ut_assert(stats.active_bundles == 0, "Recovered %u active bundles\n", stats.active_bundles);
+    ut_check(stats.lost == 0);
+
+    bplib_flush(sender);
+    bplib_close(sender);
+    bplib_close(receiver);
+}
+
+#endif
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_journal (void)
+{
+    ut_reset();
+
+    #ifdef BP_TRACE
+    size_t memused = bplib_os_memused();
+    bplib_store_ram_init();
+    bplib_flash_sim_initialize();
+    bplib_store_flash_init(flash_driver, true);
+    bplib_os_vclock_start(VIRTUAL_START, 0);
+    bplib_trace_hook(record_load, NULL);
+
+    test_1();
+    test_2();
+    test_3();
+
+    bplib_trace_hook(NULL, NULL);
+    bplib_os_vclock_stop();
+    bplib_store_flash_uninit();
+    ut_assert(bplib_os_memused() == memused, "Failed to free memory: %ld\n", (long)(bplib_os_memused() - memused));
+    #else
+    printf("\nLibrary built without BP_TRACE\n");
+    #endif
+
+    return ut_failures();
+}
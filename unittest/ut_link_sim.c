@@ -0,0 +1,398 @@
+/************************************************************************
+ * File: ut_link_sim.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "bplib.h"
+#include "bplib_os.h"
+#include "bplib_link_sim.h"
+#include "bplib_store_ram.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define NUM_BUNDLES         1000
+#define BUNDLE_SIZE         100
+#define VIRTUAL_START       600000000   /* seconds since 2000 */
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static bp_store_t ram_store = {
+    .create     = bplib_store_ram_create,
+    .destroy    = bplib_store_ram_destroy,
+    .enqueue    = bplib_store_ram_enqueue,
+    .dequeue    = bplib_store_ram_dequeue,
+    .retrieve   = bplib_store_ram_retrieve,
+    .release    = bplib_store_ram_release,
+    .relinquish = bplib_store_ram_relinquish,
+    .getcount   = bplib_store_ram_getcount,
+    .relinquish_batch = bplib_store_ram_relinquish_batch
+};
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * send_numbered - sends bundles whose first byte is their sequence number
+ *-------------------------------------------------------------------------------------*/
+static void send_numbered(bp_link_t* link, int count, int size)
+{
+    uint8_t bundle[BUNDLE_SIZE * 10];
+    int i;
+
+    memset(bundle, 0, sizeof(bundle));
+    for(i = 0; i < count; i++)
+    {
+        bundle[0] = (uint8_t)i;
+        ut_check(bplib_link_sim_send(link, bundle, size) == BP_SUCCESS);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * recv_one - returns sequence number of next bundle or -1
+ *-------------------------------------------------------------------------------------*/
+static int recv_one(bp_link_t* link)
+{
+    uint8_t bundle[BUNDLE_SIZE * 10];
+    int size = sizeof(bundle);
+    if(bplib_link_sim_recv(link, bundle, &size) != BP_SUCCESS) return -1;
+    return bundle[0];
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Perfect Link
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    bp_link_stats_t stats;
+    int i;
+
+    printf("\n==== Test 1: Perfect Link ====\n");
+
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    bp_link_t* link = bplib_link_sim_create(NULL);
+    ut_assert(link != NULL, "Failed to create link\n");
+
+    /* Delivered Immediately and in Order */
+    send_numbered(link, 10, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_next(link) == 0);
+    for(i = 0; i < 10; i++) ut_check(recv_one(link) == i);
+    ut_check(recv_one(link) == -1);
+    ut_check(bplib_link_sim_next(link) == LINK_SIM_NEVER);
+
+    /* Statistics */
+    ut_check(bplib_link_sim_stats(link, &stats) == BP_SUCCESS);
+    ut_check(stats.sent == 10);
+    ut_check(stats.delivered == 10);
+    ut_check(stats.delivered_bytes == 10 * BUNDLE_SIZE);
+    ut_check(stats.lost == 0);
+    ut_check(stats.in_flight == 0);
+
+    /* Buffer Too Small Keeps Bundle */
+    uint8_t small[BUNDLE_SIZE / 2];
+    int size = sizeof(small);
+    send_numbered(link, 1, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_recv(link, small, &size) == BP_ERROR);
+    ut_check(size == BUNDLE_SIZE);
+    ut_check(recv_one(link) == 0);
+
+    /* Invalid Parameters */
+    bp_link_attr_t attr;
+    bplib_link_sim_attrinit(&attr);
+    attr.loss_rate = 1.5;
+    ut_check(bplib_link_sim_create(&attr) == NULL);
+    ut_check(bplib_link_sim_send(link, small, 0) == BP_ERROR);
+
+    bplib_link_sim_destroy(link);
+    bplib_os_vclock_stop();
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Delay, Bandwidth, and Reordering
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    bp_link_attr_t attr;
+    bp_link_stats_t stats;
+
+    printf("\n==== Test 2: Delay, Bandwidth, and Reordering ====\n");
+
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    bplib_link_sim_attrinit(&attr);
+    attr.delay = 500;
+    attr.bandwidth = BUNDLE_SIZE * 10; /* 100ms per bundle */
+    bp_link_t* link = bplib_link_sim_create(&attr);
+    ut_assert(link != NULL, "Failed to create link\n");
+
+    /* Serialized then Delayed */
+    send_numbered(link, 3, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_next(link) == 600);
+    bplib_os_vclock_advance(599);
+    ut_check(recv_one(link) == -1);
+    bplib_os_vclock_advance(1);
+    ut_check(recv_one(link) == 0);
+    ut_check(recv_one(link) == -1);
+    ut_check(bplib_link_sim_next(link) == 700);
+    bplib_os_vclock_advance(200);
+    ut_check(recv_one(link) == 1);
+    ut_check(recv_one(link) == 2);
+    bplib_link_sim_destroy(link);
+
+    /* Every Bundle Held Back is Overtaken */
+    bplib_link_sim_attrinit(&attr);
+    attr.reorder_rate = 1.0;
+    attr.reorder_delay = 1000;
+    bp_link_t* reorder_link = bplib_link_sim_create(&attr);
+    ut_assert(reorder_link != NULL, "Failed to create link\n");
+    send_numbered(reorder_link, 1, BUNDLE_SIZE);
+    ut_check(recv_one(reorder_link) == -1);
+    ut_check(bplib_link_sim_next(reorder_link) == bplib_os_vclock_now() + 1000);
+    bplib_os_vclock_advance(1000);
+    ut_check(recv_one(reorder_link) == 0);
+    ut_check(bplib_link_sim_stats(reorder_link, &stats) == BP_SUCCESS);
+    ut_check(stats.reordered == 1);
+    bplib_link_sim_destroy(reorder_link);
+
+    /* Queue Limit */
+    bplib_link_sim_attrinit(&attr);
+    attr.delay = 100;
+    attr.queue_limit = 4;
+    bp_link_t* queue_link = bplib_link_sim_create(&attr);
+    ut_assert(queue_link != NULL, "Failed to create link\n");
+    send_numbered(queue_link, 10, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_stats(queue_link, &stats) == BP_SUCCESS);
+    ut_check(stats.in_flight == 4);
+    ut_check(stats.overflowed == 6);
+    bplib_link_sim_destroy(queue_link);
+
+    bplib_os_vclock_stop();
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Reproducible Loss
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    bp_link_attr_t attr;
+    bp_link_stats_t stats1, stats2;
+    int i;
+
+    printf("\n==== Test 3: Reproducible Loss ====\n");
+
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    bplib_link_sim_attrinit(&attr);
+    attr.loss_rate = 0.25;
+    attr.jitter = 50;
+    attr.seed = 1234;
+    bp_link_t* link1 = bplib_link_sim_create(&attr);
+    bp_link_t* link2 = bplib_link_sim_create(&attr);
+    ut_assert(link1 != NULL && link2 != NULL, "Failed to create links\n");
+
+    /* Same Seed Gives Same Losses and Order */
+    send_numbered(link1, NUM_BUNDLES, BUNDLE_SIZE);
+    send_numbered(link2, NUM_BUNDLES, BUNDLE_SIZE);
+    bplib_os_vclock_advance(50);
+    for(i = 0; i < NUM_BUNDLES; i++)
+    {
+        int seq = recv_one(link1);
+        ut_check(recv_one(link2) == seq);
+        if(seq == -1) break;
+    }
+
+    ut_check(bplib_link_sim_stats(link1, &stats1) == BP_SUCCESS);
+    ut_check(bplib_link_sim_stats(link2, &stats2) == BP_SUCCESS);
+    ut_check(stats1.lost == stats2.lost);
+    ut_check(stats1.delivered == stats2.delivered);
+    ut_check(stats1.delivered + stats1.lost == NUM_BUNDLES);
+    ut_assert(stats1.lost > (NUM_BUNDLES / 5) && stats1.lost < (NUM_BUNDLES * 3 / 10), "Lost %u of %d bundles\n", stats1.lost, NUM_BUNDLES);
+
+    bplib_link_sim_destroy(link1);
+    bplib_link_sim_destroy(link2);
+    bplib_os_vclock_stop();
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #4 - Contact Schedule
+ *-------------------------------------------------------------------------------------*/
+static void test_4(void)
+{
+    bp_link_attr_t attr;
+    bp_link_stats_t stats;
+    bp_contact_t contacts[2] = { {1000, 2000}, {5000, 5150} };
+
+    printf("\n==== Test 4: Contact Schedule ====\n");
+
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    bplib_link_sim_attrinit(&attr);
+    attr.bandwidth = BUNDLE_SIZE * 10; /* 100ms per bundle */
+    bp_link_t* link = bplib_link_sim_create(&attr);
+    ut_assert(link != NULL, "Failed to create link\n");
+
+    /* Invalid Schedules */
+    bp_contact_t backwards = {2000, 1000};
+    ut_check(bplib_link_sim_schedule(link, &backwards, 1, 0) == BP_ERROR);
+    ut_check(bplib_link_sim_schedule(link, contacts, 2, 4000) == BP_ERROR);
+    ut_check(bplib_link_sim_schedule(link, contacts, 2, 10000) == BP_SUCCESS);
+
+    /* Down Before First Contact */
+    send_numbered(link, 1, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_stats(link, &stats) == BP_SUCCESS);
+    ut_check(stats.disconnected == 1);
+
+    /* Up During Contact */
+    bplib_os_vclock_advance(1000);
+    send_numbered(link, 1, BUNDLE_SIZE);
+    bplib_os_vclock_advance(100);
+    ut_check(recv_one(link) == 0);
+
+    /* Second Contact Only Fits One Bundle, Second is Cut Off */
+    bplib_os_vclock_advance(3900);
+    send_numbered(link, 2, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_stats(link, &stats) == BP_SUCCESS);
+    ut_check(stats.in_flight == 1);
+    ut_check(stats.disconnected == 2);
+
+    /* Schedule Repeats */
+    bplib_os_vclock_advance(6000); /* 11000 */
+    send_numbered(link, 1, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_stats(link, &stats) == BP_SUCCESS);
+    ut_check(stats.in_flight == 2);
+    ut_check(stats.disconnected == 2);
+
+    /* Clearing Schedule Keeps Link Up */
+    ut_check(bplib_link_sim_schedule(link, NULL, 0, 0) == BP_SUCCESS);
+    bplib_os_vclock_advance(2000);
+    send_numbered(link, 1, BUNDLE_SIZE);
+    ut_check(bplib_link_sim_stats(link, &stats) == BP_SUCCESS);
+    ut_check(stats.disconnected == 2);
+
+    bplib_link_sim_destroy(link);
+    bplib_os_vclock_stop();
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #5 - Virtual Clock Drives Retransmissions
+ *-------------------------------------------------------------------------------------*/
+static void test_5(void)
+{
+    bp_route_t sender_route = { 4, 3, 72, 43, 0, 0 };
+    bp_route_t receiver_route = { 72, 43, 4, 3, 0, 0 };
+    bp_link_attr_t link_attr;
+    bp_stats_t stats;
+    unsigned long sysnow = 0;
+    uint32_t flags = 0;
+    char payload[] = "HELLO WORLD";
+    void* bundle;
+    int size;
+    int i;
+
+    printf("\n==== Test 5: Virtual Clock Drives Retransmissions ====\n");
+
+    /* Library Reads Virtual Time */
+    bplib_store_ram_init();
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    ut_check(bplib_os_systime(&sysnow) == BP_SUCCESS);
+    ut_check(sysnow == VIRTUAL_START);
+    bplib_os_vclock_advance(2500);
+    ut_check(bplib_os_systime(&sysnow) == BP_SUCCESS);
+    ut_check(sysnow == VIRTUAL_START + 2);
+    ut_check(bplib_os_monotime(&sysnow) == BP_SUCCESS);
+    ut_check(sysnow == 2);
+
+    /* Open Channels over a Link that Loses the First Transmission */
+    bp_attr_t attr;
+    bplib_attrinit(&attr);
+    attr.timeout = 10;
+    attr.cid_reuse = true;
+    bp_desc_t* sender = bplib_open(sender_route, ram_store, attr);
+    bp_desc_t* receiver = bplib_open(receiver_route, ram_store, attr);
+    ut_assert(sender != NULL && receiver != NULL, "Failed to open channels\n");
+    bplib_link_sim_attrinit(&link_attr);
+    link_attr.delay = 1000;
+    bp_link_t* link = bplib_link_sim_create(&link_attr);
+    bp_contact_t contact = { 60000, 120000 };
+    ut_check(bplib_link_sim_schedule(link, &contact, 1, 0) == BP_SUCCESS);
+
+    ut_check(bplib_store(sender, payload, sizeof(payload), BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_load(sender, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_link_sim_send(link, bundle, size) == BP_SUCCESS);
+    bplib_ackbundle(sender, bundle);
+
+    /* Retransmitted Each Timeout until Contact, Which Takes No Real Time */
+    for(i = 0; i < 20; i++)
+    {
+        bplib_os_vclock_advance(5000);
+        if(bplib_load(sender, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS)
+        {
+            bplib_link_sim_send(link, bundle, size);
+            bplib_ackbundle(sender, bundle);
+        }
+    }
+    ut_check(bplib_os_vclock_now() == 102500);
+
+    /* First Bundle in Contact Delivered */
+    uint8_t received[1024];
+    size = sizeof(received);
+    ut_check(bplib_link_sim_recv(link, received, &size) == BP_SUCCESS);
+    ut_check(bplib_process(receiver, received, size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_latchstats(sender, &stats) == BP_SUCCESS);
+    ut_assert(stats.retransmitted_bundles == 10, "Retransmitted %u bundles\n", stats.retransmitted_bundles);
+    ut_check(bplib_accept(receiver, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(size == sizeof(payload));
+    bplib_ackpayload(receiver, bundle);
+
+    /* Custody Signal Sent after DACS Rate */
+    bplib_os_vclock_advance(attr.dacs_rate * 1000);
+    ut_check(bplib_load(receiver, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_process(sender, bundle, size, BP_CHECK, &flags) == BP_SUCCESS);
+    bplib_ackbundle(receiver, bundle);
+    ut_check(bplib_latchstats(sender, &stats) == BP_SUCCESS);
+    ut_check(stats.active_bundles == 0);
+
+    bplib_link_sim_destroy(link);
+    bplib_close(sender);
+    bplib_close(receiver);
+
+    /* Real Time Restored */
+    bplib_os_vclock_stop();
+    ut_check(bplib_os_systime(&sysnow) == BP_SUCCESS);
+    ut_check(sysnow > VIRTUAL_START);
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_link_sim (void)
+{
+    ut_reset();
+
+    test_1();
+    test_2();
+    test_3();
+    test_4();
+    test_5();
+
+    return ut_failures();
+}
@@ -0,0 +1,301 @@
+/************************************************************************
+ * File: ut_locks.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <pthread.h>
+#include <time.h>
+
+#include "ut_assert.h"
+#include "bplib.h"
+#include "bplib_store_ram.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define NUM_LOCKS           1000    /* more than the lock table used to hold */
+#define MAX_THREADS         8
+#define NUM_INCREMENTS      200000
+#define VIRTUAL_START       600000000   /* seconds since 2000 */
+#define SECONDS_PER_DAY     86400
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static int counter_lock;
+static volatile unsigned long counter;
+static int signal_lock;
+static volatile bool signaled;
+
+static bp_store_t ram_store = {
+    .create     = bplib_store_ram_create,
+    .destroy    = bplib_store_ram_destroy,
+    .enqueue    = bplib_store_ram_enqueue,
+    .dequeue    = bplib_store_ram_dequeue,
+    .retrieve   = bplib_store_ram_retrieve,
+    .release    = bplib_store_ram_release,
+    .relinquish = bplib_store_ram_relinquish,
+    .getcount   = bplib_store_ram_getcount,
+    .relinquish_batch = bplib_store_ram_relinquish_batch
+};
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * elapsed_ms - wall clock time since start, threads are timed together
+ *-------------------------------------------------------------------------------------*/
+static double elapsed_ms(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double)(now.tv_sec - start->tv_sec) * 1000.0) + ((double)(now.tv_nsec - start->tv_nsec) / 1000000.0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * increment_counter
+ *-------------------------------------------------------------------------------------*/
+static void* increment_counter(void* parm)
+{
+    (void)parm;
+    int i;
+    for(i = 0; i < NUM_INCREMENTS; i++)
+    {
+        bplib_os_lock(counter_lock);
+        counter++;
+        bplib_os_unlock(counter_lock);
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * signal_waiter
+ *-------------------------------------------------------------------------------------*/
+static void* signal_waiter(void* parm)
+{
+    (void)parm;
+    bplib_os_sleep(1);
+    bplib_os_lock(signal_lock);
+    {
+        signaled = true;
+        bplib_os_signal(signal_lock);
+    }
+    bplib_os_unlock(signal_lock);
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - More Locks than a Fixed Table
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    static int handles[NUM_LOCKS];
+    size_t memused = bplib_os_memused();
+    int i, j;
+
+    printf("\n==== Test 1: More Locks than a Fixed Table ====\n");
+
+    for(i = 0; i < NUM_LOCKS; i++)
+    {
+        handles[i] = bplib_os_createlock();
+        if(!ut_assert(handles[i] != BP_INVALID_HANDLE, "Failed to create lock %d\n", i)) break;
+        bplib_os_lock(handles[i]);
+    }
+    for(j = 0; j < i; j++)
+    {
+        bplib_os_unlock(handles[j]);
+        bplib_os_destroylock(handles[j]);
+    }
+
+    /* Destroyed Locks are Reused */
+    int handle = bplib_os_createlock();
+    ut_check(handle != BP_INVALID_HANDLE);
+    ut_check(bplib_os_trylock(handle) == BP_SUCCESS);
+    bplib_os_unlock(handle);
+    bplib_os_destroylock(handle);
+
+    ut_assert(bplib_os_memused() == memused, "Failed to free memory of locks: %lu\n", (unsigned long)(bplib_os_memused() - memused));
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Mutual Exclusion
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    int thread_counts[] = { 1, 2, 4, 8 };
+    pthread_t threads[MAX_THREADS];
+    struct timespec start;
+    unsigned int i;
+    int t;
+
+    printf("\n==== Test 2: Mutual Exclusion ====\n");
+
+    counter_lock = bplib_os_createlock();
+    ut_assert(counter_lock != BP_INVALID_HANDLE, "Failed to create lock\n");
+
+    for(i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+    {
+        counter = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(t = 0; t < thread_counts[i]; t++) pthread_create(&threads[t], NULL, increment_counter, NULL);
+        for(t = 0; t < thread_counts[i]; t++) pthread_join(threads[t], NULL);
+        double msecs = elapsed_ms(&start);
+
+        ut_assert(counter == (unsigned long)NUM_INCREMENTS * thread_counts[i], "Lost increments: %lu\n", counter);
+        printf("%d threads - %.1lf ns per lock and unlock\n", thread_counts[i], (msecs * 1000000.0) / ((double)NUM_INCREMENTS * thread_counts[i]));
+    }
+
+    bplib_os_destroylock(counter_lock);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Signal and Wait
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    pthread_t thread;
+    struct timespec start;
+
+    printf("\n==== Test 3: Signal and Wait ====\n");
+
+    signal_lock = bplib_os_createlock();
+    ut_assert(signal_lock != BP_INVALID_HANDLE, "Failed to create lock\n");
+
+    bplib_os_lock(signal_lock);
+    {
+        /* Timeouts */
+        ut_check(bplib_os_waiton(signal_lock, 0) == BP_TIMEOUT);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        ut_check(bplib_os_waiton(signal_lock, 100) == BP_TIMEOUT);
+        ut_check(elapsed_ms(&start) >= 90.0);
+
+        /* Signaled by Another Thread */
+        signaled = false;
+        pthread_create(&thread, NULL, signal_waiter, NULL);
+        while(!signaled)
+        {
+            if(bplib_os_waiton(signal_lock, 5000) == BP_TIMEOUT) break;
+        }
+        ut_check(signaled);
+    }
+    bplib_os_unlock(signal_lock);
+
+    pthread_join(thread, NULL);
+    bplib_os_destroylock(signal_lock);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #4 - Virtual Clock
+ *-------------------------------------------------------------------------------------*/
+static void test_4(void)
+{
+    bp_route_t route = { 4, 3, 72, 43, 0, 0 };
+    pthread_t thread;
+    bp_stats_t stats;
+    struct timespec start;
+    unsigned long sysnow = 0;
+    uint32_t flags = 0;
+    char payload[] = "HELLO WORLD";
+    void* bundle;
+    int size;
+    int retransmissions = 0;
+
+    printf("\n==== Test 4: Virtual Clock ====\n");
+
+    signal_lock = bplib_os_createlock();
+    ut_assert(signal_lock != BP_INVALID_HANDLE, "Failed to create lock\n");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* Waits of the Only Thread Take No Time */
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    bplib_os_lock(signal_lock);
+    {
+        ut_check(bplib_os_waiton(signal_lock, 3600000) == BP_TIMEOUT);
+        ut_check(bplib_os_vclock_now() == 3600000);
+        ut_check(bplib_os_systime(&sysnow) == BP_SUCCESS);
+        ut_check(sysnow == VIRTUAL_START + 3600);
+    }
+    bplib_os_unlock(signal_lock);
+    bplib_os_sleep(SECONDS_PER_DAY);
+    ut_check(bplib_os_vclock_now() == 3600000 + (SECONDS_PER_DAY * 1000));
+    bplib_os_vclock_stop();
+
+    /* Time Jumps to the Sleep of the Other Thread, which then Signals */
+    bplib_os_vclock_start(VIRTUAL_START, 2);
+    bplib_os_lock(signal_lock);
+    {
+        signaled = false;
+        pthread_create(&thread, NULL, signal_waiter, NULL);
+        ut_check(bplib_os_waiton(signal_lock, 5000) == BP_SUCCESS);
+        ut_check(signaled);
+        ut_check(bplib_os_vclock_now() == 1000);
+    }
+    bplib_os_unlock(signal_lock);
+    pthread_join(thread, NULL);
+    bplib_os_vclock_stop();
+    bplib_os_destroylock(signal_lock);
+
+    /* Retransmitted from Blocking Loads until Lifetime Expires a Day Later */
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    bp_attr_t attr;
+    bplib_attrinit(&attr);
+    attr.timeout = 10;
+    attr.lifetime = SECONDS_PER_DAY;
+    attr.cid_reuse = true;
+    bp_desc_t* channel = bplib_open(route, ram_store, attr);
+    ut_assert(channel != NULL, "Failed to open channel\n");
+    ut_check(bplib_store(channel, payload, sizeof(payload), BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_load(channel, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+    bplib_ackbundle(channel, bundle);
+    do
+    {
+        if(bplib_load(channel, &bundle, &size, 1000, &flags) == BP_SUCCESS)
+        {
+            bplib_ackbundle(channel, bundle);
+            retransmissions++;
+        }
+        bplib_latchstats(channel, &stats);
+    } while(stats.active_bundles > 0);
+    ut_check(stats.expired == 1);
+    ut_assert(retransmissions == (SECONDS_PER_DAY / attr.timeout) - 1, "Retransmitted %d bundles\n", retransmissions);
+    ut_assert(bplib_os_vclock_now() == (SECONDS_PER_DAY + 1) * 1000, "Expired at %lu ms\n", bplib_os_vclock_now()); /* load waited after dropping it */
+    bplib_close(channel);
+    bplib_os_vclock_stop();
+
+    ut_assert(elapsed_ms(&start) < 10000.0, "Virtual clock took %.1lf ms\n", elapsed_ms(&start));
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_locks (void)
+{
+    ut_reset();
+
+    test_1();
+    test_2();
+    test_3();
+    test_4();
+
+    return ut_failures();
+}
@@ -0,0 +1,262 @@
+/************************************************************************
+ * File: ut_log.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "ut_assert.h"
+#include "bplib.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define SITE_RATE           10      /* BP_LOG_SITE_RATE of the posix port */
+#define NUM_BURST           100
+#define MAX_THREADS         8
+#define NUM_RECORDS         2000
+#define CAPTURE_SIZE        0x400000
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static int saved_stdout = -1;
+static FILE* capture_file = NULL;
+static char capture_buffer[CAPTURE_SIZE];
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * capture_start - redirects standard out to a temporary file
+ *-------------------------------------------------------------------------------------*/
+static bool capture_start(void)
+{
+    bplib_os_log_flush();
+    capture_file = tmpfile();
+    if(capture_file == NULL) return false;
+    saved_stdout = dup(STDOUT_FILENO);
+    dup2(fileno(capture_file), STDOUT_FILENO);
+    return true;
+}
+
+/*--------------------------------------------------------------------------------------
+ * capture_stop - restores standard out and returns what was written to it
+ *-------------------------------------------------------------------------------------*/
+static const char* capture_stop(void)
+{
+    size_t len = 0;
+
+    bplib_os_log_flush();
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(saved_stdout);
+
+    if(capture_file)
+    {
+        rewind(capture_file);
+        len = fread(capture_buffer, 1, CAPTURE_SIZE - 1, capture_file);
+        fclose(capture_file);
+        capture_file = NULL;
+    }
+
+    capture_buffer[len] = '\0';
+    return capture_buffer;
+}
+
+/*--------------------------------------------------------------------------------------
+ * count_lines - number of lines containing text
+ *-------------------------------------------------------------------------------------*/
+static int count_lines(const char* output, const char* text)
+{
+    int count = 0;
+    const char* c = output;
+    while((c = strstr(c, text)) != NULL)
+    {
+        count++;
+        c += strlen(text);
+    }
+    return count;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_storm - a single call site logging repeatedly
+ *-------------------------------------------------------------------------------------*/
+static int log_storm(int count, uint32_t* flags)
+{
+    int i, errors = 0;
+    for(i = 0; i < count; i++)
+    {
+        if(bplog(flags, BP_FLAG_STORE_FAILURE, "Storm record %d\n", i) == BP_ERROR) errors++;
+    }
+    return errors;
+}
+
+/*--------------------------------------------------------------------------------------
+ * log_records
+ *-------------------------------------------------------------------------------------*/
+static void* log_records(void* parm)
+{
+    int thread = *(int*)parm;
+    int i;
+    for(i = 0; i < NUM_RECORDS; i++)
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Thread %d record %d of %s\n", thread, i, "many");
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Formatting
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    char expected[3][256];
+    char long_string[300];
+    const char* output;
+
+    printf("\n==== Test 1: Formatting ====\n");
+
+    memset(long_string, 'Z', sizeof(long_string) - 1);
+    long_string[sizeof(long_string) - 1] = '\0';
+
+    snprintf(expected[0], sizeof(expected[0]), "Values %d %ld %llu %08X %u|%s|%c|%5.2f|%*d|%-6s|%hhd|%.3s|%%\n",
+             -7, -123456789L, 18446744073709551615ULL, 0xBEEFu, 42u, "text", 'q', 3.14159, 6, 99, "left", (char)300, "truncated");
+    snprintf(expected[1], sizeof(expected[1]), "Many %d %d %d %d %d %d %d %d %d %d\n", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10);
+    snprintf(expected[2], sizeof(expected[2]), "Null (null)\n");
+
+    ut_assert(capture_start(), "Failed to capture standard out\n");
+    {
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Values %d %ld %llu %08X %u|%s|%c|%5.2f|%*d|%-6s|%hhd|%.3s|%%\n",
+              -7, -123456789L, 18446744073709551615ULL, 0xBEEFu, 42u, "text", 'q', 3.14159, 6, 99, "left", (char)300, "truncated");
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Many %d %d %d %d %d %d %d %d %d %d\n", 1, 2, 3, 4, 5, 6, 7, 8, 9, 10);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Null %s\n", (char*)NULL);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "Long %s\n", long_string);
+        bplog(NULL, BP_FLAG_DIAGNOSTIC, "%s", "");
+    }
+    output = capture_stop();
+
+    ut_assert(strstr(output, expected[0]) != NULL, "Captured arguments formatted incorrectly: %s\n", output);
+    ut_assert(strstr(output, expected[1]) != NULL, "More arguments than captured formatted incorrectly: %s\n", output);
+    ut_assert(strstr(output, expected[2]) != NULL, "NULL string formatted incorrectly: %s\n", output);
+    ut_assert(strstr(output, "Long ZZZZZZZZ") != NULL, "Long string not logged: %s\n", output);
+    ut_check(count_lines(output, "ut_log.c:") == 4);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Rate Limit
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    uint32_t flags = 0;
+    const char* output;
+    int errors;
+
+    printf("\n==== Test 2: Rate Limit ====\n");
+
+    ut_assert(capture_start(), "Failed to capture standard out\n");
+    {
+        errors = log_storm(NUM_BURST, &flags);
+    }
+    output = capture_stop();
+
+    /* Every Call Still Reports the Event */
+    ut_check(errors == NUM_BURST);
+    ut_check(flags == BP_FLAG_STORE_FAILURE);
+
+    /* A Burst Can Span Two Seconds */
+    int logged = count_lines(output, "Storm record");
+    ut_assert(logged >= 1 && logged <= 2 * SITE_RATE, "Incorrect number of records logged: %d\n", logged);
+    ut_check(count_lines(output, ":00000080:Storm record 0\n") == 1);
+
+    /* Suppressed Records Reported with Next Record Logged */
+    bplib_os_sleep(1);
+    ut_assert(capture_start(), "Failed to capture standard out\n");
+    {
+        log_storm(1, &flags);
+    }
+    output = capture_stop();
+
+    ut_assert(count_lines(output, "messages suppressed") == 1, "Suppressed records not reported: %s\n", output);
+    ut_check(count_lines(output, "Storm record 0\n") == 1);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Concurrent Logging
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    pthread_t threads[MAX_THREADS];
+    int thread_ids[MAX_THREADS];
+    struct timespec start, stop;
+    const char* output;
+    int t;
+
+    printf("\n==== Test 3: Concurrent Logging ====\n");
+
+    ut_assert(capture_start(), "Failed to capture standard out\n");
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(t = 0; t < MAX_THREADS; t++)
+        {
+            thread_ids[t] = t;
+            pthread_create(&threads[t], NULL, log_records, &thread_ids[t]);
+        }
+        for(t = 0; t < MAX_THREADS; t++) pthread_join(threads[t], NULL);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+    }
+    output = capture_stop();
+
+    /* Every Record is Displayed Whole or Counted as Dropped */
+    int displayed = count_lines(output, " of many\n");
+    int dropped = 0;
+    const char* c = output;
+    while((c = strstr(c, " log records dropped")) != NULL)
+    {
+        const char* number = c;
+        while(number > output && number[-1] >= '0' && number[-1] <= '9') number--;
+        dropped += atoi(number);
+        c++;
+    }
+    ut_assert(displayed + dropped == MAX_THREADS * NUM_RECORDS, "Records lost: %d displayed, %d dropped\n", displayed, dropped);
+    ut_check(count_lines(output, "Thread 0 record 0 of many\n") <= 1);
+
+    double nsecs = ((double)(stop.tv_sec - start.tv_sec) * 1000000000.0) + (double)(stop.tv_nsec - start.tv_nsec);
+    printf("%d threads - %.1lf ns per record logged, %d displayed and %d dropped\n", MAX_THREADS, nsecs / (MAX_THREADS * NUM_RECORDS), displayed, dropped);
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_log (void)
+{
+    ut_reset();
+
+    test_1();
+    test_2();
+    test_3();
+
+    return ut_failures();
+}
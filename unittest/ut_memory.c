@@ -0,0 +1,282 @@
+/************************************************************************
+ * File: ut_memory.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "ut_assert.h"
+#include "bplib.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define MAX_THREADS         8
+#define NUM_BLOCKS          1000
+#define NUM_ALLOCATIONS     200000
+#define LARGE_BLOCK_SIZE    0x200000
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static void* handoff_blocks[MAX_THREADS][NUM_BLOCKS];
+static int hook_allocations;
+static int hook_frees;
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * memory_elapsed_ms - wall clock time since start, threads are timed together
+ *-------------------------------------------------------------------------------------*/
+static double memory_elapsed_ms(struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((double)(now.tv_sec - start->tv_sec) * 1000.0) + ((double)(now.tv_nsec - start->tv_nsec) / 1000000.0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * allocate_blocks - allocates blocks that are freed by another thread
+ *-------------------------------------------------------------------------------------*/
+static void* allocate_blocks(void* parm)
+{
+    void** blocks = (void**)parm;
+    int i;
+    for(i = 0; i < NUM_BLOCKS; i++)
+    {
+        blocks[i] = bplib_os_calloc_tag(16 + i, BP_MEM_STORE);
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * allocate_and_free
+ *-------------------------------------------------------------------------------------*/
+static void* allocate_and_free(void* parm)
+{
+    int count = *(int*)parm;
+    int i;
+    for(i = 0; i < count; i++)
+    {
+        void* block = bplib_os_calloc(64);
+        if(block == NULL) break;
+        bplib_os_free(block);
+    }
+    *(int*)parm = i;
+    return NULL;
+}
+
+/*--------------------------------------------------------------------------------------
+ * counting_alloc - allocator hook
+ *-------------------------------------------------------------------------------------*/
+static void* counting_alloc(size_t size, size_t alignment)
+{
+    void* ptr = NULL;
+    if(alignment < sizeof(void*)) alignment = sizeof(void*);
+    if(posix_memalign(&ptr, alignment, size) != 0) return NULL;
+    hook_allocations++;
+    return ptr;
+}
+
+/*--------------------------------------------------------------------------------------
+ * counting_free - allocator hook
+ *-------------------------------------------------------------------------------------*/
+static void counting_free(void* ptr)
+{
+    hook_frees++;
+    free(ptr);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Tagged Accounting
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    size_t memused[BP_MEM_NUM_TAGS];
+    void* blocks[BP_MEM_NUM_TAGS];
+    int tag;
+
+    printf("\n==== Test 1: Tagged Accounting ====\n");
+
+    for(tag = 0; tag < BP_MEM_NUM_TAGS; tag++) memused[tag] = bplib_os_memused_tag(tag);
+
+    /* Each Tag Accounts for its Own Blocks */
+    for(tag = 0; tag < BP_MEM_NUM_TAGS; tag++)
+    {
+        blocks[tag] = bplib_os_calloc_tag(1000, tag);
+        ut_assert(blocks[tag] != NULL, "Failed to allocate block with tag %d\n", tag);
+        ut_assert(bplib_os_memused_tag(tag) >= memused[tag] + 1000, "Block not accounted to tag %d\n", tag);
+    }
+    ut_check(bplib_os_memhigh() >= bplib_os_memused());
+    for(tag = 0; tag < BP_MEM_NUM_TAGS; tag++)
+    {
+        bplib_os_free(blocks[tag]);
+        ut_assert(bplib_os_memused_tag(tag) == memused[tag], "Block not returned to tag %d\n", tag);
+    }
+
+    /* Invalid Tags are General */
+    size_t general = bplib_os_memused_tag(BP_MEM_GENERAL);
+    void* block = bplib_os_calloc_tag(1000, BP_MEM_NUM_TAGS);
+    ut_check(block != NULL);
+    ut_check(bplib_os_memused_tag(BP_MEM_GENERAL) > general);
+    ut_check(bplib_os_memused_tag(BP_MEM_NUM_TAGS) == 0);
+    bplib_os_free(block);
+    ut_check(bplib_os_memused_tag(BP_MEM_GENERAL) == general);
+
+    /* Large Blocks are Zeroed and Cache Line Aligned */
+    uint8_t* large = (uint8_t*)bplib_os_calloc_tag(LARGE_BLOCK_SIZE, BP_MEM_ACTIVE_TABLE);
+    ut_assert(large != NULL, "Failed to allocate large block\n");
+    if(large)
+    {
+        ut_check(((uintptr_t)large % 64) == 0);
+        ut_check(large[0] == 0 && large[LARGE_BLOCK_SIZE - 1] == 0);
+        ut_check(bplib_os_memused_tag(BP_MEM_ACTIVE_TABLE) >= memused[BP_MEM_ACTIVE_TABLE] + LARGE_BLOCK_SIZE);
+        ut_check(bplib_os_memhigh() >= bplib_os_memused());
+        bplib_os_free(large);
+        ut_check(bplib_os_memused_tag(BP_MEM_ACTIVE_TABLE) == memused[BP_MEM_ACTIVE_TABLE]);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Freed by Another Thread
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    pthread_t threads[MAX_THREADS];
+    size_t memused = bplib_os_memused();
+    size_t store = bplib_os_memused_tag(BP_MEM_STORE);
+    int t, i;
+
+    printf("\n==== Test 2: Freed by Another Thread ====\n");
+
+    for(t = 0; t < MAX_THREADS; t++) pthread_create(&threads[t], NULL, allocate_blocks, handoff_blocks[t]);
+    for(t = 0; t < MAX_THREADS; t++) pthread_join(threads[t], NULL);
+
+    ut_check(bplib_os_memused_tag(BP_MEM_STORE) > store);
+    ut_check(bplib_os_memhigh() >= bplib_os_memused());
+
+    for(t = 0; t < MAX_THREADS; t++)
+    {
+        for(i = 0; i < NUM_BLOCKS; i++)
+        {
+            ut_check(handoff_blocks[t][i] != NULL);
+            bplib_os_free(handoff_blocks[t][i]);
+        }
+    }
+
+    ut_assert(bplib_os_memused() == memused, "Failed to account for memory freed by another thread: %ld\n", (long)(bplib_os_memused() - memused));
+    ut_check(bplib_os_memused_tag(BP_MEM_STORE) == store);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Allocator Hooks
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    size_t memused = bplib_os_memused();
+    int i;
+
+    printf("\n==== Test 3: Allocator Hooks ====\n");
+
+    hook_allocations = 0;
+    hook_frees = 0;
+    bplib_os_allocator(counting_alloc, counting_free);
+    {
+        uint8_t* blocks[10];
+        for(i = 0; i < 10; i++)
+        {
+            blocks[i] = (uint8_t*)bplib_os_calloc(100);
+            ut_check(blocks[i] != NULL);
+            if(blocks[i]) ut_check(blocks[i][0] == 0 && blocks[i][99] == 0);
+        }
+        void* large = bplib_os_calloc(LARGE_BLOCK_SIZE);
+        ut_check(large != NULL);
+        ut_check(bplib_os_memused() > memused + LARGE_BLOCK_SIZE);
+        for(i = 0; i < 10; i++) bplib_os_free(blocks[i]);
+        bplib_os_free(large);
+    }
+    bplib_os_allocator(NULL, NULL);
+
+    ut_assert(hook_allocations == 11, "Incorrect number of hook allocations: %d\n", hook_allocations);
+    ut_assert(hook_frees == 11, "Incorrect number of hook frees: %d\n", hook_frees);
+    ut_check(bplib_os_memused() == memused);
+
+    /* Default Restored */
+    void* block = bplib_os_calloc(100);
+    ut_check(block != NULL);
+    bplib_os_free(block);
+    ut_check(hook_allocations == 11);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #4 - Contended Allocation
+ *-------------------------------------------------------------------------------------*/
+static void test_4(void)
+{
+    int thread_counts[] = { 1, 2, 4, 8 };
+    pthread_t threads[MAX_THREADS];
+    int counts[MAX_THREADS];
+    struct timespec start;
+    unsigned int i;
+    int t;
+
+    printf("\n==== Test 4: Contended Allocation ====\n");
+
+    for(i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++)
+    {
+        int total = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for(t = 0; t < thread_counts[i]; t++)
+        {
+            counts[t] = NUM_ALLOCATIONS;
+            pthread_create(&threads[t], NULL, allocate_and_free, &counts[t]);
+        }
+        for(t = 0; t < thread_counts[i]; t++)
+        {
+            pthread_join(threads[t], NULL);
+            total += counts[t];
+        }
+        double msecs = memory_elapsed_ms(&start);
+
+        ut_assert(total == NUM_ALLOCATIONS * thread_counts[i], "Failed to allocate all blocks: %d\n", total);
+        printf("%d threads - %.1lf ns per allocate and free\n", thread_counts[i], (msecs * 1000000.0) / (double)total);
+    }
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_memory (void)
+{
+    ut_reset();
+
+    test_1();
+    test_2();
+    test_3();
+    test_4();
+
+    return ut_failures();
+}
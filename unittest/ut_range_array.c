@@ -0,0 +1,197 @@
+/************************************************************************
+ * File: ut_range_array.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "bundle_types.h"
+#include "rb_tree.h"
+#include "range_array.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define ARRAY_SIZE      8
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * check_ranges - compares the ranges of the array to the expected value/offset pairs
+ *-------------------------------------------------------------------------------------*/
+static bool check_ranges(range_array_t* array, bp_val_t* expected, int num_ranges)
+{
+    rb_range_t range;
+    int i;
+
+    if(array->size != (bp_val_t)num_ranges) return false;
+
+    range_array_goto_first(array);
+    for(i = 0; i < num_ranges; i++)
+    {
+        if(range_array_get_next(array, &range, false, false) != BP_SUCCESS) return false;
+        if(range.value != expected[i * 2] || range.offset != expected[(i * 2) + 1]) return false;
+    }
+
+    return range_array_get_next(array, &range, false, false) == BP_ERROR;
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Insert and Merge
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    range_array_t array;
+
+    printf("\n==== Test 1: Insert and Merge ====\n");
+
+    ut_assert(range_array_create(ARRAY_SIZE, &array) == BP_SUCCESS, "Failed to create range array\n");
+    ut_check(range_array_is_empty(&array));
+
+    /* Append and Extend Highest Range */
+    ut_check(range_array_insert(10, &array) == BP_SUCCESS);
+    ut_check(range_array_insert(11, &array) == BP_SUCCESS);
+    ut_check(range_array_insert(20, &array) == BP_SUCCESS);
+    bp_val_t step1[] = { 10, 1, 20, 0 };
+    ut_check(check_ranges(&array, step1, 2));
+
+    /* Insert Below, Between, and Merge Both Sides */
+    ut_check(range_array_insert(5, &array) == BP_SUCCESS);
+    ut_check(range_array_insert(15, &array) == BP_SUCCESS);
+    ut_check(range_array_insert(9, &array) == BP_SUCCESS);
+    ut_check(range_array_insert(19, &array) == BP_SUCCESS);
+    bp_val_t step2[] = { 5, 0, 9, 2, 15, 0, 19, 1 };
+    ut_check(check_ranges(&array, step2, 4));
+
+    ut_check(range_array_insert(6, &array) == BP_SUCCESS);
+    ut_check(range_array_insert(7, &array) == BP_SUCCESS);
+    ut_check(range_array_insert(8, &array) == BP_SUCCESS);
+    bp_val_t step3[] = { 5, 6, 15, 0, 19, 1 };
+    ut_check(check_ranges(&array, step3, 3));
+
+    /* Duplicates */
+    ut_check(range_array_insert(5, &array) == BP_DUPLICATE);
+    ut_check(range_array_insert(11, &array) == BP_DUPLICATE);
+    ut_check(range_array_insert(20, &array) == BP_DUPLICATE);
+    ut_check(check_ranges(&array, step3, 3));
+
+    /* Full */
+    ut_check(range_array_clear(&array) == BP_SUCCESS);
+    ut_check(range_array_is_empty(&array));
+    bp_val_t v;
+    for(v = 0; v < ARRAY_SIZE * 2; v += 2) ut_check(range_array_insert(v, &array) == BP_SUCCESS);
+    ut_check(range_array_is_full(&array));
+    ut_check(range_array_insert(ARRAY_SIZE * 4, &array) == BP_FULL);
+    ut_check(range_array_insert(1, &array) == BP_SUCCESS); /* merges, so no new range */
+
+    range_array_destroy(&array);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Delete and Split
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    range_array_t array;
+    bp_val_t v;
+
+    printf("\n==== Test 2: Delete and Split ====\n");
+
+    ut_assert(range_array_create(3, &array) == BP_SUCCESS, "Failed to create range array\n");
+    for(v = 100; v < 110; v++) ut_check(range_array_insert(v, &array) == BP_SUCCESS);
+
+    ut_check(range_array_delete(99, &array) == BP_ERROR);
+    ut_check(range_array_delete(110, &array) == BP_ERROR);
+    ut_check(range_array_delete(100, &array) == BP_SUCCESS);
+    ut_check(range_array_delete(109, &array) == BP_SUCCESS);
+    ut_check(range_array_delete(104, &array) == BP_SUCCESS);
+    bp_val_t step1[] = { 101, 2, 105, 3 };
+    ut_check(check_ranges(&array, step1, 2));
+
+    ut_check(range_array_delete(106, &array) == BP_SUCCESS);
+    ut_check(range_array_delete(102, &array) == BP_FULL);
+    bp_val_t step2[] = { 101, 2, 105, 0, 107, 1 };
+    ut_check(check_ranges(&array, step2, 3));
+
+    ut_check(range_array_delete(105, &array) == BP_SUCCESS);
+    ut_check(range_array_delete(105, &array) == BP_ERROR);
+    bp_val_t step3[] = { 101, 2, 107, 1 };
+    ut_check(check_ranges(&array, step3, 2));
+
+    range_array_destroy(&array);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Drain In Order
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    range_array_t array;
+    rb_range_t range;
+    bp_val_t v;
+
+    printf("\n==== Test 3: Drain In Order ====\n");
+
+    ut_assert(range_array_create(ARRAY_SIZE, &array) == BP_SUCCESS, "Failed to create range array\n");
+    for(v = 0; v < ARRAY_SIZE * 2; v += 2) ut_check(range_array_insert(v, &array) == BP_SUCCESS);
+
+    /* Partial Drain */
+    range_array_goto_first(&array);
+    ut_check(range_array_get_next(&array, &range, true, false) == BP_SUCCESS && range.value == 0);
+    ut_check(range_array_get_next(&array, &range, true, false) == BP_SUCCESS && range.value == 2);
+    ut_check(array.first == 2);
+
+    /* Insert Into Room Left by Popped Ranges */
+    ut_check(range_array_insert(0, &array) == BP_SUCCESS);
+    ut_check(array.first == 1);
+    ut_check(range_array_insert(ARRAY_SIZE * 4, &array) == BP_SUCCESS);
+    ut_check(range_array_is_full(&array));
+
+    /* Remaining Drain */
+    bp_val_t expected[] = { 0, 4, 6, 8, 10, 12, 14, ARRAY_SIZE * 4 };
+    int i = 0;
+    range_array_goto_first(&array);
+    while(!range_array_is_empty(&array))
+    {
+        ut_assert(range_array_get_next(&array, &range, true, false) == BP_SUCCESS, "Failed to get next range\n");
+        ut_check(i < ARRAY_SIZE && range.value == expected[i] && range.offset == 0);
+        i++;
+    }
+    ut_check(i == ARRAY_SIZE);
+    ut_check(array.first == 0);
+
+    range_array_destroy(&array);
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_range_array (void)
+{
+    ut_reset();
+
+    test_1();
+    test_2();
+    test_3();
+
+    return ut_failures();
+}
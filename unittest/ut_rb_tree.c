@@ -738,6 +738,14 @@ static void test_no_duplicates()
     ut_check(tree.size == 3);
     assert_rb_tree_is_valid(&tree);
     assert_inorder_nodes_are(tree.root, nodes, 3, 0);
+
+    /* Values inside a merged range are also duplicates */
+    ut_check(rb_tree_insert(11, &tree) == BP_SUCCESS);
+    ut_check(rb_tree_insert(12, &tree) == BP_SUCCESS);
+    ut_check(rb_tree_insert(11, &tree) == BP_DUPLICATE);
+    ut_check(rb_tree_insert(12, &tree) == BP_DUPLICATE);
+    ut_check(tree.size == 3);
+    assert_rb_tree_is_valid(&tree);
     rb_tree_destroy(&tree);
 
     if(f == ut_failures()) printf("PASS\n");
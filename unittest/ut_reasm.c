@@ -0,0 +1,195 @@
+/************************************************************************
+ * File: ut_reasm.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "reasm.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define PAYLOAD_SIZE    1000
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static uint8_t payload[PAYLOAD_SIZE];
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * add_fragment
+ *-------------------------------------------------------------------------------------*/
+static int add_fragment(reasm_t* reasm, bp_val_t seq, int offset, int size, reasm_entry_t** complete)
+{
+    int evicted;
+    reasm_key_t key = { 1, 2, 1000, seq };
+    bp_payload_data_t data = { 0, false, 0 };
+    return reasm_add(reasm, key, &data, PAYLOAD_SIZE, offset, &payload[offset], size, complete, &evicted);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - In Order
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    reasm_t reasm;
+    reasm_entry_t* complete = NULL;
+    int offset;
+
+    printf("\n==== Test 1: In Order ====\n");
+
+    ut_assert(reasm_create(&reasm, 4 * PAYLOAD_SIZE) == BP_SUCCESS, "Failed to create reassembly table\n");
+
+    for(offset = 0; offset < PAYLOAD_SIZE; offset += 100)
+    {
+        ut_assert(add_fragment(&reasm, 0, offset, 100, &complete) == BP_SUCCESS, "Failed to add fragment at %d\n", offset);
+        if(offset + 100 < PAYLOAD_SIZE)
+        {
+            ut_assert(complete == NULL, "Bundle prematurely complete at %d\n", offset);
+            ut_assert(reasm_count(&reasm) == 1, "Failed to count partial bundle\n");
+        }
+    }
+
+    ut_assert(complete != NULL, "Failed to complete bundle\n");
+    ut_assert(reasm_count(&reasm) == 0, "Failed to remove completed bundle\n");
+    ut_assert(reasm.memory_used == 0, "Failed to release memory of completed bundle: %d\n", reasm.memory_used);
+    if(complete)
+    {
+        ut_assert(complete->data.payloadsize == PAYLOAD_SIZE, "Incorrect payload size: %d\n", complete->data.payloadsize);
+        ut_assert(memcmp(complete->buffer, payload, PAYLOAD_SIZE) == 0, "Failed to reassemble payload\n");
+        reasm_release(&reasm, complete);
+    }
+
+    ut_assert(reasm_destroy(&reasm) == BP_SUCCESS, "Failed to destroy reassembly table\n");
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Out of Order, Overlapping, and Duplicate
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    reasm_t reasm;
+    reasm_entry_t* complete = NULL;
+
+    printf("\n==== Test 2: Out of Order, Overlapping, and Duplicate ====\n");
+
+    ut_assert(reasm_create(&reasm, 4 * PAYLOAD_SIZE) == BP_SUCCESS, "Failed to create reassembly table\n");
+
+    /* Disjoint Ranges - exceeds initial range array */
+    ut_check(add_fragment(&reasm, 0, 900, 100, &complete) == BP_SUCCESS);
+    ut_check(add_fragment(&reasm, 0, 100, 100, &complete) == BP_SUCCESS);
+    ut_check(add_fragment(&reasm, 0, 500, 100, &complete) == BP_SUCCESS);
+    ut_check(add_fragment(&reasm, 0, 300, 100, &complete) == BP_SUCCESS);
+    ut_check(add_fragment(&reasm, 0, 700, 100, &complete) == BP_SUCCESS);
+    ut_assert(reasm.newest->num_ranges == 5, "Incorrect number of ranges: %d\n", reasm.newest->num_ranges);
+
+    /* Duplicate */
+    ut_check(add_fragment(&reasm, 0, 300, 100, &complete) == BP_DUPLICATE);
+    ut_check(add_fragment(&reasm, 0, 320, 50, &complete) == BP_DUPLICATE);
+
+    /* Overlapping and Spanning */
+    ut_check(add_fragment(&reasm, 0, 150, 200, &complete) == BP_SUCCESS);
+    ut_assert(reasm.newest->num_ranges == 4, "Incorrect number of ranges: %d\n", reasm.newest->num_ranges);
+    ut_check(add_fragment(&reasm, 0, 350, 600, &complete) == BP_SUCCESS);
+    ut_assert(reasm.newest->num_ranges == 1, "Incorrect number of ranges: %d\n", reasm.newest->num_ranges);
+    ut_assert(reasm.newest->received == 900, "Incorrect number of bytes received: %d\n", reasm.newest->received);
+    ut_check(complete == NULL);
+
+    /* Final Gap */
+    ut_check(add_fragment(&reasm, 0, 0, 100, &complete) == BP_SUCCESS);
+    ut_assert(complete != NULL, "Failed to complete bundle\n");
+    if(complete)
+    {
+        ut_assert(memcmp(complete->buffer, payload, PAYLOAD_SIZE) == 0, "Failed to reassemble payload\n");
+        reasm_release(&reasm, complete);
+    }
+
+    /* Invalid Fragments */
+    ut_check(add_fragment(&reasm, 1, 950, 100, &complete) == BP_ERROR);
+    ut_check(add_fragment(&reasm, 1, -1, 100, &complete) == BP_ERROR);
+    ut_check(add_fragment(&reasm, 1, 0, 0, &complete) == BP_ERROR);
+
+    ut_assert(reasm_destroy(&reasm) == BP_SUCCESS, "Failed to destroy reassembly table\n");
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Memory Budget and Expiration
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    reasm_t reasm;
+    reasm_entry_t* complete = NULL;
+    reasm_key_t key = { 1, 2, 1000, 0 };
+    bp_payload_data_t data = { 50, false, 0 };
+    int evicted = 0;
+
+    printf("\n==== Test 3: Memory Budget and Expiration ====\n");
+
+    /* Budget Fits Two Partial Bundles */
+    ut_assert(reasm_create(&reasm, (int)(2 * (PAYLOAD_SIZE + sizeof(reasm_entry_t) + 4 * sizeof(reasm_range_t)))) == BP_SUCCESS, "Failed to create reassembly table\n");
+
+    key.createseq = 0; ut_check(reasm_add(&reasm, key, &data, PAYLOAD_SIZE, 0, payload, 10, &complete, &evicted) == BP_SUCCESS && evicted == 0);
+    key.createseq = 1; ut_check(reasm_add(&reasm, key, &data, PAYLOAD_SIZE, 0, payload, 10, &complete, &evicted) == BP_SUCCESS && evicted == 0);
+    ut_check(reasm_count(&reasm) == 2);
+
+    /* Third Evicts Oldest */
+    key.createseq = 2; data.exprtime = 100;
+    ut_check(reasm_add(&reasm, key, &data, PAYLOAD_SIZE, 0, payload, 10, &complete, &evicted) == BP_SUCCESS && evicted == 1);
+    ut_check(reasm_count(&reasm) == 2);
+    ut_check(reasm.oldest->key.createseq == 1);
+
+    /* Bundle Larger than Budget */
+    key.createseq = 3;
+    ut_check(reasm_add(&reasm, key, &data, 3 * PAYLOAD_SIZE, 0, payload, 10, &complete, &evicted) == BP_FULL);
+
+    /* Expiration */
+    ut_check(reasm_expire(&reasm, 49) == 0);
+    ut_check(reasm_expire(&reasm, 50) == 1);
+    ut_check(reasm_count(&reasm) == 1);
+    ut_check(reasm_expire(&reasm, 100) == 1);
+    ut_check(reasm_count(&reasm) == 0);
+    ut_check(reasm.memory_used == 0);
+
+    ut_assert(reasm_destroy(&reasm) == BP_SUCCESS, "Failed to destroy reassembly table\n");
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_reasm (void)
+{
+    int i;
+
+    ut_reset();
+
+    for(i = 0; i < PAYLOAD_SIZE; i++) payload[i] = (uint8_t)(i * 7);
+
+    test_1();
+    test_2();
+    test_3();
+
+    return ut_failures();
+}
@@ -0,0 +1,244 @@
+/************************************************************************
+ * File: ut_record.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "record.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define HEADER_SIZE     40
+#define PAYLOAD_SIZE    300
+#define OBJECT_SIZE     1024
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+static uint8_t payload[PAYLOAD_SIZE];
+static uint8_t header[HEADER_SIZE];
+static bp_val_t object_buf[OBJECT_SIZE / sizeof(bp_val_t)];
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * store_object - emulates a storage service enqueue of two blocks of data
+ *-------------------------------------------------------------------------------------*/
+static bp_object_t* store_object(void* data1, int data1_size, void* data2, int data2_size)
+{
+    bp_object_t* object = (bp_object_t*)object_buf;
+    object->header.handle = 0;
+    object->header.sid = (bp_sid_t)1;
+    object->header.size = data1_size + data2_size;
+    memcpy(object->data, data1, data1_size);
+    memcpy(&object->data[data1_size], data2, data2_size);
+    return object;
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Bundle Record
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    uint8_t buffer[BP_RECORD_PREFIX_BUF_SIZE + HEADER_SIZE];
+    bp_bundle_data_t data = { 0x123456789, { 70000, 12, 4 }, 20, 0, 30, HEADER_SIZE, HEADER_SIZE + PAYLOAD_SIZE, &buffer[BP_RECORD_PREFIX_BUF_SIZE] };
+    bp_bundle_data_t readback;
+    uint32_t flags = 0;
+
+    printf("\n==== Test 1: Bundle Record ====\n");
+
+    memcpy(data.header, header, HEADER_SIZE);
+
+    /* Write Prefix Ahead of Header */
+    int prefix_size = record_bundle_write(&data, buffer, BP_RECORD_PREFIX_BUF_SIZE, &flags);
+    ut_assert(prefix_size > 0 && prefix_size < BP_RECORD_PREFIX_BUF_SIZE, "Failed to write bundle record: %d\n", prefix_size);
+    ut_check(buffer[BP_RECORD_PREFIX_BUF_SIZE - prefix_size] == BP_RECORD_BUNDLE_V1);
+    ut_check(buffer[BP_RECORD_PREFIX_BUF_SIZE - 1] == prefix_size);
+
+    /* Read Record */
+    bp_object_t* object = store_object(data.header - prefix_size, prefix_size + HEADER_SIZE, payload, PAYLOAD_SIZE);
+    ut_assert(record_bundle_read(object, &readback, &flags) == BP_SUCCESS, "Failed to read bundle record\n");
+    ut_check(readback.exprtime == data.exprtime);
+    ut_check(readback.cidfield.value == data.cidfield.value);
+    ut_check(readback.cidfield.index == data.cidfield.index);
+    ut_check(readback.cidfield.width == data.cidfield.width);
+    ut_check(readback.cteboffset == data.cteboffset);
+    ut_check(readback.biboffset == data.biboffset);
+    ut_check(readback.payoffset == data.payoffset);
+    ut_check(readback.headersize == data.headersize);
+    ut_check(readback.bundlesize == data.bundlesize);
+    ut_check(memcmp(readback.header, header, HEADER_SIZE) == 0);
+    ut_check(memcmp(&readback.header[HEADER_SIZE], payload, PAYLOAD_SIZE) == 0);
+
+    /* Locate Object from Header */
+    ut_check(record_object(readback.header) == object);
+
+    /* Reject Inconsistent Record */
+    object->header.size -= 1;
+    ut_check(record_bundle_read(object, &readback, &flags) == BP_ERROR);
+    ut_check(flags & BP_FLAG_STORE_FAILURE);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Payload Record
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    uint8_t buffer[BP_RECORD_PREFIX_BUF_SIZE];
+    bp_payload_data_t data = { 1000, true, PAYLOAD_SIZE };
+    bp_payload_data_t readback;
+    uint8_t* record_payload = NULL;
+    uint32_t flags = 0;
+
+    printf("\n==== Test 2: Payload Record ====\n");
+
+    int prefix_size = record_payload_write(&data, buffer, BP_RECORD_PREFIX_BUF_SIZE, &flags);
+    ut_assert(prefix_size > 0, "Failed to write payload record: %d\n", prefix_size);
+
+    bp_object_t* object = store_object(&buffer[BP_RECORD_PREFIX_BUF_SIZE - prefix_size], prefix_size, payload, PAYLOAD_SIZE);
+    ut_assert(record_payload_read(object, &readback, &record_payload, &flags) == BP_SUCCESS, "Failed to read payload record\n");
+    ut_check(readback.exprtime == data.exprtime);
+    ut_check(readback.ackapp == data.ackapp);
+    ut_check(readback.payloadsize == data.payloadsize);
+    ut_check(record_payload && memcmp(record_payload, payload, PAYLOAD_SIZE) == 0);
+    ut_check(record_object(record_payload) == object);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Legacy Records
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    struct {
+        bp_val_t            exprtime;
+        bp_field_t          cidfield;
+        int                 cteboffset;
+        int                 biboffset;
+        int                 payoffset;
+        int                 headersize;
+        int                 bundlesize;
+        uint8_t             header[BP_BUNDLE_HDR_BUF_SIZE];
+    } legacy_bundle = { 5, { 7, 12, 4 }, 20, 0, 30, HEADER_SIZE, HEADER_SIZE + PAYLOAD_SIZE, { 0 } };
+    bp_payload_data_t legacy_payload = { 8, false, PAYLOAD_SIZE };
+    bp_bundle_data_t bundle_data;
+    bp_payload_data_t payload_data;
+    uint8_t* record_payload = NULL;
+    uint32_t flags = 0;
+
+    printf("\n==== Test 3: Legacy Records ====\n");
+
+    /* Legacy Bundle */
+    memcpy(legacy_bundle.header, header, HEADER_SIZE);
+    int legacy_size = (int)((uint8_t*)&legacy_bundle.header[HEADER_SIZE] - (uint8_t*)&legacy_bundle);
+    bp_object_t* object = store_object(&legacy_bundle, legacy_size, payload, PAYLOAD_SIZE);
+    ut_check(record_bundle_read(object, &bundle_data, &flags) == BP_PENDING_MIGRATION);
+    ut_check(bundle_data.exprtime == 5);
+    ut_check(bundle_data.cidfield.value == 7);
+    ut_check(bundle_data.cteboffset == 20);
+    ut_check(bundle_data.bundlesize == HEADER_SIZE + PAYLOAD_SIZE);
+    ut_check(memcmp(bundle_data.header, header, HEADER_SIZE) == 0);
+    ut_check(memcmp(&bundle_data.header[HEADER_SIZE], payload, PAYLOAD_SIZE) == 0);
+
+    /* Legacy Payload */
+    object = store_object(&legacy_payload, sizeof(legacy_payload), payload, PAYLOAD_SIZE);
+    ut_check(record_payload_read(object, &payload_data, &record_payload, &flags) == BP_PENDING_MIGRATION);
+    ut_check(payload_data.exprtime == 8);
+    ut_check(payload_data.payloadsize == PAYLOAD_SIZE);
+    ut_check(record_payload && memcmp(record_payload, payload, PAYLOAD_SIZE) == 0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #4 - Journal Record
+ *-------------------------------------------------------------------------------------*/
+static void test_4(void)
+{
+    uint8_t buffer[BP_RECORD_PREFIX_BUF_SIZE];
+    uint8_t entries[BP_JOURNAL_MAX_ENTRY_SIZE * 2];
+    bp_journal_entry_t active = { BP_JOURNAL_ACTIVE, { 0x12345678, 77, 1000, 0xABCDEF } };
+    bp_journal_entry_t custody = { BP_JOURNAL_CUSTODY, { 4, 3, 500, 20 } };
+    bp_journal_entry_t entry;
+    bp_journal_t journal = { 9, 78, true, 2, 0 };
+    bp_journal_t readback;
+    uint32_t flags = 0;
+
+    printf("\n==== Test 4: Journal Record ====\n");
+
+    /* Write Entries */
+    int offset = record_entry_write(&active, entries, 0, sizeof(entries));
+    ut_assert(offset > 0, "Failed to write active entry: %d\n", offset);
+    offset = record_entry_write(&custody, entries, offset, sizeof(entries));
+    ut_assert(offset > 0, "Failed to write custody entry: %d\n", offset);
+    ut_check(record_entry_write(&custody, entries, offset, offset + 4) == BP_FULL);
+    journal.entries_size = offset;
+
+    /* Write Record */
+    int prefix_size = record_journal_write(&journal, buffer, BP_RECORD_PREFIX_BUF_SIZE, &flags);
+    ut_assert(prefix_size > 0, "Failed to write journal record: %d\n", prefix_size);
+
+    /* Read Record */
+    bp_object_t* object = store_object(&buffer[BP_RECORD_PREFIX_BUF_SIZE - prefix_size], prefix_size, entries, offset);
+    ut_assert(record_journal_read(object, &readback, &flags) == prefix_size, "Failed to read journal record\n");
+    ut_check(readback.checkpoint == 9);
+    ut_check(readback.current_cid == 78);
+    ut_check(readback.last == true);
+    ut_check(readback.num_entries == 2);
+    ut_check(readback.entries_size == offset);
+
+    /* Read Entries */
+    offset = record_entry_read(object, prefix_size, &entry);
+    ut_check(offset > 0 && entry.type == BP_JOURNAL_ACTIVE);
+    ut_check(entry.fields[0] == active.fields[0] && entry.fields[1] == 77 && entry.fields[2] == 1000 && entry.fields[3] == 0xABCDEF);
+    offset = record_entry_read(object, offset, &entry);
+    ut_check(offset == object->header.size && entry.type == BP_JOURNAL_CUSTODY);
+    ut_check(entry.fields[0] == 4 && entry.fields[1] == 3 && entry.fields[2] == 500 && entry.fields[3] == 20);
+
+    /* Other Records are Not Journal Records */
+    bp_payload_data_t data = { 1000, true, PAYLOAD_SIZE };
+    prefix_size = record_payload_write(&data, buffer, BP_RECORD_PREFIX_BUF_SIZE, &flags);
+    object = store_object(&buffer[BP_RECORD_PREFIX_BUF_SIZE - prefix_size], prefix_size, payload, PAYLOAD_SIZE);
+    flags = 0;
+    ut_check(record_journal_read(object, &readback, &flags) < 0);
+    ut_check(flags & BP_FLAG_STORE_FAILURE);
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_record (void)
+{
+    int i;
+
+    ut_reset();
+
+    for(i = 0; i < PAYLOAD_SIZE; i++) payload[i] = (uint8_t)(i * 3);
+    for(i = 0; i < HEADER_SIZE; i++) header[i] = (uint8_t)(i + 100);
+
+    test_1();
+    test_2();
+    test_3();
+    test_4();
+
+    return ut_failures();
+}
@@ -31,7 +31,8 @@
  *-------------------------------------------------------------------------------------*/
 static void print_hash(rh_hash_t* rh_hash, const char* message)
 {
-    int i, j;
+    int i;
+    uint32_t j;
 
     printf("\n------------------------\n");
     printf("HASH TABLE: %s\n", message);
@@ -39,7 +40,7 @@ static void print_hash(rh_hash_t* rh_hash, const char* message)
     printf("Size:               %d\n", (int)rh_hash->size);
     printf("Number of Entries:  %d\n", (int)rh_hash->num_entries);
 
-    if(rh_hash->oldest_entry != BP_MAX_INDEX)
+    if(rh_hash->oldest_entry != RH_NULL_INDEX)
     {
         printf("Oldest Entry:       [%d] %lu\n", rh_hash->oldest_entry, (unsigned long)rh_hash->table[rh_hash->oldest_entry].bundle.cid);
     }
@@ -48,7 +49,7 @@ static void print_hash(rh_hash_t* rh_hash, const char* message)
         printf("Oldest Entry:       N\n");
     }
 
-    if(rh_hash->newest_entry != BP_MAX_INDEX)
+    if(rh_hash->newest_entry != RH_NULL_INDEX)
     {
         printf("Newest Entry:       [%d] %lu\n", rh_hash->newest_entry, (unsigned long)rh_hash->table[rh_hash->newest_entry].bundle.cid);
     }
@@ -68,27 +69,27 @@ static void print_hash(rh_hash_t* rh_hash, const char* message)
         {
             printf("%-4lu -- ", (unsigned long)rh_hash->table[i].bundle.cid);
 
-            j = rh_hash->table[i].next;
-            if(j == BP_MAX_INDEX) printf("   ");
+            j = rh_hash_link(rh_hash, i, RH_LINK_NEXT);
+            if(j == RH_NULL_INDEX) printf("   ");
 
-            while(j != BP_MAX_INDEX)
+            while(j != RH_NULL_INDEX)
             {
-                printf("%-2d ", j);
-                j = rh_hash->table[j].next;
+                printf("%-2d ", (int)j);
+                j = rh_hash_link(rh_hash, j, RH_LINK_NEXT);
             }
 
             printf("| ");
-            if(rh_hash->table[i].before != BP_MAX_INDEX)    printf("%d", rh_hash->table[i].before);
-            else                                            printf("N");
+            if(rh_hash_link(rh_hash, i, RH_LINK_BEFORE) != RH_NULL_INDEX)    printf("%d", rh_hash_link(rh_hash, i, RH_LINK_BEFORE));
+            else                                                                printf("N");
             printf(" <--t--> ");
-            if(rh_hash->table[i].after != BP_MAX_INDEX)     printf("%d", rh_hash->table[i].after);
-            else                                            printf("N");
+            if(rh_hash_link(rh_hash, i, RH_LINK_AFTER) != RH_NULL_INDEX)     printf("%d", rh_hash_link(rh_hash, i, RH_LINK_AFTER));
+            else                                                                printf("N");
             printf(" | ");
-            if(rh_hash->table[i].prev != BP_MAX_INDEX)      printf("%d", rh_hash->table[i].prev);
-            else                                            printf("N");
+            if(rh_hash_link(rh_hash, i, RH_LINK_PREV) != RH_NULL_INDEX)      printf("%d", rh_hash_link(rh_hash, i, RH_LINK_PREV));
+            else                                                                printf("N");
             printf(" <<-h->> ");
-            if(rh_hash->table[i].next != BP_MAX_INDEX)      printf("%d", rh_hash->table[i].next);
-            else                                            printf("N");
+            if(rh_hash_link(rh_hash, i, RH_LINK_NEXT) != RH_NULL_INDEX)      printf("%d", rh_hash_link(rh_hash, i, RH_LINK_NEXT));
+            else                                                                printf("N");
         }
         printf("\n");
     }
@@ -107,7 +108,7 @@ static void test_1(void)
     bp_val_t cid;
 
     int hash_size = 8;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
 
     printf("\n==== Test 1: Create/Destroy ====\n");
 
@@ -183,7 +184,7 @@ static void test_2(void)
     bp_val_t cid;
 
     int hash_size = 8;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
 
     printf("\n==== Test 2: Chaining ====\n");
 
@@ -250,7 +251,7 @@ static void test_3(void)
     bp_val_t cid;
 
     int hash_size = 16;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
 
     printf("\n==== Test 3: Remove First, Middle, Last in Chain ====\n");
 
@@ -361,7 +362,7 @@ static void test_4(void)
     rh_hash_t* rh_hash;
 
     int hash_size = 16;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
 
     printf("\n==== Test 4: Duplicates ====\n");
 
@@ -450,7 +451,7 @@ static void test_5(void)
     bp_val_t cid;
 
     int hash_size = 8;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
 
     printf("\n==== Test 5: Retransverse ====\n");
 
@@ -532,7 +533,7 @@ static void test_6(void)
     int i, j;
 
     int hash_size = 8;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
 
     printf("\n==== Test 6: Full Hash ====\n");
 
@@ -638,7 +639,7 @@ static void test_7(void)
     bp_val_t cid;
 
     int hash_size = 16;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
 
     printf("\n==== Test 7: Collisions - First, Middle, Last in Chain ====\n");
 
@@ -744,7 +745,7 @@ static void test_8(void)
     int cid_range = 0xFFFFFFFF;
 
     bool found_error = false;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
     bp_val_t* order_of_cids = (bp_val_t*)malloc(hash_size * sizeof(bp_val_t));
     int num_added = 0;
 
@@ -826,7 +827,7 @@ static void test_9(void)
     int cid_range = 0xFFFFFFFF;
 
     bool found_error = false;
-    bp_active_bundle_t bundle = {1, 0, 0};
+    bp_active_bundle_t bundle = {1, 0, 0, 0};
     bp_val_t* order_of_cids = (bp_val_t*)malloc(hash_size * sizeof(bp_val_t));
     int num_added = 0;
 
@@ -914,6 +915,56 @@ static void test_9(void)
     free(order_of_cids);
 }
 
+/*--------------------------------------------------------------------------------------
+ * Test #10
+ *--------------------------------------------------------------------------------------*/
+static void test_10(void)
+{
+    int i;
+    rh_hash_t* rh_hash;
+    int hash_size = 64;
+    bp_active_bundle_t bundle;
+    bp_sid_t sids[64];
+
+    printf("\n==== Test 10: Remove Range ====\n");
+
+    ut_assert(rh_hash_create(&rh_hash, hash_size) == BP_SUCCESS, "Failed to create hash\n");
+
+    /* Add Every CID but 20 */
+    for(i = 0; i < hash_size; i++)
+    {
+        if(i == 20) continue;
+        bundle.cid = i + 1000;
+        bundle.sid = (bp_sid_t)(i + 1);
+        bundle.retx = 0;
+        ut_check(rh_hash_add(rh_hash, bundle, false) == BP_SUCCESS);
+    }
+
+    /* Remove Range with Gap */
+    ut_check(rh_hash_remove_range(rh_hash, 1010, 20, sids) == 19);
+    ut_check(sids[0] == 11);
+    ut_check(sids[9] == 20);
+    ut_check(sids[10] == 22);
+    ut_check(rh_hash->num_entries == hash_size - 20);
+
+    /* Oldest Entry Unchanged */
+    ut_check(rh_hash_next(rh_hash, &bundle) == BP_SUCCESS && bundle.cid == 1000);
+
+    /* Remove Range Already Removed */
+    ut_check(rh_hash_remove_range(rh_hash, 1010, 20, sids) == 0);
+
+    /* Remove Range Overlapping End */
+    ut_check(rh_hash_remove_range(rh_hash, 1050, 100, sids) == 14);
+    ut_check(rh_hash->num_entries == hash_size - 34);
+
+    /* Remove Remaining */
+    ut_check(rh_hash_remove_range(rh_hash, 1000, 50, sids) == 30);
+    ut_check(rh_hash->num_entries == 0);
+    ut_check(rh_hash_next(rh_hash, &bundle) == BP_ERROR);
+
+    ut_assert(rh_hash_destroy(rh_hash) == BP_SUCCESS, "Failed to destroy hash\n");
+}
+
 /******************************************************************************
  EXPORTED FUNCTIONS
  ******************************************************************************/
@@ -931,6 +982,7 @@ int ut_rh_hash (void)
     test_7();
     test_8();
     test_9();
+    test_10();
 
     return ut_failures();
 }
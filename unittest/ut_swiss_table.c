@@ -0,0 +1,313 @@
+/************************************************************************
+ * File: ut_swiss_table.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "cbuf.h"
+#include "rh_hash.h"
+#include "swiss_table.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define TABLE_SIZE          8
+#define CHURN_SIZE          1000
+#define CHURN_ROUNDS        20000
+#define LARGE_TABLE_SIZE    70000   /* more entries than a 16-bit index holds */
+
+/******************************************************************************
+ LOCAL DATA
+ ******************************************************************************/
+
+static bp_active_table_t swiss_active_table = {
+    .create = (bp_table_create_t)swiss_table_create, .destroy = (bp_table_destroy_t)swiss_table_destroy,
+    .add = (bp_table_add_t)swiss_table_add, .next = (bp_table_next_t)swiss_table_next,
+    .remove = (bp_table_remove_t)swiss_table_remove, .count = (bp_table_count_t)swiss_table_count,
+    .walk = (bp_table_walk_t)swiss_table_walk };
+
+static bp_active_table_t rh_active_table = {
+    .create = (bp_table_create_t)rh_hash_create, .destroy = (bp_table_destroy_t)rh_hash_destroy,
+    .add = (bp_table_add_t)rh_hash_add, .next = (bp_table_next_t)rh_hash_next,
+    .remove = (bp_table_remove_t)rh_hash_remove, .count = (bp_table_count_t)rh_hash_count,
+    .walk = (bp_table_walk_t)rh_hash_walk };
+
+static bp_active_table_t cbuf_active_table = {
+    .create = (bp_table_create_t)cbuf_create, .destroy = (bp_table_destroy_t)cbuf_destroy,
+    .add = (bp_table_add_t)cbuf_add, .next = (bp_table_next_t)cbuf_next,
+    .remove = (bp_table_remove_t)cbuf_remove, .count = (bp_table_count_t)cbuf_count,
+    .walk = (bp_table_walk_t)cbuf_walk };
+
+static bp_val_t walked_cids[TABLE_SIZE];
+static int walked_count;
+static int walk_limit;
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * make_bundle -
+ *-------------------------------------------------------------------------------------*/
+static bp_active_bundle_t make_bundle(bp_val_t cid, bp_val_t retx)
+{
+    bp_active_bundle_t bundle = { .sid = (bp_sid_t)(cid + 1), .retx = retx, .cid = cid };
+    return bundle;
+}
+
+/*--------------------------------------------------------------------------------------
+ * visit_bundle - records custody IDs walked, failing once the walk limit is reached
+ *-------------------------------------------------------------------------------------*/
+static int visit_bundle(void* parm, bp_active_bundle_t* bundle)
+{
+    (void)parm;
+    if(walked_count >= walk_limit) return BP_ERROR;
+    walked_cids[walked_count++] = bundle->cid;
+    return BP_SUCCESS;
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Add, Next, and Remove
+ *-------------------------------------------------------------------------------------*/
+static void test_1(void)
+{
+    swiss_table_t* table;
+    bp_active_bundle_t bundle;
+    bp_sid_t sids[TABLE_SIZE];
+    bp_val_t cid;
+
+    printf("\n==== Test 1: Add, Next, and Remove ====\n");
+
+    ut_assert(swiss_table_create(&table, TABLE_SIZE) == BP_SUCCESS, "Failed to create swiss table\n");
+    ut_check(swiss_table_next(table, &bundle) == BP_ERROR);
+
+    /* Fill Table */
+    for(cid = 0; cid < TABLE_SIZE; cid++)
+    {
+        ut_check(swiss_table_available(table, cid) == BP_SUCCESS);
+        ut_check(swiss_table_add(table, make_bundle(cid, 0), false) == BP_SUCCESS);
+    }
+    ut_check(swiss_table_count(table) == TABLE_SIZE);
+    ut_check(swiss_table_available(table, TABLE_SIZE) == BP_ERROR);
+    ut_check(swiss_table_add(table, make_bundle(TABLE_SIZE, 0), false) == BP_ERROR);
+    ut_check(swiss_table_add(table, make_bundle(3, 0), false) == BP_DUPLICATE);
+
+    /* Oldest First */
+    ut_check(swiss_table_next(table, &bundle) == BP_SUCCESS && bundle.cid == 0);
+    ut_check(swiss_table_remove(table, 0, &bundle) == BP_SUCCESS && bundle.sid == 1);
+    ut_check(swiss_table_remove(table, 0, NULL) == BP_ERROR);
+    ut_check(swiss_table_next(table, &bundle) == BP_SUCCESS && bundle.cid == 1);
+
+    /* Overwrite Moves to Newest */
+    ut_check(swiss_table_add(table, make_bundle(1, 5), true) == BP_SUCCESS);
+    ut_check(swiss_table_count(table) == TABLE_SIZE - 1);
+    ut_check(swiss_table_next(table, &bundle) == BP_SUCCESS && bundle.cid == 2);
+
+    /* Remove Range */
+    ut_check(swiss_table_remove_range(table, 2, 4, sids) == 4);
+    ut_check(sids[0] == 3 && sids[3] == 6);
+    ut_check(swiss_table_next(table, &bundle) == BP_SUCCESS && bundle.cid == 6);
+    ut_check(swiss_table_remove(table, 6, NULL) == BP_SUCCESS);
+    ut_check(swiss_table_remove(table, 7, NULL) == BP_SUCCESS);
+    ut_check(swiss_table_next(table, &bundle) == BP_SUCCESS && bundle.cid == 1 && bundle.retx == 5);
+    ut_check(swiss_table_remove(table, 1, NULL) == BP_SUCCESS);
+    ut_check(swiss_table_next(table, &bundle) == BP_ERROR);
+    ut_check(swiss_table_count(table) == 0);
+
+    swiss_table_destroy(table);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Churn Against Robin Hood Hash
+ *
+ *  Acknowledges random custody IDs and retransmits the oldest, which leaves deleted
+ *  slots and wraps the ring many times over, checking the time order matches rh_hash.
+ *-------------------------------------------------------------------------------------*/
+static void test_2(void)
+{
+    swiss_table_t* table;
+    rh_hash_t* rh_hash;
+    bp_active_bundle_t bundle, expected;
+    bp_val_t next_cid = 0;
+    int round, mismatches = 0;
+
+    printf("\n==== Test 2: Churn Against Robin Hood Hash ====\n");
+
+    ut_assert(swiss_table_create(&table, CHURN_SIZE) == BP_SUCCESS, "Failed to create swiss table\n");
+    ut_assert(rh_hash_create(&rh_hash, CHURN_SIZE) == BP_SUCCESS, "Failed to create rh hash\n");
+
+    srand(1);
+    for(round = 0; round < CHURN_ROUNDS; round++)
+    {
+        int action = rand() % 4;
+        if(action < 2 && swiss_table_available(table, next_cid) == BP_SUCCESS)
+        {
+            /* Send New Bundle */
+            ut_check(swiss_table_add(table, make_bundle(next_cid, round), false) == BP_SUCCESS);
+            ut_check(rh_hash_add(rh_hash, make_bundle(next_cid, round), false) == BP_SUCCESS);
+            next_cid++;
+        }
+        else if(action == 2 && next_cid > 0)
+        {
+            /* Acknowledge Recent Custody ID */
+            bp_val_t cid = next_cid - 1 - (rand() % (CHURN_SIZE * 2));
+            int status = rh_hash_remove(rh_hash, cid, &expected);
+            ut_check(swiss_table_remove(table, cid, &bundle) == status);
+            if(status == BP_SUCCESS && bundle.sid != expected.sid) mismatches++;
+        }
+        else if(swiss_table_next(table, &bundle) == BP_SUCCESS)
+        {
+            /* Retransmit Oldest */
+            ut_check(rh_hash_next(rh_hash, &expected) == BP_SUCCESS);
+            if(bundle.cid != expected.cid) mismatches++;
+            bundle.retx = round;
+            ut_check(swiss_table_add(table, bundle, true) == BP_SUCCESS);
+            ut_check(rh_hash_add(rh_hash, bundle, true) == BP_SUCCESS);
+        }
+
+        if(swiss_table_count(table) != rh_hash_count(rh_hash)) mismatches++;
+    }
+    ut_check(mismatches == 0);
+
+    /* Drain in Same Order */
+    while(swiss_table_next(table, &bundle) == BP_SUCCESS)
+    {
+        ut_assert(rh_hash_next(rh_hash, &expected) == BP_SUCCESS, "Robin hood hash empty before swiss table\n");
+        ut_check(bundle.cid == expected.cid && bundle.retx == expected.retx);
+        swiss_table_remove(table, bundle.cid, NULL);
+        rh_hash_remove(rh_hash, expected.cid, NULL);
+    }
+    ut_check(rh_hash_next(rh_hash, &expected) == BP_ERROR);
+
+    swiss_table_destroy(table);
+    rh_hash_destroy(rh_hash);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #3 - Tables Larger Than 16-bit Index
+ *
+ *  Fills each table past 65535 entries and slides the window of unacknowledged custody
+ *  IDs by two tables, checking the oldest entry as it goes.
+ *-------------------------------------------------------------------------------------*/
+static void test_3(void)
+{
+    bp_active_table_t* tables[] = { &swiss_active_table, &rh_active_table, &cbuf_active_table };
+    const char* names[] = { "swiss table", "rh hash", "cbuf" };
+    bp_active_bundle_t bundle;
+    unsigned int i;
+    bp_val_t cid;
+
+    printf("\n==== Test 3: Tables Larger Than 16-bit Index ====\n");
+
+    for(i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+    {
+        bp_active_table_t* at = tables[i];
+        int failures = 0;
+        ut_assert(at->create(&at->table, LARGE_TABLE_SIZE) == BP_SUCCESS, "Failed to create %s\n", names[i]);
+
+        for(cid = 0; cid < LARGE_TABLE_SIZE; cid++)
+        {
+            if(at->add(at->table, make_bundle(cid, 0), false) != BP_SUCCESS) failures++;
+        }
+        ut_check(at->count(at->table) == LARGE_TABLE_SIZE);
+
+        for(cid = LARGE_TABLE_SIZE; cid < LARGE_TABLE_SIZE * 3; cid++)
+        {
+            if(at->remove(at->table, cid - LARGE_TABLE_SIZE, &bundle) != BP_SUCCESS || bundle.sid != (bp_sid_t)(cid - LARGE_TABLE_SIZE + 1)) failures++;
+            if(at->next(at->table, &bundle) != BP_SUCCESS || bundle.cid != cid - LARGE_TABLE_SIZE + 1) failures++;
+            if(at->add(at->table, make_bundle(cid, 0), false) != BP_SUCCESS) failures++;
+        }
+        ut_check(failures == 0);
+        ut_check(at->count(at->table) == LARGE_TABLE_SIZE);
+
+        at->destroy(at->table);
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #4 - Walk in Retransmit Order
+ *
+ *  Walking a table must visit entries in the order they are returned by next, which is
+ *  the order a checkpoint journals them in and recovery adds them back in.
+ *-------------------------------------------------------------------------------------*/
+static void test_4(void)
+{
+    bp_active_table_t* tables[] = { &swiss_active_table, &rh_active_table, &cbuf_active_table };
+    const char* names[] = { "swiss table", "rh hash", "cbuf" };
+    bp_active_bundle_t bundle;
+    unsigned int i;
+    bp_val_t cid;
+    int j;
+
+    printf("\n==== Test 4: Walk in Retransmit Order ====\n");
+
+    for(i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+    {
+        bp_active_table_t* at = tables[i];
+        ut_assert(at->create(&at->table, TABLE_SIZE) == BP_SUCCESS, "Failed to create %s\n", names[i]);
+
+        /* Add, Acknowledge, and Retransmit */
+        for(cid = 100; cid < 100 + TABLE_SIZE / 2; cid++)
+        {
+            ut_check(at->add(at->table, make_bundle(cid, cid), false) == BP_SUCCESS);
+        }
+        ut_check(at->remove(at->table, 103, NULL) == BP_SUCCESS);
+        ut_check(at->add(at->table, make_bundle(101, 200), true) == BP_SUCCESS);
+
+        /* Walk Stops at Failure */
+        walked_count = 0;
+        walk_limit = 2;
+        ut_check(at->walk(at->table, visit_bundle, NULL) == BP_ERROR);
+        ut_check(walked_count == 2);
+
+        /* Walk All */
+        walked_count = 0;
+        walk_limit = TABLE_SIZE;
+        ut_check(at->walk(at->table, visit_bundle, NULL) == BP_SUCCESS);
+        ut_check(walked_count == at->count(at->table));
+
+        /* Drain in Walked Order */
+        for(j = 0; j < walked_count; j++)
+        {
+            ut_assert(at->next(at->table, &bundle) == BP_SUCCESS, "%s empty before walked entries\n", names[i]);
+            ut_check(bundle.cid == walked_cids[j]);
+            ut_check(at->remove(at->table, bundle.cid, NULL) == BP_SUCCESS);
+        }
+        ut_check(at->count(at->table) == 0);
+
+        at->destroy(at->table);
+    }
+}
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_swiss_table (void)
+{
+    ut_reset();
+
+    test_1();
+    test_2();
+    test_3();
+    test_4();
+
+    return ut_failures();
+}
@@ -0,0 +1,235 @@
+/************************************************************************
+ * File: ut_trace.c
+ *
+ *  Copyright 2019 United States Government as represented by the
+ *  Administrator of the National Aeronautics and Space Administration.
+ *  All Other Rights Reserved.
+ *
+ *  This software was created at NASA's Goddard Space Flight Center.
+ *  This software is governed by the NASA Open Source Agreement and may be
+ *  used, distributed and modified only pursuant to the terms of that
+ *  agreement.
+ *
+ * Maintainer(s):
+ *  Joe-Paul Swinski, Code 582 NASA GSFC
+ *
+ *************************************************************************/
+
+/******************************************************************************
+ INCLUDES
+ ******************************************************************************/
+
+#include "ut_assert.h"
+#include "bplib.h"
+#include "bplib_trace.h"
+#include "bplib_store_ram.h"
+
+/******************************************************************************
+ DEFINES
+ ******************************************************************************/
+
+#define VIRTUAL_START       600000000   /* seconds since 2000 */
+#define NUM_BUNDLES         100
+#define RECORDER_SIZE       100         /* rounded up to 128 */
+
+/******************************************************************************
+ FILE DATA
+ ******************************************************************************/
+
+#ifdef BP_TRACE
+
+static int hook_counts[BP_TRACE_NUM_POINTS];
+static bp_trace_event_t hook_events[BP_TRACE_NUM_POINTS]; /* last event of each point */
+
+static bp_store_t ram_store = {
+    .create     = bplib_store_ram_create,
+    .destroy    = bplib_store_ram_destroy,
+    .enqueue    = bplib_store_ram_enqueue,
+    .dequeue    = bplib_store_ram_dequeue,
+    .retrieve   = bplib_store_ram_retrieve,
+    .release    = bplib_store_ram_release,
+    .relinquish = bplib_store_ram_relinquish,
+    .getcount   = bplib_store_ram_getcount,
+    .relinquish_batch = bplib_store_ram_relinquish_batch
+};
+
+/******************************************************************************
+ LOCAL FUNCTIONS
+ ******************************************************************************/
+
+/*--------------------------------------------------------------------------------------
+ * count_event - trace hook
+ *-------------------------------------------------------------------------------------*/
+static void count_event(const bp_trace_event_t* event, void* parm)
+{
+    (void)parm;
+    if(event->point >= 0 && event->point < BP_TRACE_NUM_POINTS)
+    {
+        hook_counts[event->point]++;
+        hook_events[event->point] = *event;
+    }
+}
+
+/*--------------------------------------------------------------------------------------
+ * round_trip - sends a payload with custody and returns the custody signal to the sender
+ *-------------------------------------------------------------------------------------*/
+static void round_trip(bp_desc_t* sender, bp_desc_t* receiver, int payload_size)
+{
+    uint8_t payload[1024];
+    uint32_t flags = 0;
+    void* bundle;
+    int size;
+
+    memset(payload, 0xA5, sizeof(payload));
+    ut_check(bplib_store(sender, payload, payload_size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_load(sender, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_process(receiver, bundle, size, BP_CHECK, &flags) == BP_SUCCESS);
+    bplib_ackbundle(sender, bundle);
+    ut_check(bplib_accept(receiver, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+    bplib_ackpayload(receiver, bundle);
+
+    /* Custody Signal */
+    bplib_os_vclock_advance(BP_DEFAULT_DACS_RATE * 1000);
+    ut_check(bplib_load(receiver, &bundle, &size, BP_CHECK, &flags) == BP_SUCCESS);
+    ut_check(bplib_process(sender, bundle, size, BP_CHECK, &flags) == BP_SUCCESS);
+    bplib_ackbundle(receiver, bundle);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #1 - Hook
+ *-------------------------------------------------------------------------------------*/
+static void test_1(bp_desc_t* sender, bp_desc_t* receiver)
+{
+    printf("\n==== Test 1: Hook ====\n");
+
+    memset(hook_counts, 0, sizeof(hook_counts));
+    bplib_trace_hook(count_event, NULL);
+    round_trip(sender, receiver, 500);
+    bplib_trace_hook(NULL, NULL);
+
+    /* Each Stage Reported */
+    ut_check(hook_counts[BP_TRACE_STORE] == 1);
+    ut_check(hook_counts[BP_TRACE_LOAD] == 2);
+    ut_check(hook_counts[BP_TRACE_PROCESS] == 2);
+    ut_check(hook_counts[BP_TRACE_PROCESS_DECODE] == 2);
+    ut_check(hook_counts[BP_TRACE_PROCESS_CUSTODY] == 1);
+    ut_check(hook_counts[BP_TRACE_PROCESS_ACKNOWLEDGE] == 1);
+    ut_check(hook_counts[BP_TRACE_ACCEPT] == 1);
+    ut_check(hook_counts[BP_TRACE_ENQUEUE_PAYLOAD] == 1);
+    ut_check(hook_counts[BP_TRACE_ENQUEUE_BUNDLE] >= 2); /* data bundle and custody signal */
+    ut_check(hook_counts[BP_TRACE_LOAD_LOCK] == 2);
+    ut_check(hook_counts[BP_TRACE_LOAD_DEQUEUE] >= 1);
+    ut_check(hook_counts[BP_TRACE_BIB_UPDATE] >= 1);
+    ut_check(hook_counts[BP_TRACE_BIB_VERIFY] >= 1);
+    ut_check(hook_counts[BP_TRACE_ACKNOWLEDGED] == 1);
+
+    /* Events Carry Channel, Custody ID and Size */
+    ut_check(hook_events[BP_TRACE_STORE].channel == sender->channel);
+    ut_check(hook_events[BP_TRACE_STORE].size == 500);
+    ut_check(hook_events[BP_TRACE_STORE].cid == BP_TRACE_NO_CID);
+    ut_check(hook_events[BP_TRACE_PROCESS_CUSTODY].channel == receiver->channel);
+    ut_check(hook_events[BP_TRACE_PROCESS_CUSTODY].cid == 0);
+    ut_check(hook_events[BP_TRACE_ACKNOWLEDGED].channel == sender->channel);
+    ut_check(hook_events[BP_TRACE_ACKNOWLEDGED].cid == 0);
+    ut_check(hook_events[BP_TRACE_ACKNOWLEDGED].size == 1);
+    ut_check(hook_events[BP_TRACE_ACCEPT].size == 500);
+    ut_check(hook_events[BP_TRACE_ACCEPT].status == BP_SUCCESS);
+    ut_check(hook_events[BP_TRACE_LOAD].timestamp >= hook_events[BP_TRACE_LOAD].duration);
+
+    /* Nothing Reported once Removed */
+    memset(hook_counts, 0, sizeof(hook_counts));
+    round_trip(sender, receiver, 500);
+    ut_check(hook_counts[BP_TRACE_STORE] == 0);
+}
+
+/*--------------------------------------------------------------------------------------
+ * Test #2 - Recorder
+ *-------------------------------------------------------------------------------------*/
+static void test_2(bp_desc_t* sender, bp_desc_t* receiver)
+{
+    static bp_trace_event_t events[RECORDER_SIZE * 2];
+    size_t memused = bplib_os_memused();
+    int count, i;
+
+    printf("\n==== Test 2: Recorder ====\n");
+
+    ut_check(bplib_trace_start(0) == BP_ERROR);
+    ut_check(bplib_trace_start(RECORDER_SIZE) == BP_SUCCESS);
+    ut_check(bplib_trace_start(RECORDER_SIZE) == BP_ERROR);
+
+    /* Timeline of One Bundle - custody id 2 after the two bundles of test 1 */
+    round_trip(sender, receiver, 100);
+    count = bplib_trace_timeline(sender->channel, 2, events, RECORDER_SIZE * 2);
+    ut_assert(count == 2, "Timeline has %d events\n", count); /* load and acknowledged */
+    ut_check(events[0].point == BP_TRACE_LOAD);
+    ut_check(events[1].point == BP_TRACE_ACKNOWLEDGED);
+    ut_check(events[1].timestamp >= events[0].timestamp);
+    count = bplib_trace_timeline(receiver->channel, 2, events, RECORDER_SIZE * 2);
+    ut_check(count == 2); /* process_custody and process */
+
+    /* Oldest Events Overwritten */
+    for(i = 0; i < NUM_BUNDLES; i++) round_trip(sender, receiver, 100);
+    count = bplib_trace_read(events, RECORDER_SIZE * 2);
+    ut_assert(count == 128, "Read %d events\n", count);
+    for(i = 1; i < count; i++) ut_check(events[i].timestamp >= events[i - 1].timestamp);
+    ut_check(events[count - 1].point == BP_TRACE_PROCESS);
+    ut_check(events[count - 1].channel == sender->channel);
+    ut_check(bplib_trace_read(events, 10) == 10);
+
+    /* Dump Grouped by Bundle */
+    FILE* stream = tmpfile();
+    if(ut_assert(stream != NULL, "Failed to open temporary file\n"))
+    {
+        char line[256];
+        int headers = 0;
+        ut_check(bplib_trace_dump(stream) == BP_SUCCESS);
+        rewind(stream);
+        while(fgets(line, sizeof(line), stream))
+        {
+            if(strstr(line, "custody id") != NULL) headers++;
+        }
+        fclose(stream);
+        ut_check(headers > 1);
+    }
+
+    bplib_trace_stop();
+    ut_check(bplib_trace_read(events, RECORDER_SIZE) == 0);
+    ut_assert(bplib_os_memused() == memused, "Failed to free memory of recorder: %ld\n", (long)(bplib_os_memused() - memused));
+}
+
+#endif
+
+/******************************************************************************
+ EXPORTED FUNCTIONS
+ ******************************************************************************/
+
+int ut_trace (void)
+{
+    ut_reset();
+
+    #ifdef BP_TRACE
+    bp_route_t sender_route = { 4, 3, 72, 43, 0, 0 };
+    bp_route_t receiver_route = { 72, 43, 4, 3, 0, 0 };
+    bp_attr_t attr;
+
+    bplib_store_ram_init();
+    bplib_os_vclock_start(VIRTUAL_START, 1);
+    bplib_attrinit(&attr);
+    attr.integrity_check = true;
+    bp_desc_t* sender = bplib_open(sender_route, ram_store, attr);
+    bp_desc_t* receiver = bplib_open(receiver_route, ram_store, attr);
+    if(ut_assert(sender != NULL && receiver != NULL, "Failed to open channels\n"))
+    {
+        test_1(sender, receiver);
+        test_2(sender, receiver);
+    }
+    if(sender) bplib_close(sender);
+    if(receiver) bplib_close(receiver);
+    bplib_os_vclock_stop();
+    #else
+    printf("\nLibrary built without BP_TRACE\n");
+    ut_check(bplib_trace_start(RECORDER_SIZE) == BP_ERROR);
+    #endif
+
+    return ut_failures();
+}
@@ -35,14 +35,14 @@
  *  rec - buffer containing the ACS record [OUTPUT]
  *  size - size of buffer [INPUT]
  *  max_fills_per_dacs - the maximum number of allowable fills for each dacs
- *  tree - a rb_tree ptr containing the cid ranges for the bundle. The tree nodes will 
+ *  tree - a custody tree containing the cid ranges for the bundle. The ranges will
  *      be deleted as they are written to the dacs. [OUTPUT]
  *  iter - a ptr to a ptr the next rb_node in the tree to extract the fill information
  *      and then delete. [OUTPUT]
  * 
  *  Returns:    Number of bytes processed of bundle
  *-------------------------------------------------------------------------------------*/
-int dacs_write(uint8_t* rec, int size, int max_fills_per_dacs, rb_tree_t* tree, uint32_t* flags)
+int dacs_write(uint8_t* rec, int size, int max_fills_per_dacs, bp_custody_tree_t* tree, uint32_t* flags)
 {
     bp_field_t cid = { 0, 2, 0 };
     bp_field_t fill = { 0, 0, 0 };
@@ -59,8 +59,8 @@ int dacs_write(uint8_t* rec, int size, int max_fills_per_dacs, rb_tree_t* tree,
     rb_range_t range;
     rb_range_t prev_range;
 
-    /* Get the first available range from the rb tree and fill it. */
-    rb_tree_get_next(tree, &range, true, false);
+    /* Get the first available range from the custody tree and fill it. */
+    tree->get_next(tree->tree, &range, true, false);
     cid.value = range.value;
     fill.index = sdnv_write(rec, size, cid, &sdnvflags);
     fill.value = range.offset + 1;
@@ -68,10 +68,10 @@ int dacs_write(uint8_t* rec, int size, int max_fills_per_dacs, rb_tree_t* tree,
     count_fills += 2;
 
     /* Traverse tree in order and write out fills to dacs. */
-    while (count_fills < max_fills_per_dacs && !rb_tree_is_empty(tree))
+    while (count_fills < max_fills_per_dacs && !tree->is_empty(tree->tree))
     {
         prev_range = range;
-        rb_tree_get_next(tree, &range, true, false);        
+        tree->get_next(tree->tree, &range, true, false);        
 
         /* Write range of missing cid.
            Calculate the missing values between the current and previous node. */
@@ -97,10 +97,14 @@ int dacs_write(uint8_t* rec, int size, int max_fills_per_dacs, rb_tree_t* tree,
 
 /*--------------------------------------------------------------------------------------
  * dacs_read -
+ *
+ *  Notes:  Custody IDs reported missing between acknowledged fills are passed to the
+ *          missing call-back once at least tolerance higher custody IDs have been
+ *          acknowledged in the same signal (a negative tolerance or NULL call-back
+ *          ignores them, leaving the bundles to time out)
  *-------------------------------------------------------------------------------------*/
-int dacs_read(uint8_t* rec, int rec_size, int* num_acks, bp_delete_func_t ack, void* ack_parm, uint32_t* flags)
+int dacs_read(uint8_t* rec, int rec_size, int* num_acks, int tolerance, bp_delete_func_t ack, bp_missing_func_t missing, void* ack_parm, uint32_t* flags)
 {
-    bp_val_t i;
     bp_field_t cid = { 0, 2, 0 };
     bp_field_t fill = { 0, 0, 0 };
     int cidin = true;
@@ -109,6 +113,7 @@ int dacs_read(uint8_t* rec, int rec_size, int* num_acks, bp_delete_func_t ack, v
     int ack_count = 0;
     uint32_t sdnvflags = 0;
     int ret_status = BP_SUCCESS;
+    bp_val_t last_acked = 0;
 
     /* Read First Custody ID */
     fill.index = sdnv_read(rec, rec_size, &cid, &sdnvflags);
@@ -118,6 +123,22 @@ int dacs_read(uint8_t* rec, int rec_size, int* num_acks, bp_delete_func_t ack, v
         return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed to read first custody ID (%08X)\n", sdnvflags);
     }
 
+    /* Find Last Acknowledged Custody ID (parse errors are reported below) */
+    if(missing && ack_success && tolerance >= 0)
+    {
+        bp_field_t scan = { 0, fill.index, 0 };
+        bp_val_t scan_cid = cid.value;
+        bool scanin = true;
+        while((int)scan.index < rec_size && sdnvflags == 0)
+        {
+            scan.index = sdnv_read(rec, rec_size, &scan, &sdnvflags);
+            if(scanin && scan.value > 0) last_acked = scan_cid + scan.value - 1;
+            scan_cid += scan.value;
+            scanin = !scanin;
+        }
+        sdnvflags = 0;
+    }
+
     /* Process Fills */
     while((int)fill.index < rec_size)
     {
@@ -132,24 +153,39 @@ int dacs_read(uint8_t* rec, int rec_size, int* num_acks, bp_delete_func_t ack, v
         /* Process Custody IDs */
         if(cidin == true && ack_success)
         {
-            /* Free Bundles */
+            /* Free Bundles (acknowledge range of CIDs in fill) */
             cidin = false;
-            for(i = 0; i < fill.value; i++)
-            {
-                /* Acknowledge Bundle CID */
-                int status = ack(ack_parm, cid.value + i, flags);
-                if(status == BP_SUCCESS) ack_count++;
+            int num_deleted = 0;
+            int status = ack(ack_parm, cid.value, fill.value, &num_deleted, flags);
+            ack_count += num_deleted;
 
-                /* Set Return Status */
-                if(status != BP_SUCCESS && ret_status != BP_SUCCESS)
-                {
-                    /* Save Off First Failure */
-                    ret_status = status;
-                }
+            /* Set Return Status */
+            if(status != BP_SUCCESS && ret_status == BP_SUCCESS)
+            {
+                /* Save Off First Failure */
+                ret_status = status;
             }
         }
         else
         {
+            /* Report Missing Bundles (past reordering tolerance) */
+            if(missing && ack_success && tolerance >= 0 && last_acked >= cid.value + (bp_val_t)tolerance)
+            {
+                bp_val_t count = last_acked - (bp_val_t)tolerance - cid.value + 1;
+                if(count > fill.value) count = fill.value;
+                if(count > 0)
+                {
+                    int status = missing(ack_parm, cid.value, count, flags);
+
+                    /* Set Return Status */
+                    if(status != BP_SUCCESS && ret_status == BP_SUCCESS)
+                    {
+                        /* Save Off First Failure */
+                        ret_status = status;
+                    }
+                }
+            }
+
             /* Skip Bundles */
             cidin = true;
         }
@@ -164,4 +200,4 @@ int dacs_read(uint8_t* rec, int rec_size, int* num_acks, bp_delete_func_t ack, v
     /* Return Bytes Read or Error Code */
     if(ret_status == BP_SUCCESS)    return fill.index;
     else                            return ret_status;
-}
\ No newline at end of file
+}
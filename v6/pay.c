@@ -101,9 +101,6 @@ int pay_write (void* block, int size, bp_blk_pay_t* pay, bool update_indices, ui
     pay->bf.value |= BP_BLK_REPALL_MASK;
     pay->bf.value |= BP_BLK_LASTBLOCK_MASK;
 
-    /* Set Block Length */
-    if(pay->payptr) pay->blklen.value = pay->paysize;
-
     /* Write Block */
     buffer[0] = BP_PAY_BLK_TYPE;
     if(!update_indices)
@@ -213,7 +213,7 @@ int pri_write (void* block, int size, bp_blk_pri_t* pri, bool update_indices, ui
         sdnv_write(buffer, size, pri->lifetime,   &sdnvflags);
 
         /* Handle Optional Fragmentation Fields */
-        if(pri->allow_frag)
+        if(pri->is_frag)
         {
             sdnv_write(buffer, size, pri->dictlen,    &sdnvflags);
             sdnv_write(buffer, size, pri->fragoffset, &sdnvflags);
@@ -27,13 +27,12 @@
 #include "cteb.h"
 #include "dacs.h"
 #include "sdnv.h"
+#include "trace.h"
 
 /******************************************************************************
  DEFINES
  ******************************************************************************/
 
-#define BP_NUM_EXCLUDE_REGIONS 16
-
 /******************************************************************************
  TYPEDEFS
  ******************************************************************************/
@@ -43,6 +42,8 @@ typedef struct {
     bp_blk_cteb_t       custody_block;
     bp_blk_bib_t        integrity_block;
     bp_blk_pay_t        payload_block;
+    bool                integrity_valid;    /* integrity block already holds the result for the entire payload */
+    bp_val_t            createseq;          /* next creation sequence of library provided bundles, kept across rebuilds */
 } bp_v6blocks_t;
 
 /******************************************************************************
@@ -119,12 +120,70 @@ static const bp_blk_pay_t bundle_pay_blk = {
  LOCAL FUNCTIONS
  ******************************************************************************/
 
+/*--------------------------------------------------------------------------------------
+ * v6_copy_blocks -
+ *
+ *  Copies the extension blocks of a received bundle that are forwarded as is; the
+ *  CTEB and BIB are rebuilt by this node, and blocks flagged to be dropped when not
+ *  processed are left out.
+ *
+ *  Returns:    number of bytes copied, or error code
+ *-------------------------------------------------------------------------------------*/
+BP_LOCAL_SCOPE int v6_copy_blocks(uint8_t* dst, int dst_size, uint8_t* src, int src_size, uint32_t* flags)
+{
+    int src_index = 0;
+    int dst_index = 0;
+
+    while(src_index < src_size)
+    {
+        uint8_t blk_type = src[src_index];
+        bp_field_t blk_flags = { 0, 1, 0 };
+        bp_field_t blk_len = { 0, 0, 0 };
+        uint32_t sdnvflags = 0;
+
+        /* Read Block Length */
+        blk_len.index = sdnv_read(&src[src_index], src_size - src_index, &blk_flags, &sdnvflags);
+        int data_index = sdnv_read(&src[src_index], src_size - src_index, &blk_len, &sdnvflags);
+        if(sdnvflags != 0 || blk_len.value > (bp_val_t)(src_size - src_index - data_index))
+        {
+            return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed to parse forwarded block at index %d\n", src_index);
+        }
+        int blk_size = data_index + (int)blk_len.value;
+
+        /* Copy Block */
+        if(blk_type != BP_CTEB_BLK_TYPE && blk_type != BP_BIB_BLK_TYPE && !(blk_flags.value & BP_BLK_DROPNOPROC_MASK))
+        {
+            if(dst_index + blk_size > dst_size)
+            {
+                return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Forwarded blocks exceed header buffer (%d)\n", dst_size);
+            }
+            memcpy(&dst[dst_index], &src[src_index], blk_size);
+            dst_index += blk_size;
+        }
+
+        src_index += blk_size;
+    }
+
+    return dst_index;
+}
+
 /*--------------------------------------------------------------------------------------
  * v6_build -
  *
  *  This builds the bundle
+ *
+ *  bib - verified integrity block of a received bundle being forwarded; if its
+ *        cipher suite matches the channel's, the security result is carried over
+ *        instead of being recalculated when the bundle is sent [INPUT]
+ *  hdr_buf - extension blocks of a received bundle being forwarded [INPUT]
+ *  hdr_len - size of the extension blocks [INPUT]
+ *
+ *  Headers are built in the bundle's inline header buffer; if the extension blocks
+ *  of a forwarded bundle do not fit, the header is moved to an extended buffer
+ *  allocated to the size needed.  Both buffers reserve room ahead of the header
+ *  for the storage record prefix.
  *-------------------------------------------------------------------------------------*/
-int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_len, uint32_t* flags)
+int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, bp_blk_bib_t* bib, uint8_t* hdr_buf, int hdr_len, uint32_t* flags)
 {
     int bytes_written;
     int hdr_index;
@@ -132,15 +191,39 @@ int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_l
     bp_bundle_data_t* data = &bundle->data;
     bp_v6blocks_t* blocks = (bp_v6blocks_t*)bundle->blocks;
 
-    /* Initialize Data Storage Memory */
+    /* Initialize Data Storage Memory (starting with inline header buffer) */
     hdr_index = 0;
     memset(data, 0, sizeof(bp_bundle_data_t));
+    data->header = &bundle->hdrbuf[BP_RECORD_PREFIX_BUF_SIZE];
+    bundle->hdrbufsize = BP_BUNDLE_HDR_BUF_SIZE;
+    blocks->integrity_valid = false;
 
     /* Initialize Primary Block */
     if(pri)
     {
-        /* User Provided Primary Block */
-        blocks->primary_block = *pri;
+        /* User Provided Primary Block (values re-encoded in library field layout,
+         * since fields read from a received bundle only have their minimal width) */
+        blocks->primary_block                   = bundle_pri_blk;
+        blocks->primary_block.dstnode.value     = pri->dstnode.value;
+        blocks->primary_block.dstserv.value     = pri->dstserv.value;
+        blocks->primary_block.srcnode.value     = pri->srcnode.value;
+        blocks->primary_block.srcserv.value     = pri->srcserv.value;
+        blocks->primary_block.rptnode.value     = pri->rptnode.value;
+        blocks->primary_block.rptserv.value     = pri->rptserv.value;
+        blocks->primary_block.cstnode.value     = pri->cstnode.value;
+        blocks->primary_block.cstserv.value     = pri->cstserv.value;
+        blocks->primary_block.createsec.value   = pri->createsec.value;
+        blocks->primary_block.createseq.value   = pri->createseq.value;
+        blocks->primary_block.lifetime.value    = pri->lifetime.value;
+        blocks->primary_block.dictlen.value     = pri->dictlen.value;
+        blocks->primary_block.fragoffset.value  = pri->fragoffset.value;
+        blocks->primary_block.paylen.value      = pri->paylen.value;
+        blocks->primary_block.is_admin_rec      = pri->is_admin_rec;
+        blocks->primary_block.is_frag           = pri->is_frag;
+        blocks->primary_block.allow_frag        = pri->allow_frag;
+        blocks->primary_block.cst_rqst          = pri->cst_rqst;
+        blocks->primary_block.ack_app           = pri->ack_app;
+        blocks->primary_block.cos               = pri->cos;
 
         /* Set Pre-Built Flag to FALSE */
         bundle->prebuilt = false;
@@ -165,6 +248,7 @@ int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_l
             blocks->primary_block.cstnode.value = 0;
             blocks->primary_block.cstserv.value = 0;
         }
+        blocks->primary_block.createseq.value   = blocks->createseq;
         blocks->primary_block.lifetime.value    = bundle->attributes.lifetime;
         blocks->primary_block.is_admin_rec      = bundle->attributes.admin_record;
         blocks->primary_block.allow_frag        = bundle->attributes.allow_fragmentation;
@@ -183,7 +267,7 @@ int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_l
     }
 
     /* Write Primary Block */
-    bytes_written = pri_write(data->header, BP_BUNDLE_HDR_BUF_SIZE, &blocks->primary_block, false, flags);
+    bytes_written = pri_write(data->header, bundle->hdrbufsize, &blocks->primary_block, false, flags);
     if(bytes_written < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to write primary block of bundle\n", bytes_written);
     hdr_index += bytes_written;
 
@@ -198,7 +282,7 @@ int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_l
         /* Populate Data with Block */
         data->cidfield = blocks->custody_block.cid;
         data->cteboffset = hdr_index;
-        bytes_written = cteb_write(&data->header[hdr_index], BP_BUNDLE_HDR_BUF_SIZE - hdr_index, &blocks->custody_block, false, flags);
+        bytes_written = cteb_write(&data->header[hdr_index], bundle->hdrbufsize - hdr_index, &blocks->custody_block, false, flags);
 
         /* Check Status */
         if(bytes_written < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to write custody block of bundle\n", bytes_written);
@@ -216,9 +300,16 @@ int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_l
         blocks->integrity_block = bundle_bib_blk;
         blocks->integrity_block.cipher_suite_id.value = bundle->attributes.cipher_suite;
 
+        /* Carry Over Verified Result of Forwarded Bundle */
+        if(bib && bib->cipher_suite_id.value == blocks->integrity_block.cipher_suite_id.value)
+        {
+            blocks->integrity_block.security_result_data = bib->security_result_data;
+            blocks->integrity_valid = true;
+        }
+
         /* Populate Data */
         data->biboffset = hdr_index;
-        bytes_written = bib_write(&data->header[hdr_index], BP_BUNDLE_HDR_BUF_SIZE - hdr_index, &blocks->integrity_block, false, flags);
+        bytes_written = bib_write(&data->header[hdr_index], bundle->hdrbufsize - hdr_index, &blocks->integrity_block, false, flags);
 
         /* Check Status */
         if(bytes_written < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to write integrity block of bundle\n", bytes_written);
@@ -229,15 +320,30 @@ int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_l
         data->biboffset = 0;
     }
 
-    /* Copy Non-excluded Header Regions */
-    if(hdr_index + hdr_len < BP_BUNDLE_HDR_BUF_SIZE)
+    /* Move to Extended Data if Forwarded Blocks do not Fit (with room for fragment fields) */
+    int hdr_needed = hdr_index + hdr_len + bundle_pay_blk.blklen.index + bundle_pay_blk.blklen.width;
+    if(!blocks->primary_block.is_frag) hdr_needed += BP_PRI_FRAG_FIELDS_SIZE;
+    if(hdr_needed > bundle->hdrbufsize)
     {
-        memcpy(&data->header[hdr_index], hdr_buf, hdr_len);
-        hdr_index += hdr_len;
+        if(bundle->ext_hdrbufsize < hdr_needed)
+        {
+            if(bundle->ext_hdrbuf) bplib_os_free(bundle->ext_hdrbuf);
+            bundle->ext_hdrbuf = (uint8_t*)bplib_os_calloc_tag(BP_RECORD_PREFIX_BUF_SIZE + hdr_needed, BP_MEM_CODEC);
+            bundle->ext_hdrbufsize = bundle->ext_hdrbuf ? hdr_needed : 0;
+            if(bundle->ext_hdrbuf == NULL) return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Failed to allocate header of size %d\n", hdr_needed);
+        }
+
+        memcpy(&bundle->ext_hdrbuf[BP_RECORD_PREFIX_BUF_SIZE], data->header, hdr_index);
+        data->header = &bundle->ext_hdrbuf[BP_RECORD_PREFIX_BUF_SIZE];
+        bundle->hdrbufsize = bundle->ext_hdrbufsize;
     }
-    else
+
+    /* Copy Forwarded Extension Blocks */
+    if(hdr_len > 0)
     {
-        return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Non-excluded forwarded bundle exceed maximum header size (%d)\n", hdr_index);
+        bytes_written = v6_copy_blocks(&data->header[hdr_index], bundle->hdrbufsize - hdr_index, hdr_buf, hdr_len, flags);
+        if(bytes_written < 0) return bytes_written;
+        hdr_index += bytes_written;
     }
 
     /* Initialize Payload Block */
@@ -250,6 +356,52 @@ int v6_build(bp_bundle_t* bundle, bp_blk_pri_t* pri, uint8_t* hdr_buf, int hdr_l
     return BP_SUCCESS;
 }
 
+/*--------------------------------------------------------------------------------------
+ * v6_set_fragment -
+ *
+ *  header - bundle header, primary block through the blocks ahead of the payload block [INPUT/OUTPUT]
+ *  size - size of memory holding header [INPUT]
+ *  data - offsets of the blocks in the header, moved along with the blocks [INPUT/OUTPUT]
+ *  pri - primary block of the header, in library field layout [INPUT/OUTPUT]
+ *  is_frag - whether the primary block should carry the fragment fields [INPUT]
+ *
+ *  Returns:    BP_SUCCESS or error code
+ *
+ *  Notes:  Bundles are built without the fragment offset and payload length fields,
+ *          so they are inserted (and the blocks after the primary block moved) only
+ *          when a bundle is actually split.
+ *-------------------------------------------------------------------------------------*/
+static int v6_set_fragment(uint8_t* header, int size, bp_bundle_data_t* data, bp_blk_pri_t* pri, bool is_frag, uint32_t* flags)
+{
+    if(pri->is_frag == is_frag) return BP_SUCCESS;
+
+    /* Calculate Move */
+    int pri_size = pri->dictlen.index + pri->dictlen.width;
+    int shift = is_frag ? BP_PRI_FRAG_FIELDS_SIZE : -BP_PRI_FRAG_FIELDS_SIZE;
+    int blocks_start = is_frag ? pri_size : pri_size + BP_PRI_FRAG_FIELDS_SIZE;
+    if(data->payoffset + shift > size)
+    {
+        return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Fragment header does not fit in %d bytes\n", size);
+    }
+
+    /* Move Blocks Following Primary Block */
+    memmove(&header[blocks_start + shift], &header[blocks_start], data->payoffset - blocks_start);
+    if(data->cteboffset != 0) data->cteboffset += shift;
+    if(data->biboffset != 0) data->biboffset += shift;
+    data->payoffset += shift;
+
+    /* Rewrite Primary Block */
+    pri->is_frag = is_frag;
+    pri->fragoffset.index = pri_size;
+    pri->fragoffset.width = bundle_pri_blk.fragoffset.width;
+    pri->paylen.index = pri->fragoffset.index + pri->fragoffset.width;
+    pri->paylen.width = bundle_pri_blk.paylen.width;
+    int bytes_written = pri_write(header, size, pri, false, flags);
+    if(bytes_written < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to write primary block of fragment\n", bytes_written);
+
+    return BP_SUCCESS;
+}
+
 /******************************************************************************
  EXPORTED FUNCTIONS
  ******************************************************************************/
@@ -286,8 +438,15 @@ int v6_create(bp_bundle_t* bundle, bp_route_t route, bp_attr_t attributes)
     /* Initialize Blocks */
     bundle->blocks = NULL;
 
+    /* Initialize Data */
+    memset(&bundle->data, 0, sizeof(bp_bundle_data_t));
+    bundle->data.header = &bundle->hdrbuf[BP_RECORD_PREFIX_BUF_SIZE];
+    bundle->hdrbufsize = BP_BUNDLE_HDR_BUF_SIZE;
+    bundle->ext_hdrbuf = NULL;
+    bundle->ext_hdrbufsize = 0;
+
     /* Allocate Blocks */
-    bundle->blocks = (bp_v6blocks_t*)bplib_os_calloc(sizeof(bp_v6blocks_t));
+    bundle->blocks = (bp_v6blocks_t*)bplib_os_calloc_tag(sizeof(bp_v6blocks_t), BP_MEM_CODEC);
     if(bundle->blocks == NULL)
     {
         status = BP_ERROR;
@@ -308,7 +467,10 @@ int v6_create(bp_bundle_t* bundle, bp_route_t route, bp_attr_t attributes)
 int v6_destroy(bp_bundle_t* bundle)
 {
     if(bundle->blocks) bplib_os_free(bundle->blocks);
+    if(bundle->ext_hdrbuf) bplib_os_free(bundle->ext_hdrbuf);
     bundle->blocks = NULL;
+    bundle->ext_hdrbuf = NULL;
+    bundle->ext_hdrbufsize = 0;
     return BP_SUCCESS;
 }
 
@@ -319,7 +481,7 @@ int v6_destroy(bp_bundle_t* bundle)
  *-------------------------------------------------------------------------------------*/
 int v6_populate_bundle(bp_bundle_t* bundle, uint32_t* flags)
 {
-    return v6_build(bundle, NULL, NULL, 0, flags);
+    return v6_build(bundle, NULL, NULL, NULL, 0, flags);
 }
 
 /*--------------------------------------------------------------------------------------
@@ -338,23 +500,44 @@ int v6_send_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_create_fun
     pay->payptr = buffer;
     pay->paysize = size;
 
+    /* Establish Fragment Position in Original Payload */
+    bp_val_t adu_offset = 0;
+    bp_val_t adu_length = pay->paysize;
+    if(!bundle->prebuilt && pri->is_frag)
+    {
+        adu_offset = pri->fragoffset.value;
+        adu_length = pri->paylen.value;
+    }
+
     /* Check Fragmentation */
-    int max_paysize = bundle->attributes.max_length - data->headersize;
-    if(pay->paysize > max_paysize)
+    int pay_hdrsize = pay->blklen.index + pay->blklen.width;
+    int max_paysize = bundle->attributes.max_length - (data->payoffset + pay_hdrsize);
+    bool add_frag = false;
+    if(max_paysize <= 0)
     {
-        if(bundle->attributes.allow_fragmentation)
+        return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Bundle header blocks exceed maximum size of bundle (%d > %d)\n", data->payoffset + pay_hdrsize, bundle->attributes.max_length);
+    }
+    else if(pay->paysize > max_paysize)
+    {
+        if(!bundle->attributes.allow_fragmentation || !pri->allow_frag)
         {
-            pri->is_frag = true;
+            return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Unable to fragment forwarded bundle (%d > %d)\n", pay->paysize, max_paysize);
         }
-        else
+        else if(!pri->is_frag)
         {
-            return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Unable to fragment forwarded bundle (%d > %d)\n", pay->paysize, max_paysize);
+            /* Add Fragment Fields to Header for the Fragments of this Payload */
+            max_paysize -= BP_PRI_FRAG_FIELDS_SIZE;
+            if(max_paysize <= 0)
+            {
+                return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Fragment header blocks exceed maximum size of bundle (%d > %d)\n", data->payoffset + pay_hdrsize + BP_PRI_FRAG_FIELDS_SIZE, bundle->attributes.max_length);
+            }
+            else if(v6_set_fragment(data->header, bundle->hdrbufsize, data, pri, true, flags) != BP_SUCCESS)
+            {
+                return BP_ERROR;
+            }
+            add_frag = true;
         }
     }
-    else if(max_paysize <= 0)
-    {
-        return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Bundle header blocks exceed maximum size of bundle (%d > %d)\n", data->headersize, bundle->attributes.max_length);
-    }
 
     /* Check if Time Needs to be Set  */
     bp_field_t lifetime = pri->lifetime;
@@ -373,15 +556,15 @@ int v6_send_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_create_fun
             sysnow = 0;
 
             /* Jam Lifetime */
-            sdnv_write(data->header, BP_BUNDLE_HDR_BUF_SIZE, lifetime, flags);
+            sdnv_write(data->header, bundle->hdrbufsize, lifetime, flags);
         }
 
         /* Set Creation Time */
         pri->createsec.value = (bp_val_t)sysnow;
-        sdnv_write(data->header, BP_BUNDLE_HDR_BUF_SIZE, pri->createsec, flags);
+        sdnv_write(data->header, bundle->hdrbufsize, pri->createsec, flags);
 
         /* Set Sequence */
-        sdnv_write(data->header, BP_BUNDLE_HDR_BUF_SIZE, pri->createseq, flags);
+        sdnv_write(data->header, bundle->hdrbufsize, pri->createseq, flags);
     }
 
     /* Set Expiration Time of Bundle */
@@ -414,22 +597,28 @@ int v6_send_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_create_fun
         /* Update Primary Block Fragmentation */
         if(pri->is_frag)
         {
-            pri->fragoffset.value = payload_offset;
-            pri->paylen.value = pay->paysize;
-            sdnv_write(data->header, BP_BUNDLE_HDR_BUF_SIZE, pri->fragoffset, flags);
-            sdnv_write(data->header, BP_BUNDLE_HDR_BUF_SIZE, pri->paylen, flags);
+            pri->fragoffset.value = adu_offset + payload_offset;
+            pri->paylen.value = adu_length;
+            sdnv_write(data->header, bundle->hdrbufsize, pri->fragoffset, flags);
+            sdnv_write(data->header, bundle->hdrbufsize, pri->paylen, flags);
         }
 
-        /* Update Integrity Block */
-        if(data->biboffset != 0)
+        /* Update Integrity Block (unless carried over for the entire payload) */
+        if(data->biboffset != 0 && !(blocks->integrity_valid && fragment_size == pay->paysize))
         {
-            bib_update(&data->header[data->biboffset], BP_BUNDLE_HDR_BUF_SIZE - data->biboffset, &pay->payptr[payload_offset], fragment_size, bib, flags);
+            BP_TRACE_BEGIN(trace_start);
+            bib_update(&data->header[data->biboffset], bundle->hdrbufsize - data->biboffset, &pay->payptr[payload_offset], fragment_size, bib, flags);
+            BP_TRACE_END(trace_start, BP_TRACE_BIB_UPDATE, NULL, BP_TRACE_NO_CID, fragment_size, BP_SUCCESS);
         }
 
         /* Write Payload Block (static portion) */
         pay->blklen.value = fragment_size;
-        int bytes_written = pay_write(&data->header[data->payoffset], BP_BUNDLE_HDR_BUF_SIZE - data->payoffset, pay, false, flags);
-        if(bytes_written < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to write payload block (static portion) of bundle\n", bytes_written);
+        int bytes_written = pay_write(&data->header[data->payoffset], bundle->hdrbufsize - data->payoffset, pay, false, flags);
+        if(bytes_written < 0)
+        {
+            if(add_frag) v6_set_fragment(data->header, bundle->hdrbufsize, data, pri, false, flags);
+            return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to write payload block (static portion) of bundle\n", bytes_written);
+        }
         data->headersize = data->payoffset + bytes_written;
         data->bundlesize = data->headersize + fragment_size;
 
@@ -437,23 +626,112 @@ int v6_send_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_create_fun
         int status = create(parm, pri->is_admin_rec, &pay->payptr[payload_offset], fragment_size, timeout);
         if(status != BP_SUCCESS)
         {
+            if(add_frag) v6_set_fragment(data->header, bundle->hdrbufsize, data, pri, false, flags);
             return bplog(flags, BP_FLAG_STORE_FAILURE, "Failed (%d) to store bundle in storage system\n", status);
         }
 
         payload_offset += fragment_size;
     }
 
+    /* Remove Fragment Fields from Header for the Next Payload */
+    if(add_frag) v6_set_fragment(data->header, bundle->hdrbufsize, data, pri, false, flags);
+
     /* Increment Sequence Count (done here since now bundle successfully stored) */
     if(bundle->prebuilt)
     {
         pri->createseq.value++;
         sdnv_mask(&pri->createseq);
+        blocks->createseq = pri->createseq.value;
     }
 
     /* Return Payload Bytes Stored */
     return BP_SUCCESS;
 }
 
+/*--------------------------------------------------------------------------------------
+ * v6_fragment_bundle -
+ *
+ *  data - stored bundle, header immediately followed by payload [INPUT]
+ *  frag - populated with the header of the fragment, frag->header must hold
+ *         data->headersize + BP_PRI_FRAG_FIELDS_SIZE bytes [OUTPUT]
+ *  max_length - maximum size of the fragment in bytes [INPUT]
+ *  offset - offset into the stored payload where the fragment starts [INPUT]
+ *
+ *  Returns:    number of payload bytes in fragment, or error code
+ *
+ *  Notes:  The fragment header is built by patching a copy of the stored header,
+ *          adding the fragment fields to the primary block if the stored bundle is
+ *          not already a fragment; the fragment payload is the stored payload
+ *          starting at offset.
+ *-------------------------------------------------------------------------------------*/
+int v6_fragment_bundle(bp_bundle_data_t* data, bp_bundle_data_t* frag, int max_length, int offset, uint32_t* flags)
+{
+    bp_blk_pri_t    pri_blk;
+    bp_blk_bib_t    bib_blk     = bundle_bib_blk;
+    bp_blk_pay_t    pay_blk     = bundle_pay_blk;
+    uint8_t*        payload     = &data->header[data->headersize];
+    int             paysize     = data->bundlesize - data->headersize;
+    int             frag_hdrsize = data->headersize + BP_PRI_FRAG_FIELDS_SIZE;
+
+    /* Check Parameters */
+    if(offset < 0 || offset >= paysize) return bplog(flags, BP_FLAG_API_ERROR, "Invalid fragment offset %d into payload of size %d\n", offset, paysize);
+
+    /* Read Stored Primary Block (stored headers are always in library field layout) */
+    pri_blk = bundle_pri_blk;
+    if(pri_read(data->header, data->payoffset, &pri_blk, false, flags) < 0) return BP_ERROR;
+    if(!pri_blk.allow_frag)
+    {
+        return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Stored bundle of size %d cannot be fragmented\n", data->bundlesize);
+    }
+
+    /* Copy Stored Header (up to payload block) */
+    uint8_t* frag_header = frag->header;
+    *frag = *data;
+    frag->header = frag_header;
+    memcpy(frag->header, data->header, data->payoffset);
+
+    /* Update Primary Block Fragmentation */
+    if(pri_blk.is_frag)
+    {
+        pri_blk.fragoffset.value += offset;
+        sdnv_write(frag->header, frag->payoffset, pri_blk.fragoffset, flags);
+    }
+    else
+    {
+        pri_blk.fragoffset.value = offset;
+        pri_blk.paylen.value = paysize;
+        if(v6_set_fragment(frag->header, frag_hdrsize, frag, &pri_blk, true, flags) != BP_SUCCESS) return BP_ERROR;
+    }
+
+    /* Calculate Fragment Size */
+    int pay_hdrsize = pay_blk.blklen.index + pay_blk.blklen.width;
+    int max_paysize = max_length - (frag->payoffset + pay_hdrsize);
+    if(max_paysize <= 0)
+    {
+        return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Bundle header blocks exceed maximum size of fragment (%d > %d)\n", frag->payoffset + pay_hdrsize, max_length);
+    }
+    int payload_remaining = paysize - offset;
+    int fragment_size = max_paysize < payload_remaining ? max_paysize : payload_remaining;
+
+    /* Update Integrity Block */
+    if(frag->biboffset != 0)
+    {
+        int bib_size = frag->payoffset - frag->biboffset;
+        if(bib_read(&frag->header[frag->biboffset], bib_size, &bib_blk, false, flags) < 0) return BP_ERROR;
+        bib_update(&frag->header[frag->biboffset], bib_size, &payload[offset], fragment_size, &bib_blk, flags);
+    }
+
+    /* Write Payload Block (static portion) */
+    pay_blk.blklen.value = fragment_size;
+    int bytes_written = pay_write(&frag->header[frag->payoffset], frag_hdrsize - frag->payoffset, &pay_blk, false, flags);
+    if(bytes_written < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to write payload block (static portion) of fragment\n", bytes_written);
+    frag->headersize = frag->payoffset + bytes_written;
+    frag->bundlesize = frag->headersize + fragment_size;
+
+    /* Return Fragment Size */
+    return fragment_size;
+}
+
 /*--------------------------------------------------------------------------------------
  * v6_receive_bundle -
  *-------------------------------------------------------------------------------------*/
@@ -464,8 +742,7 @@ int v6_receive_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload
     int                 index = 0;
     int                 bytes_read = 0;
 
-    int                 ei = 0;
-    int                 exclude[BP_NUM_EXCLUDE_REGIONS];
+    int                 ext_index = 0;
 
     bp_blk_pri_t        pri_blk;
 
@@ -481,11 +758,10 @@ int v6_receive_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload
     bp_blk_pay_t        pay_blk;
 
     /* Parse Primary Block */
-    exclude[ei++] = index;
     bytes_read = pri_read(buffer, size, &pri_blk, true, flags);
     if(bytes_read < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed to parse primary block of size %d\n", size);
     else               index += bytes_read;
-    exclude[ei++] = index;
+    ext_index = index;
 
     /* Check Unsupported */
     if(pri_blk.dictlen.value != 0)
@@ -519,27 +795,17 @@ int v6_receive_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload
         /* Read Block Information */
         uint8_t blk_type = buffer[index];
 
-        /* Check for Room in Exclude Region Array */
-        if(ei >= (BP_NUM_EXCLUDE_REGIONS - 2))
-        {
-            return bplog(flags, BP_FLAG_NONCOMPLIANT, "Bundle has too many extension blocks, %d\n", (BP_NUM_EXCLUDE_REGIONS / 2) - 2);
-        }
-
         /* Check Block Type */
         if(blk_type == BP_BIB_BLK_TYPE)
         {
             /* Mark Start of BIB Region */
             bib_present = true;
             bib_index = index;
-            exclude[ei++] = index;
 
             /* Read BIB */
             bytes_read = bib_read(&buffer[bib_index], size - bib_index, &bib_blk, true, flags);
             if(bytes_read < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed to parse BIB block at offset %d\n", bib_index);
             else               index += bytes_read;
-
-            /* Mark End of BIB Region */
-            exclude[ei++] = index;
         }
         else if(blk_type == BP_CTEB_BLK_TYPE)
         {
@@ -584,16 +850,9 @@ int v6_receive_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload
                 status = bplog(flags, BP_FLAG_DROPPED, "Dropping bundle with unrecognized block\n");
             }
 
-            /* Check if Block Should be Included */
-            if(blk_flags.value & BP_BLK_DROPNOPROC_MASK)
-            {
-                /* Exclude Block */
-                exclude[ei++] = start_index;
-                exclude[ei++] = index;
-            }
-            else
+            /* Mark As Forwarded without Processed (unless dropped when forwarded) */
+            if(!(blk_flags.value & BP_BLK_DROPNOPROC_MASK))
             {
-                /* Mark As Forwarded without Processed */
                 blk_flags.value |= BP_BLK_FORWARDNOPROC_MASK;
                 sdnv_write(&buffer[start_index], size - start_index, blk_flags, flags);
             }
@@ -601,11 +860,9 @@ int v6_receive_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload
         else /* payload block */
         {
             pay_index = index;
-            exclude[ei++] = index; /* start of payload header */
             bytes_read = pay_read(&buffer[pay_index], size - pay_index, &pay_blk, true, flags);
             if(bytes_read < 0) return bplog(flags, BP_FLAG_FAILED_TO_PARSE, "Failed (%d) to read payload block\n", status);
             else               index += bytes_read;
-            exclude[ei++] = index + pay_blk.paysize;
 
             /* Set Returned Payload */
             payload->data.exprtime = exprtime;
@@ -613,10 +870,21 @@ int v6_receive_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload
             payload->data.payloadsize = pay_blk.paysize;
             payload->memptr = pay_blk.payptr;
 
+            /* Set Fragment Identification */
+            payload->is_frag = pri_blk.is_frag;
+            payload->fragoffset = pri_blk.is_frag ? pri_blk.fragoffset.value : 0;
+            payload->paylen = pri_blk.is_frag ? pri_blk.paylen.value : (bp_val_t)pay_blk.paysize;
+            payload->srcnode = pri_blk.srcnode.value;
+            payload->srcserv = pri_blk.srcserv.value;
+            payload->createsec = pri_blk.createsec.value;
+            payload->createseq = pri_blk.createseq.value;
+
             /* Perform Integrity Check */
             if(bib_present)
             {
+                BP_TRACE_BEGIN(trace_start);
                 status = bib_verify(pay_blk.payptr, pay_blk.paysize, &bib_blk, flags);
+                BP_TRACE_END(trace_start, BP_TRACE_BIB_VERIFY, NULL, BP_TRACE_NO_CID, pay_blk.paysize, status);
                 if(status != BP_SUCCESS) return status;
             }
 
@@ -638,28 +906,8 @@ int v6_receive_bundle(bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload
                     pri_blk.cstserv.value = bundle->route.local_service;
                 }
 
-                /* Copy Non-excluded Header Regions */
-                uint8_t hdr_buf[BP_BUNDLE_HDR_BUF_SIZE];
-                int hdr_index = 0;
-                int i;
-                for(i = 1; (i + 1) < ei; i+=2)
-                {
-                    int start_index = exclude[i];
-                    int stop_index = exclude[i + 1];
-                    int bytes_to_copy = stop_index - start_index;
-                    if((hdr_index + bytes_to_copy) >= BP_BUNDLE_HDR_BUF_SIZE)
-                    {
-                        return bplog(flags, BP_FLAG_BUNDLE_TOO_LARGE, "Non-excluded forwarded blocks exceed maximum header size (%d)\n", hdr_index);
-                    }
-                    else
-                    {
-                        memcpy(&hdr_buf[hdr_index], &buffer[start_index], bytes_to_copy);
-                        hdr_index += bytes_to_copy;
-                    }
-                }
-
                 /* Initialize Forwarded Bundle */
-                status = v6_build(bundle, &pri_blk, hdr_buf, hdr_index, flags);
+                status = v6_build(bundle, &pri_blk, bib_present ? &bib_blk : NULL, &buffer[ext_index], pay_index - ext_index, flags);
                 if(status == BP_SUCCESS)
                 {
                     /* Return Bundle for Forwarding */
@@ -752,10 +1000,28 @@ int v6_update_bundle(bp_bundle_data_t* data, bp_val_t cid, uint32_t* flags)
     return sdnv_write(&data->header[data->cteboffset], data->bundlesize - data->cteboffset, data->cidfield, flags);
 }
 
+/*--------------------------------------------------------------------------------------
+ * v6_stamp_bundle -
+ *
+ *  Notes:  Folds the creation time, creation sequence, and fragment offset of a stored
+ *          bundle into one value, so that a stored bundle can be told apart from another
+ *          bundle later stored under the same storage ID
+ *-------------------------------------------------------------------------------------*/
+int v6_stamp_bundle(bp_bundle_data_t* data, bp_val_t* stamp, uint32_t* flags)
+{
+    /* Read Stored Primary Block (stored headers are always in library field layout) */
+    bp_blk_pri_t pri_blk = bundle_pri_blk;
+    if(pri_read(data->header, data->headersize, &pri_blk, false, flags) < 0) return BP_ERROR;
+
+    *stamp = (pri_blk.createsec.value << 16) ^ pri_blk.createseq.value ^ (pri_blk.fragoffset.value * 2654435761UL);
+
+    return BP_SUCCESS;
+}
+
 /*--------------------------------------------------------------------------------------
  * v6_populate_acknowledgment -
  *-------------------------------------------------------------------------------------*/
-int v6_populate_acknowledgment(uint8_t* rec, int size, int max_fills, rb_tree_t* tree, uint32_t* flags)
+int v6_populate_acknowledgment(uint8_t* rec, int size, int max_fills, bp_custody_tree_t* tree, uint32_t* flags)
 {
     return dacs_write(rec, size, max_fills, tree, flags);
 }
@@ -763,9 +1029,9 @@ int v6_populate_acknowledgment(uint8_t* rec, int size, int max_fills, rb_tree_t*
 /*--------------------------------------------------------------------------------------
  * v6_receive_acknowledgment -
  *-------------------------------------------------------------------------------------*/
-int v6_receive_acknowledgment(uint8_t* rec, int size, int* num_acks, bp_delete_func_t remove, void* parm, uint32_t* flags)
+int v6_receive_acknowledgment(uint8_t* rec, int size, int* num_acks, int tolerance, bp_delete_func_t remove, bp_missing_func_t missing, void* parm, uint32_t* flags)
 {
-    return dacs_read(rec, size, num_acks, remove, parm, flags);
+    return dacs_read(rec, size, num_acks, tolerance, remove, missing, parm, flags);
 }
 
 /*--------------------------------------------------------------------------------------
@@ -30,6 +30,7 @@
  ******************************************************************************/
 
 #define BP_PRI_VERSION                  0x06
+#define BP_PRI_FRAG_FIELDS_SIZE         8   /* fragment offset and payload length added to the primary block of a fragment */
 
 /* Block Processing Control Flags */
 #define BP_BLK_REPALL_MASK              0x000001    /* block must be replicated in every fragment */
@@ -82,10 +83,12 @@ int v6_create                   (bp_bundle_t* bundle, bp_route_t route, bp_attr_
 int v6_destroy                  (bp_bundle_t* bundle);
 int v6_populate_bundle          (bp_bundle_t* bundle, uint32_t* flags);
 int v6_send_bundle              (bp_bundle_t* bundle, uint8_t* buffer, int size, bp_create_func_t create, void* parm, int timeout, uint32_t* flags);
+int v6_fragment_bundle          (bp_bundle_data_t* data, bp_bundle_data_t* frag, int max_length, int offset, uint32_t* flags);
 int v6_receive_bundle           (bp_bundle_t* bundle, uint8_t* buffer, int size, bp_payload_t* payload, uint32_t* flags);
 int v6_update_bundle            (bp_bundle_data_t* data, bp_val_t cid, uint32_t* flags);
-int v6_populate_acknowledgment  (uint8_t* rec, int size, int max_fills, rb_tree_t* tree, uint32_t* flags);
-int v6_receive_acknowledgment   (uint8_t* rec, int size, int* num_acks, bp_delete_func_t remove, void* parm, uint32_t* flags);
+int v6_stamp_bundle             (bp_bundle_data_t* data, bp_val_t* stamp, uint32_t* flags);
+int v6_populate_acknowledgment  (uint8_t* rec, int size, int max_fills, bp_custody_tree_t* tree, uint32_t* flags);
+int v6_receive_acknowledgment   (uint8_t* rec, int size, int* num_acks, int tolerance, bp_delete_func_t remove, bp_missing_func_t missing, void* parm, uint32_t* flags);
 int v6_routeinfo                (void* bundle, int size, bp_route_t* route);
 int v6_display                  (void* bundle, int size, uint32_t* flags);
 